@@ -90,7 +90,7 @@ ta3DO* taOpen3DO(taFS* pFS, const char* fileName)
         goto on_error;
     }
 
-    p3DO->pFile = taOpenFile(pFS, fullFileName, 0);
+    p3DO->pFile = taOpenFile(pFS, fullFileName, TA_OPEN_FILE_READ_ONLY);
     if (p3DO->pFile == NULL) {
         goto on_error;
     }
@@ -7,13 +7,123 @@
 // - The contents of an object are wrapped in { ... } pairs
 // - Each key/value pair is terminated with a semi-colon
 
-taConfigObj* taAllocateConfigObject()
+// Everything making up a config is allocated from an arena which is owned by the root object. The arena is a list of blocks that
+// are allocated from linearly and are never freed individually, so deleting a config is just a matter of freeing each block. The
+// names and values of variables point straight into the text of the file which is also owned by the root object.
+struct taConfigArenaBlock
 {
-    taConfigObj* pObj = calloc(1, sizeof(*pObj));
+    // The next block in the list. Blocks are listed newest first.
+    taConfigArenaBlock* pNext;
+
+    // The size of the block's data, and how much of it has been allocated. The data comes straight after the header.
+    size_t sizeInBytes;
+    size_t usedInBytes;
+};
+
+#define TA_CONFIG_ARENA_ALIGNMENT       16
+#define TA_CONFIG_ARENA_HEADER_SIZE     ((sizeof(taConfigArenaBlock) + (TA_CONFIG_ARENA_ALIGNMENT-1)) & ~(size_t)(TA_CONFIG_ARENA_ALIGNMENT-1))
+#define TA_CONFIG_ARENA_MIN_BLOCK_SIZE  4096
+
+typedef struct
+{
+    // The blocks making up the arena, newest first. Allocations are only ever made from the first block.
+    taConfigArenaBlock* pBlocks;
+} taConfigArena;
+
+// Finds the first of c0, c1 or a null terminator, starting at str. pEnd is one past the null terminator of the text, and is never read
+// past.
+typedef char* (* taConfigFindProc)(char* str, const char* pEnd, char c0, char c1);
+
+// Returns a pointer to the first character at or after str that is not whitespace. This stops at the null terminator.
+typedef char* (* taConfigSkipWhitespaceProc)(char* str, const char* pEnd);
+
+typedef struct
+{
+    taConfigFindProc find;
+    taConfigSkipWhitespaceProc skipWhitespace;
+} taConfigScanner;
+
+// The state of a config while it's being parsed.
+typedef struct
+{
+    // The arena everything is allocated from.
+    taConfigArena arena;
+
+    // The scanning functions to use for the CPU we're running on, and one past the null terminator of the text being parsed.
+    taConfigScanner scanner;
+    const char* pEnd;
+
+    // The variables of the objects that are still being parsed, with the variables of inner objects on top. An object's variables are
+    // copied into the arena once it's finished, so the size of each object is known before allocating from the arena.
+    taConfigVar* pVarStack;
+    taUInt32 varStackCount;
+    taUInt32 varStackCapacity;
+} taConfigParser;
+
+// Adds a new block to the front of the arena.
+taBool32 taConfigArenaPushBlock(taConfigArena* pArena, size_t blockSize)
+{
+    assert(pArena != NULL);
+
+    taConfigArenaBlock* pBlock = (taConfigArenaBlock*)malloc(TA_CONFIG_ARENA_HEADER_SIZE + blockSize);
+    if (pBlock == NULL) {
+        return TA_FALSE;
+    }
+
+    pBlock->pNext = pArena->pBlocks;
+    pBlock->sizeInBytes = blockSize;
+    pBlock->usedInBytes = 0;
+
+    pArena->pBlocks = pBlock;
+    return TA_TRUE;
+}
+
+void* taConfigArenaAlloc(taConfigArena* pArena, size_t sizeInBytes)
+{
+    assert(pArena != NULL);
+
+    sizeInBytes = (sizeInBytes + (TA_CONFIG_ARENA_ALIGNMENT-1)) & ~(size_t)(TA_CONFIG_ARENA_ALIGNMENT-1);
+
+    taConfigArenaBlock* pBlock = pArena->pBlocks;
+    if (pBlock == NULL || pBlock->sizeInBytes - pBlock->usedInBytes < sizeInBytes) {
+        // Each new block is double the size of the last one so that the number of blocks stays small.
+        size_t blockSize = (pBlock != NULL) ? pBlock->sizeInBytes*2 : TA_CONFIG_ARENA_MIN_BLOCK_SIZE;
+        if (blockSize < sizeInBytes) {
+            blockSize = sizeInBytes;
+        }
+
+        if (!taConfigArenaPushBlock(pArena, blockSize)) {
+            return NULL;
+        }
+
+        pBlock = pArena->pBlocks;
+    }
+
+    void* p = (taUInt8*)pBlock + TA_CONFIG_ARENA_HEADER_SIZE + pBlock->usedInBytes;
+    pBlock->usedInBytes += sizeInBytes;
+
+    return p;
+}
+
+void taConfigArenaFree(taConfigArenaBlock* pBlocks)
+{
+    while (pBlocks != NULL) {
+        taConfigArenaBlock* pNext = pBlocks->pNext;
+        free(pBlocks);
+        pBlocks = pNext;
+    }
+}
+
+taConfigObj* taAllocateConfigObject(taConfigParser* pParser)
+{
+    assert(pParser != NULL);
+
+    taConfigObj* pObj = (taConfigObj*)taConfigArenaAlloc(&pParser->arena, sizeof(*pObj));
     if (pObj == NULL) {
         return NULL;
     }
 
+    taZeroObject(pObj);
     return pObj;
 }
 
@@ -22,66 +132,162 @@ taBool32 taConfigIsWhitespace(char c)
     return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
 }
 
-char* taConfigFirstNonWhitespace(char* str)
+taBool32 taConfigIsOnLineComment(const char* configString)
 {
-    if (str == NULL) {
-        return NULL;
-    }
+    return configString[0] == '/' && configString[1] == '/';
+}
+
+taBool32 taConfigIsOnBlockComment(const char* configString)
+{
+    return configString[0] == '/' && configString[1] == '*';
+}
+
+
+//// Scanning ////
+//
+// Scanning is done 16 bytes at a time where the CPU supports it. Each block is classified with a few compares and turned into a bit
+// mask, the lowest set bit of which is the character we're looking for. Blocks are only read while they fit entirely before the end
+// of the text, and the remainder is finished one character at a time. Since the text is null terminated, the scalar loops don't need
+// to check against the end.
+//
+// There's no AVX2 version because most names and values are shorter than 16 bytes. Scanning 32 bytes at a time was measured to be
+// slower than 16.
+
+TA_PRIVATE char* taConfigFind_Scalar(char* str, const char* pEnd, char c0, char c1)
+{
+    (void)pEnd;
 
-    while (str[0] != '\0' && !(str[0] != ' ' && str[0] != '\t' && str[0] != '\n' && str[0] != '\v' && str[0] != '\f' && str[0] != '\r')) {
+    while (str[0] != c0 && str[0] != c1 && str[0] != '\0') {
         str += 1;
     }
 
     return str;
 }
 
-taBool32 taConfigIsOnLineComment(const char* configString)
+TA_PRIVATE char* taConfigSkipWhitespace_Scalar(char* str, const char* pEnd)
 {
-    return configString[0] == '/' && configString[1] == '/';
+    (void)pEnd;
+
+    while (taConfigIsWhitespace(str[0])) {
+        str += 1;
+    }
+
+    return str;
 }
 
-taBool32 taConfigIsOnBlockComment(const char* configString)
+#if defined(TA_SUPPORT_SSE2)
+TA_PRIVATE TA_TARGET_SSE2 char* taConfigFind_SSE2(char* str, const char* pEnd, char c0, char c1)
 {
-    return configString[0] == '/' && configString[1] == '*';
+    __m128i v0 = _mm_set1_epi8(c0);
+    __m128i v1 = _mm_set1_epi8(c1);
+    __m128i vz = _mm_setzero_si128();
+
+    while (pEnd - str >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)str);
+        taUInt32 mask = (taUInt32)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, v0), _mm_cmpeq_epi8(v, v1)), _mm_cmpeq_epi8(v, vz)));
+        if (mask != 0) {
+            return str + taBitScanForward32(mask);
+        }
+
+        str += 16;
+    }
+
+    return taConfigFind_Scalar(str, pEnd, c0, c1);
 }
 
-char* taConfigSeekToEndOfLineComment(char* configString)
+TA_PRIVATE TA_TARGET_SSE2 char* taConfigSkipWhitespace_SSE2(char* str, const char* pEnd)
 {
-    while (*configString != '\0')
-    {
-        if (*configString++ == '\n') {
-            break;
+    // '\t', '\n', '\v', '\f' and '\r' are the range 9..13, which is checked by subtracting 9 and seeing if the result is at most 4.
+    __m128i vSpace = _mm_set1_epi8(' ');
+    __m128i vNine  = _mm_set1_epi8(9);
+    __m128i vFour  = _mm_set1_epi8(4);
+
+    while (pEnd - str >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)str);
+        __m128i t = _mm_sub_epi8(v, vNine);
+        __m128i isWhitespace = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(t, vFour), t), _mm_cmpeq_epi8(v, vSpace));
+        taUInt32 mask = (taUInt32)_mm_movemask_epi8(isWhitespace) ^ 0xFFFF;
+        if (mask != 0) {
+            return str + taBitScanForward32(mask);
         }
+
+        str += 16;
     }
 
-    return configString;
+    return taConfigSkipWhitespace_Scalar(str, pEnd);
 }
+#endif
 
-char* taConfigSeekToEndOfBlockComment(char* configString)
+TA_PRIVATE taConfigScanner taConfigSelectScanner()
 {
-    while (*configString != '\0')
-    {
-        if (configString[0] == '*' && configString[1] == '/') {
-            configString += 2;
-            break;
+    // Like taHPISelectDecryptProc(), this is selected once and cached without a lock since every thread arrives at the same result.
+    static taConfigScanner s_scanner = {NULL, NULL};
+    if (s_scanner.find == NULL) {
+        taConfigScanner scanner;
+        scanner.find = taConfigFind_Scalar;
+        scanner.skipWhitespace = taConfigSkipWhitespace_Scalar;
+#if defined(TA_SUPPORT_SSE2)
+        if (taHasSSE2()) {
+            scanner.find = taConfigFind_SSE2;
+            scanner.skipWhitespace = taConfigSkipWhitespace_SSE2;
         }
+#endif
+        s_scanner.skipWhitespace = scanner.skipWhitespace;
+        s_scanner.find = scanner.find;  // <-- Set last since it's what is checked above.
+    }
+
+    return s_scanner;
+}
 
+char* taConfigSeekToEndOfLineComment(taConfigParser* pParser, char* configString)
+{
+    configString = pParser->scanner.find(configString, pParser->pEnd, '\n', '\n');
+    if (*configString == '\n') {
         configString += 1;
     }
 
     return configString;
 }
 
-char* taConfigNextToken(char* configString)
+char* taConfigSeekToEndOfBlockComment(taConfigParser* pParser, char* configString)
 {
-    while (*configString != '\0')
-    {
-        // Skip any whitespace.
-        configString = taConfigFirstNonWhitespace(configString);
-        if (configString == NULL) {
+    for (;;) {
+        configString = pParser->scanner.find(configString, pParser->pEnd, '*', '*');
+        if (*configString == '\0') {
+            return configString;
+        }
+
+        if (configString[1] == '/') {
+            return configString + 2;
+        }
+
+        configString += 1;
+    }
+}
+
+// Finds the delimiter ending a name or value. Returns null if the end of the string or a comment is found first.
+char* taConfigSeekToDelimiter(taConfigParser* pParser, char* configString, char delimiter)
+{
+    for (;;) {
+        configString = pParser->scanner.find(configString, pParser->pEnd, delimiter, '/');
+        if (*configString == delimiter) {
+            return configString;
+        }
+
+        if (*configString == '\0' || taConfigIsOnLineComment(configString) || taConfigIsOnBlockComment(configString)) {
             return NULL;
         }
 
+        configString += 1;  // <-- A lone '/', which is allowed in names and values.
+    }
+}
+
+char* taConfigNextToken(taConfigParser* pParser, char* configString)
+{
+    for (;;)
+    {
+        // Skip any whitespace.
+        configString = pParser->scanner.skipWhitespace(configString, pParser->pEnd);
         if (*configString == '\0') {
             return NULL;
         }
@@ -89,13 +295,11 @@ char* taConfigNextToken(char* configString)
         // Skip comments.
         if (taConfigIsOnLineComment(configString))
         {
-            configString += 2;
-            configString = taConfigSeekToEndOfLineComment(configString);
+            configString = taConfigSeekToEndOfLineComment(pParser, configString + 2);
         }
         else if (taConfigIsOnBlockComment(configString))
         {
-            configString += 2;
-            configString = taConfigSeekToEndOfBlockComment(configString);
+            configString = taConfigSeekToEndOfBlockComment(pParser, configString + 2);
         }
         else
         {
@@ -103,43 +307,40 @@ char* taConfigNextToken(char* configString)
             return configString;
         }
     }
-
-    return configString;
 }
 
-taConfigVar* taConfigPushNewVar(taConfigObj* pParentObj, const char* name, const char* value)
+// Pushes a variable of the object currently being parsed. The returned pointer is only valid until the next variable is pushed.
+taConfigVar* taConfigPushNewVar(taConfigParser* pParser, const char* name, const char* value)
 {
-    assert(pParentObj != NULL);
+    assert(pParser != NULL);
     assert(name != NULL);
     assert(value != NULL);
 
-    unsigned int chunkSize = 16;
-    if (pParentObj->bufferSize <= pParentObj->varCount)
-    {
-        // Not enough space in the buffer - reallocate.
-        pParentObj->bufferSize += chunkSize;
-
-        taConfigVar* pNewVars = realloc(pParentObj->pVars, pParentObj->bufferSize * sizeof(*pNewVars));
-        if (pNewVars == NULL) {
+    if (pParser->varStackCount == pParser->varStackCapacity) {
+        taUInt32 newCapacity = (pParser->varStackCapacity == 0) ? 256 : pParser->varStackCapacity*2;
+        taConfigVar* pNewVarStack = (taConfigVar*)realloc(pParser->pVarStack, newCapacity * sizeof(*pNewVarStack));
+        if (pNewVarStack == NULL) {
             return NULL;    // Failed to allocate new buffer.
         }
 
-        pParentObj->pVars = pNewVars;
+        pParser->pVarStack = pNewVarStack;
+        pParser->varStackCapacity = newCapacity;
     }
 
 
-    taConfigVar* pVar = pParentObj->pVars + pParentObj->varCount;
+    taConfigVar* pVar = pParser->pVarStack + pParser->varStackCount;
     pVar->pObject = NULL;
     pVar->name = name;
     pVar->value = value;
-    
-    pParentObj->varCount += 1;
+    pVar->nameHash = taHashStringCaseInsensitive(name);
+
+    pParser->varStackCount += 1;
     return pVar;
 }
 
-taConfigObj* taConfigPushNewSubObj(taConfigObj* pParentObj, const char* name, const char* value)
+taConfigObj* taConfigPushNewSubObj(taConfigParser* pParser, const char* name, const char* value)
 {
-    assert(pParentObj != NULL);
+    assert(pParser != NULL);
     assert(name != NULL);
     assert(value != NULL);
 
@@ -147,12 +348,12 @@ taConfigObj* taConfigPushNewSubObj(taConfigObj* pParentObj, const char* name, co
     assert(value[0] == '\0');
 
 
-    taConfigObj* pSubObj = taAllocateConfigObject();
+    taConfigObj* pSubObj = taAllocateConfigObject(pParser);
     if (pSubObj == NULL) {
         return NULL;
     }
 
-    taConfigVar* pVar = taConfigPushNewVar(pParentObj, name, value);
+    taConfigVar* pVar = taConfigPushNewVar(pParser, name, value);
     if (pVar == NULL) {
         return NULL;
     }
@@ -161,13 +362,89 @@ taConfigObj* taConfigPushNewSubObj(taConfigObj* pParentObj, const char* name, co
     return pSubObj;
 }
 
+// Builds the hash index of an object once all of it's variables have been added. If this fails the object will just be searched
+// linearly.
+void taConfigBuildIndex(taConfigParser* pParser, taConfigObj* pObj)
+{
+    assert(pObj != NULL);
+    assert(pObj->pSlots == NULL);
+
+    if (pObj->varCount < TA_CONFIG_INDEX_THRESHOLD) {
+        return;
+    }
+
+    // The table is kept at most half full.
+    taUInt32 slotCount = 16;
+    while (slotCount < pObj->varCount*2) {
+        slotCount *= 2;
+    }
+
+    taUInt32* pSlots = (taUInt32*)taConfigArenaAlloc(&pParser->arena, slotCount * sizeof(*pSlots));
+    if (pSlots == NULL) {
+        return;
+    }
+
+    memset(pSlots, 0, slotCount * sizeof(*pSlots));
+
+    // Variables are inserted in order so that when a name is used more than once, the first one is found first.
+    taUInt32 mask = slotCount - 1;
+    for (taUInt32 iVar = 0; iVar < pObj->varCount; ++iVar) {
+        taUInt32 iSlot = pObj->pVars[iVar].nameHash & mask;
+        while (pSlots[iSlot] != 0) {
+            iSlot = (iSlot + 1) & mask;
+        }
+
+        pSlots[iSlot] = iVar + 1;
+    }
+
+    pObj->slotCount = slotCount;
+    pObj->pSlots = pSlots;
+}
 
-char* taParseConfigObject(char* configString, taConfigObj* pObj)
+// Moves the variables of a finished object from the top of the stack into the arena. firstVar is where the object's variables start
+// on the stack.
+void taConfigFinishObject(taConfigParser* pParser, taConfigObj* pObj, taUInt32 firstVar)
+{
+    assert(pParser != NULL);
+    assert(pObj != NULL);
+    assert(firstVar <= pParser->varStackCount);
+
+    taUInt32 varCount = pParser->varStackCount - firstVar;
+    pParser->varStackCount = firstVar;
+
+    if (varCount > 0) {
+        pObj->pVars = (taConfigVar*)taConfigArenaAlloc(&pParser->arena, varCount * sizeof(*pObj->pVars));
+        if (pObj->pVars == NULL) {
+            return; // <-- Out of memory. The object is left empty.
+        }
+
+        memcpy(pObj->pVars, pParser->pVarStack + firstVar, varCount * sizeof(*pObj->pVars));
+        pObj->varCount = varCount;
+    }
+
+    taConfigBuildIndex(pParser, pObj);
+}
+
+
+char* taParseConfigObjectVars(taConfigParser* pParser, char* configString);
+
+// Parses the contents of an object. The object is finished even if an error occurs so that whatever has been parsed up to that point
+// can still be used.
+char* taParseConfigObject(taConfigParser* pParser, char* configString, taConfigObj* pObj)
+{
+    taUInt32 firstVar = pParser->varStackCount;
+    configString = taParseConfigObjectVars(pParser, configString);
+    taConfigFinishObject(pParser, pObj, firstVar);
+
+    return configString;
+}
+
+char* taParseConfigObjectVars(taConfigParser* pParser, char* configString)
 {
     // This is the where the real meat of the parsing is done. It assumes the config string is sitting on the byte just
     // after the opening curly bracket of the object.
 
-    while ((configString = taConfigNextToken(configString)) != NULL) {
+    while ((configString = taConfigNextToken(pParser, configString)) != NULL) {
         if (*configString == '\0') {
             return NULL;            // Reached the end of the string. Technically an error because we were expecting a closing curly bracket.
         }
@@ -183,18 +460,9 @@ char* taParseConfigObject(char* configString, taConfigObj* pObj)
             configString += 1;  // Skip past the opening "["
 
             char* nameBeg = configString;
-            char* nameEnd = nameBeg;
-            while (*nameEnd != ']') {
-                if (*nameEnd == '\0') {
-                    return NULL;   // Unexpected end of file.
-                }
-                if (taConfigIsOnLineComment(nameEnd)) {
-                    return NULL;    // Expecting closing ']' but found a comment instead.
-                }
-                if (taConfigIsOnBlockComment(nameEnd)) {
-                    return NULL;    // Expecting closing ']' but found a comment instead.
-                }
-                nameEnd += 1;
+            char* nameEnd = taConfigSeekToDelimiter(pParser, nameBeg, ']');
+            if (nameEnd == NULL) {
+                return NULL;    // Unexpected end of file, or found a comment when expecting the closing ']'.
             }
 
             // Null terminate the name.
@@ -202,7 +470,7 @@ char* taParseConfigObject(char* configString, taConfigObj* pObj)
 
 
             // Expecting an opening curly bracket.
-            configString = taConfigNextToken(nameEnd + 1);
+            configString = taConfigNextToken(pParser, nameEnd + 1);
             if (configString == NULL || *configString == '\0') {
                 return NULL;    // Unexpected end of file.
             }
@@ -213,12 +481,12 @@ char* taParseConfigObject(char* configString, taConfigObj* pObj)
 
 
             // We are beginning a sub-object so we'll need to call this recursively.
-            taConfigObj* pSubObj = taConfigPushNewSubObj(pObj, nameBeg, nameEnd);     // <-- Set the value to "nameEnd" which simply makes it an empty string rather than NULL which is a bit safer.
+            taConfigObj* pSubObj = taConfigPushNewSubObj(pParser, nameBeg, nameEnd);     // <-- Set the value to "nameEnd" which simply makes it an empty string rather than NULL which is a bit safer.
             if (pSubObj == NULL) {
                 return NULL;    // Failed to allocate the sub-object.
             }
 
-            configString = taParseConfigObject(configString, pSubObj);
+            configString = taParseConfigObject(pParser, configString, pSubObj);
             if (configString == NULL) {
                 return NULL;
             }
@@ -230,65 +498,29 @@ char* taParseConfigObject(char* configString, taConfigObj* pObj)
                 return NULL;    // Unexpected token. Variables must begin with a character or underscore.
             }
 
-            char* nameBeg = configString++;
-            char* nameEnd = configString;
-            while (*configString != '=') {
-                if (*configString == '\0') {
-                    return NULL;    // Unexpected end of file.
-                }
-                if (taConfigIsOnLineComment(configString)) {
-                    return NULL;
-                }
-                if (taConfigIsOnBlockComment(configString)) {
-                    return NULL;
-                }
-
-                configString += 1;
-                if (!taConfigIsWhitespace(*configString)) {
-                    nameEnd = configString;
-                }
-            }
-
-            if (*configString != '=') {
-                return NULL;    // Expecting '='.
+            // The name and value run right up to the '=' and ';', including any whitespace before them.
+            char* nameBeg = configString;
+            char* nameEnd = taConfigSeekToDelimiter(pParser, nameBeg + 1, '=');
+            if (nameEnd == NULL) {
+                return NULL;    // Unexpected end of file, or found a comment when expecting '='.
             }
 
             // Null terminate the name.
             *nameEnd = '\0';
 
-            // Skip past the '='.
-            configString += 1;
-
-            char* valueBeg = configString;
-            char* valueEnd = configString;
-            while (*configString != ';') {
-                if (*configString == '\0') {
-                    return NULL;    // Unexpected end of file.
-                }
-                if (taConfigIsOnLineComment(configString)) {
-                    return NULL;
-                }
-                if (taConfigIsOnBlockComment(configString)) {
-                    return NULL;
-                }
-
-                configString += 1;
-                if (!taConfigIsWhitespace(*configString)) {
-                    valueEnd = configString;
-                }
-            }
-
-            if (*configString != ';') {
-                return NULL;    // Expecting ';'.
+            char* valueBeg = nameEnd + 1;
+            char* valueEnd = taConfigSeekToDelimiter(pParser, valueBeg, ';');
+            if (valueEnd == NULL) {
+                return NULL;    // Unexpected end of file, or found a comment when expecting ';'.
             }
 
             // Null terminate the value.
             *valueEnd = '\0';
 
             // Skip past the ';'
-            configString += 1;
+            configString = valueEnd + 1;
 
-            taConfigVar* pVar = taConfigPushNewVar(pObj, nameBeg, valueBeg);
+            taConfigVar* pVar = taConfigPushNewVar(pParser, nameBeg, valueBeg);
             if (pVar == NULL) {
                 return NULL;
             }
@@ -302,18 +534,454 @@ taConfigObj* taParseConfigFromOpenFile(taFile* pFile)
 {
     assert(pFile != NULL);
 
-    taConfigObj* pConfig = taAllocateConfigObject();
-    if (pConfig == NULL) {
+    taConfigParser parser;
+    taZeroObject(&parser);
+    parser.scanner = taConfigSelectScanner();
+    parser.pEnd = pFile->pFileData + pFile->sizeInBytes + 1;   // <-- The file is opened with a null terminator.
+
+    // The first block is sized from the file so that most configs fit in a single block.
+    size_t firstBlockSize = pFile->sizeInBytes*2;
+    if (firstBlockSize < TA_CONFIG_ARENA_MIN_BLOCK_SIZE) {
+        firstBlockSize = TA_CONFIG_ARENA_MIN_BLOCK_SIZE;
+    }
+
+    if (!taConfigArenaPushBlock(&parser.arena, firstBlockSize)) {
+        taCloseFile(pFile);
         return NULL;
     }
 
+    taConfigObj* pConfig = taAllocateConfigObject(&parser);
+    assert(pConfig != NULL);    // <-- Always fits in the first block.
+
+    taParseConfigObject(&parser, pFile->pFileData, pConfig);
+    free(parser.pVarStack);
+
     pConfig->_pFile = pFile;
-    if (pConfig->_pFile == NULL) {
-        free(pConfig);
+    pConfig->_pArenaBlocks = parser.arena.pBlocks;
+    return pConfig;
+}
+
+//// Compiled Config Cache ////
+//
+// The first time a config from a memory mapped archive is parsed, it's compiled to a binary form and written to the cache directory.
+// From then on the binary form is loaded instead of parsing the text, for as long as the signature of the source file still matches.
+// The binary form is the parsed tree with every object, variable and index slot flattened into arrays that refer to each other by
+// index, followed by the strings. The names are stored with their hashes. Loading it is a single pass over the mapped cache file to
+// turn the indices back into the pointers used by taConfigObj. Define TA_NO_CONFIG_CACHE to disable this.
+//
+// Layout:
+//   taConfigCacheHeader
+//   char sourceKey[sourceKeySize]          (padded to 4 bytes)
+//   taConfigCacheObject objects[objectCount]  (the root object is first)
+//   taConfigCacheVar vars[varCount]
+//   taUInt32 slots[slotCount]
+//   char strings[stringsSize]
+
+#define TA_CONFIG_CACHE_MAGIC       0x43434154  // 'TACC'
+#define TA_CONFIG_CACHE_VERSION     1
+#define TA_CONFIG_CACHE_NO_OBJECT   0xFFFFFFFF
+
+typedef struct
+{
+    taUInt32 magic;
+    taUInt32 version;
+
+    // The signature of the source file at the time the cache was written.
+    taUInt64 sourceSize;
+    taUInt32 sourceHash;
+
+    // The size of the source key, including the null terminator. Different sources can hash to the same cache file, so the key the
+    // cache was written for is stored and checked when loading.
+    taUInt32 sourceKeySize;
+
+    taUInt32 objectCount;
+    taUInt32 varCount;
+    taUInt32 slotCount;
+    taUInt32 stringsSize;
+} taConfigCacheHeader;
+
+typedef struct
+{
+    taUInt32 firstVar;
+    taUInt32 varCount;
+    taUInt32 firstSlot;
+    taUInt32 slotCount;
+} taConfigCacheObject;
+
+typedef struct
+{
+    // Offsets into the strings.
+    taUInt32 nameOffset;
+    taUInt32 valueOffset;
+
+    // The index of the sub-object, or TA_CONFIG_CACHE_NO_OBJECT.
+    taUInt32 objectIndex;
+
+    taUInt32 nameHash;
+} taConfigCacheVar;
+
+#define TA_CONFIG_CACHE_ALIGN4(x)   (((x) + 3) & ~(size_t)3)
+
+#ifndef TA_NO_CONFIG_CACHE
+// Builds the key identifying a source file, and the path of it's cache file. archiveRelativePath is null for configs loaded with
+// taParseConfigFromFile() since the file can come from any archive.
+TA_PRIVATE taBool32 taConfigCacheGetPath(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath, char* keyOut, size_t keyOutSize, char* pathOut, size_t pathOutSize)
+{
+    int length = snprintf(keyOut, keyOutSize, "%s:%s", (archiveRelativePath != NULL) ? archiveRelativePath : "", fileRelativePath);
+    if (length < 0 || (size_t)length >= keyOutSize) {
+        return TA_FALSE;
+    }
+
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%08x.cfg", taHashStringCaseInsensitive(keyOut));
+
+    char directoryPath[TA_MAX_PATH];
+    return taPathAppend(directoryPath, sizeof(directoryPath), pFS->rootDir, TA_CONFIG_CACHE_DIRECTORY) && taPathAppend(pathOut, pathOutSize, directoryPath, fileName);
+}
+
+// Loads a config from it's cache file. Returns null if the cache file does not exist, is out of date or is corrupt.
+TA_PRIVATE taConfigObj* taConfigCacheLoad(const char* cachePath, const char* sourceKey, const taFSFileSignature* pSignature)
+{
+    taMappedFile mappedFile;
+    if (!taMapFile(cachePath, &mappedFile)) {
+        return NULL;
+    }
+
+    taConfigObj* pConfig = NULL;
+    const taUInt8* pData = mappedFile.pData;
+    taUInt64 dataSize = mappedFile.sizeInBytes;
+
+    taConfigCacheHeader header;
+    if (dataSize < sizeof(header)) {
+        goto done;
+    }
+
+    memcpy(&header, pData, sizeof(header));
+    if (header.magic != TA_CONFIG_CACHE_MAGIC || header.version != TA_CONFIG_CACHE_VERSION || header.sourceSize != pSignature->sizeInBytes || header.sourceHash != pSignature->hash) {
+        goto done;  // <-- Out of date.
+    }
+
+    // Every section needs to fit in the file exactly. The sizes are done in 64-bit so they can't overflow.
+    taUInt64 sourceKeyPos = sizeof(header);
+    taUInt64 objectsPos   = sourceKeyPos + TA_CONFIG_CACHE_ALIGN4((taUInt64)header.sourceKeySize);
+    taUInt64 varsPos      = objectsPos + (taUInt64)header.objectCount * sizeof(taConfigCacheObject);
+    taUInt64 slotsPos     = varsPos    + (taUInt64)header.varCount    * sizeof(taConfigCacheVar);
+    taUInt64 stringsPos   = slotsPos   + (taUInt64)header.slotCount   * sizeof(taUInt32);
+    if (stringsPos + header.stringsSize != dataSize || header.objectCount == 0 || header.stringsSize == 0 || pData[dataSize-1] != '\0') {
+        goto done;
+    }
+
+    if (header.sourceKeySize != strlen(sourceKey)+1 || memcmp(pData + sourceKeyPos, sourceKey, header.sourceKeySize) != 0) {
+        goto done;  // <-- Written for a different source that happens to have the same hash.
+    }
+
+    const taConfigCacheObject* pCachedObjects = (const taConfigCacheObject*)(pData + objectsPos);
+    const taConfigCacheVar*    pCachedVars    = (const taConfigCacheVar*)(pData + varsPos);
+    const taUInt32*            pCachedSlots   = (const taUInt32*)(pData + slotsPos);
+    const char*                pCachedStrings = (const char*)(pData + stringsPos);
+
+    // Everything goes into a single block of the arena.
+    taConfigArena arena;
+    taZeroObject(&arena);
+
+    size_t blockSize = (4 * TA_CONFIG_ARENA_ALIGNMENT) +
+        header.objectCount * sizeof(taConfigObj) +
+        header.varCount    * sizeof(taConfigVar) +
+        header.slotCount   * sizeof(taUInt32)    +
+        header.stringsSize;
+    if (!taConfigArenaPushBlock(&arena, blockSize)) {
+        goto done;
+    }
+
+    taConfigObj* pObjects = (taConfigObj*)taConfigArenaAlloc(&arena, header.objectCount * sizeof(*pObjects));
+    taConfigVar* pVars    = (taConfigVar*)taConfigArenaAlloc(&arena, header.varCount    * sizeof(*pVars));
+    taUInt32*    pSlots   = (taUInt32*)   taConfigArenaAlloc(&arena, header.slotCount   * sizeof(*pSlots));
+    char*        pStrings = (char*)       taConfigArenaAlloc(&arena, header.stringsSize);
+    assert(arena.pBlocks->pNext == NULL);   // <-- Everything should have fit in the first block.
+
+    memcpy(pSlots, pCachedSlots, header.slotCount * sizeof(*pSlots));
+    memcpy(pStrings, pCachedStrings, header.stringsSize);
+
+    // Sub-objects are numbered in the order the variables refer to them, so each one has exactly one parent.
+    taUInt32 nextObjectIndex = 1;
+    for (taUInt32 iVar = 0; iVar < header.varCount; ++iVar) {
+        const taConfigCacheVar* pCachedVar = &pCachedVars[iVar];
+        if (pCachedVar->nameOffset >= header.stringsSize || pCachedVar->valueOffset >= header.stringsSize || (pCachedVar->objectIndex != TA_CONFIG_CACHE_NO_OBJECT && (pCachedVar->objectIndex != nextObjectIndex || pCachedVar->objectIndex >= header.objectCount))) {
+            taConfigArenaFree(arena.pBlocks);
+            goto done;
+        }
+
+        if (pCachedVar->objectIndex != TA_CONFIG_CACHE_NO_OBJECT) {
+            nextObjectIndex += 1;
+        }
+
+        pVars[iVar].name     = pStrings + pCachedVar->nameOffset;
+        pVars[iVar].value    = pStrings + pCachedVar->valueOffset;
+        pVars[iVar].pObject  = (pCachedVar->objectIndex != TA_CONFIG_CACHE_NO_OBJECT) ? &pObjects[pCachedVar->objectIndex] : NULL;
+        pVars[iVar].nameHash = pCachedVar->nameHash;
+
+        // Lookups compare hashes before names, so a wrong hash would make the variable impossible to find.
+        if (pVars[iVar].nameHash != taHashStringCaseInsensitive(pVars[iVar].name)) {
+            taConfigArenaFree(arena.pBlocks);
+            goto done;
+        }
+    }
+
+    // The objects need to own consecutive runs of variables and slots, in order, the same way taConfigCacheSave() writes them. This
+    // makes sure each variable belongs to exactly one object.
+    taUInt32 nextVar  = 0;
+    taUInt32 nextSlot = 0;
+    for (taUInt32 iObject = 0; iObject < header.objectCount; ++iObject) {
+        const taConfigCacheObject* pCachedObject = &pCachedObjects[iObject];
+        if (pCachedObject->firstVar  != nextVar  || (taUInt64)pCachedObject->firstVar  + pCachedObject->varCount  > header.varCount  ||
+            pCachedObject->firstSlot != nextSlot || (taUInt64)pCachedObject->firstSlot + pCachedObject->slotCount > header.slotCount ||
+            (pCachedObject->slotCount & (pCachedObject->slotCount - 1)) != 0)
+        {
+            taConfigArenaFree(arena.pBlocks);
+            goto done;
+        }
+
+        // The probe loop in taConfigFindVar() stops at the first empty slot, so an index needs to have at least twice as many slots
+        // as variables, with no more than one slot in use per variable.
+        if (pCachedObject->slotCount > 0 && pCachedObject->slotCount < (taUInt64)pCachedObject->varCount*2) {
+            taConfigArenaFree(arena.pBlocks);
+            goto done;
+        }
+
+        // Every slot needs to refer to one of the object's own variables.
+        taUInt32 usedSlotCount = 0;
+        for (taUInt32 iSlot = 0; iSlot < pCachedObject->slotCount; ++iSlot) {
+            taUInt32 slot = pSlots[pCachedObject->firstSlot + iSlot];
+            if (slot > pCachedObject->varCount) {
+                taConfigArenaFree(arena.pBlocks);
+                goto done;
+            }
+
+            if (slot != 0) {
+                usedSlotCount += 1;
+            }
+        }
+
+        if (usedSlotCount > pCachedObject->varCount) {
+            taConfigArenaFree(arena.pBlocks);
+            goto done;
+        }
+
+        // Sub-objects always come after the object that owns them. Anything else could make the tree refer back to itself.
+        for (taUInt32 iVar = 0; iVar < pCachedObject->varCount; ++iVar) {
+            taUInt32 objectIndex = pCachedVars[pCachedObject->firstVar + iVar].objectIndex;
+            if (objectIndex != TA_CONFIG_CACHE_NO_OBJECT && objectIndex <= iObject) {
+                taConfigArenaFree(arena.pBlocks);
+                goto done;
+            }
+        }
+
+        nextVar  += pCachedObject->varCount;
+        nextSlot += pCachedObject->slotCount;
+
+        taZeroObject(&pObjects[iObject]);
+        pObjects[iObject].varCount  = pCachedObject->varCount;
+        pObjects[iObject].pVars     = (pCachedObject->varCount  > 0) ? &pVars[pCachedObject->firstVar]   : NULL;
+        pObjects[iObject].slotCount = pCachedObject->slotCount;
+        pObjects[iObject].pSlots    = (pCachedObject->slotCount > 0) ? &pSlots[pCachedObject->firstSlot] : NULL;
+    }
+
+    if (nextObjectIndex != header.objectCount || nextVar != header.varCount || nextSlot != header.slotCount) {
+        taConfigArenaFree(arena.pBlocks);
+        goto done;
+    }
+
+    pConfig = &pObjects[0];
+    pConfig->_pArenaBlocks = arena.pBlocks;
+
+done:
+    taUnmapFile(&mappedFile);
+    return pConfig;
+}
+
+// Writes the cache file of a config that was just parsed. This is allowed to fail, in which case the config will just be parsed
+// again next time.
+TA_PRIVATE void taConfigCacheSave(const char* cachePath, const char* sourceKey, const taFSFileSignature* pSignature, const taConfigObj* pConfig)
+{
+    taConfigCacheHeader header;
+    taZeroObject(&header);
+    header.magic         = TA_CONFIG_CACHE_MAGIC;
+    header.version       = TA_CONFIG_CACHE_VERSION;
+    header.sourceSize    = pSignature->sizeInBytes;
+    header.sourceHash    = pSignature->hash;
+    header.sourceKeySize = (taUInt32)strlen(sourceKey)+1;
+
+    // The objects are flattened breadth first, using the list of objects itself as the queue. The first pass only counts.
+    taUInt32 objectCapacity = 64;
+    const taConfigObj** ppObjects = (const taConfigObj**)malloc(objectCapacity * sizeof(*ppObjects));
+    if (ppObjects == NULL) {
+        return;
+    }
+
+    ppObjects[0] = pConfig;
+    header.objectCount = 1;
+
+    size_t stringsSize = 0;
+    for (taUInt32 iObject = 0; iObject < header.objectCount; ++iObject) {
+        const taConfigObj* pObject = ppObjects[iObject];
+        header.varCount  += pObject->varCount;
+        header.slotCount += pObject->slotCount;
+
+        for (unsigned int iVar = 0; iVar < pObject->varCount; ++iVar) {
+            stringsSize += strlen(pObject->pVars[iVar].name)+1 + strlen(pObject->pVars[iVar].value)+1;
+
+            if (pObject->pVars[iVar].pObject != NULL) {
+                if (header.objectCount == objectCapacity) {
+                    objectCapacity *= 2;
+                    const taConfigObj** ppNewObjects = (const taConfigObj**)realloc((void*)ppObjects, objectCapacity * sizeof(*ppObjects));
+                    if (ppNewObjects == NULL) {
+                        free((void*)ppObjects);
+                        return;
+                    }
+
+                    ppObjects = ppNewObjects;
+                }
+
+                ppObjects[header.objectCount++] = pObject->pVars[iVar].pObject;
+            }
+        }
+    }
+
+    if (stringsSize == 0 || stringsSize > 0xFFFFFFFF) {
+        stringsSize = 1;    // <-- There always needs to be at least one byte of strings for the null terminator check.
+    }
+    header.stringsSize = (taUInt32)stringsSize;
+
+    size_t objectsPos = sizeof(header) + TA_CONFIG_CACHE_ALIGN4(header.sourceKeySize);
+    size_t varsPos    = objectsPos + header.objectCount * sizeof(taConfigCacheObject);
+    size_t slotsPos   = varsPos    + header.varCount    * sizeof(taConfigCacheVar);
+    size_t stringsPos = slotsPos   + header.slotCount   * sizeof(taUInt32);
+    size_t fileSize   = stringsPos + header.stringsSize;
+
+    taUInt8* pData = (taUInt8*)calloc(1, fileSize);
+    if (pData == NULL) {
+        free((void*)ppObjects);
+        return;
+    }
+
+    memcpy(pData, &header, sizeof(header));
+    memcpy(pData + sizeof(header), sourceKey, header.sourceKeySize);
+
+    taConfigCacheObject* pCachedObjects = (taConfigCacheObject*)(pData + objectsPos);
+    taConfigCacheVar*    pCachedVars    = (taConfigCacheVar*)(pData + varsPos);
+    taUInt32*            pCachedSlots   = (taUInt32*)(pData + slotsPos);
+    char*                pCachedStrings = (char*)(pData + stringsPos);
+
+    // Sub-objects are numbered in the same order they were queued above.
+    taUInt32 nextObjectIndex = 1;
+    taUInt32 varCount = 0;
+    taUInt32 slotCount = 0;
+    taUInt32 stringsOffset = 0;
+    for (taUInt32 iObject = 0; iObject < header.objectCount; ++iObject) {
+        const taConfigObj* pObject = ppObjects[iObject];
+
+        pCachedObjects[iObject].firstVar  = varCount;
+        pCachedObjects[iObject].varCount  = pObject->varCount;
+        pCachedObjects[iObject].firstSlot = slotCount;
+        pCachedObjects[iObject].slotCount = pObject->slotCount;
+
+        if (pObject->slotCount > 0) {
+            memcpy(pCachedSlots + slotCount, pObject->pSlots, pObject->slotCount * sizeof(*pCachedSlots));
+            slotCount += pObject->slotCount;
+        }
+
+        for (unsigned int iVar = 0; iVar < pObject->varCount; ++iVar) {
+            const taConfigVar* pVar = &pObject->pVars[iVar];
+            taConfigCacheVar* pCachedVar = &pCachedVars[varCount++];
+
+            size_t nameSize = strlen(pVar->name)+1;
+            memcpy(pCachedStrings + stringsOffset, pVar->name, nameSize);
+            pCachedVar->nameOffset = stringsOffset;
+            stringsOffset += (taUInt32)nameSize;
+
+            size_t valueSize = strlen(pVar->value)+1;
+            memcpy(pCachedStrings + stringsOffset, pVar->value, valueSize);
+            pCachedVar->valueOffset = stringsOffset;
+            stringsOffset += (taUInt32)valueSize;
+
+            pCachedVar->objectIndex = (pVar->pObject != NULL) ? nextObjectIndex++ : TA_CONFIG_CACHE_NO_OBJECT;
+            pCachedVar->nameHash = pVar->nameHash;
+        }
+    }
+
+    free((void*)ppObjects);
+
+    // The file is written to a temporary file first so that a config being parsed on another thread never sees half a file.
+    char tempPath[TA_MAX_PATH];
+    char tempExtension[32];
+    snprintf(tempExtension, sizeof(tempExtension), "%p.tmp", (void*)&tempPath);
+    if (!taPathAppendExtension(tempPath, sizeof(tempPath), cachePath, tempExtension)) {
+        free(pData);
+        return;
+    }
+
+    taFSCreateFileDirectory(cachePath);
+
+    FILE* pFile = taFOpen(tempPath, "wb");
+    if (pFile == NULL) {
+        free(pData);
+        return;
+    }
+
+    taBool32 isWritten = fwrite(pData, 1, fileSize, pFile) == fileSize;
+    isWritten = (fclose(pFile) == 0) && isWritten;
+    free(pData);
+
+    if (isWritten) {
+        remove(cachePath);  // <-- rename() will not replace an existing file on Windows.
+        isWritten = rename(tempPath, cachePath) == 0;
+    }
+
+    if (!isWritten) {
+        remove(tempPath);
+    }
+}
+#endif
+
+// Parses a config from the archives, going through the cache if possible. If archiveRelativePath is null the file is searched for
+// like taOpenFile().
+TA_PRIVATE taConfigObj* taParseConfigFromArchive(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath)
+{
+    assert(pFS != NULL);
+    assert(fileRelativePath != NULL);
+
+#ifndef TA_NO_CONFIG_CACHE
+    char sourceKey[TA_MAX_PATH*2];
+    char cachePath[TA_MAX_PATH];
+    taFSFileSignature signature;
+    taBool32 useCache = taFSGetFileSignature(pFS, archiveRelativePath, fileRelativePath, &signature) == TA_SUCCESS && taConfigCacheGetPath(pFS, archiveRelativePath, fileRelativePath, sourceKey, sizeof(sourceKey), cachePath, sizeof(cachePath));
+    if (useCache) {
+        taConfigObj* pConfig = taConfigCacheLoad(cachePath, sourceKey, &signature);
+        if (pConfig != NULL) {
+            return pConfig;
+        }
+    }
+#endif
+
+    taFile* pFile;
+    if (archiveRelativePath == NULL) {
+        pFile = taOpenFile(pFS, fileRelativePath, TA_OPEN_FILE_WITH_NULL_TERMINATOR);
+    } else {
+        pFile = taOpenSpecificFile(pFS, archiveRelativePath, fileRelativePath, TA_OPEN_FILE_WITH_NULL_TERMINATOR);
+    }
+
+    if (pFile == NULL) {
         return NULL;
     }
 
-    taParseConfigObject(pConfig->_pFile->pFileData, pConfig);
+    taConfigObj* pConfig = taParseConfigFromOpenFile(pFile);
+
+#ifndef TA_NO_CONFIG_CACHE
+    if (useCache && pConfig != NULL) {
+        taConfigCacheSave(cachePath, sourceKey, &signature, pConfig);
+    }
+#endif
+
     return pConfig;
 }
 
@@ -323,6 +991,11 @@ taConfigObj* taParseConfigFromSpecificFile(taFS* pFS, const char* archiveRelativ
         return NULL;
     }
 
+    // Files on the real file system are parsed directly.
+    if (archiveRelativePath != NULL && archiveRelativePath[0] != '\0') {
+        return taParseConfigFromArchive(pFS, archiveRelativePath, fileRelativePath);
+    }
+
     taFile* pFile = taOpenSpecificFile(pFS, archiveRelativePath, fileRelativePath, TA_OPEN_FILE_WITH_NULL_TERMINATOR);
     if (pFile == NULL) {
         return NULL;
@@ -337,12 +1010,7 @@ taConfigObj* taParseConfigFromFile(taFS* pFS, const char* fileRelativePath)
         return NULL;
     }
 
-    taFile* pFile = taOpenFile(pFS, fileRelativePath, TA_OPEN_FILE_WITH_NULL_TERMINATOR);
-    if (pFile == NULL) {
-        return NULL;
-    }
-
-    return taParseConfigFromOpenFile(pFile);
+    return taParseConfigFromArchive(pFS, NULL, fileRelativePath);
 }
 
 void taDeleteConfig(taConfigObj* pConfig)
@@ -351,49 +1019,79 @@ void taDeleteConfig(taConfigObj* pConfig)
         return;
     }
 
-    if (pConfig->_pFile) {
-        taCloseFile(pConfig->_pFile);
+    // The root object is allocated from the arena so it can't be accessed after freeing it.
+    taFile* pFile = pConfig->_pFile;
+    taConfigArenaFree(pConfig->_pArenaBlocks);
+
+    if (pFile != NULL) {
+        taCloseFile(pFile);
+    }
+}
+
+
+TA_PRIVATE taBool32 taConfigIsVarNamed(const taConfigVar* pVar, const char* name, size_t nameLength, taUInt32 nameHash, taBool32 caseInsensitive)
+{
+    if (pVar->nameHash != nameHash) {
+        return TA_FALSE;
     }
 
+    int cmp = (caseInsensitive) ? _strnicmp(pVar->name, name, nameLength) : strncmp(pVar->name, name, nameLength);
+    return cmp == 0 && pVar->name[nameLength] == '\0';
+}
 
-    // Sub objects need to be deleted recursively.
-    for (unsigned int iVar = 0; iVar < pConfig->varCount; ++iVar) {
-        if (pConfig->pVars[iVar].pObject != NULL) {
-            taDeleteConfig(pConfig->pVars[iVar].pObject);
+// Finds a variable in a single object. name does not need to be null terminated.
+TA_PRIVATE taConfigVar* taConfigFindVar(const taConfigObj* pConfig, const char* name, size_t nameLength, taUInt32 nameHash, taBool32 caseInsensitive)
+{
+    assert(pConfig != NULL);
+
+    if (pConfig->pSlots != NULL) {
+        taUInt32 mask = pConfig->slotCount - 1;
+        for (taUInt32 iSlot = nameHash & mask; pConfig->pSlots[iSlot] != 0; iSlot = (iSlot + 1) & mask) {
+            taConfigVar* pVar = &pConfig->pVars[pConfig->pSlots[iSlot] - 1];
+            if (taConfigIsVarNamed(pVar, name, nameLength, nameHash, caseInsensitive)) {
+                return pVar;
+            }
+        }
+    } else {
+        for (unsigned int iVar = 0; iVar < pConfig->varCount; ++iVar) {
+            taConfigVar* pVar = &pConfig->pVars[iVar];
+            if (taConfigIsVarNamed(pVar, name, nameLength, nameHash, caseInsensitive)) {
+                return pVar;
+            }
         }
     }
 
-    free(pConfig->pVars);
-    free(pConfig);
+    return NULL;
 }
 
-
 taConfigVar* taConfigGetVar(const taConfigObj* pConfig, const char* varName)
 {
     if (pConfig == NULL || varName == NULL) {
         return NULL;
     }
 
+    // Each segment of the path is looked up in place, one object at a time.
     taPathIterator iSeg;
-    if (taPathFirst(varName, &iSeg)) {
-        taPathIterator iNextSeg = iSeg;
-        if (taPathNext(&iNextSeg)) {
-            char subobjName[256];
-            taPathAppendIterator(subobjName, sizeof(subobjName), "", iSeg);
-            taConfigObj* pSubObj = taConfigGetSubObj(pConfig, subobjName);
-            if (pSubObj != NULL) {
-                return taConfigGetVar(pSubObj, iNextSeg.path + iNextSeg.segment.offset);
-            }
-        } else {
-            for (unsigned int i = 0; i < pConfig->varCount; ++i) {
-                if (strcmp(pConfig->pVars[i].name, varName) == 0) { // <-- Should this be case insensitive?
-                    return &pConfig->pVars[i];
-                }
-            }
-        }
+    if (!taPathFirst(varName, &iSeg)) {
+        return NULL;
     }
 
-    return NULL;
+    for (;;) {
+        const char* segment = iSeg.path + iSeg.segment.offset;
+        taConfigVar* pVar = taConfigFindVar(pConfig, segment, iSeg.segment.length, taHashStringCaseInsensitiveN(segment, iSeg.segment.length), TA_FALSE);
+        if (pVar == NULL) {
+            return NULL;
+        }
+
+        if (!taPathNext(&iSeg)) {
+            return pVar;
+        }
+
+        pConfig = pVar->pObject;
+        if (pConfig == NULL) {
+            return NULL;    // <-- Not a sub-object.
+        }
+    }
 }
 
 taConfigObj* taConfigGetSubObj(const taConfigObj* pConfig, const char* varName)
@@ -450,6 +1148,95 @@ taBool32 taConfigGetBool(const taConfigObj* pConfig, const char* varName)
     return TA_TRUE;
 }
 
+
+taBool32 taConfigInitKey(taConfigKey* pKey, const char* path, unsigned int flags)
+{
+    if (pKey == NULL) {
+        return TA_FALSE;
+    }
+
+    taZeroObject(pKey);
+
+    taPathIterator iSeg;
+    if (!taPathFirst(path, &iSeg)) {
+        return TA_FALSE;
+    }
+
+    do
+    {
+        if (pKey->segmentCount == TA_CONFIG_MAX_KEY_SEGMENTS || iSeg.segment.offset + iSeg.segment.length > 0xFFFF) {
+            taZeroObject(pKey);
+            return TA_FALSE;
+        }
+
+        pKey->segments[pKey->segmentCount].offset = (taUInt16)iSeg.segment.offset;
+        pKey->segments[pKey->segmentCount].length = (taUInt16)iSeg.segment.length;
+        pKey->segments[pKey->segmentCount].hash   = taHashStringCaseInsensitiveN(path + iSeg.segment.offset, iSeg.segment.length);
+        pKey->segmentCount += 1;
+    } while (taPathNext(&iSeg));
+
+    pKey->path = path;
+    pKey->flags = flags;
+    return TA_TRUE;
+}
+
+taConfigVar* taConfigGetVarByKey(const taConfigObj* pConfig, const taConfigKey* pKey)
+{
+    if (pConfig == NULL || pKey == NULL || pKey->segmentCount == 0) {
+        return NULL;
+    }
+
+    taBool32 caseInsensitive = (pKey->flags & TA_CONFIG_KEY_CASE_INSENSITIVE) != 0;
+
+    taConfigVar* pVar = NULL;
+    for (taUInt32 iSeg = 0; iSeg < pKey->segmentCount; ++iSeg) {
+        if (iSeg > 0) {
+            pConfig = pVar->pObject;
+            if (pConfig == NULL) {
+                return NULL;    // <-- Not a sub-object.
+            }
+        }
+
+        pVar = taConfigFindVar(pConfig, pKey->path + pKey->segments[iSeg].offset, pKey->segments[iSeg].length, pKey->segments[iSeg].hash, caseInsensitive);
+        if (pVar == NULL) {
+            return NULL;
+        }
+    }
+
+    return pVar;
+}
+
+taConfigObj* taConfigGetSubObjByKey(const taConfigObj* pConfig, const taConfigKey* pKey)
+{
+    taConfigVar* pVar = taConfigGetVarByKey(pConfig, pKey);
+    if (pVar == NULL) {
+        return NULL;
+    }
+
+    return pVar->pObject;
+}
+
+const char* taConfigGetStringByKey(const taConfigObj* pConfig, const taConfigKey* pKey)
+{
+    taConfigVar* pVar = taConfigGetVarByKey(pConfig, pKey);
+    if (pVar == NULL) {
+        return NULL;
+    }
+
+    return pVar->value;
+}
+
+int taConfigGetIntByKey(const taConfigObj* pConfig, const taConfigKey* pKey)
+{
+    const char* value = taConfigGetStringByKey(pConfig, pKey);
+    if (value == NULL) {
+        return 0;
+    }
+
+    return atoi(value);
+}
+
+
 taBool32 taConfigIsSubObjByIndex(const taConfigObj* pConfig, taUInt32 varIndex)
 {
     if (pConfig == NULL || varIndex >= pConfig->varCount) {
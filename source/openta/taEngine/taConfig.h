@@ -2,6 +2,7 @@
 
 typedef struct taConfigObj taConfigObj;
 typedef struct taConfigVar taConfigVar;
+typedef struct taConfigArenaBlock taConfigArenaBlock;
 
 struct taConfigVar
 {
@@ -13,6 +14,9 @@ struct taConfigVar
 
     // A pointer to the sub-object, if applicable.
     taConfigObj* pObject;
+
+    // The case-insensitive hash of the name. This is used for looking up the variable in the hash index of the parent object.
+    taUInt32 nameHash;
 };
 
 struct taConfigObj
@@ -20,28 +24,70 @@ struct taConfigObj
     // The number of varibles making up the object.
     unsigned int varCount;
 
-    // The size of the buffer containing the variables. This is used for determining whether or not a new allocation needs to be done.
-    unsigned int bufferSize;
-
     // The list of variables making up the object.
     taConfigVar* pVars;
 
+    // The hash index over the names of the variables, built once the object has been parsed. Each slot holds the index of a variable
+    // plus one, with 0 marking an empty slot. slotCount is always a power of 2. Objects with fewer than TA_CONFIG_INDEX_THRESHOLD
+    // variables do not have an index and are searched linearly, in which case pSlots will be null.
+    taUInt32 slotCount;
+    taUInt32* pSlots;
+
 
     // Internal use only. The file used to load the config. This is only set for the root object.
     taFile* _pFile;
+
+    // Internal use only. The arena that every object, variable and index of the config is allocated from, including the root object
+    // itself. This is only set for the root object.
+    taConfigArenaBlock* _pArenaBlocks;
 };
 
+// Objects with at least this many variables get a hash index.
+#define TA_CONFIG_INDEX_THRESHOLD       8
+
+// The maximum number of segments in the path of a taConfigKey.
+#define TA_CONFIG_MAX_KEY_SEGMENTS      8
+
+// Flags for taConfigInitKey().
+#define TA_CONFIG_KEY_CASE_INSENSITIVE  (1 << 0)    // Match variable names case-insensitively like the original game does.
+
+// A pre-hashed path to a variable, such as "GlobalHeader/missionname". Use these for variables that are looked up often. Keys are
+// initialized with taConfigInitKey() and can be used with any config.
+typedef struct
+{
+    // The path the key was initialized with. This is not copied so it needs to stay valid for the life of the key.
+    const char* path;
+
+    // The TA_CONFIG_KEY_* flags.
+    unsigned int flags;
+
+    // The location and hash of each segment of the path.
+    taUInt32 segmentCount;
+    struct
+    {
+        taUInt16 offset;
+        taUInt16 length;
+        taUInt32 hash;
+    } segments[TA_CONFIG_MAX_KEY_SEGMENTS];
+} taConfigKey;
+
+// The directory within the root directory where compiled configs are cached.
+#define TA_CONFIG_CACHE_DIRECTORY       "configcache"
+
 // Parses a script.
 //
-// Configs are immutable after parsing.
+// Configs are immutable after parsing. Configs in memory mapped archives are compiled to a binary form the first time they're parsed,
+// and cached in TA_CONFIG_CACHE_DIRECTORY. From then on the cached form is loaded instead, until the source file changes.
 taConfigObj* taParseConfigFromSpecificFile(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath);
 taConfigObj* taParseConfigFromFile(taFS* pFS, const char* fileRelativePath);
 
-// Deletes the given config object.
+// Deletes the given config object. This must be the root object returned by one of the functions above, and frees every sub-object
+// along with it.
 void taDeleteConfig(taConfigObj* pConfig);
 
 
-// Retrieves a pointer to a generic variable from the given config.
+// Retrieves a pointer to a generic variable from the given config. Variables in sub-objects are retrieved with a path such as
+// "GlobalHeader/missionname". Names are case-sensitive.
 taConfigVar* taConfigGetVar(const taConfigObj* pConfig, const char* varName);
 
 // Retrieves the value of the given config variable as a sub-object. Returns NULL if the variable does not exist.
@@ -61,5 +107,16 @@ float taConfigGetFloat(const taConfigObj* pConfig, const char* varName);
 taBool32 taConfigGetBool(const taConfigObj* pConfig, const char* varName);
 
 
+// Initializes a key for the variable at the given path. Returns false if the path is empty, or has more than
+// TA_CONFIG_MAX_KEY_SEGMENTS segments.
+taBool32 taConfigInitKey(taConfigKey* pKey, const char* path, unsigned int flags);
+
+// The same as the functions above, except the variable is looked up with a pre-hashed key.
+taConfigVar* taConfigGetVarByKey(const taConfigObj* pConfig, const taConfigKey* pKey);
+taConfigObj* taConfigGetSubObjByKey(const taConfigObj* pConfig, const taConfigKey* pKey);
+const char* taConfigGetStringByKey(const taConfigObj* pConfig, const taConfigKey* pKey);
+int taConfigGetIntByKey(const taConfigObj* pConfig, const taConfigKey* pKey);
+
+
 // Determines if the variable at the given index is a sub-object.
 taBool32 taConfigIsSubObjByIndex(const taConfigObj* pConfig, taUInt32 varIndex);
@@ -12,6 +12,23 @@
 // Platform headers. Never expose these publicly. Ever.
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <dirent.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/version.h>
+#if defined(__NR_io_uring_setup) && LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0) && !defined(TA_NO_IO_URING)   // <-- IORING_OP_READ needs 5.6 headers.
+#include <linux/io_uring.h>
+#define TA_SUPPORT_IO_URING
+#endif
 #endif
 
 // Platform libraries, for simplifying MSVC builds.
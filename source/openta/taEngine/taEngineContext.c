@@ -2,7 +2,7 @@
 
 TA_PRIVATE taBool32 taLoadPalette(taFS* pFS, const char* filePath, taUInt32* paletteOut)
 {
-    taFile* pPaletteFile = taOpenFile(pFS, filePath, 0);
+    taFile* pPaletteFile = taOpenFile(pFS, filePath, TA_OPEN_FILE_READ_ONLY);
     if (pPaletteFile == NULL) {
         return TA_FALSE;
     }
@@ -59,6 +59,28 @@ taResult taEngineContextInit(int argc, char** argv, taLoadPropertiesProc onLoadP
         goto on_error1;
     }
 
+    // The number of threads to use for decompressing large files. Leave this unset to use the default.
+    taPropertyHandle fsThreadCount = taPropertyManagerGetHandle(&pEngine->properties, "openta.fs-thread-count");
+    if (taPropertyManagerGetTypeByHandle(&pEngine->properties, fsThreadCount) != TA_PROPERTY_TYPE_NONE) {
+        taFSSetThreadCount(pEngine->pFS, (taUInt32)taPropertyManagerGetIntByHandle(&pEngine->properties, fsThreadCount));
+    }
+
+    // The number of threads to use for asynchronous file requests. Leave this unset to use the default.
+    taPropertyHandle fsIOThreadCount = taPropertyManagerGetHandle(&pEngine->properties, "openta.fs-io-thread-count");
+    if (taPropertyManagerGetTypeByHandle(&pEngine->properties, fsIOThreadCount) != TA_PROPERTY_TYPE_NONE) {
+        taFSSetIOThreadCount(pEngine->pFS, (taUInt32)taPropertyManagerGetIntByHandle(&pEngine->properties, fsIOThreadCount));
+    }
+
+    // The maximum number of bytes to keep in the cache of decompressed files. Leave this unset to use the default, or set it to 0 to
+    // disable the cache. Sizes that don't fit in an int can be given as a string.
+    taPropertyHandle fsCacheSize = taPropertyManagerGetHandle(&pEngine->properties, "openta.fs-cache-size");
+    taUInt32 fsCacheSizeType = taPropertyManagerGetTypeByHandle(&pEngine->properties, fsCacheSize);
+    if (fsCacheSizeType == TA_PROPERTY_TYPE_STRING) {
+        taFSSetCacheSize(pEngine->pFS, (size_t)strtoull(taPropertyManagerGetByHandle(&pEngine->properties, fsCacheSize), NULL, 10));
+    } else if (fsCacheSizeType != TA_PROPERTY_TYPE_NONE) {
+        taFSSetCacheSize(pEngine->pFS, (size_t)taPropertyManagerGetIntByHandle(&pEngine->properties, fsCacheSize));
+    }
+
 
     //// Graphics ////
 
@@ -150,7 +172,9 @@ taResult taEngineContextInit(int argc, char** argv, taLoadPropertiesProc onLoadP
     iGAF = taFSBegin(pEngine->pFS, "textures", TA_FALSE);
     while (taFSNext(iGAF)) {
         if (taPathExtensionEqual(iGAF->fileInfo.relativePath, "gaf")) {
-            pEngine->ppTextureGAFs[pEngine->textureGAFCount] = taOpenGAF(pEngine->pFS, iGAF->fileInfo.relativePath);
+            // These are streamed because they stay open for the lifetime of the engine, but only a handful of textures are read from
+            // each of them when a map is loaded.
+            pEngine->ppTextureGAFs[pEngine->textureGAFCount] = taOpenGAF(pEngine->pFS, iGAF->fileInfo.relativePath, TA_OPEN_FILE_STREAMED);
             if (pEngine->ppTextureGAFs[pEngine->textureGAFCount] != NULL) {
                 pEngine->textureGAFCount += 1;
             } else {
@@ -209,7 +233,7 @@ taTexture* taLoadImage(taEngineContext* pEngine, const char* filePath)
     }
     
     if (taPathExtensionEqual(filePath, "pcx")) {
-        taFile* pFile = taOpenFile(pEngine->pFS, filePath, 0);
+        taFile* pFile = taOpenFile(pEngine->pFS, filePath, TA_OPEN_FILE_READ_ONLY);
         if (pFile == NULL) {
             return NULL;    // File not found.
         }
@@ -11,6 +11,105 @@ typedef struct
     taUInt32 startPos;
 } taHPIHeader;
 
+#define TA_HPI_CHUNK_SIZE           65536
+#define TA_HPI_CHUNK_HEADER_SIZE    19
+
+typedef struct
+{
+    taUInt32 marker;
+    taUInt8 unused;
+    taUInt8 compressionType;
+    taUInt8 encrypted;
+    taUInt32 compressedSize;
+    taUInt32 uncompressedSize;
+    taUInt32 checksum;
+} taHPIChunkHeader;
+
+typedef struct
+{
+    taHPIChunkHeader header;
+
+    // The position of the chunk's compressed data within the archive.
+    size_t dataPos;
+
+    // The offset of the chunk's region within the scratch buffer.
+    size_t scratchOffset;
+} taHPIChunk;
+
+// A file's data, read from an archive that could not be memory mapped. The data is decrypted, but is still compressed.
+typedef struct
+{
+    // The file to read.
+    taFSArchive* pArchive;
+    taUInt32 dataOffset;
+    taUInt32 dataSize;
+    taUInt32 compressionType;
+
+    // The file's data. For compressed files this starts with the chunk sizes and runs to the end of the last chunk. This is null if
+    // the data could not be read.
+    taUInt8* pRawData;
+    size_t rawDataSize;
+
+    // This file's share of the time it took to read the batch it was read in, in nanoseconds. Only set while I/O statistics are
+    // being gathered.
+    taUInt64 readTime;
+} taFSRawRead;
+
+// The I/O statistics of a single open, gathered while I/O statistics are enabled. Times are in nanoseconds. The chunks of a file can
+// be decoded on multiple threads, so the times are only ever updated with taFSIOCountersAddTime().
+typedef struct
+{
+    volatile taUInt64 readTime;
+    volatile taUInt64 decryptTime;
+    volatile taUInt64 decompressTime;
+    taUInt64 storedBytes;
+    taBool32 isCacheHit;
+} taFSIOCounters;
+
+// Streamed files. These are implemented near the bottom of this file.
+TA_PRIVATE taBool32 taFSCanStreamFile(taFSArchive* pArchive, taUInt32 dataSize, taUInt32 compressionType, unsigned int options);
+TA_PRIVATE taFile* taFSOpenStreamedFile(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType);
+TA_PRIVATE size_t taStreamedFileRead(taFile* pFile, void* pBufferOut, size_t bytesToRead);
+
+// The pack. This is also implemented near the bottom of this file.
+TA_PRIVATE void taFSMountPack(taFS* pFS);
+TA_PRIVATE void taFSUnmountPack(taFS* pFS);
+TA_PRIVATE void taFSResolvePack(taFS* pFS);
+TA_PRIVATE taUInt32 taFSPackFindSource(const taFSPack* pPack, const char* archiveRelativePath, const taMappedFile* pArchiveFile, taUInt32 centralDirectorySize);
+TA_PRIVATE const taUInt8* taFSPackGetCentralDirectory(const taFSPack* pPack, taUInt32 sourceIndex);
+TA_PRIVATE taFile* taFSOpenFileFromPack(taFS* pFS, taUInt32 packFileIndex, unsigned int options);
+
+// Asynchronous loading. This is also implemented near the bottom of this file.
+TA_PRIVATE void taFSStopIOThreads(taFS* pFS);
+
+// The file cache. This is also implemented near the bottom of this file.
+TA_PRIVATE taBool32 taFSCanCacheFile(taFS* pFS, taUInt32 dataSize, unsigned int options);
+TA_PRIVATE taFile* taFSOpenCachedFile(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType, const taFSRawRead* pRawRead, taFSIOCounters* pCounters);
+TA_PRIVATE void taFSCloseCachedFile(taFile* pFile);
+
+// Cached directory listings. These are implemented with the iteration functions.
+TA_PRIVATE void taFSClearListings(taFS* pFS);
+
+// Recording for manifests. This is also implemented near the bottom of this file.
+TA_PRIVATE void taFSRecordAccess(taFS* pFS, taUInt32 entryIndex, unsigned int options);
+
+// I/O statistics. This is also implemented near the bottom of this file.
+TA_PRIVATE void taFSIOCountersAddTime(volatile taUInt64* pTime, taTimer* pTimer);
+TA_PRIVATE void taFSTouchPages(const taUInt8* pData, size_t sizeInBytes);
+TA_PRIVATE void taFSRecordIO(taFS* pFS, taUInt32 entryIndex, const taFSIOCounters* pCounters);
+
+// HPI helpers. These are implemented with the rest of the HPI functions.
+TA_PRIVATE size_t taHPICalculateChunkCount(size_t uncompressedSize);
+TA_PRIVATE taBool32 taHPIDecodeCompressedFromMemory(const taUInt8* pArchiveData, size_t archiveSize, taUInt32 dataOffset, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey, taThreadPool* pThreadPool, taFSIOCounters* pCounters);
+
+// Reading from archives that could not be memory mapped. This is also implemented near the bottom of this file.
+TA_PRIVATE taFSRing* taFSCreateRing();
+TA_PRIVATE void taFSDeleteRing(taFSRing* pRing);
+#ifndef _WIN32
+TA_PRIVATE taUInt8* taFSReadRawFileData(taFS* pFS, taFSRawRead* pReads, taUInt32 readCount);
+TA_PRIVATE taBool32 taFSDecodeRawFileData(taFS* pFS, const taFSRawRead* pRead, void* pDataOut, taFSIOCounters* pCounters);
+#endif
+
 FILE* taFOpen(const char* filePath, const char* openMode)
 {
     FILE* pFile;
@@ -47,6 +146,155 @@ taInt64 taFTell(FILE* pFile)
 }
 
 
+// Files within an archive that are at least this big will have the OS advised that they are about to be read sequentially. Smaller
+// files aren't worth the system call.
+#define TA_FS_SEQUENTIAL_ADVICE_THRESHOLD   (256*1024)
+
+// Files opened together with taOpenFiles() that are closer than this within the same archive have their advice merged into one range.
+#define TA_FS_BATCHED_OPEN_MERGE_DISTANCE   (64*1024)
+
+// The maximum number of bytes taOpenFiles() will read up front from archives that could not be memory mapped.
+#define TA_FS_MAX_RAW_BATCH_SIZE            (8*1024*1024)
+
+// The maximum number of decompression threads to use by default. Decompression is quickly bottlenecked by memory bandwidth so there's
+// not much point going beyond this.
+#define TA_FS_MAX_DEFAULT_THREAD_COUNT      8
+
+taBool32 taMapFile(const char* filePath, taMappedFile* pMappedFile)
+{
+    assert(filePath != NULL);
+    assert(pMappedFile != NULL);
+
+    taZeroObject(pMappedFile);
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return TA_FALSE;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 || (taUInt64)fileSize.QuadPart > (size_t)-1) {
+        CloseHandle(hFile);
+        return TA_FALSE;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL) {
+        CloseHandle(hFile);
+        return TA_FALSE;
+    }
+
+    void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (pData == NULL) {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return TA_FALSE;
+    }
+
+    FILETIME modifiedTime;
+    if (GetFileTime(hFile, NULL, NULL, &modifiedTime)) {
+        pMappedFile->modifiedTime = ((taUInt64)modifiedTime.dwHighDateTime << 32) | modifiedTime.dwLowDateTime;
+    }
+
+    pMappedFile->pData = (const taUInt8*)pData;
+    pMappedFile->sizeInBytes = (size_t)fileSize.QuadPart;
+    pMappedFile->hFile = hFile;
+    pMappedFile->hMapping = hMapping;
+#else
+    int fd = open(filePath, O_RDONLY);
+    if (fd == -1) {
+        return TA_FALSE;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 || (taUInt64)info.st_size > (size_t)-1) {
+        close(fd);
+        return TA_FALSE;
+    }
+
+    void* pData = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // <-- The mapping holds its own reference to the file so the descriptor can be closed straight away.
+
+    if (pData == MAP_FAILED) {
+        return TA_FALSE;
+    }
+
+    pMappedFile->pData = (const taUInt8*)pData;
+    pMappedFile->sizeInBytes = (size_t)info.st_size;
+    pMappedFile->modifiedTime = (taUInt64)info.st_mtime;
+#endif
+
+    return TA_TRUE;
+}
+
+void taUnmapFile(taMappedFile* pMappedFile)
+{
+    assert(pMappedFile != NULL);
+
+    if (pMappedFile->pData == NULL) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(pMappedFile->pData);
+    CloseHandle(pMappedFile->hMapping);
+    CloseHandle(pMappedFile->hFile);
+#else
+    munmap((void*)pMappedFile->pData, pMappedFile->sizeInBytes);
+#endif
+
+    taZeroObject(pMappedFile);
+}
+
+// Lets the OS know that the given range of the mapping is about to be read from start to end. This is only a hint, and is
+// currently a no-op on Windows.
+TA_PRIVATE void taMappedFileAdviseSequential(const taMappedFile* pMappedFile, size_t offset, size_t sizeInBytes)
+{
+    assert(pMappedFile != NULL);
+
+    if (pMappedFile->pData == NULL || offset >= pMappedFile->sizeInBytes) {
+        return;
+    }
+
+    if (sizeInBytes > pMappedFile->sizeInBytes - offset) {
+        sizeInBytes = pMappedFile->sizeInBytes - offset;
+    }
+
+#ifndef _WIN32
+    // madvise() requires a page aligned address.
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = offset & ~(pageSize - 1);
+    void* pAlignedData = (void*)(pMappedFile->pData + alignedOffset);
+    size_t alignedSize = sizeInBytes + (offset - alignedOffset);
+
+    madvise(pAlignedData, alignedSize, MADV_SEQUENTIAL);
+    madvise(pAlignedData, alignedSize, MADV_WILLNEED);
+#endif
+}
+
+// Asks the OS to start reading the given range of the mapping in the background. Unlike taMappedFileAdviseSequential() this does not
+// change how the rest of the range is read ahead, so it's fine to use on small files. This is currently a no-op on Windows.
+TA_PRIVATE void taMappedFileAdviseWillNeed(const taMappedFile* pMappedFile, size_t offset, size_t sizeInBytes)
+{
+    assert(pMappedFile != NULL);
+
+    if (pMappedFile->pData == NULL || offset >= pMappedFile->sizeInBytes || sizeInBytes == 0) {
+        return;
+    }
+
+    if (sizeInBytes > pMappedFile->sizeInBytes - offset) {
+        sizeInBytes = pMappedFile->sizeInBytes - offset;
+    }
+
+#ifndef _WIN32
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = offset & ~(pageSize - 1);
+    madvise((void*)(pMappedFile->pData + alignedOffset), sizeInBytes + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+
 TA_PRIVATE taBool32 taFSFindFileInArchive(taFS* pFS, taFSArchive* pArchive, const char* fileRelativePath, taUInt32* pDataPosOut)
 {
     assert(pFS != NULL);
@@ -127,14 +375,142 @@ TA_PRIVATE taBool32 taFSFindFileInArchive(taFS* pFS, taFSArchive* pArchive, cons
 }
 
 
-TA_PRIVATE taBool32 taFSFileExistsInList(const char* relativePath, taUInt32 fileCount, taFSFileInfo* pFiles)
+// Directory listings are gathered into a builder and then compacted into a single allocation. Every string is stored in one
+// buffer and referenced by offset while building, and duplicates are found with a hash set rather than by searching the list.
+typedef struct
+{
+    taUInt32 pathOffset;
+    taUInt32 archivePathOffset;
+    taUInt32 hash;
+    taBool32 isDirectory;
+} taFSListingItem;
+
+typedef struct
+{
+    taFSListingItem* pItems;
+    taUInt32 itemCount;
+    taUInt32 itemCapacity;
+
+    // Offset 0 is always an empty string.
+    char* pStrings;
+    size_t stringsSize;
+    size_t stringsCapacity;
+
+    // The set of items from previous sources. Each slot is an item index plus one, with 0 being an empty slot. Items from the source
+    // currently being gathered are only added once the next source begins.
+    taUInt32* pSet;
+    taUInt32 setCapacity;
+    taUInt32 setItemCount;
+
+    // The path of the archive currently being gathered. Each archive's path is only stored once.
+    taUInt32 archivePathOffset;
+
+    // Set when an allocation fails. The listing will be incomplete.
+    taBool32 isOutOfMemory;
+} taFSListingBuilder;
+
+TA_PRIVATE taUInt32 taFSListingBuilderPushString(taFSListingBuilder* pBuilder, const char* str)
+{
+    assert(pBuilder != NULL);
+    assert(str != NULL);
+
+    size_t len = strlen(str) + 1;
+    if (pBuilder->stringsSize + len > pBuilder->stringsCapacity) {
+        size_t newCapacity = (pBuilder->stringsCapacity == 0) ? 4096 : pBuilder->stringsCapacity * 2;
+        while (newCapacity < pBuilder->stringsSize + len) {
+            newCapacity *= 2;
+        }
+
+        char* pNewStrings = (newCapacity <= 0xFFFFFFFF) ? realloc(pBuilder->pStrings, newCapacity) : NULL;    // <-- Strings are referenced with 32-bit offsets.
+        if (pNewStrings == NULL) {
+            pBuilder->isOutOfMemory = TA_TRUE;
+            return 0;
+        }
+
+        pBuilder->pStrings = pNewStrings;
+        pBuilder->stringsCapacity = newCapacity;
+    }
+
+    taUInt32 offset = (taUInt32)pBuilder->stringsSize;
+    memcpy(pBuilder->pStrings + offset, str, len);
+    pBuilder->stringsSize += len;
+
+    return offset;
+}
+
+TA_PRIVATE void taFSListingBuilderInit(taFSListingBuilder* pBuilder)
+{
+    assert(pBuilder != NULL);
+
+    taZeroObject(pBuilder);
+    taFSListingBuilderPushString(pBuilder, "");
+}
+
+TA_PRIVATE void taFSListingBuilderUninit(taFSListingBuilder* pBuilder)
+{
+    assert(pBuilder != NULL);
+
+    free(pBuilder->pItems);
+    free(pBuilder->pStrings);
+    free(pBuilder->pSet);
+}
+
+TA_PRIVATE void taFSListingBuilderInsertIntoSet(taFSListingBuilder* pBuilder, taUInt32 itemIndex)
+{
+    taUInt32 mask = pBuilder->setCapacity - 1;
+    taUInt32 iSlot = pBuilder->pItems[itemIndex].hash & mask;
+    while (pBuilder->pSet[iSlot] != 0) {
+        iSlot = (iSlot + 1) & mask;
+    }
+
+    pBuilder->pSet[iSlot] = itemIndex + 1;
+}
+
+TA_PRIVATE void taFSListingBuilderBeginSource(taFSListingBuilder* pBuilder, const char* archiveRelativePath)
+{
+    assert(pBuilder != NULL);
+    assert(archiveRelativePath != NULL);
+
+    // Every item gathered up to this point needs to be added to the set. The set is kept at most half full.
+    if (pBuilder->itemCount * 2 > pBuilder->setCapacity) {
+        taUInt32 newCapacity = (pBuilder->setCapacity == 0) ? 256 : pBuilder->setCapacity;
+        while (newCapacity < pBuilder->itemCount * 2) {
+            newCapacity *= 2;
+        }
+
+        taUInt32* pNewSet = calloc(newCapacity, sizeof(*pNewSet));
+        if (pNewSet == NULL) {
+            pBuilder->isOutOfMemory = TA_TRUE;
+            return;
+        }
+
+        free(pBuilder->pSet);
+        pBuilder->pSet = pNewSet;
+        pBuilder->setCapacity = newCapacity;
+        pBuilder->setItemCount = 0;
+    }
+
+    for (taUInt32 iItem = pBuilder->setItemCount; iItem < pBuilder->itemCount; ++iItem) {
+        taFSListingBuilderInsertIntoSet(pBuilder, iItem);
+    }
+    pBuilder->setItemCount = pBuilder->itemCount;
+
+    pBuilder->archivePathOffset = (archiveRelativePath[0] == '\0') ? 0 : taFSListingBuilderPushString(pBuilder, archiveRelativePath);
+}
+
+TA_PRIVATE taBool32 taFSListingBuilderContains(const taFSListingBuilder* pBuilder, const char* relativePath, taUInt32 hash)
 {
-    if (pFiles == NULL) {
+    assert(pBuilder != NULL);
+    assert(relativePath != NULL);
+
+    if (pBuilder->setCapacity == 0) {
         return TA_FALSE;
     }
 
-    for (taUInt32 i = 0; i < fileCount; ++i) {
-        if (_stricmp(pFiles[i].relativePath, relativePath) == 0) {    // <-- TA seems to be case insensitive.
+    taUInt32 mask = pBuilder->setCapacity - 1;
+    for (taUInt32 iSlot = hash & mask; pBuilder->pSet[iSlot] != 0; iSlot = (iSlot + 1) & mask) {
+        const taFSListingItem* pItem = &pBuilder->pItems[pBuilder->pSet[iSlot] - 1];
+        if (pItem->hash == hash && _stricmp(pBuilder->pStrings + pItem->pathOffset, relativePath) == 0) {    // <-- TA seems to be case insensitive.
             return TA_TRUE;
         }
     }
@@ -142,12 +518,106 @@ TA_PRIVATE taBool32 taFSFileExistsInList(const char* relativePath, taUInt32 file
     return TA_FALSE;
 }
 
-TA_PRIVATE void taFSGatherFilesInNativeDirectory(taFS* pFS, const char* directoryRelativePath, taBool32 recursive, taUInt32* pFileCountInOut, taFSFileInfo** ppFilesInOut)
+TA_PRIVATE taBool32 taFSListingBuilderPushItem(taFSListingBuilder* pBuilder, const char* relativePath, taUInt32 hash, taBool32 isDirectory)
+{
+    assert(pBuilder != NULL);
+    assert(relativePath != NULL);
+
+    if (pBuilder->isOutOfMemory) {
+        return TA_FALSE;
+    }
+
+    if (pBuilder->itemCount == pBuilder->itemCapacity) {
+        taUInt32 newCapacity = (pBuilder->itemCapacity == 0) ? 256 : pBuilder->itemCapacity * 2;
+        taFSListingItem* pNewItems = realloc(pBuilder->pItems, newCapacity * sizeof(*pNewItems));
+        if (pNewItems == NULL) {
+            pBuilder->isOutOfMemory = TA_TRUE;
+            return TA_FALSE;
+        }
+
+        pBuilder->pItems = pNewItems;
+        pBuilder->itemCapacity = newCapacity;
+    }
+
+    taUInt32 pathOffset = taFSListingBuilderPushString(pBuilder, relativePath);
+    if (pBuilder->isOutOfMemory) {
+        return TA_FALSE;
+    }
+
+    taFSListingItem* pItem = &pBuilder->pItems[pBuilder->itemCount];
+    pItem->pathOffset = pathOffset;
+    pItem->archivePathOffset = pBuilder->archivePathOffset;
+    pItem->hash = hash;
+    pItem->isDirectory = isDirectory;
+    pBuilder->itemCount += 1;
+
+    return TA_TRUE;
+}
+
+struct taFSListing
+{
+    // The next listing in the same bucket of the listing cache.
+    taFSListing* pNextInBucket;
+
+    // The directory this listing was gathered from, and its case insensitive hash.
+    const char* directoryRelativePath;
+    taUInt32 hash;
+    taBool32 recursive;
+
+    // The cache holds one reference, and each iterator holds one.
+    taUInt32 refCount;
+
+    // The files, in iteration order.
+    taUInt32 fileCount;
+    taFSFileInfo* pFiles;
+};
+
+// Compacts the builder into a listing. The listing, its files and its strings all live in a single allocation, so it is freed with free().
+TA_PRIVATE taFSListing* taFSListingBuilderFinalize(const taFSListingBuilder* pBuilder, const char* directoryRelativePath, taBool32 recursive)
+{
+    assert(pBuilder != NULL);
+    assert(directoryRelativePath != NULL);
+
+    if (pBuilder->isOutOfMemory) {
+        return NULL;
+    }
+
+    size_t directoryPathSize = strlen(directoryRelativePath) + 1;
+    size_t filesSize = pBuilder->itemCount * sizeof(taFSFileInfo);
+
+    taFSListing* pListing = malloc(sizeof(*pListing) + filesSize + pBuilder->stringsSize + directoryPathSize);
+    if (pListing == NULL) {
+        return NULL;
+    }
+
+    char* pStrings = (char*)(pListing + 1) + filesSize;
+    memcpy(pStrings, pBuilder->pStrings, pBuilder->stringsSize);
+
+    char* pDirectoryPath = pStrings + pBuilder->stringsSize;
+    memcpy(pDirectoryPath, directoryRelativePath, directoryPathSize);
+
+    pListing->pNextInBucket = NULL;
+    pListing->directoryRelativePath = pDirectoryPath;
+    pListing->hash = taHashStringCaseInsensitive(directoryRelativePath);
+    pListing->recursive = recursive;
+    pListing->refCount = 0;
+    pListing->fileCount = pBuilder->itemCount;
+    pListing->pFiles = (taFSFileInfo*)(pListing + 1);
+
+    for (taUInt32 iItem = 0; iItem < pBuilder->itemCount; ++iItem) {
+        pListing->pFiles[iItem].archiveRelativePath = pStrings + pBuilder->pItems[iItem].archivePathOffset;
+        pListing->pFiles[iItem].relativePath        = pStrings + pBuilder->pItems[iItem].pathOffset;
+        pListing->pFiles[iItem].isDirectory         = pBuilder->pItems[iItem].isDirectory;
+    }
+
+    return pListing;
+}
+
+TA_PRIVATE void taFSGatherFilesInNativeDirectory(taFS* pFS, const char* directoryRelativePath, taBool32 recursive, taFSListingBuilder* pBuilder)
 {
     assert(pFS != NULL);
     assert(directoryRelativePath != NULL);
-    assert(pFileCountInOut != NULL);
-    assert(ppFilesInOut != NULL);
+    assert(pBuilder != NULL);
 
 #ifdef _WIN32
     char searchQuery[TA_MAX_PATH];
@@ -164,8 +634,6 @@ TA_PRIVATE void taFSGatherFilesInNativeDirectory(taFS* pFS, const char* director
     searchQuery[searchQueryLength + 1] = '*';
     searchQuery[searchQueryLength + 2] = '\0';
 
-    taUInt32 fileCount = 0;
-
     WIN32_FIND_DATAA ffd;
     HANDLE hFind = FindFirstFileA(searchQuery, &ffd);
     if (hFind == INVALID_HANDLE_VALUE) {
@@ -179,42 +647,71 @@ TA_PRIVATE void taFSGatherFilesInNativeDirectory(taFS* pFS, const char* director
             continue;
         }
 
-        taFSFileInfo fi;
-        fi.archiveRelativePath[0] = '\0';
-        taPathAppend(fi.relativePath, sizeof(fi.relativePath), directoryRelativePath, ffd.cFileName);
-        fi.isDirectory = (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-
-        // Skip past the file if it's already in the list.
-        if (taFSFileExistsInList(fi.relativePath, *pFileCountInOut, *ppFilesInOut)) {
+        char relativePath[TA_MAX_PATH];
+        if (!taPathAppend(relativePath, sizeof(relativePath), directoryRelativePath, ffd.cFileName)) {
             continue;
         }
 
-
-
-        taFSFileInfo* pNewFiles = realloc(*ppFilesInOut, ((*pFileCountInOut) + fileCount + 1) * sizeof(**ppFilesInOut));
-        if (pNewFiles == NULL) {
+        // The real file system has the highest priority so there is never anything to deduplicate against.
+        taBool32 isDirectory = (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (!taFSListingBuilderPushItem(pBuilder, relativePath, taHashStringCaseInsensitive(relativePath), isDirectory)) {
             break;
         }
 
-        (*ppFilesInOut) = pNewFiles;
-        (*ppFilesInOut)[*pFileCountInOut + fileCount] = fi;
-        fileCount += 1;
-
-
-        if (recursive && ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            taFSGatherFilesInNativeDirectory(pFS, fi.relativePath, recursive, pFileCountInOut, ppFilesInOut);
+        if (recursive && isDirectory) {
+            taFSGatherFilesInNativeDirectory(pFS, relativePath, recursive, pBuilder);
         }
 
     } while (FindNextFileA(hFind, &ffd));
 
     FindClose(hFind);
-    *pFileCountInOut += fileCount;
 #else
-    // TODO: Posix
+    char directoryAbsolutePath[TA_MAX_PATH];
+    if (!taPathAppend(directoryAbsolutePath, sizeof(directoryAbsolutePath), pFS->rootDir, directoryRelativePath)) {
+        return;
+    }
+
+    DIR* pDir = opendir(directoryAbsolutePath);
+    if (pDir == NULL) {
+        return; // Failed to begin search.
+    }
+
+    struct dirent* pEntry;
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        // Skip past "." and ".." directories.
+        if (strcmp(pEntry->d_name, ".") == 0 || strcmp(pEntry->d_name, "..") == 0) {
+            continue;
+        }
+
+        char relativePath[TA_MAX_PATH];
+        if (!taPathAppend(relativePath, sizeof(relativePath), directoryRelativePath, pEntry->d_name)) {
+            continue;
+        }
+
+        // d_type isn't filled in by every file system so the entry is stat'd instead.
+        char absolutePath[TA_MAX_PATH];
+        struct stat info;
+        if (!taPathAppend(absolutePath, sizeof(absolutePath), pFS->rootDir, relativePath) || stat(absolutePath, &info) != 0) {
+            continue;
+        }
+
+        // The real file system has the highest priority so there is never anything to deduplicate against.
+        taBool32 isDirectory = S_ISDIR(info.st_mode);
+        if (!taFSListingBuilderPushItem(pBuilder, relativePath, taHashStringCaseInsensitive(relativePath), isDirectory)) {
+            break;
+        }
+
+        if (recursive && isDirectory) {
+            taFSGatherFilesInNativeDirectory(pFS, relativePath, recursive, pBuilder);
+        }
+    }
+
+    closedir(pDir);
 #endif
 }
 
-TA_PRIVATE void taFSGatherFilesInArchiveDirectoryAtLocation(taFS* pFS, taFSArchive* pArchive, taUInt32 directoryDataPos, const char* parentPath, taBool32 recursive, taUInt32* pFileCountInOut, taFSFileInfo** ppFilesInOut, taUInt32 prevFileCount)
+TA_PRIVATE void taFSGatherFilesInArchiveDirectoryAtLocation(taFS* pFS, taFSArchive* pArchive, taUInt32 directoryDataPos, const char* parentPath, taBool32 recursive, taFSListingBuilder* pBuilder)
 {
     taMemoryStream stream = taCreateMemoryStream(pArchive->pCentralDirectory, pArchive->centralDirectorySize);
     if (!taMemoryStreamSeek(&stream, directoryDataPos, taSeekOriginStart)) {
@@ -248,39 +745,33 @@ TA_PRIVATE void taFSGatherFilesInArchiveDirectoryAtLocation(taFS* pFS, taFSArchi
         }
 
 
-        taFSFileInfo fi;
-        ta_strncpy_s(fi.archiveRelativePath, sizeof(fi.archiveRelativePath), pArchive->relativePath, _TRUNCATE);
-        taPathAppend(fi.relativePath, sizeof(fi.relativePath), parentPath, pArchive->pCentralDirectory + namePos);
-        fi.isDirectory = isDirectory;
-
-        // Skip past the file if it's already in the list. Never skip directories.
-        if (!fi.isDirectory && taFSFileExistsInList(fi.relativePath, prevFileCount, *ppFilesInOut)) {       // <-- use prevFileCount here to make this search more efficient.
+        char relativePath[TA_MAX_PATH];
+        if (!taPathAppend(relativePath, sizeof(relativePath), parentPath, pArchive->pCentralDirectory + namePos)) {
             continue;
         }
 
+        // Skip past the file if a higher priority source already has it. Never skip directories.
+        taUInt32 hash = taHashStringCaseInsensitive(relativePath);
+        if (!isDirectory && taFSListingBuilderContains(pBuilder, relativePath, hash)) {
+            continue;
+        }
 
-        taFSFileInfo* pNewFiles = realloc(*ppFilesInOut, ((*pFileCountInOut) + 1) * sizeof(**ppFilesInOut));
-        if (pNewFiles == NULL) {
+        if (!taFSListingBuilderPushItem(pBuilder, relativePath, hash, isDirectory)) {
             return;
         }
 
-        (*ppFilesInOut) = pNewFiles;
-        (*ppFilesInOut)[*pFileCountInOut] = fi;
-        *pFileCountInOut += 1;
-
 
         if (recursive && isDirectory) {
-            taFSGatherFilesInArchiveDirectoryAtLocation(pFS, pArchive, dataPos, fi.relativePath, recursive, pFileCountInOut, ppFilesInOut, prevFileCount);
+            taFSGatherFilesInArchiveDirectoryAtLocation(pFS, pArchive, dataPos, relativePath, recursive, pBuilder);
         }
     }
 }
 
-TA_PRIVATE void taFSGatherFilesInArchiveDirectory(taFS* pFS, taFSArchive* pArchive, const char* directoryRelativePath, taBool32 recursive, taUInt32* pFileCountInOut, taFSFileInfo** ppFilesInOut)
+TA_PRIVATE void taFSGatherFilesInArchiveDirectory(taFS* pFS, taFSArchive* pArchive, const char* directoryRelativePath, taBool32 recursive, taFSListingBuilder* pBuilder)
 {
     assert(pFS != NULL);
     assert(directoryRelativePath != NULL);
-    assert(pFileCountInOut != NULL);
-    assert(ppFilesInOut != NULL);
+    assert(pBuilder != NULL);
 
     // The first thing to do is find the entry within the central directory that represents the directory. 
     taUInt32 directoryDataPos;
@@ -289,7 +780,7 @@ TA_PRIVATE void taFSGatherFilesInArchiveDirectory(taFS* pFS, taFSArchive* pArchi
     }
 
     // We found the directory, so now we need to gather the files within it.
-    taFSGatherFilesInArchiveDirectoryAtLocation(pFS, pArchive, directoryDataPos, directoryRelativePath, recursive, pFileCountInOut, ppFilesInOut, *pFileCountInOut);
+    taFSGatherFilesInArchiveDirectoryAtLocation(pFS, pArchive, directoryDataPos, directoryRelativePath, recursive, pBuilder);
 }
 
 TA_PRIVATE int taFSFileInfoQuickSortCallback(const void* a, const void* b)
@@ -408,30 +899,50 @@ TA_PRIVATE taBool32 taFSRegisterArchive(taFS* pFS, const char* archiveRelativePa
         return TA_FALSE;
     }
 
-    FILE* pFile = taFOpen(archiveAbsolutePath, "rb");
-    if (pFile == NULL) {
-        return TA_FALSE;
+    // The archive is mapped for the lifetime of the file system. If this fails we fall back to reading through stdio.
+    taMappedFile mappedFile;
+    FILE* pFile = NULL;
+    if (!taMapFile(archiveAbsolutePath, &mappedFile)) {
+        pFile = taFOpen(archiveAbsolutePath, "rb");
+        if (pFile == NULL) {
+            return TA_FALSE;
+        }
     }
 
 
     // Header
     taHPIHeader header;
-    if (fread(&header, 1, sizeof(header), pFile) != sizeof(header)) {
-        fclose(pFile);
-        return TA_FALSE;
+    if (pFile == NULL) {
+        if (mappedFile.sizeInBytes < sizeof(header)) {
+            taUnmapFile(&mappedFile);
+            return TA_FALSE;
+        }
+
+        memcpy(&header, mappedFile.pData, sizeof(header));
+    } else {
+        if (fread(&header, 1, sizeof(header), pFile) != sizeof(header)) {
+            fclose(pFile);
+            return TA_FALSE;
+        }
     }
 
-    if (header.marker != 'IPAH') {
-        fclose(pFile);
+    if (header.marker != 'IPAH' || header.directorySize < header.startPos || (pFile == NULL && header.directorySize > mappedFile.sizeInBytes)) {
+        if (pFile == NULL) {
+            taUnmapFile(&mappedFile);
+        } else {
+            fclose(pFile);
+        }
         return TA_FALSE;    // Not a HPI file.
     }
 
 
+    // Any listings gathered before now would be missing the files in this archive.
+    taFSClearListings(pFS);
+
     // It appears to be a valid archive - add it to the list.
     taFSArchive* pNewArchives = realloc(pFS->pArchives, (pFS->archiveCount + 1) * sizeof(*pNewArchives));
     if (pNewArchives == NULL) {
-        fclose(pFile);
-        return TA_FALSE;
+        goto on_error;
     }
 
     pFS->pArchives = pNewArchives;
@@ -439,8 +950,7 @@ TA_PRIVATE taBool32 taFSRegisterArchive(taFS* pFS, const char* archiveRelativePa
 
     taFSArchive* pArchive = pNewArchives + pFS->archiveCount;
     if (strncpy_s(pArchive->relativePath, sizeof(pArchive->relativePath), archiveRelativePath, _TRUNCATE) != 0) {
-        fclose(pFile);
-        return TA_FALSE;
+        goto on_error;
     }
 
     if (header.key == 0) {
@@ -453,671 +963,4949 @@ TA_PRIVATE taBool32 taFSRegisterArchive(taFS* pFS, const char* archiveRelativePa
     // so that they're relative to the start of the central directory data.
     pArchive->centralDirectorySize = header.directorySize - header.startPos;    // <-- Subtract header.startPos because the directory size includes the size of the header.
 
-    if (taFSeek(pFile, header.startPos, SEEK_SET) != 0) {
-        fclose(pFile);
-        return TA_FALSE;
-    }
-
     pArchive->pCentralDirectory = malloc(pArchive->centralDirectorySize);
     if (pArchive->pCentralDirectory == NULL) {
-        fclose(pFile);
-        return TA_FALSE;
+        goto on_error;
     }
 
-    if (fread(pArchive->pCentralDirectory, 1, pArchive->centralDirectorySize, pFile) != pArchive->centralDirectorySize) {
-        free(pArchive->pCentralDirectory);
-        fclose(pFile);
-        return TA_FALSE;
+    // If the pack was written from this exact archive it will have a copy of the central directory that's already been decrypted and
+    // adjusted. The pack can only be matched against mapped archives because that's where the modification time comes from.
+    pArchive->packSourceIndex = TA_FS_INDEX_NONE;
+    if (pFile == NULL) {
+        pArchive->packSourceIndex = taFSPackFindSource(&pFS->pack, archiveRelativePath, &mappedFile, pArchive->centralDirectorySize);
     }
-    
-    fclose(pFile);
 
+    if (pArchive->packSourceIndex != TA_FS_INDEX_NONE) {
+        memcpy(pArchive->pCentralDirectory, taFSPackGetCentralDirectory(&pFS->pack, pArchive->packSourceIndex), pArchive->centralDirectorySize);
+        pArchive->mappedFile = mappedFile;
 
-    // The central directory needs to be decrypted.
-    taHPIDecrypt((taUInt8*)pArchive->pCentralDirectory, pArchive->centralDirectorySize, pArchive->decryptionKey, header.startPos);
+        pFS->archiveCount += 1;
+        return TA_TRUE;
+    }
 
-    // Now we need to recursively traverse the central directory and adjust the pointers to the file names so that they're
-    // relative to the central directory. To do this we just offset it by -header.startPos. By doing this now we can simplify
+    if (pFile == NULL) {
+        // The central directory is decrypted straight out of the mapping.
+        taHPIDecryptCopy((taUInt8*)pArchive->pCentralDirectory, mappedFile.pData + header.startPos, pArchive->centralDirectorySize, pArchive->decryptionKey, header.startPos);
+        pArchive->mappedFile = mappedFile;
+    } else {
+        if (taFSeek(pFile, header.startPos, SEEK_SET) != 0) {
+            free(pArchive->pCentralDirectory);
+            goto on_error;
+        }
+
+        if (fread(pArchive->pCentralDirectory, 1, pArchive->centralDirectorySize, pFile) != pArchive->centralDirectorySize) {
+            free(pArchive->pCentralDirectory);
+            goto on_error;
+        }
+
+        fclose(pFile);
+        taZeroObject(&pArchive->mappedFile);
+
+        // The central directory needs to be decrypted.
+        taHPIDecrypt((taUInt8*)pArchive->pCentralDirectory, pArchive->centralDirectorySize, pArchive->decryptionKey, header.startPos);
+    }
+
+
+    // Now we need to recursively traverse the central directory and adjust the pointers to the file names so that they're
+    // relative to the central directory. To do this we just offset it by -header.startPos. By doing this now we can simplify
     // future traversals.
     if (!taFSAdjustCentralDirectoryNamePointers(pArchive->pCentralDirectory, pArchive->centralDirectorySize, header.startPos)) {
         free(pArchive->pCentralDirectory);
+        taUnmapFile(&pArchive->mappedFile);
         return TA_FALSE;
     }
 
-    
+
     pFS->archiveCount += 1;
     return TA_TRUE;
+
+on_error:
+    if (pFile == NULL) {
+        taUnmapFile(&mappedFile);
+    } else {
+        fclose(pFile);
+    }
+    return TA_FALSE;
 }
 
 
-TA_PRIVATE taFile* taFSOpenFileFromArchive(taFS* pFS, taFSArchive* pArchive, const char* fileRelativePath, unsigned int options)
+//// Path Index ////
+
+TA_PRIVATE taBool32 taFSIndexPushEntry(taFSIndex* pIndex, taUInt32 archiveIndex, taUInt32 entryDataPos, const char* relativePath, taMemoryStream* pCentralDirectoryStream)
 {
-    taUInt32 dataPos;
-    if (!taFSFindFileInArchive(pFS, pArchive, fileRelativePath, &dataPos)) {
-        return NULL;
+    assert(pIndex != NULL);
+    assert(relativePath != NULL);
+    assert(pCentralDirectoryStream != NULL);
+
+    // The entry data is read up front so that opening a file does not need to touch the central directory at all.
+    taUInt32 dataOffset;
+    taUInt32 dataSize;
+    taUInt8 compressionType;
+    if (!taMemoryStreamSeek(pCentralDirectoryStream, entryDataPos, taSeekOriginStart) ||
+        taMemoryStreamRead(pCentralDirectoryStream, &dataOffset, 4) != 4 ||
+        taMemoryStreamRead(pCentralDirectoryStream, &dataSize, 4) != 4 ||
+        taMemoryStreamRead(pCentralDirectoryStream, &compressionType, 1) != 1)
+    {
+        return TA_FALSE;
     }
 
-    // It's in this archive.
+    taUInt32 pathLength = (taUInt32)strlen(relativePath) + 1;   // +1 for null terminator.
+    if (pIndex->pathsSize + pathLength > pIndex->pathsCapacity) {
+        taUInt32 newPathsCapacity = (pIndex->pathsCapacity == 0) ? 65536 : pIndex->pathsCapacity*2;
+        while (newPathsCapacity < pIndex->pathsSize + pathLength) {
+            newPathsCapacity *= 2;
+        }
+
+        char* pNewPaths = (char*)realloc(pIndex->pPaths, newPathsCapacity);
+        if (pNewPaths == NULL) {
+            return TA_FALSE;
+        }
+
+        pIndex->pPaths = pNewPaths;
+        pIndex->pathsCapacity = newPathsCapacity;
+    }
+
+    if (pIndex->entryCount == pIndex->entryCapacity) {
+        taUInt32 newEntryCapacity = (pIndex->entryCapacity == 0) ? 1024 : pIndex->entryCapacity*2;
+        taFSIndexEntry* pNewEntries = (taFSIndexEntry*)realloc(pIndex->pEntries, newEntryCapacity * sizeof(*pNewEntries));
+        if (pNewEntries == NULL) {
+            return TA_FALSE;
+        }
+
+        pIndex->pEntries = pNewEntries;
+        pIndex->entryCapacity = newEntryCapacity;
+    }
+
+    taFSIndexEntry* pEntry = &pIndex->pEntries[pIndex->entryCount];
+    pEntry->hash            = taHashStringCaseInsensitive(relativePath);
+    pEntry->pathOffset      = pIndex->pathsSize;
+    pEntry->archiveIndex    = archiveIndex;
+    pEntry->entryDataPos    = entryDataPos;
+    pEntry->dataOffset      = dataOffset;
+    pEntry->dataSize        = dataSize;
+    pEntry->compressionType = compressionType;
+    pEntry->nextEntryIndex  = TA_FS_INDEX_NONE;
+    pEntry->packFileIndex   = TA_FS_INDEX_NONE;
+
+    memcpy(pIndex->pPaths + pIndex->pathsSize, relativePath, pathLength);
+    pIndex->pathsSize  += pathLength;
+    pIndex->entryCount += 1;
+
+    return TA_TRUE;
+}
+
+TA_PRIVATE taBool32 taFSIndexGatherArchiveDirectoryRecursive(taFS* pFS, taUInt32 archiveIndex, taUInt32 directoryDataPos, const char* parentPath)
+{
+    assert(pFS != NULL);
+    assert(parentPath != NULL);
+
+    taFSArchive* pArchive = &pFS->pArchives[archiveIndex];
+
+    taMemoryStream stream = taCreateMemoryStream(pArchive->pCentralDirectory, pArchive->centralDirectorySize);
+    if (!taMemoryStreamSeek(&stream, directoryDataPos, taSeekOriginStart)) {
+        return TA_FALSE;
+    }
+
+    taUInt32 fileCount;
+    if (taMemoryStreamRead(&stream, &fileCount, 4) != 4) {
+        return TA_FALSE;
+    }
+
+    taUInt32 entryOffset;
+    if (taMemoryStreamRead(&stream, &entryOffset, 4) != 4) {
+        return TA_FALSE;
+    }
+
+    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+        taUInt32 namePos;
+        if (taMemoryStreamRead(&stream, &namePos, 4) != 4) {
+            return TA_FALSE;
+        }
+
+        taUInt32 dataPos;
+        if (taMemoryStreamRead(&stream, &dataPos, 4) != 4) {
+            return TA_FALSE;
+        }
+
+        taUInt8 isDirectory;
+        if (taMemoryStreamRead(&stream, &isDirectory, 1) != 1) {
+            return TA_FALSE;
+        }
+
+        if (namePos >= pArchive->centralDirectorySize) {
+            return TA_FALSE;    // Corrupt central directory.
+        }
+
+        char relativePath[TA_MAX_PATH];
+        if (!taPathAppend(relativePath, sizeof(relativePath), parentPath, pArchive->pCentralDirectory + namePos)) {
+            continue;   // Path is too long. Skip it, which is consistent with how it would be found by searching the central directory.
+        }
+
+        if (isDirectory) {
+            if (!taFSIndexGatherArchiveDirectoryRecursive(pFS, archiveIndex, dataPos, relativePath)) {
+                return TA_FALSE;
+            }
+        } else {
+            // A separate stream is used for reading the entry data so we don't lose our place in this directory.
+            taMemoryStream entryStream = taCreateMemoryStream(pArchive->pCentralDirectory, pArchive->centralDirectorySize);
+            if (!taFSIndexPushEntry(&pFS->index, archiveIndex, dataPos, relativePath, &entryStream)) {
+                return TA_FALSE;
+            }
+        }
+    }
+
+    return TA_TRUE;
+}
+
+// Paths in the index are always separated with a single forward slash, with no leading or trailing slashes. Paths coming in from
+// elsewhere can use back slashes and redundant separators, which used to be handled by walking the path one segment at a time.
+TA_PRIVATE taBool32 taFSIndexIsPathNormalized(const char* relativePath)
+{
+    char prev = '/';    // <-- Catches a leading slash.
+    for (const char* c = relativePath; c[0] != '\0'; ++c) {
+        if (c[0] == '\\' || (c[0] == '/' && prev == '/')) {
+            return TA_FALSE;
+        }
+
+        prev = c[0];
+    }
+
+    return prev != '/' || relativePath[0] == '\0';
+}
+
+TA_PRIVATE taBool32 taFSIndexNormalizePath(const char* relativePath, char* pathOut, size_t pathOutSize)
+{
+    assert(pathOutSize > 0);
+    pathOut[0] = '\0';
+
+    taPathIterator i;
+    if (taPathFirst(relativePath, &i)) {
+        size_t pathOutLength = 0;
+        do {
+            if (i.segment.length == 0) {
+                continue;   // <-- A leading separator.
+            }
+
+            size_t separatorLength = (pathOutLength > 0) ? 1 : 0;
+            if (pathOutLength + separatorLength + i.segment.length + 1 > pathOutSize) {
+                return TA_FALSE;
+            }
+
+            if (separatorLength > 0) {
+                pathOut[pathOutLength] = '/';
+            }
+
+            memcpy(pathOut + pathOutLength + separatorLength, i.path + i.segment.offset, i.segment.length);
+            pathOutLength += separatorLength + i.segment.length;
+            pathOut[pathOutLength] = '\0';
+        } while (taPathNext(&i));
+    }
+
+    return TA_TRUE;
+}
+
+TA_PRIVATE taUInt32 taFSIndexFind(const taFSIndex* pIndex, const char* relativePath)
+{
+    assert(pIndex != NULL);
+    assert(relativePath != NULL);
+
+    if (pIndex->pSlots == NULL) {
+        return TA_FS_INDEX_NONE;
+    }
+
+    char normalizedPath[TA_MAX_PATH];
+    if (!taFSIndexIsPathNormalized(relativePath)) {
+        if (!taFSIndexNormalizePath(relativePath, normalizedPath, sizeof(normalizedPath))) {
+            return TA_FS_INDEX_NONE;    // <-- Too long to be in the index.
+        }
+
+        relativePath = normalizedPath;
+    }
+
+    taUInt32 hash = taHashStringCaseInsensitive(relativePath);
+    taUInt32 mask = pIndex->slotCount - 1;
+
+    for (taUInt32 iSlot = hash & mask; pIndex->pSlots[iSlot] != TA_FS_INDEX_NONE; iSlot = (iSlot + 1) & mask) {
+        const taFSIndexEntry* pEntry = &pIndex->pEntries[pIndex->pSlots[iSlot]];
+        if (pEntry->hash == hash && _stricmp(pIndex->pPaths + pEntry->pathOffset, relativePath) == 0) {   // <-- TA seems to be case insensitive.
+            return pIndex->pSlots[iSlot];
+        }
+    }
+
+    return TA_FS_INDEX_NONE;
+}
+
+TA_PRIVATE void taFSUninitIndex(taFSIndex* pIndex)
+{
+    assert(pIndex != NULL);
+
+    free(pIndex->pSlots);
+    free(pIndex->pEntries);
+    free(pIndex->pPaths);
+    taZeroObject(pIndex);
+}
+
+TA_PRIVATE taBool32 taFSBuildIndex(taFS* pFS)
+{
+    assert(pFS != NULL);
+
+    taFSIndex* pIndex = &pFS->index;
+    taZeroObject(pIndex);
+
+    // Every file in every archive is gathered first, in order of priority.
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        if (!taFSIndexGatherArchiveDirectoryRecursive(pFS, iArchive, 0, "")) {
+            taFSUninitIndex(pIndex);
+            return TA_FALSE;
+        }
+    }
+
+    // The hash table is kept at no more than 50% load.
+    pIndex->slotCount = taNextPowerOf2((pIndex->entryCount < 8) ? 16 : pIndex->entryCount*2);
+    pIndex->pSlots = (taUInt32*)malloc(pIndex->slotCount * sizeof(*pIndex->pSlots));
+    if (pIndex->pSlots == NULL) {
+        taFSUninitIndex(pIndex);
+        return TA_FALSE;
+    }
+
+    memset(pIndex->pSlots, 0xFF, pIndex->slotCount * sizeof(*pIndex->pSlots));   // <-- 0xFFFFFFFF = TA_FS_INDEX_NONE.
+
+    // Entries are inserted in order of priority. If a path is already in the table it will be from a higher priority archive in
+    // which case the new entry is chained to the end of the existing one.
+    taUInt32 mask = pIndex->slotCount - 1;
+    for (taUInt32 iEntry = 0; iEntry < pIndex->entryCount; ++iEntry) {
+        taFSIndexEntry* pEntry = &pIndex->pEntries[iEntry];
+        const char* relativePath = pIndex->pPaths + pEntry->pathOffset;
+
+        taUInt32 iSlot = pEntry->hash & mask;
+        for (;;) {
+            taUInt32 iExistingEntry = pIndex->pSlots[iSlot];
+            if (iExistingEntry == TA_FS_INDEX_NONE) {
+                pIndex->pSlots[iSlot] = iEntry;
+                break;
+            }
+
+            taFSIndexEntry* pExistingEntry = &pIndex->pEntries[iExistingEntry];
+            if (pExistingEntry->hash == pEntry->hash && _stricmp(pIndex->pPaths + pExistingEntry->pathOffset, relativePath) == 0) {
+                while (pExistingEntry->nextEntryIndex != TA_FS_INDEX_NONE) {
+                    pExistingEntry = &pIndex->pEntries[pExistingEntry->nextEntryIndex];
+                }
+
+                pExistingEntry->nextEntryIndex = iEntry;
+                break;
+            }
+
+            iSlot = (iSlot + 1) & mask;
+        }
+    }
+
+    return TA_TRUE;
+}
+
+
+TA_PRIVATE taBool32 taFSReadFileDataFromMappedArchive(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType, void* pDataOut, taFSIOCounters* pCounters)
+{
+    assert(pArchive->mappedFile.pData != NULL);
+
+    const taMappedFile* pMappedFile = &pArchive->mappedFile;
+    if (dataOffset >= pMappedFile->sizeInBytes) {
+        return TA_FALSE;
+    }
+
+    // For uncompressed files this is exact. For compressed files the compressed data is almost always smaller, in which case we'll
+    // end up reading ahead into the next file in the archive, which is quite likely to be loaded soon after anyway.
+    if (dataSize >= TA_FS_SEQUENTIAL_ADVICE_THRESHOLD) {
+        taMappedFileAdviseSequential(pMappedFile, dataOffset, dataSize);
+    }
+
+    if (compressionType == 0) {
+        if (dataSize > pMappedFile->sizeInBytes - dataOffset) {
+            return TA_FALSE;
+        }
+
+        // The pages are faulted in separately when gathering statistics so that reading and decrypting can be told apart.
+        taTimer timer;
+        if (pCounters != NULL) {
+            taTimerInit(&timer);
+            taFSTouchPages(pMappedFile->pData + dataOffset, dataSize);
+            taFSIOCountersAddTime(&pCounters->readTime, &timer);
+            pCounters->storedBytes += dataSize;
+        }
+
+        taHPIDecryptCopy((taUInt8*)pDataOut, pMappedFile->pData + dataOffset, dataSize, pArchive->decryptionKey, dataOffset);
+
+        if (pCounters != NULL) {
+            taFSIOCountersAddTime((pArchive->decryptionKey != 0) ? &pCounters->decryptTime : &pCounters->readTime, &timer);
+        }
+
+        return TA_TRUE;
+    } else {
+        return taHPIDecodeCompressedFromMemory(pMappedFile->pData, pMappedFile->sizeInBytes, dataOffset, pDataOut, dataSize, pArchive->decryptionKey, &pFS->threadPool, pCounters);
+    }
+}
+
+TA_PRIVATE taBool32 taFSReadFileDataFromArchive(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType, void* pDataOut, const taFSRawRead* pRawRead, taFSIOCounters* pCounters)
+{
+    // If the archive is mapped we can avoid the real file system entirely.
+    if (pArchive->mappedFile.pData != NULL) {
+        return taFSReadFileDataFromMappedArchive(pFS, pArchive, dataOffset, dataSize, compressionType, pDataOut, pCounters);
+    }
+
+    taTimer timer;
+    taZeroObject(&timer);
+    if (pCounters != NULL) {
+        taTimerInit(&timer);
+    }
+
+#ifndef _WIN32
+    // The file's data is read with a couple of large reads and then decoded in memory.
+    taBool32 isDecoded;
+    if (pRawRead == NULL) {
+        taFSRawRead rawRead;
+        rawRead.pArchive = pArchive;
+        rawRead.dataOffset = dataOffset;
+        rawRead.dataSize = dataSize;
+        rawRead.compressionType = compressionType;
+        rawRead.readTime = 0;
+
+        taUInt8* pRawData = taFSReadRawFileData(pFS, &rawRead, 1);
+        if (pCounters != NULL) {
+            taFSIOCountersAddTime(&pCounters->readTime, &timer);
+            pCounters->storedBytes += rawRead.rawDataSize;
+        }
+
+        isDecoded = rawRead.pRawData != NULL && taFSDecodeRawFileData(pFS, &rawRead, pDataOut, pCounters);
+        free(pRawData);
+    } else {
+        if (pCounters != NULL) {
+            taAtomicFetchAdd64(&pCounters->readTime, pRawRead->readTime);
+            pCounters->storedBytes += pRawRead->rawDataSize;
+        }
+
+        isDecoded = pRawRead->pRawData != NULL && taFSDecodeRawFileData(pFS, pRawRead, pDataOut, pCounters);
+    }
+
+    if (isDecoded) {
+        return TA_TRUE;
+    }
+
+    if (pCounters != NULL) {
+        taTimerInit(&timer);
+    }
+
+    // This will only fail if the chunk sizes at the start of a compressed file are wrong, or if the archive could not be read. Fall
+    // back to reading it through stdio which only relies on the chunk headers.
+#else
+    (void)pRawRead;
+#endif
+
     char archiveAbsolutePath[TA_MAX_PATH];
     if (!taPathAppend(archiveAbsolutePath, sizeof(archiveAbsolutePath), pFS->rootDir, pArchive->relativePath)) {
-        return NULL;
+        return TA_FALSE;
     }
 
     FILE* pSTDIOFile = taFOpen(archiveAbsolutePath, "rb");
     if (pSTDIOFile == NULL) {
-        return NULL;
+        return TA_FALSE;
     }
 
+    // Seek to the first byte of the file within the archive.
+    if (taFSeek(pSTDIOFile, dataOffset, taSeekOriginStart) != 0) {
+        fclose(pSTDIOFile);
+        return TA_FALSE;
+    }
 
-    taMemoryStream stream = taCreateMemoryStream(pArchive->pCentralDirectory, pArchive->centralDirectorySize);
-    taMemoryStreamSeek(&stream, dataPos, taSeekOriginStart);
+    // Here is where we need to read the file data. There is 3 types of compression used.
+    //  0 - uncompressed
+    //  1 - LZ77
+    //  2 - Zlib
+    taBool32 result;
+    if (compressionType == 0) {
+        result = taHPIReadAndDecrypt(pSTDIOFile, pDataOut, dataSize, pArchive->decryptionKey) == dataSize;
+    } else {
+        result = taHPIReadAndDecryptCompressed(pSTDIOFile, pDataOut, dataSize, pArchive->decryptionKey) != 0;
+    }
 
-    taUInt32 dataOffset;
-    if (taMemoryStreamRead(&stream, &dataOffset, 4) != 4) {
-        return NULL;
+    // Reading, decrypting and decompressing are all mixed together here so it's all counted as reading.
+    if (pCounters != NULL) {
+        taFSIOCountersAddTime(&pCounters->readTime, &timer);
+        if (result) {
+            pCounters->storedBytes += (taUInt64)(taFTell(pSTDIOFile) - dataOffset);
+        }
     }
 
-    taUInt32 dataSize;
-    if (taMemoryStreamRead(&stream, &dataSize, 4) != 4) {
+    fclose(pSTDIOFile);
+    return result;
+}
+
+// Opens a file that's neither compressed nor encrypted by pointing straight into the archive's mapping.
+TA_PRIVATE taFile* taFSOpenFileView(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taFSIOCounters* pCounters)
+{
+    assert(pFS != NULL);
+    assert(pArchive != NULL);
+    assert(pArchive->mappedFile.pData != NULL);
+    assert(pArchive->decryptionKey == 0);
+
+    taMappedFile* pMappedFile = &pArchive->mappedFile;
+    if (dataOffset > pMappedFile->sizeInBytes || dataSize > pMappedFile->sizeInBytes - dataOffset) {
         return NULL;
     }
 
-    taUInt8 compressionType;
-    if (taMemoryStreamRead(&stream, &compressionType, 1) != 1) {
-        return NULL;
+    if (dataSize >= TA_FS_SEQUENTIAL_ADVICE_THRESHOLD) {
+        taMappedFileAdviseSequential(pMappedFile, dataOffset, dataSize);
     }
 
+    // Nothing is read until the file is used, but the read is still counted in the statistics.
+    if (pCounters != NULL) {
+        taTimer timer;
+        taTimerInit(&timer);
+        taFSTouchPages(pMappedFile->pData + dataOffset, dataSize);
+        taFSIOCountersAddTime(&pCounters->readTime, &timer);
+        pCounters->storedBytes += dataSize;
+    }
 
-    // Seek to the first byte of the file within the archive.
-    if (taFSeek(pSTDIOFile, dataOffset, taSeekOriginStart) != 0) {
+    taFile* pFile = malloc(sizeof(*pFile));
+    if (pFile == NULL) {
         return NULL;
     }
 
+    pFile->pFileData = (char*)pMappedFile->pData + dataOffset;
+    pFile->_pStreamed = NULL;
+    pFile->_pCacheEntry = NULL;
+    pFile->_stream = taCreateMemoryStream(pFile->pFileData, dataSize);
+    pFile->pFS = pFS;
+    pFile->sizeInBytes = dataSize;
+
+    return pFile;
+}
+
+// pRawRead is the file's data if it has already been read with taFSReadRawFileData(), and is otherwise null. pCounters is where the
+// I/O statistics for the open are gathered, and is null when they're not being gathered.
+TA_PRIVATE taFile* taFSOpenFileFromArchiveData(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType, unsigned int options, const taFSRawRead* pRawRead, taFSIOCounters* pCounters)
+{
+    if (taFSCanStreamFile(pArchive, dataSize, compressionType, options)) {
+        return taFSOpenStreamedFile(pFS, pArchive, dataOffset, dataSize, compressionType);
+    }
+
+    // Read-only files that are stored as-is don't need to be copied anywhere. This is how the hot files in archives written by
+    // taFSRepackArchive() are stored.
+    if ((options & TA_OPEN_FILE_READ_ONLY) != 0 && (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) == 0 && compressionType == 0 && pArchive->decryptionKey == 0 && pArchive->mappedFile.pData != NULL) {
+        return taFSOpenFileView(pFS, pArchive, dataOffset, dataSize, pCounters);
+    }
+
+    if (taFSCanCacheFile(pFS, dataSize, options)) {
+        return taFSOpenCachedFile(pFS, pArchive, dataOffset, dataSize, compressionType, pRawRead, pCounters);
+    }
+
+
+    taUInt32 extraBytes = 0;
+    if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
+        extraBytes = 1;
+    }
+
+    taFile* pFile = malloc(sizeof(*pFile) + dataSize + extraBytes);
+    if (pFile == NULL) {
+        return NULL;
+    }
+
+    pFile->pFileData = (char*)(pFile + 1);     // <-- The file data is stored in the same allocation, just after the taFile object.
+    pFile->_pStreamed = NULL;
+    pFile->_pCacheEntry = NULL;
+    pFile->_stream = taCreateMemoryStream(pFile->pFileData, dataSize);
+    pFile->pFS = pFS;
+    pFile->sizeInBytes = dataSize;
+
+    if (!taFSReadFileDataFromArchive(pFS, pArchive, dataOffset, dataSize, compressionType, pFile->pFileData, pRawRead, pCounters)) {
+        free(pFile);
+        return NULL;
+    }
+
+    // Null terminate if required.
+    if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
+        pFile->pFileData[pFile->sizeInBytes] = '\0';
+    }
+
+    return pFile;
+}
+
+TA_PRIVATE taFile* taFSOpenFileFromIndexEntry(taFS* pFS, taUInt32 entryIndex, unsigned int options)
+{
+    assert(pFS != NULL);
+    assert(entryIndex < pFS->index.entryCount);
+
+    taFSRecordAccess(pFS, entryIndex, options);
+
+    // This is checked without the lock for the same reason as recording. See taFSRecordAccess().
+    taFSIOCounters counters;
+    taFSIOCounters* pCounters = NULL;
+    if (pFS->ioStats.isEnabled) {
+        taZeroObject(&counters);
+        pCounters = &counters;
+    }
+
+    taFile* pFile;
+    const taFSIndexEntry* pEntry = &pFS->index.pEntries[entryIndex];
+    if (pEntry->packFileIndex != TA_FS_INDEX_NONE) {
+        // Files in the pack are stored as-is so the whole open is counted as reading.
+        taTimer timer;
+        taZeroObject(&timer);
+        if (pCounters != NULL) {
+            taTimerInit(&timer);
+        }
+
+        pFile = taFSOpenFileFromPack(pFS, pEntry->packFileIndex, options);
+
+        if (pCounters != NULL) {
+            taFSIOCountersAddTime(&pCounters->readTime, &timer);
+            pCounters->storedBytes += pEntry->dataSize;
+        }
+    } else {
+        pFile = taFSOpenFileFromArchiveData(pFS, &pFS->pArchives[pEntry->archiveIndex], pEntry->dataOffset, pEntry->dataSize, pEntry->compressionType, options, NULL, pCounters);
+    }
+
+    if (pFile != NULL && pCounters != NULL) {
+        taFSRecordIO(pFS, entryIndex, pCounters);
+    }
+
+    return pFile;
+}
+
+TA_PRIVATE taFile* taFSOpenFileFromArchive(taFS* pFS, taFSArchive* pArchive, const char* fileRelativePath, unsigned int options)
+{
+    // Use the index if we have one.
+    if (pFS->index.pSlots != NULL) {
+        taUInt32 archiveIndex = (taUInt32)(pArchive - pFS->pArchives);
+        for (taUInt32 iEntry = taFSIndexFind(&pFS->index, fileRelativePath); iEntry != TA_FS_INDEX_NONE; iEntry = pFS->index.pEntries[iEntry].nextEntryIndex) {
+            if (pFS->index.pEntries[iEntry].archiveIndex == archiveIndex) {
+                return taFSOpenFileFromIndexEntry(pFS, iEntry, options);
+            }
+        }
+
+        return NULL;
+    }
+
+
+    taUInt32 dataPos;
+    if (!taFSFindFileInArchive(pFS, pArchive, fileRelativePath, &dataPos)) {
+        return NULL;
+    }
+
+    // It's in this archive.
+    taMemoryStream stream = taCreateMemoryStream(pArchive->pCentralDirectory, pArchive->centralDirectorySize);
+    taMemoryStreamSeek(&stream, dataPos, taSeekOriginStart);
+
+    taUInt32 dataOffset;
+    if (taMemoryStreamRead(&stream, &dataOffset, 4) != 4) {
+        return NULL;
+    }
+
+    taUInt32 dataSize;
+    if (taMemoryStreamRead(&stream, &dataSize, 4) != 4) {
+        return NULL;
+    }
+
+    taUInt8 compressionType;
+    if (taMemoryStreamRead(&stream, &compressionType, 1) != 1) {
+        return NULL;
+    }
+
+    return taFSOpenFileFromArchiveData(pFS, pArchive, dataOffset, dataSize, compressionType, options, NULL, NULL);
+}
+
+taFS* taCreateFileSystem()
+{
+    // We need to retrieve the root directory first. We can't continue if this fails.
+    char exedir[TA_MAX_PATH];
+    if (taGetExecutableDirectoryPath(exedir, sizeof(exedir)) != TA_SUCCESS) {
+        return NULL;
+    }
+
+
+
+    taFS* pFS = calloc(1, sizeof(*pFS));
+    if (pFS == NULL) {
+        return NULL;
+    }
+
+    // The thread pool starts off with no worker threads. Threads are added with taFSSetThreadCount() at the end.
+    if (!taThreadPoolInit(&pFS->threadPool, 0)) {
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taMutexInit(&pFS->cache.lock)) {
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taMutexInit(&pFS->ioQueue.lock)) {
+        taMutexUninit(&pFS->cache.lock);
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taSemaphoreInit(&pFS->ioQueue.workSemaphore, 0)) {
+        taMutexUninit(&pFS->ioQueue.lock);
+        taMutexUninit(&pFS->cache.lock);
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taMutexInit(&pFS->listings.lock)) {
+        taSemaphoreUninit(&pFS->ioQueue.workSemaphore);
+        taMutexUninit(&pFS->ioQueue.lock);
+        taMutexUninit(&pFS->cache.lock);
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taMutexInit(&pFS->recorder.lock)) {
+        taMutexUninit(&pFS->listings.lock);
+        taSemaphoreUninit(&pFS->ioQueue.workSemaphore);
+        taMutexUninit(&pFS->ioQueue.lock);
+        taMutexUninit(&pFS->cache.lock);
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    if (!taMutexInit(&pFS->ioStats.lock)) {
+        taMutexUninit(&pFS->recorder.lock);
+        taMutexUninit(&pFS->listings.lock);
+        taSemaphoreUninit(&pFS->ioQueue.workSemaphore);
+        taMutexUninit(&pFS->ioQueue.lock);
+        taMutexUninit(&pFS->cache.lock);
+        taThreadPoolUninit(&pFS->threadPool);
+        free(pFS);
+        return NULL;
+    }
+
+    pFS->cache.stats.budgetInBytes = TA_FS_DEFAULT_CACHE_SIZE;
+
+    // This is allowed to fail, in which case archives that can't be mapped are read with pread().
+    pFS->pRing = taFSCreateRing();
+
+    if (strcpy_s(pFS->rootDir, sizeof(pFS->rootDir), exedir) != 0) {
+        taDeleteFileSystem(pFS);
+        return NULL;
+    }
+
+    pFS->archiveCount = 0;
+    pFS->pArchives = NULL;
+
+    // The pack needs to be mounted before the archives are registered so they can use the central directories stored in it.
+    taFSMountPack(pFS);
+
+    // Now we want to try loading all of the known archive files. There are a few mandatory packages which if not present will result
+    // in this failing to initialize.
+    if (!taFSRegisterArchive(pFS, "rev31.gp3")   ||
+        !taFSRegisterArchive(pFS, "totala1.hpi") ||
+        !taFSRegisterArchive(pFS, "totala2.hpi"))
+    {
+        taDeleteFileSystem(pFS);
+        return TA_FALSE;
+    }
+
+    // Optional packages.
+    taFSRegisterArchive(pFS, "totala4.hpi");
+    taFSRegisterArchive(pFS, "ccdata.ccx");
+    taFSRegisterArchive(pFS, "ccmaps.ccx");
+    taFSRegisterArchive(pFS, "ccmiss.ccx");
+    taFSRegisterArchive(pFS, "btdata.ccx");
+    taFSRegisterArchive(pFS, "btmaps.ccx");
+    taFSRegisterArchive(pFS, "tactics1.hpi");
+    taFSRegisterArchive(pFS, "tactics2.hpi");
+    taFSRegisterArchive(pFS, "tactics3.hpi");
+    taFSRegisterArchive(pFS, "tactics4.hpi");
+    taFSRegisterArchive(pFS, "tactics5.hpi");
+    taFSRegisterArchive(pFS, "tactics6.hpi");
+    taFSRegisterArchive(pFS, "tactics7.hpi");
+    taFSRegisterArchive(pFS, "tactics8.hpi");
+
+    // Now we need to search for .ufo files and register them. We only search the root directory for these.
+    taFSListingBuilder rootBuilder;
+    taFSListingBuilderInit(&rootBuilder);
+    taFSGatherFilesInNativeDirectory(pFS, "", TA_FALSE, &rootBuilder);
+
+    taFSListing* pRootListing = taFSListingBuilderFinalize(&rootBuilder, "", TA_FALSE);
+    taFSListingBuilderUninit(&rootBuilder);
+
+    if (pRootListing != NULL) {
+        qsort(pRootListing->pFiles, pRootListing->fileCount, sizeof(*pRootListing->pFiles), taFSFileInfoQuickSortCallback);
+
+        for (taUInt32 iFile = 0; iFile < pRootListing->fileCount; ++iFile) {
+            if (!pRootListing->pFiles[iFile].isDirectory && taPathExtensionEqual(pRootListing->pFiles[iFile].relativePath, "ufo")) {
+                taFSRegisterArchive(pFS, pRootListing->pFiles[iFile].relativePath);
+            }
+        }
+
+        free(pRootListing);
+    }
+
+
+    // Now that every archive has been registered we can build the path index. If this fails we can still continue, but file
+    // lookups will need to fall back to searching the central directory of each archive.
+    taFSBuildIndex(pFS);
+
+    // Files in the pack are found through the index so this needs to be done after building it.
+    taFSResolvePack(pFS);
+
+    taFSSetThreadCount(pFS, 0);
+    taFSSetIOThreadCount(pFS, 0);
+
+    return pFS;
+}
+
+void taDeleteFileSystem(taFS* pFS)
+{
+    if (pFS == NULL) {
+        return;
+    }
+
+    // The prefetch thread reads from the archives and the cache so it needs to be stopped before anything else.
+    taFSCancelPrefetch(pFS);
+    taFSEndRecording(pFS, NULL);
+    taMutexUninit(&pFS->recorder.lock);
+
+    taFSEndIOStats(pFS);
+    free(pFS->ioStats.pFileStats);
+    free(pFS->ioStats.pArchiveStats);
+    taMutexUninit(&pFS->ioStats.lock);
+
+    // Every request should have been finished or cancelled by now, so the I/O threads will be idle.
+    taFSStopIOThreads(pFS);
+    assert(pFS->ioQueue.pFirst == NULL);
+    taSemaphoreUninit(&pFS->ioQueue.workSemaphore);
+    taMutexUninit(&pFS->ioQueue.lock);
+
+    // Every file should have been closed by now, so this will empty the cache.
+    taFSSetCacheSize(pFS, 0);
+    taMutexUninit(&pFS->cache.lock);
+
+    // Every iterator should have been ended by now, so this will free every listing.
+    taFSClearListings(pFS);
+    taMutexUninit(&pFS->listings.lock);
+
+    taFSUnmountPack(pFS);
+
+    if (pFS->pArchives != NULL) {
+        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+            free(pFS->pArchives[iArchive].pCentralDirectory);
+            taUnmapFile(&pFS->pArchives[iArchive].mappedFile);
+        }
+
+        free(pFS->pArchives);
+    }
+
+    taFSUninitIndex(&pFS->index);
+    taThreadPoolUninit(&pFS->threadPool);
+    taFSDeleteRing(pFS->pRing);
+    
+    free(pFS);
+}
+
+void taFSSetThreadCount(taFS* pFS, taUInt32 threadCount)
+{
+    if (pFS == NULL) {
+        return;
+    }
+
+    if (threadCount == 0) {
+        threadCount = taGetCPUCount();
+        if (threadCount > TA_FS_MAX_DEFAULT_THREAD_COUNT) {
+            threadCount = TA_FS_MAX_DEFAULT_THREAD_COUNT;
+        }
+    }
+
+    // Nothing can be using the pool while it's recreated. See the notes in taFS.h.
+    assert(!pFS->prefetcher.isRunning);
+    assert(pFS->threadPool.isBusy == TA_FALSE);
+
+    // The thread opening the file takes part in decompression so it's not included in the pool.
+    taThreadPoolUninit(&pFS->threadPool);
+    taThreadPoolInit(&pFS->threadPool, threadCount - 1);
+}
+
+
+taFile* taOpenSpecificFile(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath, unsigned int options)
+{
+    if (pFS == NULL) {
+        return NULL;
+    }
+
+
+    if (archiveRelativePath == NULL || archiveRelativePath[0] == '\0') {
+        // No archive file was specified. Try opening from the native file system.
+        char fileAbsolutePath[TA_MAX_PATH];
+        if (!taPathAppend(fileAbsolutePath, sizeof(fileAbsolutePath), pFS->rootDir, fileRelativePath)) {
+            return NULL;
+        }
+
+        FILE* pSTDIOFile = taFOpen(fileAbsolutePath, "rb");
+        if (pSTDIOFile == NULL) {
+            return NULL;
+        }
+
+        taUInt32 extraBytes = 0;
+        if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
+            extraBytes = 1;
+        }
+
+
+        taFSeek(pSTDIOFile, 0, SEEK_END);
+        taUInt64 sizeInBytes = taFTell(pSTDIOFile);
+        taFSeek(pSTDIOFile, 0, SEEK_SET);
+
+        if (sizeInBytes > (sizeInBytes - extraBytes)) {
+            fclose(pSTDIOFile);
+            return NULL;    // File's too big.
+        }
+
+
+        taFile* pFile = malloc(sizeof(*pFile) + (size_t)sizeInBytes + extraBytes);
+        if (pFile == NULL) {
+            fclose(pSTDIOFile);
+            return NULL;
+        }
+
+        pFile->pFileData = (char*)(pFile + 1);     // <-- The file data is stored in the same allocation, just after the taFile object.
+        pFile->_pStreamed = NULL;
+        pFile->_pCacheEntry = NULL;
+        pFile->_stream = taCreateMemoryStream(pFile->pFileData, (size_t)sizeInBytes);
+        pFile->pFS = pFS;
+        pFile->sizeInBytes = (size_t)sizeInBytes;
+
+        if (!fread(pFile->pFileData, 1, pFile->sizeInBytes, pSTDIOFile)) {
+            fclose(pSTDIOFile);
+            return NULL;
+        }
+
+
+        // Null terminate if required.
+        if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
+            pFile->pFileData[pFile->sizeInBytes] = '\0';
+        }
+
+        fclose(pSTDIOFile);
+        return pFile;
+    } else {
+        // An archive file was specified. Try opening from that archive. To do this we need to search the central directory.
+        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+            if (_stricmp(pFS->pArchives[iArchive].relativePath, archiveRelativePath) == 0) {
+                return taFSOpenFileFromArchive(pFS, &pFS->pArchives[iArchive], fileRelativePath, options);
+            }
+        }
+
+        return NULL;
+    }
+}
+
+taFile* taOpenFile(taFS* pFS, const char* relativePath, unsigned int options)
+{
+    // All we need to do is try opening the file from every archive, in order of priority.
+
+    // The native file system is highest priority.
+    taFile* pFile = taOpenSpecificFile(pFS, NULL, relativePath, options);
+    if (pFile != NULL) {
+        return pFile;   // It's on the native file system.
+    }
+
+
+    // At this point the file is not on the native file system so we just need to search for it. The index will give us the
+    // highest priority instance of the file with a single hash lookup.
+    if (pFS->index.pSlots != NULL) {
+        taUInt32 iEntry = taFSIndexFind(&pFS->index, relativePath);
+        if (iEntry == TA_FS_INDEX_NONE) {
+            return NULL;
+        }
+
+        return taFSOpenFileFromIndexEntry(pFS, iEntry, options);
+    }
+
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        pFile = taFSOpenFileFromArchive(pFS, &pFS->pArchives[iArchive], relativePath, options);
+        if (pFile != NULL) {
+            return pFile;
+        }
+    }
+
+
+    // Didn't find the file...
+    assert(pFile == NULL);
+    return NULL;
+}
+
+taResult taFSGetFileSignature(taFS* pFS, const char* archiveRelativePath, const char* relativePath, taFSFileSignature* pSignatureOut)
+{
+    if (pSignatureOut == NULL) {
+        return TA_INVALID_ARGS;
+    }
+
+    taZeroObject(pSignatureOut);
+
+    if (pFS == NULL || relativePath == NULL) {
+        return TA_INVALID_ARGS;
+    }
+
+    if (pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
+
+    // Files on the real file system take priority, but are not supported.
+    if (archiveRelativePath == NULL || archiveRelativePath[0] == '\0') {
+        char fileAbsolutePath[TA_MAX_PATH];
+        if (!taPathAppend(fileAbsolutePath, sizeof(fileAbsolutePath), pFS->rootDir, relativePath)) {
+            return TA_INVALID_ARGS;
+        }
+
+        FILE* pSTDIOFile = taFOpen(fileAbsolutePath, "rb");
+        if (pSTDIOFile != NULL) {
+            fclose(pSTDIOFile);
+            return TA_ERROR;
+        }
+
+        if (archiveRelativePath != NULL) {
+            return TA_FILE_NOT_FOUND;
+        }
+    }
+
+    const taFSIndexEntry* pEntry = NULL;
+    for (taUInt32 iEntry = taFSIndexFind(&pFS->index, relativePath); iEntry != TA_FS_INDEX_NONE; iEntry = pFS->index.pEntries[iEntry].nextEntryIndex) {
+        if (archiveRelativePath == NULL || _stricmp(pFS->pArchives[pFS->index.pEntries[iEntry].archiveIndex].relativePath, archiveRelativePath) == 0) {
+            pEntry = &pFS->index.pEntries[iEntry];
+            break;
+        }
+    }
+
+    if (pEntry == NULL) {
+        return TA_FILE_NOT_FOUND;
+    }
+
+    const taFSArchive* pArchive = &pFS->pArchives[pEntry->archiveIndex];
+    const taMappedFile* pMappedFile = &pArchive->mappedFile;
+    if (pMappedFile->pData == NULL || pEntry->dataOffset > pMappedFile->sizeInBytes) {
+        return TA_ERROR;
+    }
+
+    // Compressed files start with the size of each chunk which is where the size of the stored data comes from.
+    size_t storedSize = pEntry->dataSize;
+    if (pEntry->compressionType != 0) {
+        size_t chunkCount = taHPICalculateChunkCount(pEntry->dataSize);
+        if (chunkCount * 4 > pMappedFile->sizeInBytes - pEntry->dataOffset) {
+            return TA_INVALID_RESOURCE;
+        }
+
+        storedSize = chunkCount * 4;
+        for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+            taUInt32 chunkSize;
+            taUInt32 chunkSizePos = pEntry->dataOffset + (taUInt32)(iChunk * 4);
+            taHPIDecryptCopy((taUInt8*)&chunkSize, pMappedFile->pData + chunkSizePos, 4, pArchive->decryptionKey, chunkSizePos);
+            storedSize += chunkSize;
+        }
+    }
+
+    if (storedSize > pMappedFile->sizeInBytes - pEntry->dataOffset) {
+        return TA_INVALID_RESOURCE;
+    }
+
+    pSignatureOut->sizeInBytes = pEntry->dataSize;
+    pSignatureOut->hash = taHashBytes(pMappedFile->pData + pEntry->dataOffset, storedSize, pEntry->dataSize);
+    return TA_SUCCESS;
+}
+
+
+// A file that taOpenFiles() will be loading from an archive.
+typedef struct
+{
+    taUInt32 iFile;
+    const taFSIndexEntry* pEntry;
+
+    // The file's data if it's in an archive that could not be memory mapped and was read up front. Otherwise null.
+    const taFSRawRead* pRawRead;
+} taFSBatchedOpen;
+
+typedef struct
+{
+    taFS* pFS;
+    const taFSBatchedOpen* pOpens;
+    unsigned int options;
+    taFile** ppFilesOut;
+} taFSBatchedOpenJob;
+
+TA_PRIVATE int taFSBatchedOpenQuickSortCallback(const void* a, const void* b)
+{
+    const taFSIndexEntry* pEntryA = ((const taFSBatchedOpen*)a)->pEntry;
+    const taFSIndexEntry* pEntryB = ((const taFSBatchedOpen*)b)->pEntry;
+
+    if (pEntryA->archiveIndex != pEntryB->archiveIndex) {
+        return (pEntryA->archiveIndex < pEntryB->archiveIndex) ? -1 : +1;
+    }
+
+    if (pEntryA->dataOffset != pEntryB->dataOffset) {
+        return (pEntryA->dataOffset < pEntryB->dataOffset) ? -1 : +1;
+    }
+
+    return 0;
+}
+
+TA_PRIVATE void taFSBatchedOpenJobProc(void* pUserData, taUInt32 iJob)
+{
+    taFSBatchedOpenJob* pJob = (taFSBatchedOpenJob*)pUserData;
+    const taFSBatchedOpen* pOpen = &pJob->pOpens[iJob];
+
+    taFSIOCounters counters;
+    taFSIOCounters* pCounters = NULL;
+    if (pJob->pFS->ioStats.isEnabled) {
+        taZeroObject(&counters);
+        pCounters = &counters;
+    }
+
+    // The thread pool is busy running this batch, so large files will be decompressed on this thread rather than in parallel chunks.
+    pJob->ppFilesOut[pOpen->iFile] = taFSOpenFileFromArchiveData(pJob->pFS, &pJob->pFS->pArchives[pOpen->pEntry->archiveIndex], pOpen->pEntry->dataOffset, pOpen->pEntry->dataSize, pOpen->pEntry->compressionType, pJob->options, pOpen->pRawRead, pCounters);
+
+    if (pJob->ppFilesOut[pOpen->iFile] != NULL && pCounters != NULL) {
+        taFSRecordIO(pJob->pFS, (taUInt32)(pOpen->pEntry - pJob->pFS->index.pEntries), pCounters);
+    }
+}
+
+// Tells the OS which parts of the mapped archives are about to be read, in the order they're stored. Neighbouring files are merged
+// into a single range. The size of compressed files is not known until their chunk table is read, but the uncompressed size will
+// almost always cover it.
+TA_PRIVATE void taFSAdviseBatchedOpens(taFS* pFS, const taFSBatchedOpen* pOpens, taUInt32 openCount)
+{
+    size_t rangeBeg = 0;
+    size_t rangeEnd = 0;
+    const taMappedFile* pRangeMappedFile = NULL;
+
+    for (taUInt32 iOpen = 0; iOpen <= openCount; ++iOpen) {
+        const taMappedFile* pMappedFile = NULL;
+        size_t dataBeg = 0;
+        size_t dataEnd = 0;
+        if (iOpen < openCount) {
+            const taFSIndexEntry* pEntry = pOpens[iOpen].pEntry;
+            pMappedFile = &pFS->pArchives[pEntry->archiveIndex].mappedFile;
+            dataBeg = pEntry->dataOffset;
+            dataEnd = dataBeg + pEntry->dataSize;
+        }
+
+        if (pMappedFile == pRangeMappedFile && dataBeg <= rangeEnd + TA_FS_BATCHED_OPEN_MERGE_DISTANCE) {
+            if (rangeEnd < dataEnd) {
+                rangeEnd = dataEnd;
+            }
+            continue;
+        }
+
+        if (pRangeMappedFile != NULL && pRangeMappedFile->pData != NULL && rangeEnd - rangeBeg >= TA_FS_SEQUENTIAL_ADVICE_THRESHOLD) {
+            taMappedFileAdviseSequential(pRangeMappedFile, rangeBeg, rangeEnd - rangeBeg);
+        }
+
+        pRangeMappedFile = pMappedFile;
+        rangeBeg = dataBeg;
+        rangeEnd = dataEnd;
+    }
+}
+
+#ifndef _WIN32
+// Reads the data of the files in archives that could not be memory mapped. This is done for the whole batch at once so that the reads
+// can be submitted together rather than one file at a time. Only up to TA_FS_MAX_RAW_BATCH_SIZE bytes are read up front - anything
+// past that is read when the file is opened like normal. The returned reads and *ppRawDataOut need to be freed with free().
+TA_PRIVATE taFSRawRead* taFSReadBatchedRawData(taFS* pFS, taFSBatchedOpen* pOpens, taUInt32 openCount, taUInt8** ppRawDataOut)
+{
+    *ppRawDataOut = NULL;
+
+    taUInt32 rawReadCount = 0;
+    size_t batchSize = 0;
+    for (taUInt32 iOpen = 0; iOpen < openCount; ++iOpen) {
+        const taFSIndexEntry* pEntry = pOpens[iOpen].pEntry;
+        if (pFS->pArchives[pEntry->archiveIndex].mappedFile.pData == NULL && batchSize + pEntry->dataSize <= TA_FS_MAX_RAW_BATCH_SIZE) {
+            batchSize += pEntry->dataSize;
+            rawReadCount += 1;
+        }
+    }
+
+    if (rawReadCount == 0) {
+        return NULL;
+    }
+
+    taFSRawRead* pRawReads = (taFSRawRead*)malloc(rawReadCount * sizeof(*pRawReads));
+    if (pRawReads == NULL) {
+        return NULL;    // <-- Not a big deal. The files will just be read individually.
+    }
+
+    // This needs to pick the same files as the loop above.
+    taUInt32 iRawRead = 0;
+    batchSize = 0;
+    for (taUInt32 iOpen = 0; iOpen < openCount; ++iOpen) {
+        const taFSIndexEntry* pEntry = pOpens[iOpen].pEntry;
+        if (pFS->pArchives[pEntry->archiveIndex].mappedFile.pData == NULL && batchSize + pEntry->dataSize <= TA_FS_MAX_RAW_BATCH_SIZE) {
+            batchSize += pEntry->dataSize;
+
+            pRawReads[iRawRead].pArchive = &pFS->pArchives[pEntry->archiveIndex];
+            pRawReads[iRawRead].dataOffset = pEntry->dataOffset;
+            pRawReads[iRawRead].dataSize = pEntry->dataSize;
+            pRawReads[iRawRead].compressionType = pEntry->compressionType;
+            pRawReads[iRawRead].readTime = 0;
+            pOpens[iOpen].pRawRead = &pRawReads[iRawRead];
+            iRawRead += 1;
+        }
+    }
+
+    taTimer timer;
+    taTimerInit(&timer);
+
+    *ppRawDataOut = taFSReadRawFileData(pFS, pRawReads, rawReadCount);
+
+    // The time it took to read the batch is shared between the files by how much data was read for each of them.
+    if (pFS->ioStats.isEnabled) {
+        double readTime = taTimerTick(&timer) * 1000000000.0;
+
+        size_t rawDataSize = 0;
+        for (iRawRead = 0; iRawRead < rawReadCount; ++iRawRead) {
+            rawDataSize += pRawReads[iRawRead].rawDataSize;
+        }
+
+        for (iRawRead = 0; iRawRead < rawReadCount && rawDataSize > 0; ++iRawRead) {
+            pRawReads[iRawRead].readTime = (taUInt64)(readTime * ((double)pRawReads[iRawRead].rawDataSize / rawDataSize));
+        }
+    }
+
+    return pRawReads;
+}
+#endif
+
+taUInt32 taOpenFiles(taFS* pFS, const char** ppRelativePaths, taUInt32 count, unsigned int options, taFile** ppFilesOut)
+{
+    if (ppFilesOut == NULL) {
+        return 0;
+    }
+
+    for (taUInt32 iFile = 0; iFile < count; ++iFile) {
+        ppFilesOut[iFile] = NULL;
+    }
+
+    if (pFS == NULL || ppRelativePaths == NULL) {
+        return 0;
+    }
+
+    taFSBatchedOpen* pOpens = NULL;
+    if (pFS->index.pSlots != NULL && count > 0) {
+        pOpens = (taFSBatchedOpen*)malloc(count * sizeof(*pOpens));
+    }
+
+    // Everything is resolved first. Files on the native file system, in the pack, or that are going to be streamed are cheap to open
+    // so they're just opened straight away. Everything else is loaded from the archives afterwards.
+    taUInt32 openCount = 0;
+    for (taUInt32 iFile = 0; iFile < count; ++iFile) {
+        if (ppRelativePaths[iFile] == NULL) {
+            continue;
+        }
+
+        if (pOpens == NULL) {
+            ppFilesOut[iFile] = taOpenFile(pFS, ppRelativePaths[iFile], options);
+            continue;
+        }
+
+        ppFilesOut[iFile] = taOpenSpecificFile(pFS, NULL, ppRelativePaths[iFile], options);
+        if (ppFilesOut[iFile] != NULL) {
+            continue;
+        }
+
+        taUInt32 iEntry = taFSIndexFind(&pFS->index, ppRelativePaths[iFile]);
+        if (iEntry == TA_FS_INDEX_NONE) {
+            continue;
+        }
+
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+        if (pEntry->packFileIndex != TA_FS_INDEX_NONE || taFSCanStreamFile(&pFS->pArchives[pEntry->archiveIndex], pEntry->dataSize, pEntry->compressionType, options)) {
+            ppFilesOut[iFile] = taFSOpenFileFromIndexEntry(pFS, iEntry, options);
+            continue;
+        }
+
+        taFSRecordAccess(pFS, iEntry, options);
+
+        pOpens[openCount].iFile = iFile;
+        pOpens[openCount].pEntry = pEntry;
+        pOpens[openCount].pRawRead = NULL;
+        openCount += 1;
+    }
+
+    if (openCount > 0) {
+        qsort(pOpens, openCount, sizeof(*pOpens), taFSBatchedOpenQuickSortCallback);
+        taFSAdviseBatchedOpens(pFS, pOpens, openCount);
+
+#ifndef _WIN32
+        taUInt8* pRawData;
+        taFSRawRead* pRawReads = taFSReadBatchedRawData(pFS, pOpens, openCount, &pRawData);
+#endif
+
+        // The thread pool takes jobs in order, so the files will be read in roughly ascending order.
+        taFSBatchedOpenJob job;
+        job.pFS = pFS;
+        job.pOpens = pOpens;
+        job.options = options;
+        job.ppFilesOut = ppFilesOut;
+        taThreadPoolRun(&pFS->threadPool, openCount, taFSBatchedOpenJobProc, &job);
+
+#ifndef _WIN32
+        free(pRawData);
+        free(pRawReads);
+#endif
+    }
+
+    free(pOpens);
+
+    taUInt32 openedCount = 0;
+    for (taUInt32 iFile = 0; iFile < count; ++iFile) {
+        if (ppFilesOut[iFile] != NULL) {
+            openedCount += 1;
+        }
+    }
+
+    return openedCount;
+}
+
+void taCloseFile(taFile* pFile)
+{
+    if (pFile == NULL) {
+        return;
+    }
+
+    if (pFile->_pCacheEntry != NULL) {
+        taFSCloseCachedFile(pFile);
+    }
+
+    free(pFile);
+}
+
+
+taBool32 taReadFile(taFile* pFile, void* pBufferOut, size_t bytesToRead, size_t* pBytesReadOut)
+{
+    if (pFile == NULL || pBufferOut == NULL) {
+        return TA_FALSE;
+    }
+
+    size_t bytesRead;
+    if (pFile->_pStreamed != NULL) {
+        bytesRead = taStreamedFileRead(pFile, pBufferOut, bytesToRead);
+    } else {
+        bytesRead = taMemoryStreamRead(&pFile->_stream, pBufferOut, bytesToRead);
+    }
+
+    if (pBytesReadOut) {
+        *pBytesReadOut = bytesRead;
+    }
+
+    return TA_TRUE;
+}
+
+taBool32 taSeekFile(taFile* pFile, taInt64 bytesToSeek, taSeekOrigin origin)
+{
+    if (pFile == NULL) {
+        return TA_FALSE;
+    }
+
+    return taMemoryStreamSeek(&pFile->_stream, bytesToSeek, origin);
+}
+
+taUInt64 taTellFile(taFile* pFile)
+{
+    if (pFile == NULL) {
+        return TA_FALSE;
+    }
+
+    return (taUInt64)taMemoryStreamTell(&pFile->_stream);
+}
+
+
+taBool32 taReadFileUInt32(taFile* pFile, taUInt32* pBufferOut)
+{
+    size_t bytesRead;
+    return taReadFile(pFile, pBufferOut, sizeof(taUInt32), &bytesRead) && bytesRead == sizeof(taUInt32);
+}
+
+taBool32 taReadFileInt32(taFile* pFile, taInt32* pBufferOut)
+{
+    size_t bytesRead;
+    return taReadFile(pFile, pBufferOut, sizeof(taInt32), &bytesRead) && bytesRead == sizeof(taInt32);
+}
+
+taBool32 taReadFileUInt16(taFile* pFile, taUInt16* pBufferOut)
+{
+    size_t bytesRead;
+    return taReadFile(pFile, pBufferOut, sizeof(taUInt16), &bytesRead) && bytesRead == sizeof(taUInt16);
+}
+
+taBool32 taReadFileInt16(taFile* pFile, taInt16* pBufferOut)
+{
+    size_t bytesRead;
+    return taReadFile(pFile, pBufferOut, sizeof(taInt16), &bytesRead) && bytesRead == sizeof(taInt16);
+}
+
+taBool32 taReadFileUInt8(taFile* pFile, taUInt8* pBufferOut)
+{
+    size_t bytesRead;
+    return taReadFile(pFile, pBufferOut, sizeof(taUInt8), &bytesRead) && bytesRead == sizeof(taUInt8);
+}
+
+
+
+//// Iteration ////
+
+TA_PRIVATE taFSListing* taFSGatherListing(taFS* pFS, const char* directoryRelativePath, taBool32 recursive)
+{
+    assert(pFS != NULL);
+    assert(directoryRelativePath != NULL);
+
+    taFSListingBuilder builder;
+    taFSListingBuilderInit(&builder);
+
+    // Native directory has the highest priority.
+    taFSListingBuilderBeginSource(&builder, "");
+    taFSGatherFilesInNativeDirectory(pFS, directoryRelativePath, recursive, &builder);
+
+    // Archives after the native directory.
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        taFSListingBuilderBeginSource(&builder, pFS->pArchives[iArchive].relativePath);
+        taFSGatherFilesInArchiveDirectory(pFS, &pFS->pArchives[iArchive], directoryRelativePath, recursive, &builder);
+    }
+
+    taFSListing* pListing = taFSListingBuilderFinalize(&builder, directoryRelativePath, recursive);
+    taFSListingBuilderUninit(&builder);
+
+    return pListing;
+}
+
+TA_PRIVATE taFSListing* taFSFindListing(taFSListingCache* pCache, const char* directoryRelativePath, taUInt32 hash, taBool32 recursive)
+{
+    for (taFSListing* pListing = pCache->pBuckets[hash % TA_FS_LISTING_BUCKET_COUNT]; pListing != NULL; pListing = pListing->pNextInBucket) {
+        if (pListing->hash == hash && pListing->recursive == recursive && _stricmp(pListing->directoryRelativePath, directoryRelativePath) == 0) {
+            return pListing;
+        }
+    }
+
+    return NULL;
+}
+
+TA_PRIVATE taFSListing* taFSAcquireListing(taFS* pFS, const char* directoryRelativePath, taBool32 recursive)
+{
+    assert(pFS != NULL);
+    assert(directoryRelativePath != NULL);
+
+    taUInt32 hash = taHashStringCaseInsensitive(directoryRelativePath);
+
+    taMutexLock(&pFS->listings.lock);
+    {
+        taFSListing* pListing = taFSFindListing(&pFS->listings, directoryRelativePath, hash, recursive);
+        if (pListing != NULL) {
+            pListing->refCount += 1;
+            taMutexUnlock(&pFS->listings.lock);
+            return pListing;
+        }
+    }
+    taMutexUnlock(&pFS->listings.lock);
+
+
+    // The listing is gathered outside of the lock. If another thread gathers the same listing at the same time, whichever one gets
+    // added to the cache first is used.
+    taFSListing* pNewListing = taFSGatherListing(pFS, directoryRelativePath, recursive);
+    if (pNewListing == NULL) {
+        return NULL;
+    }
+
+    taMutexLock(&pFS->listings.lock);
+    taFSListing* pListing = taFSFindListing(&pFS->listings, directoryRelativePath, hash, recursive);
+    if (pListing == NULL) {
+        taUInt32 iBucket = hash % TA_FS_LISTING_BUCKET_COUNT;
+        pNewListing->pNextInBucket = pFS->listings.pBuckets[iBucket];
+        pNewListing->refCount = 1;
+        pFS->listings.pBuckets[iBucket] = pNewListing;
+
+        pListing = pNewListing;
+        pNewListing = NULL;
+    }
+
+    pListing->refCount += 1;
+    taMutexUnlock(&pFS->listings.lock);
+
+    free(pNewListing);
+    return pListing;
+}
+
+TA_PRIVATE void taFSReleaseListing(taFS* pFS, taFSListing* pListing)
+{
+    assert(pFS != NULL);
+    assert(pListing != NULL);
+
+    taMutexLock(&pFS->listings.lock);
+    assert(pListing->refCount > 0);
+    pListing->refCount -= 1;
+    taBool32 isUnreferenced = pListing->refCount == 0;
+    taMutexUnlock(&pFS->listings.lock);
+
+    if (isUnreferenced) {
+        free(pListing);
+    }
+}
+
+TA_PRIVATE void taFSClearListings(taFS* pFS)
+{
+    assert(pFS != NULL);
+
+    // Listings that are still being iterated are freed in taFSEnd() instead.
+    taMutexLock(&pFS->listings.lock);
+    for (taUInt32 iBucket = 0; iBucket < TA_FS_LISTING_BUCKET_COUNT; ++iBucket) {
+        taFSListing* pListing = pFS->listings.pBuckets[iBucket];
+        while (pListing != NULL) {
+            taFSListing* pNextListing = pListing->pNextInBucket;
+
+            pListing->pNextInBucket = NULL;
+            pListing->refCount -= 1;
+            if (pListing->refCount == 0) {
+                free(pListing);
+            }
+
+            pListing = pNextListing;
+        }
+
+        pFS->listings.pBuckets[iBucket] = NULL;
+    }
+    taMutexUnlock(&pFS->listings.lock);
+}
+
+taFSIterator* taFSBegin(taFS* pFS, const char* directoryRelativePath, taBool32 recursive)
+{
+    if (pFS == NULL) {
+        return NULL;
+    }
+
+    // If the directory path is null, just treat it as though we are iteration over the root directory.
+    if (directoryRelativePath == NULL) {
+        directoryRelativePath = "";
+    }
+
+    taFSIterator* pIter = calloc(1, sizeof(*pIter));
+    if (pIter == NULL) {
+        return NULL;
+    }
+
+    pIter->_pListing = taFSAcquireListing(pFS, directoryRelativePath, recursive);
+    if (pIter->_pListing == NULL) {
+        free(pIter);
+        return NULL;
+    }
+
+    pIter->pFS = pFS;
+    pIter->_fileCount = pIter->_pListing->fileCount;
+    pIter->_pFiles = pIter->_pListing->pFiles;
+
+    return pIter;
+}
+
+void taFSEnd(taFSIterator* pIter)
+{
+    if (pIter == NULL) {
+        return;
+    }
+
+    taFSReleaseListing(pIter->pFS, pIter->_pListing);
+    free(pIter);
+}
+
+taBool32 taFSNext(taFSIterator* pIter)
+{
+    if (pIter == NULL || pIter->_iFile >= pIter->_fileCount) {
+        return TA_FALSE;
+    }
+
+    assert(pIter->_pFiles != NULL);
+
+    pIter->fileInfo = pIter->_pFiles[pIter->_iFile];
+    pIter->_iFile += 1;
+
+    return TA_TRUE;
+}
+
+
+
+//// HPI Helpers ////
+
+taBool32 taHPIDecompressLZ77(const unsigned char* pIn, taUInt32 compressedSize, unsigned char* pOut, taUInt32 uncompressedSize)
+{
+    if (pIn == NULL || pOut == NULL) {
+        return TA_FALSE;
+    }
+
+    const unsigned char* pInEnd = pIn + compressedSize;
+    unsigned char* pOutBeg = pOut;
+    unsigned char* pOutEnd = pOut + uncompressedSize;
+
+    // The format is defined in terms of a 4096 byte window, but the window is only ever a copy of the most recent output, so except
+    // for the start of a chunk back references can be copied straight out of the output buffer. A reference to window position
+    // "offset" refers to the output byte whose index is congruent to offset-1 (the window starts at position 1), which is the
+    // following distance back from the current output position.
+    while (pIn < pInEnd) {
+        unsigned int tag = *pIn++;
+
+        // Fast path for a run of 8 literals.
+        if (tag == 0 && (pInEnd - pIn) >= 8 && (pOutEnd - pOut) >= 8) {
+            memcpy(pOut, pIn, 8);
+            pOut += 8;
+            pIn  += 8;
+            continue;
+        }
+
+        for (unsigned int iBit = 0; iBit < 8; ++iBit) {
+            if (pIn >= pInEnd) {
+                break;
+            }
+
+            if ((tag & (1 << iBit)) == 0) {
+                if (pOut == pOutEnd) {
+                    return TA_FALSE;    // Corrupt. Too much data.
+                }
+
+                *pOut++ = *pIn++;
+            } else {
+                if ((pInEnd - pIn) < 2) {
+                    return TA_FALSE;    // Corrupt. Truncated reference.
+                }
+
+                unsigned int offset = (pIn[1] << 4) | (pIn[0] >> 4);
+                unsigned int length = (pIn[0] & 0x0F) + 2;
+                pIn += 2;
+
+                if (offset == 0) {
+                    return pOut == pOutEnd; // Done.
+                }
+
+                if ((size_t)(pOutEnd - pOut) < length) {
+                    return TA_FALSE;    // Corrupt. Too much data.
+                }
+
+                size_t produced = (size_t)(pOut - pOutBeg);
+                size_t distance = ((produced - offset) & 0xFFF) + 1;
+
+                if (distance > produced) {
+                    // The reference starts in the part of the window that hasn't been written to yet. This can only happen near
+                    // the start of a chunk. Unwritten parts of the window are treated as zero.
+                    for (unsigned int i = 0; i < length; ++i) {
+                        size_t iOut = produced + i;
+                        pOut[i] = (iOut >= distance) ? pOutBeg[iOut - distance] : 0;
+                    }
+                } else if (distance >= 8 && (size_t)(pOutEnd - pOut) >= length + 7) {
+                    // The source and destination do not overlap within a word so we can copy in word sized blocks. This may
+                    // write past the end of the match, but that part is overwritten by whatever comes next.
+                    const unsigned char* pSrc = pOut - distance;
+                    for (unsigned int i = 0; i < length; i += 8) {
+                        memcpy(pOut + i, pSrc + i, 8);
+                    }
+                } else {
+                    // Overlapping. This is how runs are encoded so it needs to be done one byte at a time.
+                    const unsigned char* pSrc = pOut - distance;
+                    for (unsigned int i = 0; i < length; ++i) {
+                        pOut[i] = pSrc[i];
+                    }
+                }
+
+                pOut += length;
+            }
+        }
+    }
+
+    return pOut == pOutEnd;
+}
+
+taBool32 taHPIDecompressZlib(const void* pIn, taUInt32 compressedSize, void* pOut, taUInt32 uncompressedSize)
+{
+    mz_ulong outSize = (mz_ulong)uncompressedSize;
+    return mz_uncompress(pOut, &outSize, pIn, compressedSize) == MZ_OK;
+}
+
+// The decryption transform is out[i] = ((pos + i) ^ key) ^ ~in[i], truncated to 8 bits. Only the low byte of the key and position
+// matter, which means the key stream is just an incrementing byte XOR'd with a constant. This makes it trivial to vectorize.
+typedef void (* taHPIDecryptProc)(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos);
+
+TA_PRIVATE void taHPIDecrypt_Scalar(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
+{
+    for (size_t i = 0; i < sizeInBytes; ++i) {
+        pDst[i] = (taUInt8)((firstBytePos + i) ^ decryptionKey) ^ ~pSrc[i];
+    }
+}
+
+#if defined(TA_SUPPORT_SSE2)
+TA_PRIVATE TA_TARGET_SSE2 void taHPIDecrypt_SSE2(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
+{
+    size_t i = 0;
+    if (sizeInBytes >= 16) {
+        // The ~ is folded into the key.
+        __m128i key     = _mm_set1_epi8((char)(~decryptionKey & 0xFF));
+        __m128i counter = _mm_add_epi8(_mm_set1_epi8((char)firstBytePos), _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        __m128i step    = _mm_set1_epi8(16);
+
+        for (; i + 16 <= sizeInBytes; i += 16) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_xor_si128(data, _mm_xor_si128(counter, key)));
+            counter = _mm_add_epi8(counter, step);
+        }
+    }
+
+    taHPIDecrypt_Scalar(pDst + i, pSrc + i, sizeInBytes - i, decryptionKey, firstBytePos + (taUInt32)i);
+}
+#endif
+
+#if defined(TA_SUPPORT_AVX2)
+TA_PRIVATE TA_TARGET_AVX2 void taHPIDecrypt_AVX2(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
+{
+    size_t i = 0;
+    if (sizeInBytes >= 32) {
+        __m256i key     = _mm256_set1_epi8((char)(~decryptionKey & 0xFF));
+        __m256i counter = _mm256_add_epi8(_mm256_set1_epi8((char)firstBytePos), _mm256_setr_epi8( 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+                                                                                                 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31));
+        __m256i step    = _mm256_set1_epi8(32);
+
+        for (; i + 32 <= sizeInBytes; i += 32) {
+            __m256i data = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+            _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_xor_si256(data, _mm256_xor_si256(counter, key)));
+            counter = _mm256_add_epi8(counter, step);
+        }
+    }
+
+    taHPIDecrypt_Scalar(pDst + i, pSrc + i, sizeInBytes - i, decryptionKey, firstBytePos + (taUInt32)i);
+}
+#endif
+
+TA_PRIVATE taHPIDecryptProc taHPISelectDecryptProc()
+{
+    // This is selected once and cached. It's not protected by a lock, but every thread will arrive at the same result so it doesn't
+    // matter if a few threads end up doing the selection at the same time.
+    static taHPIDecryptProc s_decryptProc = NULL;
+    if (s_decryptProc == NULL) {
+        taHPIDecryptProc decryptProc = taHPIDecrypt_Scalar;
+#if defined(TA_SUPPORT_SSE2)
+        if (taHasSSE2()) {
+            decryptProc = taHPIDecrypt_SSE2;
+        }
+#endif
+#if defined(TA_SUPPORT_AVX2)
+        if (taHasAVX2()) {
+            decryptProc = taHPIDecrypt_AVX2;
+        }
+#endif
+        s_decryptProc = decryptProc;
+    }
+
+    return s_decryptProc;
+}
+
+void taHPIDecrypt(taUInt8* pData, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
+{
+    assert(pData != NULL);
+
+    if (decryptionKey == 0) {
+        return;
+    }
+
+    taHPISelectDecryptProc()(pData, pData, sizeInBytes, decryptionKey, firstBytePos);
+}
+
+void taHPIDecryptCopy(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
+{
+    assert(pDst != NULL);
+    assert(pSrc != NULL);
+
+    if (decryptionKey == 0) {
+        memcpy(pDst, pSrc, sizeInBytes);
+        return;
+    }
+
+    taHPISelectDecryptProc()(pDst, pSrc, sizeInBytes, decryptionKey, firstBytePos);
+}
+
+size_t taHPIReadAndDecrypt(FILE* pFile, void* pBufferOut, size_t bytesToRead, taUInt32 decryptionKey)
+{
+    if (pFile == NULL) {
+        return 0;
+    }
+
+    taUInt32 firstBytePos = (taUInt32)taFTell(pFile);
+
+    size_t bytesRead = fread(pBufferOut, 1, bytesToRead, pFile);
+    if (decryptionKey != 0) {
+        taHPIDecrypt(pBufferOut, bytesRead, decryptionKey, firstBytePos);
+    }
+
+    return bytesRead;
+}
+
+
+// Parses a decrypted chunk header. The header is not aligned or padded in the archive which is why it's not read directly into the struct.
+TA_PRIVATE taBool32 taHPIParseChunkHeader(const taUInt8* pHeaderData, taHPIChunkHeader* pHeader)
+{
+    assert(pHeaderData != NULL);
+    assert(pHeader != NULL);
+
+    memcpy(&pHeader->marker,           pHeaderData +  0, 4);
+    memcpy(&pHeader->unused,           pHeaderData +  4, 1);
+    memcpy(&pHeader->compressionType,  pHeaderData +  5, 1);
+    memcpy(&pHeader->encrypted,        pHeaderData +  6, 1);
+    memcpy(&pHeader->compressedSize,   pHeaderData +  7, 4);
+    memcpy(&pHeader->uncompressedSize, pHeaderData + 11, 4);
+    memcpy(&pHeader->checksum,         pHeaderData + 15, 4);
+
+    return pHeader->marker == 'HSQS';
+}
+
+// Verifies, decrypts and decompresses the data of a single chunk. pScratch is where the chunk's inner encryption is removed to, and only
+// needs to be set if the chunk is encrypted. It can be the same as pCompressedData in which case decryption is done in-place. pCounters
+// can be null.
+TA_PRIVATE taBool32 taHPIDecodeChunk(const taHPIChunkHeader* pHeader, const taUInt8* pCompressedData, taUInt8* pScratch, void* pOut, size_t outSizeInBytes, taFSIOCounters* pCounters)
+{
+    assert(pHeader != NULL);
+    assert(pCompressedData != NULL);
+
+    if (pHeader->uncompressedSize > outSizeInBytes) {
+        return TA_FALSE;    // Corrupt chunk. It would overflow the output buffer.
+    }
+
+    taTimer timer;
+    taZeroObject(&timer);   // <-- Only read when pCounters is set, but some compilers can't tell.
+    if (pCounters != NULL) {
+        taTimerInit(&timer);
+    }
+
+    // We do the decryption and checksum in one loop iteration.
+    taUInt32 checksum = 0;
+    if (pHeader->encrypted) {
+        assert(pScratch != NULL);
+        for (taUInt32 i = 0; i < pHeader->compressedSize; ++i) {
+            taUInt8 b = pCompressedData[i];
+            checksum += b;
+            pScratch[i] = (taUInt8)((b - i) ^ i);
+        }
+
+        pCompressedData = pScratch;
+    } else {
+        for (taUInt32 i = 0; i < pHeader->compressedSize; ++i) {
+            checksum += pCompressedData[i];
+        }
+    }
+
+    if (checksum != pHeader->checksum) {
+        return TA_FALSE;
+    }
+
+    if (pCounters != NULL) {
+        taFSIOCountersAddTime(&pCounters->decryptTime, &timer);
+    }
+
+
+    // The actual decompression.
+    taBool32 result;
+    switch (pHeader->compressionType)
+    {
+        case 1:  result = taHPIDecompressLZ77(pCompressedData, pHeader->compressedSize, (unsigned char*)pOut, pHeader->uncompressedSize); break;
+        case 2:  result = taHPIDecompressZlib(pCompressedData, pHeader->compressedSize, pOut, pHeader->uncompressedSize); break;
+        default: result = TA_FALSE; break;
+    }
+
+    if (pCounters != NULL) {
+        taFSIOCountersAddTime(&pCounters->decompressTime, &timer);
+    }
+
+    return result;
+}
+
+TA_PRIVATE size_t taHPICalculateChunkCount(size_t uncompressedSize)
+{
+    size_t chunkCount = uncompressedSize / TA_HPI_CHUNK_SIZE;
+    if ((uncompressedSize % TA_HPI_CHUNK_SIZE) > 0) {
+        chunkCount += 1;
+    }
+
+    return chunkCount;
+}
+
+TA_PRIVATE taBool32 taHPIEnsureScratchCapacity(taUInt8** ppScratch, size_t* pScratchCapacity, size_t requiredCapacity)
+{
+    if (*pScratchCapacity >= requiredCapacity) {
+        return TA_TRUE;
+    }
+
+    taUInt8* pNewScratch = (taUInt8*)realloc(*ppScratch, requiredCapacity);
+    if (pNewScratch == NULL) {
+        return TA_FALSE;
+    }
+
+    *ppScratch = pNewScratch;
+    *pScratchCapacity = requiredCapacity;
+    return TA_TRUE;
+}
+
+size_t taHPIReadAndDecryptCompressed(FILE* pFile, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey)
+{
+    if (pFile == NULL) {
+        return 0;
+    }
+
+    size_t chunkCount = taHPICalculateChunkCount(uncompressedBytesToRead);
+
+    // The chunk sizes are not needed because each chunk has a header containing its size. Just skip past them.
+    if (taFSeek(pFile, (taInt64)chunkCount * 4, SEEK_CUR) != 0) {
+        return 0;
+    }
+
+    // A single scratch buffer is used for every chunk.
+    taBool32 result = TA_FALSE;
+    taUInt8* pCompressedData = NULL;
+    size_t compressedDataCapacity = 0;
+
+    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+        taUInt8 headerData[TA_HPI_CHUNK_HEADER_SIZE];
+        if (taHPIReadAndDecrypt(pFile, headerData, sizeof(headerData), decryptionKey) != sizeof(headerData)) {
+            goto finished;
+        }
+
+        taHPIChunkHeader header;
+        if (!taHPIParseChunkHeader(headerData, &header)) {
+            goto finished;
+        }
+
+        if (!taHPIEnsureScratchCapacity(&pCompressedData, &compressedDataCapacity, header.compressedSize)) {
+            goto finished;
+        }
+
+        if (taHPIReadAndDecrypt(pFile, pCompressedData, header.compressedSize, decryptionKey) != header.compressedSize) {
+            goto finished;
+        }
+
+        size_t chunkOffset = iChunk * TA_HPI_CHUNK_SIZE;
+        if (!taHPIDecodeChunk(&header, pCompressedData, pCompressedData, (unsigned char*)pBufferOut + chunkOffset, uncompressedBytesToRead - chunkOffset, NULL)) {
+            goto finished;
+        }
+    }
+
+    result = TA_TRUE;
+
+
+finished:
+    free(pCompressedData);
+    return result;
+}
+
+typedef struct
+{
+    const taUInt8* pArchiveData;
+    taUInt32 decryptionKey;
+    taHPIChunk* pChunks;
+    taUInt8* pScratch;
+    taUInt8* pOut;
+    size_t outSizeInBytes;
+    taFSIOCounters* pCounters;
+    volatile taBool32 failed;
+} taHPIDecodeChunksJob;
+
+// Gathers the headers of each of a compressed file's chunks. Each chunk that needs decrypting is given its own region of the scratch
+// buffer, the total size of which is returned in pScratchSizeOut.
+TA_PRIVATE taBool32 taHPIGatherChunks(const taUInt8* pArchiveData, size_t archiveSize, taUInt32 dataOffset, size_t chunkCount, taUInt32 decryptionKey, taHPIChunk* pChunks, size_t* pScratchSizeOut)
+{
+    assert(pArchiveData != NULL);
+    assert(pChunks != NULL);
+    assert(pScratchSizeOut != NULL);
+
+    *pScratchSizeOut = 0;
+
+    // Skip past the chunk sizes. See taHPIReadAndDecryptCompressed().
+    size_t cursor = (size_t)dataOffset + (chunkCount * 4);
+    if (dataOffset > archiveSize || cursor > archiveSize) {
+        return TA_FALSE;
+    }
+
+    size_t scratchSize = 0;
+    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+        if (archiveSize - cursor < TA_HPI_CHUNK_HEADER_SIZE) {
+            return TA_FALSE;
+        }
+
+        taUInt8 headerData[TA_HPI_CHUNK_HEADER_SIZE];
+        taHPIDecryptCopy(headerData, pArchiveData + cursor, sizeof(headerData), decryptionKey, (taUInt32)cursor);
+        cursor += TA_HPI_CHUNK_HEADER_SIZE;
+
+        taHPIChunk* pChunk = &pChunks[iChunk];
+        if (!taHPIParseChunkHeader(headerData, &pChunk->header)) {
+            return TA_FALSE;
+        }
+
+        if (archiveSize - cursor < pChunk->header.compressedSize) {
+            return TA_FALSE;
+        }
+
+        // The scratch buffer is only needed when the archive is encrypted or a chunk has its own encryption. When neither is the
+        // case the chunk is decompressed straight out of the archive data.
+        pChunk->dataPos = cursor;
+        pChunk->scratchOffset = scratchSize;
+        if (decryptionKey != 0 || pChunk->header.encrypted) {
+            scratchSize += pChunk->header.compressedSize;
+        }
+
+        cursor += pChunk->header.compressedSize;
+    }
+
+    *pScratchSizeOut = scratchSize;
+    return TA_TRUE;
+}
+
+// Decodes a chunk that was gathered with taHPIGatherChunks(). pScratch must be large enough for the chunk's compressed data if the
+// archive is encrypted or the chunk has its own encryption. pOut must be the start of the chunk's region within the file's data. pCounters
+// can be null.
+TA_PRIVATE taBool32 taHPIDecodeChunkFromMemory(const taUInt8* pArchiveData, taUInt32 decryptionKey, const taHPIChunk* pChunk, taUInt8* pScratch, taUInt8* pOut, size_t fileSizeInBytes, size_t iChunk, taFSIOCounters* pCounters)
+{
+    assert(pArchiveData != NULL);
+    assert(pChunk != NULL);
+
+    const taUInt8* pCompressedData = pArchiveData + pChunk->dataPos;
+    if (decryptionKey != 0) {
+        taTimer timer;
+        taZeroObject(&timer);
+        if (pCounters != NULL) {
+            taTimerInit(&timer);
+        }
+
+        taHPIDecryptCopy(pScratch, pCompressedData, pChunk->header.compressedSize, decryptionKey, (taUInt32)pChunk->dataPos);
+        pCompressedData = pScratch;
+
+        if (pCounters != NULL) {
+            taFSIOCountersAddTime(&pCounters->decryptTime, &timer);
+        }
+    }
+
+    // A chunk must never write past the start of the next one, otherwise chunks being decoded in parallel could overlap.
+    size_t chunkOffset = iChunk * TA_HPI_CHUNK_SIZE;
+    size_t chunkCapacity = fileSizeInBytes - chunkOffset;
+    if (chunkCapacity > TA_HPI_CHUNK_SIZE) {
+        chunkCapacity = TA_HPI_CHUNK_SIZE;
+    }
+
+    return taHPIDecodeChunk(&pChunk->header, pCompressedData, pScratch, pOut, chunkCapacity, pCounters);
+}
+
+TA_PRIVATE void taHPIDecodeChunksJobProc(void* pUserData, taUInt32 iChunk)
+{
+    taHPIDecodeChunksJob* pJob = (taHPIDecodeChunksJob*)pUserData;
+    assert(pJob != NULL);
+
+    const taHPIChunk* pChunk = &pJob->pChunks[iChunk];
+
+    // Each chunk has it's own region of the scratch buffer so that chunks can be decoded at the same time.
+    taUInt8* pScratch = NULL;
+    if (pJob->pScratch != NULL) {
+        pScratch = pJob->pScratch + pChunk->scratchOffset;
+    }
+
+    if (!taHPIDecodeChunkFromMemory(pJob->pArchiveData, pJob->decryptionKey, pChunk, pScratch, pJob->pOut + ((size_t)iChunk * TA_HPI_CHUNK_SIZE), pJob->outSizeInBytes, iChunk, pJob->pCounters)) {
+        pJob->failed = TA_TRUE;
+    }
+}
+
+// taHPIDecryptCompressedFromMemory() with I/O statistics. pCounters can be null.
+TA_PRIVATE taBool32 taHPIDecodeCompressedFromMemory(const taUInt8* pArchiveData, size_t archiveSize, taUInt32 dataOffset, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey, taThreadPool* pThreadPool, taFSIOCounters* pCounters)
+{
+    if (pArchiveData == NULL || pBufferOut == NULL) {
+        return TA_FALSE;
+    }
+
+    size_t chunkCount = taHPICalculateChunkCount(uncompressedBytesToRead);
+    if (chunkCount == 0) {
+        return TA_TRUE;     // Empty file.
+    }
+
+    if (chunkCount > 0xFFFFFFFF) {
+        return TA_FALSE;
+    }
+
+    taHPIDecodeChunksJob job;
+    job.pArchiveData   = pArchiveData;
+    job.decryptionKey  = decryptionKey;
+    job.pChunks        = NULL;
+    job.pScratch       = NULL;
+    job.pOut           = (taUInt8*)pBufferOut;
+    job.outSizeInBytes = uncompressedBytesToRead;
+    job.pCounters      = pCounters;
+    job.failed         = TA_FALSE;
+
+    taHPIChunk singleChunk;     // <-- Most files fit in a single chunk, in which case we can avoid an allocation.
+    if (chunkCount == 1) {
+        job.pChunks = &singleChunk;
+    } else {
+        job.pChunks = (taHPIChunk*)malloc(chunkCount * sizeof(*job.pChunks));
+        if (job.pChunks == NULL) {
+            return TA_FALSE;
+        }
+    }
+
+    // The chunk headers are gathered up front. This is cheap compared to the decompression, and is what allows the chunks to be
+    // decoded independently of each other.
+    taTimer timer;
+    taZeroObject(&timer);
+    if (pCounters != NULL) {
+        taTimerInit(&timer);
+    }
+
+    taBool32 result = TA_FALSE;
+    size_t scratchSize;
+    if (!taHPIGatherChunks(pArchiveData, archiveSize, dataOffset, chunkCount, decryptionKey, job.pChunks, &scratchSize)) {
+        goto finished;
+    }
+
+    // The pages are faulted in separately when gathering statistics so that reading can be told apart from decoding.
+    if (pCounters != NULL) {
+        const taHPIChunk* pLastChunk = &job.pChunks[chunkCount-1];
+        size_t storedSize = (pLastChunk->dataPos + pLastChunk->header.compressedSize) - dataOffset;
+        taFSTouchPages(pArchiveData + dataOffset, storedSize);
+        taFSIOCountersAddTime(&pCounters->readTime, &timer);
+
+        // The chunk sizes are counted separately for raw reads.
+        if (dataOffset != 0) {
+            pCounters->storedBytes += storedSize;
+        }
+    }
+
+    if (scratchSize > 0) {
+        job.pScratch = (taUInt8*)malloc(scratchSize);
+        if (job.pScratch == NULL) {
+            goto finished;
+        }
+    }
+
+    taThreadPoolRun(pThreadPool, (taUInt32)chunkCount, taHPIDecodeChunksJobProc, &job);
+    result = !job.failed;
+
+
+finished:
+    free(job.pScratch);
+    if (job.pChunks != &singleChunk) {
+        free(job.pChunks);
+    }
+
+    return result;
+}
+
+taBool32 taHPIDecryptCompressedFromMemory(const taUInt8* pArchiveData, size_t archiveSize, taUInt32 dataOffset, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey, taThreadPool* pThreadPool)
+{
+    return taHPIDecodeCompressedFromMemory(pArchiveData, archiveSize, dataOffset, pBufferOut, uncompressedBytesToRead, decryptionKey, pThreadPool, NULL);
+}
+
+
+
+//// Streamed Files ////
+
+// The number of decompressed chunks a streamed file keeps in memory.
+#define TA_STREAMED_FILE_CACHE_SIZE     4
+
+typedef struct
+{
+    // The index of the chunk in this slot, or TA_FS_INDEX_NONE if the slot is unused.
+    taUInt32 iChunk;
+
+    // The value of the file's use counter when the chunk was last accessed. The least recently used slot is the one to be evicted.
+    taUInt32 lastUsed;
+
+    // The decompressed chunk data. This is TA_HPI_CHUNK_SIZE bytes.
+    taUInt8* pData;
+} taStreamedFileCacheSlot;
+
+struct taStreamedFile
+{
+    // The archive containing the file. Streamed files are only supported for memory mapped archives.
+    const taFSArchive* pArchive;
+
+    // The position of the file's data within the archive.
+    taUInt32 dataOffset;
+
+    // The compression type. When this is 0, reads are decrypted straight out of the mapping and there are no chunks.
+    taUInt32 compressionType;
+
+    // The file's chunks. These are gathered when the file is opened.
+    taUInt32 chunkCount;
+    taHPIChunk* pChunks;
+
+    // Used for decrypting chunks. This is large enough for the largest chunk in the file.
+    taUInt8* pScratch;
+
+    // The most recently used decompressed chunks.
+    taStreamedFileCacheSlot cache[TA_STREAMED_FILE_CACHE_SIZE];
+    taUInt32 useCounter;
+};
+
+TA_PRIVATE taBool32 taFSCanStreamFile(taFSArchive* pArchive, taUInt32 dataSize, taUInt32 compressionType, unsigned int options)
+{
+    assert(pArchive != NULL);
+
+    if ((options & TA_OPEN_FILE_STREAMED) == 0 || (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) != 0) {
+        return TA_FALSE;
+    }
+
+    if (pArchive->mappedFile.pData == NULL) {
+        return TA_FALSE;
+    }
+
+    // If the whole file fits in the cache there's no point streaming it.
+    if (compressionType != 0 && taHPICalculateChunkCount(dataSize) <= TA_STREAMED_FILE_CACHE_SIZE) {
+        return TA_FALSE;
+    }
+
+    return TA_TRUE;
+}
+
+TA_PRIVATE taFile* taFSOpenStreamedFile(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType)
+{
+    assert(pFS != NULL);
+    assert(pArchive != NULL);
+    assert(pArchive->mappedFile.pData != NULL);
+
+    const taMappedFile* pMappedFile = &pArchive->mappedFile;
+    if (dataOffset > pMappedFile->sizeInBytes) {
+        return NULL;
+    }
+
+    size_t chunkCount = 0;
+    if (compressionType == 0) {
+        if (dataSize > pMappedFile->sizeInBytes - dataOffset) {
+            return NULL;
+        }
+    } else {
+        chunkCount = taHPICalculateChunkCount(dataSize);
+    }
+
+    // Everything is stored in a single allocation: the taFile object, followed by the stream state, the chunk list, the cached
+    // chunk data and finally the scratch buffer. The scratch buffer is sized after gathering the chunks, so it's allocated at
+    // its maximum possible size.
+    size_t chunksOffset  = sizeof(taFile) + sizeof(taStreamedFile);
+    size_t cacheOffset   = chunksOffset + (chunkCount * sizeof(taHPIChunk));
+    size_t scratchOffset = cacheOffset;
+    if (chunkCount > 0) {
+        scratchOffset += TA_STREAMED_FILE_CACHE_SIZE * TA_HPI_CHUNK_SIZE;
+    }
+
+    taFile* pFile = (taFile*)malloc(scratchOffset);
+    if (pFile == NULL) {
+        return NULL;
+    }
+
+    taStreamedFile* pStreamed = (taStreamedFile*)(pFile + 1);
+    pStreamed->pArchive        = pArchive;
+    pStreamed->dataOffset      = dataOffset;
+    pStreamed->compressionType = compressionType;
+    pStreamed->chunkCount      = (taUInt32)chunkCount;
+    pStreamed->pChunks         = NULL;
+    pStreamed->pScratch        = NULL;
+    pStreamed->useCounter      = 0;
+
+    for (taUInt32 iSlot = 0; iSlot < TA_STREAMED_FILE_CACHE_SIZE; ++iSlot) {
+        pStreamed->cache[iSlot].iChunk   = TA_FS_INDEX_NONE;
+        pStreamed->cache[iSlot].lastUsed = 0;
+        pStreamed->cache[iSlot].pData    = NULL;
+    }
+
+    if (chunkCount > 0) {
+        pStreamed->pChunks = (taHPIChunk*)((taUInt8*)pFile + chunksOffset);
+
+        size_t scratchSize;
+        if (!taHPIGatherChunks(pMappedFile->pData, pMappedFile->sizeInBytes, dataOffset, chunkCount, pArchive->decryptionKey, pStreamed->pChunks, &scratchSize)) {
+            free(pFile);
+            return NULL;
+        }
+
+        // Only one chunk is decoded at a time so the scratch buffer only needs to be big enough for the largest one.
+        size_t maxCompressedSize = 0;
+        if (scratchSize > 0) {
+            for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+                if (maxCompressedSize < pStreamed->pChunks[iChunk].header.compressedSize) {
+                    maxCompressedSize = pStreamed->pChunks[iChunk].header.compressedSize;
+                }
+            }
+        }
+
+        taFile* pNewFile = (taFile*)realloc(pFile, scratchOffset + maxCompressedSize);
+        if (pNewFile == NULL) {
+            free(pFile);
+            return NULL;
+        }
+
+        pFile = pNewFile;
+        pStreamed = (taStreamedFile*)(pFile + 1);
+        pStreamed->pChunks = (taHPIChunk*)((taUInt8*)pFile + chunksOffset);
+        if (maxCompressedSize > 0) {
+            pStreamed->pScratch = (taUInt8*)pFile + scratchOffset;
+        }
+
+        for (taUInt32 iSlot = 0; iSlot < TA_STREAMED_FILE_CACHE_SIZE; ++iSlot) {
+            pStreamed->cache[iSlot].pData = (taUInt8*)pFile + cacheOffset + (iSlot * TA_HPI_CHUNK_SIZE);
+        }
+    }
+
+    pFile->pFileData = NULL;
+    pFile->_pStreamed = pStreamed;
+    pFile->_pCacheEntry = NULL;
+    pFile->_stream = taCreateMemoryStream(NULL, dataSize);
+    pFile->pFS = pFS;
+    pFile->sizeInBytes = dataSize;
+
+    return pFile;
+}
+
+// Retrieves the decompressed data of the given chunk, decompressing it if it's not already in the cache.
+TA_PRIVATE const taUInt8* taStreamedFileGetChunk(taFile* pFile, taUInt32 iChunk)
+{
+    assert(pFile != NULL);
+    assert(pFile->_pStreamed != NULL);
+
+    taStreamedFile* pStreamed = pFile->_pStreamed;
+    assert(iChunk < pStreamed->chunkCount);
+
+    pStreamed->useCounter += 1;
+
+    taStreamedFileCacheSlot* pVictim = &pStreamed->cache[0];
+    for (taUInt32 iSlot = 0; iSlot < TA_STREAMED_FILE_CACHE_SIZE; ++iSlot) {
+        taStreamedFileCacheSlot* pSlot = &pStreamed->cache[iSlot];
+        if (pSlot->iChunk == iChunk) {
+            pSlot->lastUsed = pStreamed->useCounter;
+            return pSlot->pData;
+        }
+
+        if (pVictim->lastUsed > pSlot->lastUsed) {
+            pVictim = pSlot;
+        }
+    }
+
+    // Not in the cache. Replace the least recently used chunk.
+    const taMappedFile* pMappedFile = &pStreamed->pArchive->mappedFile;
+    if (!taHPIDecodeChunkFromMemory(pMappedFile->pData, pStreamed->pArchive->decryptionKey, &pStreamed->pChunks[iChunk], pStreamed->pScratch, pVictim->pData, pFile->sizeInBytes, iChunk, NULL)) {
+        pVictim->iChunk = TA_FS_INDEX_NONE;
+        pVictim->lastUsed = 0;
+        return NULL;
+    }
+
+    pVictim->iChunk = iChunk;
+    pVictim->lastUsed = pStreamed->useCounter;
+    return pVictim->pData;
+}
+
+TA_PRIVATE size_t taStreamedFileRead(taFile* pFile, void* pBufferOut, size_t bytesToRead)
+{
+    assert(pFile != NULL);
+    assert(pFile->_pStreamed != NULL);
+
+    taStreamedFile* pStreamed = pFile->_pStreamed;
+
+    size_t readPos = pFile->_stream.currentReadPos;
+    if (bytesToRead > pFile->sizeInBytes - readPos) {
+        bytesToRead = pFile->sizeInBytes - readPos;
+    }
+
+    size_t bytesRead = 0;
+    if (pStreamed->compressionType == 0) {
+        size_t dataPos = pStreamed->dataOffset + readPos;
+        taHPIDecryptCopy((taUInt8*)pBufferOut, pStreamed->pArchive->mappedFile.pData + dataPos, bytesToRead, pStreamed->pArchive->decryptionKey, (taUInt32)dataPos);
+        bytesRead = bytesToRead;
+    } else {
+        while (bytesRead < bytesToRead) {
+            size_t filePos = readPos + bytesRead;
+            taUInt32 iChunk = (taUInt32)(filePos / TA_HPI_CHUNK_SIZE);
+            size_t chunkPos = filePos % TA_HPI_CHUNK_SIZE;
+
+            const taUInt8* pChunkData = taStreamedFileGetChunk(pFile, iChunk);
+            if (pChunkData == NULL) {
+                break;  // Corrupt chunk.
+            }
+
+            size_t bytesToCopy = TA_HPI_CHUNK_SIZE - chunkPos;
+            if (bytesToCopy > bytesToRead - bytesRead) {
+                bytesToCopy = bytesToRead - bytesRead;
+            }
+
+            memcpy((taUInt8*)pBufferOut + bytesRead, pChunkData + chunkPos, bytesToCopy);
+            bytesRead += bytesToCopy;
+        }
+    }
+
+    pFile->_stream.currentReadPos += bytesRead;
+    return bytesRead;
+}
+
+
+
+
+//// Pack ////
+
+// The pack file starts with this header. Every offset in the pack is relative to the start of the file.
+#define TA_FS_PACK_MARKER   'KPAT'  // "TAPK"
+#define TA_FS_PACK_VERSION  1
+
+typedef struct
+{
+    taUInt32 marker;
+    taUInt32 version;
+    taUInt32 sourceCount;
+    taUInt32 fileCount;
+    taUInt64 sourcesOffset;
+    taUInt64 filesOffset;
+    taUInt64 pathsOffset;
+    taUInt64 pathsSize;
+} taFSPackHeader;
+
+// An archive the pack was written from. The size and modification time are used to check that the archive hasn't changed.
+typedef struct
+{
+    taUInt64 archiveSize;
+    taUInt64 archiveModifiedTime;
+    taUInt64 centralDirectoryOffset;
+    taUInt32 centralDirectorySize;
+    taUInt32 pathOffset;    // <-- Offset into the path buffer.
+} taFSPackSource;
+
+// A file within the pack. The data is stored decrypted and decompressed, and is followed by a null terminator.
+typedef struct
+{
+    taUInt64 dataOffset;
+    taUInt32 dataSize;
+    taUInt32 sourceIndex;
+    taUInt32 pathOffset;    // <-- Offset into the path buffer.
+    taUInt32 padding;
+} taFSPackFile;
+
+// The data of each file is aligned to this.
+#define TA_FS_PACK_DATA_ALIGNMENT   16
+
+TA_PRIVATE const taFSPackHeader* taFSPackGetHeader(const taFSPack* pPack)
+{
+    return (const taFSPackHeader*)pPack->mappedFile.pData;
+}
+
+TA_PRIVATE const taFSPackSource* taFSPackGetSource(const taFSPack* pPack, taUInt32 sourceIndex)
+{
+    assert(sourceIndex < pPack->sourceCount);
+    return (const taFSPackSource*)(pPack->mappedFile.pData + taFSPackGetHeader(pPack)->sourcesOffset) + sourceIndex;
+}
+
+TA_PRIVATE const taFSPackFile* taFSPackGetFile(const taFSPack* pPack, taUInt32 fileIndex)
+{
+    assert(fileIndex < pPack->fileCount);
+    return (const taFSPackFile*)(pPack->mappedFile.pData + taFSPackGetHeader(pPack)->filesOffset) + fileIndex;
+}
+
+TA_PRIVATE const char* taFSPackGetPath(const taFSPack* pPack, taUInt32 pathOffset)
+{
+    return (const char*)pPack->mappedFile.pData + taFSPackGetHeader(pPack)->pathsOffset + pathOffset;
+}
+
+TA_PRIVATE taBool32 taFSPackIsRangeValid(const taMappedFile* pMappedFile, taUInt64 offset, taUInt64 sizeInBytes)
+{
+    return offset <= pMappedFile->sizeInBytes && sizeInBytes <= pMappedFile->sizeInBytes - offset;
+}
+
+// Checks that everything in the pack is within the bounds of the file so that nothing needs to be checked when it's used.
+TA_PRIVATE taBool32 taFSPackValidate(const taMappedFile* pMappedFile)
+{
+    if (pMappedFile->sizeInBytes < sizeof(taFSPackHeader)) {
+        return TA_FALSE;
+    }
+
+    const taFSPackHeader* pHeader = (const taFSPackHeader*)pMappedFile->pData;
+    if (pHeader->marker != TA_FS_PACK_MARKER || pHeader->version != TA_FS_PACK_VERSION) {
+        return TA_FALSE;
+    }
+
+    if ((pHeader->sourcesOffset % 8) != 0 || !taFSPackIsRangeValid(pMappedFile, pHeader->sourcesOffset, (taUInt64)pHeader->sourceCount * sizeof(taFSPackSource)) ||
+        (pHeader->filesOffset   % 8) != 0 || !taFSPackIsRangeValid(pMappedFile, pHeader->filesOffset,   (taUInt64)pHeader->fileCount   * sizeof(taFSPackFile))   ||
+        pHeader->pathsSize == 0           || !taFSPackIsRangeValid(pMappedFile, pHeader->pathsOffset,   pHeader->pathsSize))
+    {
+        return TA_FALSE;
+    }
+
+    const char* pPaths = (const char*)pMappedFile->pData + pHeader->pathsOffset;
+    if (pPaths[pHeader->pathsSize-1] != '\0') {
+        return TA_FALSE;    // <-- Every path needs to be null terminated.
+    }
+
+    const taFSPackSource* pSources = (const taFSPackSource*)(pMappedFile->pData + pHeader->sourcesOffset);
+    for (taUInt32 iSource = 0; iSource < pHeader->sourceCount; ++iSource) {
+        if (pSources[iSource].pathOffset >= pHeader->pathsSize || !taFSPackIsRangeValid(pMappedFile, pSources[iSource].centralDirectoryOffset, pSources[iSource].centralDirectorySize)) {
+            return TA_FALSE;
+        }
+    }
+
+    const taFSPackFile* pFiles = (const taFSPackFile*)(pMappedFile->pData + pHeader->filesOffset);
+    for (taUInt32 iFile = 0; iFile < pHeader->fileCount; ++iFile) {
+        if (pFiles[iFile].pathOffset >= pHeader->pathsSize || pFiles[iFile].sourceIndex >= pHeader->sourceCount || !taFSPackIsRangeValid(pMappedFile, pFiles[iFile].dataOffset, (taUInt64)pFiles[iFile].dataSize + 1)) {
+            return TA_FALSE;
+        }
+    }
+
+    return TA_TRUE;
+}
+
+TA_PRIVATE void taFSMountPack(taFS* pFS)
+{
+    assert(pFS != NULL);
+
+    taZeroObject(&pFS->pack);
+
+    char packAbsolutePath[TA_MAX_PATH];
+    if (!taPathAppend(packAbsolutePath, sizeof(packAbsolutePath), pFS->rootDir, TA_FS_PACK_FILE_NAME)) {
+        return;
+    }
+
+    if (!taMapFile(packAbsolutePath, &pFS->pack.mappedFile)) {
+        return; // <-- There's no pack, which is the normal case.
+    }
+
+    if (!taFSPackValidate(&pFS->pack.mappedFile)) {
+        taUnmapFile(&pFS->pack.mappedFile);
+        taZeroObject(&pFS->pack);
+        return;
+    }
+
+    pFS->pack.sourceCount = taFSPackGetHeader(&pFS->pack)->sourceCount;
+    pFS->pack.fileCount   = taFSPackGetHeader(&pFS->pack)->fileCount;
+}
+
+TA_PRIVATE void taFSUnmountPack(taFS* pFS)
+{
+    assert(pFS != NULL);
+
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        pFS->pArchives[iArchive].packSourceIndex = TA_FS_INDEX_NONE;
+    }
+
+    for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+        pFS->index.pEntries[iEntry].packFileIndex = TA_FS_INDEX_NONE;
+    }
+
+    taUnmapFile(&pFS->pack.mappedFile);
+    taZeroObject(&pFS->pack);
+}
+
+TA_PRIVATE taUInt32 taFSPackFindSource(const taFSPack* pPack, const char* archiveRelativePath, const taMappedFile* pArchiveFile, taUInt32 centralDirectorySize)
+{
+    assert(pPack != NULL);
+    assert(archiveRelativePath != NULL);
+    assert(pArchiveFile != NULL);
+
+    for (taUInt32 iSource = 0; iSource < pPack->sourceCount; ++iSource) {
+        const taFSPackSource* pSource = taFSPackGetSource(pPack, iSource);
+        if (_stricmp(taFSPackGetPath(pPack, pSource->pathOffset), archiveRelativePath) == 0) {
+            if (pSource->archiveSize == pArchiveFile->sizeInBytes && pSource->archiveModifiedTime == pArchiveFile->modifiedTime && pSource->centralDirectorySize == centralDirectorySize) {
+                return iSource;
+            }
+
+            break;  // <-- The archive has changed since the pack was written.
+        }
+    }
+
+    return TA_FS_INDEX_NONE;
+}
+
+TA_PRIVATE const taUInt8* taFSPackGetCentralDirectory(const taFSPack* pPack, taUInt32 sourceIndex)
+{
+    return pPack->mappedFile.pData + taFSPackGetSource(pPack, sourceIndex)->centralDirectoryOffset;
+}
+
+TA_PRIVATE void taFSResolvePack(taFS* pFS)
+{
+    assert(pFS != NULL);
+
+    if (pFS->pack.fileCount == 0 || pFS->index.pSlots == NULL) {
+        return;
+    }
+
+    for (taUInt32 iFile = 0; iFile < pFS->pack.fileCount; ++iFile) {
+        const taFSPackFile* pPackFile = taFSPackGetFile(&pFS->pack, iFile);
+
+        // Only the instance of the file from the same archive can be replaced. Files from archives that have changed are ignored.
+        for (taUInt32 iEntry = taFSIndexFind(&pFS->index, taFSPackGetPath(&pFS->pack, pPackFile->pathOffset)); iEntry != TA_FS_INDEX_NONE; iEntry = pFS->index.pEntries[iEntry].nextEntryIndex) {
+            taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+            if (pFS->pArchives[pEntry->archiveIndex].packSourceIndex == pPackFile->sourceIndex) {
+                if (pEntry->dataSize == pPackFile->dataSize) {
+                    pEntry->packFileIndex = iFile;
+                }
+                break;
+            }
+        }
+    }
+}
+
+TA_PRIVATE taFile* taFSOpenFileFromPack(taFS* pFS, taUInt32 packFileIndex, unsigned int options)
+{
+    assert(pFS != NULL);
+
+    const taFSPackFile* pPackFile = taFSPackGetFile(&pFS->pack, packFileIndex);
+    const char* pPackData = (const char*)pFS->pack.mappedFile.pData + pPackFile->dataOffset;
+
+    if (pPackFile->dataSize >= TA_FS_SEQUENTIAL_ADVICE_THRESHOLD) {
+        taMappedFileAdviseSequential(&pFS->pack.mappedFile, (size_t)pPackFile->dataOffset, pPackFile->dataSize);
+    }
+
+    // Files that won't be modified can point straight into the mapping. Streamed files are included in this because they can
+    // only be accessed with taReadFile(). The data in the pack is always null terminated.
+    taBool32 isView = (options & (TA_OPEN_FILE_READ_ONLY | TA_OPEN_FILE_STREAMED)) != 0;
+
+    size_t dataAllocationSize = 0;
+    if (!isView) {
+        dataAllocationSize = pPackFile->dataSize;
+        if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
+            dataAllocationSize += 1;
+        }
+    }
+
+    taFile* pFile = malloc(sizeof(*pFile) + dataAllocationSize);
+    if (pFile == NULL) {
+        return NULL;
+    }
+
+    if (isView) {
+        pFile->pFileData = (char*)pPackData;
+    } else {
+        pFile->pFileData = (char*)(pFile + 1);     // <-- The file data is stored in the same allocation, just after the taFile object.
+        memcpy(pFile->pFileData, pPackData, dataAllocationSize);
+    }
+
+    pFile->_pStreamed = NULL;
+    pFile->_pCacheEntry = NULL;
+    pFile->_stream = taCreateMemoryStream(pFile->pFileData, pPackFile->dataSize);
+    pFile->pFS = pFS;
+    pFile->sizeInBytes = pPackFile->dataSize;
+
+    return pFile;
+}
+
+TA_PRIVATE taBool32 taFSPackPatternMatch(const char* relativePath, const char* pattern)
+{
+    const char* patternFileName = taPathFileName(pattern);
+    if (patternFileName[0] == '*') {
+        // It's a directory followed by a wildcard. The directory part includes the trailing slash.
+        size_t directoryLength = (size_t)(patternFileName - pattern);
+        if (_strnicmp(relativePath, pattern, directoryLength) != 0) {
+            return TA_FALSE;
+        }
+
+        if (patternFileName[1] == '.') {
+            return taPathExtensionEqual(relativePath, patternFileName + 2);
+        }
+
+        return TA_TRUE;
+    }
+
+    return _stricmp(relativePath, pattern) == 0;
+}
+
+TA_PRIVATE taUInt64 taFSPackAlign(taUInt64 offset, taUInt64 alignment)
+{
+    return (offset + (alignment-1)) & ~(alignment-1);
+}
+
+taResult taFSWritePack(taFS* pFS, const char* filePath, const char** ppPatterns, taUInt32 patternCount)
+{
+    if (pFS == NULL || filePath == NULL || (ppPatterns == NULL && patternCount > 0)) {
+        return TA_INVALID_ARGS;
+    }
+
+    // The list of files is taken from the index.
+    if (pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
+
+    // The files need to be read from the archives themselves rather than an older pack, and on Windows the pack can't be replaced while
+    // it's mapped.
+    taFSUnmountPack(pFS);
+
+    // The pack is written to a temporary file first so that a failed write doesn't leave a broken pack behind.
+    char tempFilePath[TA_MAX_PATH];
+    if (!taPathAppendExtension(tempFilePath, sizeof(tempFilePath), filePath, "tmp")) {
+        return TA_INVALID_ARGS;
+    }
+
+    taResult result = TA_OUT_OF_MEMORY;
+    taUInt8* pTables = NULL;
+    taUInt8* pFileData = NULL;
+    FILE* pSTDIOFile = NULL;
+
+    taUInt32* pEntryIndices = (taUInt32*)malloc(((pFS->index.entryCount > 0) ? pFS->index.entryCount : 1) * sizeof(*pEntryIndices));
+    if (pEntryIndices == NULL) {
+        return TA_OUT_OF_MEMORY;
+    }
+
+    // Everything up to the start of the file data is built in memory first. To do this we need to know the size of everything.
+    taUInt32 fileCount = 0;
+    taUInt64 pathsSize = 0;
+    taUInt32 largestFileSize = 0;
+    for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+        const char* relativePath = pFS->index.pPaths + pEntry->pathOffset;
+
+        for (taUInt32 iPattern = 0; iPattern < patternCount; ++iPattern) {
+            if (taFSPackPatternMatch(relativePath, ppPatterns[iPattern])) {
+                pEntryIndices[fileCount++] = iEntry;
+                pathsSize += strlen(relativePath) + 1;
+                if (largestFileSize < pEntry->dataSize) {
+                    largestFileSize = pEntry->dataSize;
+                }
+                break;
+            }
+        }
+    }
+
+    taUInt64 centralDirectoriesSize = 0;
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        pathsSize += strlen(pFS->pArchives[iArchive].relativePath) + 1;
+        centralDirectoriesSize += taFSPackAlign(pFS->pArchives[iArchive].centralDirectorySize, 8);
+    }
+
+    taFSPackHeader header;
+    taZeroObject(&header);
+    header.marker        = TA_FS_PACK_MARKER;
+    header.version       = TA_FS_PACK_VERSION;
+    header.sourceCount   = pFS->archiveCount;
+    header.fileCount     = fileCount;
+    header.sourcesOffset = sizeof(header);
+    header.filesOffset   = header.sourcesOffset + (taUInt64)header.sourceCount * sizeof(taFSPackSource);
+    header.pathsOffset   = header.filesOffset   + (taUInt64)header.fileCount   * sizeof(taFSPackFile);
+    header.pathsSize     = (pathsSize > 0) ? pathsSize : 1;
+
+    taUInt64 centralDirectoriesOffset = taFSPackAlign(header.pathsOffset + header.pathsSize, 8);
+    taUInt64 tablesSize = centralDirectoriesOffset + centralDirectoriesSize;
+    if (tablesSize > (size_t)-1) {
+        goto done;
+    }
+
+    pTables = (taUInt8*)calloc(1, (size_t)tablesSize);
+    pFileData = (taUInt8*)malloc((size_t)largestFileSize + TA_FS_PACK_DATA_ALIGNMENT);   // <-- Room for the null terminator and padding.
+    if (pTables == NULL || pFileData == NULL) {
+        goto done;
+    }
+
+    memcpy(pTables, &header, sizeof(header));
+
+    taFSPackSource* pSources = (taFSPackSource*)(pTables + header.sourcesOffset);
+    taFSPackFile* pFiles = (taFSPackFile*)(pTables + header.filesOffset);
+    char* pPaths = (char*)(pTables + header.pathsOffset);
+    taUInt32 pathOffset = 0;
+
+    taUInt64 centralDirectoryOffset = centralDirectoriesOffset;
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        const taFSArchive* pArchive = &pFS->pArchives[iArchive];
+
+        // Archives that aren't mapped don't have a modification time. Leaving the size as 0 means they'll never be matched.
+        if (pArchive->mappedFile.pData != NULL) {
+            pSources[iArchive].archiveSize         = pArchive->mappedFile.sizeInBytes;
+            pSources[iArchive].archiveModifiedTime = pArchive->mappedFile.modifiedTime;
+        }
+
+        pSources[iArchive].centralDirectoryOffset = centralDirectoryOffset;
+        pSources[iArchive].centralDirectorySize   = pArchive->centralDirectorySize;
+        pSources[iArchive].pathOffset             = pathOffset;
+
+        memcpy(pTables + centralDirectoryOffset, pArchive->pCentralDirectory, pArchive->centralDirectorySize);
+        centralDirectoryOffset += taFSPackAlign(pArchive->centralDirectorySize, 8);
+
+        size_t pathLength = strlen(pArchive->relativePath) + 1;
+        memcpy(pPaths + pathOffset, pArchive->relativePath, pathLength);
+        pathOffset += (taUInt32)pathLength;
+    }
+
+    taUInt64 dataOffset = taFSPackAlign(tablesSize, TA_FS_PACK_DATA_ALIGNMENT);
+    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[pEntryIndices[iFile]];
+        const char* relativePath = pFS->index.pPaths + pEntry->pathOffset;
+
+        pFiles[iFile].dataOffset  = dataOffset;
+        pFiles[iFile].dataSize    = pEntry->dataSize;
+        pFiles[iFile].sourceIndex = pEntry->archiveIndex;
+        pFiles[iFile].pathOffset  = pathOffset;
+        dataOffset = taFSPackAlign(dataOffset + pEntry->dataSize + 1, TA_FS_PACK_DATA_ALIGNMENT);
+
+        size_t pathLength = strlen(relativePath) + 1;
+        memcpy(pPaths + pathOffset, relativePath, pathLength);
+        pathOffset += (taUInt32)pathLength;
+    }
+
+
+    pSTDIOFile = taFOpen(tempFilePath, "wb");
+    if (pSTDIOFile == NULL) {
+        result = TA_ERROR;
+        goto done;
+    }
+
+    result = TA_ERROR;
+
+    size_t tablesPaddingSize = (size_t)(taFSPackAlign(tablesSize, TA_FS_PACK_DATA_ALIGNMENT) - tablesSize);
+    memset(pFileData, 0, tablesPaddingSize);
+    if (fwrite(pTables, 1, (size_t)tablesSize, pSTDIOFile) != tablesSize || fwrite(pFileData, 1, tablesPaddingSize, pSTDIOFile) != tablesPaddingSize) {
+        goto done;
+    }
+
+    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[pEntryIndices[iFile]];
+        if (!taFSReadFileDataFromArchive(pFS, &pFS->pArchives[pEntry->archiveIndex], pEntry->dataOffset, pEntry->dataSize, pEntry->compressionType, pFileData, NULL, NULL)) {
+            goto done;
+        }
+
+        // The data is followed by a null terminator, and then padding up to the next file.
+        size_t paddedSize = (size_t)(taFSPackAlign((taUInt64)pEntry->dataSize + 1, TA_FS_PACK_DATA_ALIGNMENT));
+        memset(pFileData + pEntry->dataSize, 0, paddedSize - pEntry->dataSize);
+
+        if (fwrite(pFileData, 1, paddedSize, pSTDIOFile) != paddedSize) {
+            goto done;
+        }
+    }
+
+    if (fclose(pSTDIOFile) != 0) {
+        pSTDIOFile = NULL;
+        goto done;
+    }
+    pSTDIOFile = NULL;
+
+    remove(filePath);   // <-- rename() will not replace an existing file on Windows.
+    if (rename(tempFilePath, filePath) != 0) {
+        goto done;
+    }
+
+    result = TA_SUCCESS;
+
+done:
+    if (pSTDIOFile != NULL) {
+        fclose(pSTDIOFile);
+    }
+
+    if (result == TA_ERROR) {
+        remove(tempFilePath);
+    }
+
+    free(pFileData);
+    free(pTables);
+    free(pEntryIndices);
+    return result;
+}
+
+
+//// File Cache ////
+
+struct taFSCacheEntry
+{
+    // The archive containing the file and the position of the file's data within it. Together these uniquely identify a file.
+    taFSArchive* pArchive;
+    taUInt32 dataOffset;
+
+    // The size of the file data. The data is stored in the same allocation, just after the entry, and is always null terminated.
+    taUInt32 dataSize;
+
+    // The number of open files referencing this entry. Entries are only evicted when this is 0.
+    taUInt32 refCount;
+
+    // The next entry in the same hash bucket.
+    taFSCacheEntry* pNextInBucket;
+
+    // The neighbouring entries in the list of entries in order of use.
+    taFSCacheEntry* pPrev;
+    taFSCacheEntry* pNext;
+};
+
+TA_PRIVATE taUInt32 taFSCacheBucketIndex(taFSArchive* pArchive, taUInt32 dataOffset)
+{
+    taUInt32 hash = (taUInt32)((size_t)pArchive >> 4) ^ (dataOffset * 2654435761U);
+    return (hash ^ (hash >> 16)) & (TA_FS_CACHE_BUCKET_COUNT - 1);
+}
+
+TA_PRIVATE void taFSCacheUnlinkFromUseList(taFSCache* pCache, taFSCacheEntry* pEntry)
+{
+    if (pEntry->pPrev != NULL) {
+        pEntry->pPrev->pNext = pEntry->pNext;
+    } else {
+        pCache->pFirst = pEntry->pNext;
+    }
+
+    if (pEntry->pNext != NULL) {
+        pEntry->pNext->pPrev = pEntry->pPrev;
+    } else {
+        pCache->pLast = pEntry->pPrev;
+    }
+
+    pEntry->pPrev = NULL;
+    pEntry->pNext = NULL;
+}
+
+TA_PRIVATE void taFSCacheLinkToUseListFront(taFSCache* pCache, taFSCacheEntry* pEntry)
+{
+    pEntry->pPrev = NULL;
+    pEntry->pNext = pCache->pFirst;
+    if (pCache->pFirst != NULL) {
+        pCache->pFirst->pPrev = pEntry;
+    } else {
+        pCache->pLast = pEntry;
+    }
+
+    pCache->pFirst = pEntry;
+}
+
+TA_PRIVATE taFSCacheEntry* taFSCacheFind(taFSCache* pCache, taFSArchive* pArchive, taUInt32 dataOffset)
+{
+    for (taFSCacheEntry* pEntry = pCache->pBuckets[taFSCacheBucketIndex(pArchive, dataOffset)]; pEntry != NULL; pEntry = pEntry->pNextInBucket) {
+        if (pEntry->pArchive == pArchive && pEntry->dataOffset == dataOffset) {
+            return pEntry;
+        }
+    }
+
+    return NULL;
+}
+
+TA_PRIVATE void taFSCacheRemove(taFSCache* pCache, taFSCacheEntry* pEntry)
+{
+    assert(pEntry->refCount == 0);
+
+    taFSCacheEntry** ppEntry = &pCache->pBuckets[taFSCacheBucketIndex(pEntry->pArchive, pEntry->dataOffset)];
+    while (*ppEntry != pEntry) {
+        ppEntry = &(*ppEntry)->pNextInBucket;
+    }
+    *ppEntry = pEntry->pNextInBucket;
+
+    taFSCacheUnlinkFromUseList(pCache, pEntry);
+
+    pCache->stats.entryCount -= 1;
+    pCache->stats.sizeInBytes -= pEntry->dataSize;
+    free(pEntry);
+}
+
+// Evicts unreferenced entries, starting from the least recently used, until the cache is back within its budget. This must be
+// called while the lock is held.
+TA_PRIVATE void taFSCacheTrim(taFSCache* pCache)
+{
+    taFSCacheEntry* pEntry = pCache->pLast;
+    while (pEntry != NULL && pCache->stats.sizeInBytes > pCache->stats.budgetInBytes) {
+        taFSCacheEntry* pPrev = pEntry->pPrev;
+        if (pEntry->refCount == 0) {
+            taFSCacheRemove(pCache, pEntry);
+            pCache->stats.evictionCount += 1;
+        }
+
+        pEntry = pPrev;
+    }
+}
+
+TA_PRIVATE taBool32 taFSCanCacheFile(taFS* pFS, taUInt32 dataSize, unsigned int options)
+{
+    // Only files that will not be modified can be shared. The budget is read without the lock, but at worst this means a file
+    // is cached or not cached right as the budget is changed.
+    if ((options & TA_OPEN_FILE_READ_ONLY) == 0) {
+        return TA_FALSE;
+    }
+
+    // Files larger than the entire budget would just evict everything else.
+    return dataSize > 0 && dataSize <= pFS->cache.stats.budgetInBytes;
+}
+
+TA_PRIVATE taFile* taFSOpenCachedFile(taFS* pFS, taFSArchive* pArchive, taUInt32 dataOffset, taUInt32 dataSize, taUInt32 compressionType, const taFSRawRead* pRawRead, taFSIOCounters* pCounters)
+{
+    taFSCache* pCache = &pFS->cache;
+
+    // The file itself is just a view of the cache entry's data.
+    taFile* pFile = malloc(sizeof(*pFile));
+    if (pFile == NULL) {
+        return NULL;
+    }
+
+    taMutexLock(&pCache->lock);
+    taFSCacheEntry* pEntry = taFSCacheFind(pCache, pArchive, dataOffset);
+    if (pEntry != NULL) {
+        pEntry->refCount += 1;
+        pCache->stats.hitCount += 1;
+        taFSCacheUnlinkFromUseList(pCache, pEntry);
+        taFSCacheLinkToUseListFront(pCache, pEntry);
+    } else {
+        pCache->stats.missCount += 1;
+    }
+    taMutexUnlock(&pCache->lock);
+
+    if (pEntry != NULL && pCounters != NULL) {
+        pCounters->isCacheHit = TA_TRUE;
+    }
+
+    if (pEntry == NULL) {
+        // Not in the cache. The file is decompressed without holding the lock so that other files can still be opened in the meantime.
+        taFSCacheEntry* pNewEntry = malloc(sizeof(*pNewEntry) + dataSize + 1);
+        if (pNewEntry == NULL) {
+            free(pFile);
+            return NULL;
+        }
+
+        char* pNewData = (char*)(pNewEntry + 1);
+        if (!taFSReadFileDataFromArchive(pFS, pArchive, dataOffset, dataSize, compressionType, pNewData, pRawRead, pCounters)) {
+            free(pNewEntry);
+            free(pFile);
+            return NULL;
+        }
+
+        pNewData[dataSize] = '\0';   // <-- Always null terminated so TA_OPEN_FILE_WITH_NULL_TERMINATOR can share the same entry.
+
+        pNewEntry->pArchive = pArchive;
+        pNewEntry->dataOffset = dataOffset;
+        pNewEntry->dataSize = dataSize;
+        pNewEntry->refCount = 1;
+
+        taMutexLock(&pCache->lock);
+        {
+            // Another thread may have loaded the same file while we were decompressing it, in which case we just use theirs.
+            pEntry = taFSCacheFind(pCache, pArchive, dataOffset);
+            if (pEntry != NULL) {
+                pEntry->refCount += 1;
+                free(pNewEntry);
+            } else {
+                pEntry = pNewEntry;
+
+                taUInt32 iBucket = taFSCacheBucketIndex(pArchive, dataOffset);
+                pEntry->pNextInBucket = pCache->pBuckets[iBucket];
+                pCache->pBuckets[iBucket] = pEntry;
+                taFSCacheLinkToUseListFront(pCache, pEntry);
+
+                pCache->stats.entryCount += 1;
+                pCache->stats.sizeInBytes += dataSize;
+                taFSCacheTrim(pCache);
+            }
+        }
+        taMutexUnlock(&pCache->lock);
+    }
+
+    pFile->pFileData = (char*)(pEntry + 1);
+    pFile->_pStreamed = NULL;
+    pFile->_pCacheEntry = pEntry;
+    pFile->_stream = taCreateMemoryStream(pFile->pFileData, dataSize);
+    pFile->pFS = pFS;
+    pFile->sizeInBytes = dataSize;
+
+    return pFile;
+}
+
+TA_PRIVATE void taFSCloseCachedFile(taFile* pFile)
+{
+    assert(pFile->_pCacheEntry != NULL);
+
+    taFSCache* pCache = &pFile->pFS->cache;
+    taMutexLock(&pCache->lock);
+    {
+        assert(pFile->_pCacheEntry->refCount > 0);
+        pFile->_pCacheEntry->refCount -= 1;
+
+        // The entry may have been kept around past the budget only because it was open.
+        taFSCacheTrim(pCache);
+    }
+    taMutexUnlock(&pCache->lock);
+}
+
+void taFSSetCacheSize(taFS* pFS, size_t sizeInBytes)
+{
+    if (pFS == NULL) {
+        return;
+    }
+
+    taMutexLock(&pFS->cache.lock);
+    {
+        pFS->cache.stats.budgetInBytes = sizeInBytes;
+        taFSCacheTrim(&pFS->cache);
+    }
+    taMutexUnlock(&pFS->cache.lock);
+}
+
+void taFSGetCacheStats(taFS* pFS, taFSCacheStats* pStatsOut)
+{
+    if (pStatsOut == NULL) {
+        return;
+    }
+
+    if (pFS == NULL) {
+        taZeroObject(pStatsOut);
+        return;
+    }
+
+    taMutexLock(&pFS->cache.lock);
+    {
+        *pStatsOut = pFS->cache.stats;
+    }
+    taMutexUnlock(&pFS->cache.lock);
+}
+
+
+
+//// Asynchronous Loading ////
+
+#define TA_FILE_REQUEST_STATE_PENDING   0
+#define TA_FILE_REQUEST_STATE_LOADING   1
+#define TA_FILE_REQUEST_STATE_COMPLETE  2
+
+struct taFileRequest
+{
+    // The file system the request was made on.
+    taFS* pFS;
+
+    // The file to open, and the options to open it with.
+    char relativePath[TA_MAX_PATH];
+    unsigned int options;
+
+    // The priority of the request. Only used while the request is pending.
+    taInt32 priority;
+
+    // The callback to fire when the request has finished.
+    taFileRequestProc onComplete;
+    void* pUserData;
+
+    // The state of the request. This is protected by the queue's lock.
+    taUInt32 state;
+
+    // The opened file. This is set when the request has finished, and is null if the file could not be opened.
+    taFile* pFile;
+
+    // Released once when the request has finished.
+    taSemaphore completeSemaphore;
+
+    // The neighbouring requests in the queue while the request is pending.
+    taFileRequest* pPrev;
+    taFileRequest* pNext;
+};
+
+// Inserts a request into the queue, after any other requests of the same or higher priority. This must be called while the lock is held.
+TA_PRIVATE void taFSIOQueueInsert(taFSIOQueue* pQueue, taFileRequest* pRequest)
+{
+    // Most requests will have the same priority so searching from the back will almost always stop straight away.
+    taFileRequest* pPrev = pQueue->pLast;
+    while (pPrev != NULL && pPrev->priority < pRequest->priority) {
+        pPrev = pPrev->pPrev;
+    }
+
+    pRequest->pPrev = pPrev;
+    if (pPrev != NULL) {
+        pRequest->pNext = pPrev->pNext;
+        pPrev->pNext = pRequest;
+    } else {
+        pRequest->pNext = pQueue->pFirst;
+        pQueue->pFirst = pRequest;
+    }
+
+    if (pRequest->pNext != NULL) {
+        pRequest->pNext->pPrev = pRequest;
+    } else {
+        pQueue->pLast = pRequest;
+    }
+
+    pQueue->pendingCount += 1;
+}
+
+// Removes a pending request from the queue. This must be called while the lock is held.
+TA_PRIVATE void taFSIOQueueRemove(taFSIOQueue* pQueue, taFileRequest* pRequest)
+{
+    if (pRequest->pPrev != NULL) {
+        pRequest->pPrev->pNext = pRequest->pNext;
+    } else {
+        pQueue->pFirst = pRequest->pNext;
+    }
+
+    if (pRequest->pNext != NULL) {
+        pRequest->pNext->pPrev = pRequest->pPrev;
+    } else {
+        pQueue->pLast = pRequest->pPrev;
+    }
+
+    pRequest->pPrev = NULL;
+    pRequest->pNext = NULL;
+    pQueue->pendingCount -= 1;
+}
+
+TA_PRIVATE taThreadResult TA_THREADCALL taFSIOThread(void* pData)
+{
+    taFS* pFS = (taFS*)pData;
+    taFSIOQueue* pQueue = &pFS->ioQueue;
+
+    for (;;) {
+        taSemaphoreWait(&pQueue->workSemaphore);
+
+        taMutexLock(&pQueue->lock);
+        if (pQueue->isTerminating) {
+            taMutexUnlock(&pQueue->lock);
+            break;
+        }
+
+        // The queue can be empty if the request this thread was woken up for has since been cancelled.
+        taFileRequest* pRequest = pQueue->pFirst;
+        if (pRequest != NULL) {
+            taFSIOQueueRemove(pQueue, pRequest);
+            pRequest->state = TA_FILE_REQUEST_STATE_LOADING;
+        }
+        taMutexUnlock(&pQueue->lock);
+
+        if (pRequest == NULL) {
+            continue;
+        }
+
+        taFile* pFile = taOpenFile(pFS, pRequest->relativePath, pRequest->options);
+
+        // The callback is fired before the request is marked as complete so that the request can't be deleted while it's running.
+        if (pRequest->onComplete) {
+            pRequest->onComplete(pRequest, pFile, pRequest->pUserData);
+        }
+
+        taMutexLock(&pQueue->lock);
+        {
+            pRequest->pFile = pFile;
+            pRequest->state = TA_FILE_REQUEST_STATE_COMPLETE;
+        }
+        taMutexUnlock(&pQueue->lock);
+
+        taSemaphoreRelease(&pRequest->completeSemaphore);   // <-- The request may be deleted as soon as this is released.
+    }
+
+    return 0;
+}
+
+TA_PRIVATE void taFSStopIOThreads(taFS* pFS)
+{
+    taFSIOQueue* pQueue = &pFS->ioQueue;
+
+    taMutexLock(&pQueue->lock);
+    {
+        pQueue->isTerminating = TA_TRUE;
+    }
+    taMutexUnlock(&pQueue->lock);
+
+    for (taUInt32 iThread = 0; iThread < pQueue->threadCount; ++iThread) {
+        taSemaphoreRelease(&pQueue->workSemaphore);
+    }
+
+    for (taUInt32 iThread = 0; iThread < pQueue->threadCount; ++iThread) {
+        taWaitForThread(&pQueue->pThreads[iThread]);
+    }
+
+    free(pQueue->pThreads);
+    pQueue->pThreads = NULL;
+    pQueue->threadCount = 0;
+    pQueue->isTerminating = TA_FALSE;
+}
+
+void taFSSetIOThreadCount(taFS* pFS, taUInt32 threadCount)
+{
+    if (pFS == NULL) {
+        return;
+    }
+
+    if (threadCount == 0) {
+        threadCount = TA_FS_DEFAULT_IO_THREAD_COUNT;
+    }
+
+    taFSIOQueue* pQueue = &pFS->ioQueue;
+    taFSStopIOThreads(pFS);
+
+    // The work semaphore will have been left with an unknown count by the old threads so it's reset to match the pending requests.
+    taSemaphoreUninit(&pQueue->workSemaphore);
+    if (!taSemaphoreInit(&pQueue->workSemaphore, pQueue->pendingCount)) {
+        return;
+    }
+
+    pQueue->pThreads = (taThread*)malloc(threadCount * sizeof(*pQueue->pThreads));
+    if (pQueue->pThreads == NULL) {
+        return;
+    }
+
+    // If a thread fails to start we just run with what we have.
+    for (taUInt32 iThread = 0; iThread < threadCount; ++iThread) {
+        if (!taCreateThread(&pQueue->pThreads[iThread], taFSIOThread, pFS)) {
+            break;
+        }
+
+        pQueue->threadCount += 1;
+    }
+}
+
+taFileRequest* taOpenFileAsync(taFS* pFS, const char* relativePath, unsigned int options, taInt32 priority, taFileRequestProc onComplete, void* pUserData)
+{
+    if (pFS == NULL || relativePath == NULL) {
+        return NULL;
+    }
+
+    taFileRequest* pRequest = (taFileRequest*)calloc(1, sizeof(*pRequest));
+    if (pRequest == NULL) {
+        return NULL;
+    }
+
+    if (strcpy_s(pRequest->relativePath, sizeof(pRequest->relativePath), relativePath) != 0) {
+        free(pRequest);
+        return NULL;
+    }
+
+    if (!taSemaphoreInit(&pRequest->completeSemaphore, 0)) {
+        free(pRequest);
+        return NULL;
+    }
+
+    pRequest->pFS        = pFS;
+    pRequest->options    = options;
+    pRequest->priority   = priority;
+    pRequest->onComplete = onComplete;
+    pRequest->pUserData  = pUserData;
+    pRequest->state      = TA_FILE_REQUEST_STATE_PENDING;
+
+    taMutexLock(&pFS->ioQueue.lock);
+    {
+        taFSIOQueueInsert(&pFS->ioQueue, pRequest);
+    }
+    taMutexUnlock(&pFS->ioQueue.lock);
+
+    taSemaphoreRelease(&pFS->ioQueue.workSemaphore);
+    return pRequest;
+}
+
+void taSetFileRequestPriority(taFileRequest* pRequest, taInt32 priority)
+{
+    if (pRequest == NULL) {
+        return;
+    }
+
+    taFSIOQueue* pQueue = &pRequest->pFS->ioQueue;
+    taMutexLock(&pQueue->lock);
+    {
+        if (pRequest->state == TA_FILE_REQUEST_STATE_PENDING && pRequest->priority != priority) {
+            taFSIOQueueRemove(pQueue, pRequest);
+            pRequest->priority = priority;
+            taFSIOQueueInsert(pQueue, pRequest);
+        }
+    }
+    taMutexUnlock(&pQueue->lock);
+}
+
+taBool32 taIsFileRequestComplete(taFileRequest* pRequest)
+{
+    if (pRequest == NULL) {
+        return TA_FALSE;
+    }
+
+    taBool32 isComplete;
+    taMutexLock(&pRequest->pFS->ioQueue.lock);
+    {
+        isComplete = pRequest->state == TA_FILE_REQUEST_STATE_COMPLETE;
+    }
+    taMutexUnlock(&pRequest->pFS->ioQueue.lock);
+
+    return isComplete;
+}
+
+taFile* taFinishFileRequest(taFileRequest* pRequest)
+{
+    if (pRequest == NULL) {
+        return NULL;
+    }
+
+    taSemaphoreWait(&pRequest->completeSemaphore);
+    taFile* pFile = pRequest->pFile;
+
+    taSemaphoreUninit(&pRequest->completeSemaphore);
+    free(pRequest);
+
+    return pFile;
+}
+
+void taCancelFileRequest(taFileRequest* pRequest)
+{
+    if (pRequest == NULL) {
+        return;
+    }
+
+    taFSIOQueue* pQueue = &pRequest->pFS->ioQueue;
+
+    taBool32 wasPending = TA_FALSE;
+    taMutexLock(&pQueue->lock);
+    {
+        if (pRequest->state == TA_FILE_REQUEST_STATE_PENDING) {
+            taFSIOQueueRemove(pQueue, pRequest);
+            wasPending = TA_TRUE;
+        }
+    }
+    taMutexUnlock(&pQueue->lock);
+
+    if (wasPending) {
+        // No I/O thread will ever see the request now so it can be deleted straight away.
+        taSemaphoreUninit(&pRequest->completeSemaphore);
+        free(pRequest);
+    } else {
+        taCloseFile(taFinishFileRequest(pRequest));
+    }
+}
+
+
+
+//// Recording and Prefetching ////
+
+// The manifest is a text file with a line for each file, in the order they were recorded. Each line is a mode character, the relative
+// path of the archive containing the file, and the relative path of the file, separated by tabs. The mode is TA_FS_MANIFEST_MODE_CACHE
+// if the file was opened in a way that allows it to be shared through the file cache, and TA_FS_MANIFEST_MODE_PAGE otherwise.
+#define TA_FS_MANIFEST_MODE_CACHE   'c'
+#define TA_FS_MANIFEST_MODE_PAGE    'p'
+
+TA_PRIVATE taBool32 taFSIsEntryRecordedNoLock(const taFSRecorder* pRecorder, taUInt32 entryIndex)
+{
+    return (pRecorder->pRecordedBits[entryIndex >> 3] & (1 << (entryIndex & 7))) != 0;
+}
+
+TA_PRIVATE void taFSRecordAccess(taFS* pFS, taUInt32 entryIndex, unsigned int options)
+{
+    taFSRecorder* pRecorder = &pFS->recorder;
+
+    // This is checked without the lock so that opening a file costs nothing extra when there's no recording. At worst a file opened
+    // on another thread right as the recording is started or ended will be missed.
+    if (!pRecorder->isRecording) {
+        return;
+    }
+
+    taMutexLock(&pRecorder->lock);
+    if (pRecorder->isRecording && !taFSIsEntryRecordedNoLock(pRecorder, entryIndex)) {
+        if (pRecorder->accessCount == pRecorder->accessCapacity) {
+            taUInt32 newCapacity = (pRecorder->accessCapacity == 0) ? 64 : pRecorder->accessCapacity*2;
+            taFSRecordedAccess* pNewAccesses = (taFSRecordedAccess*)realloc(pRecorder->pAccesses, newCapacity * sizeof(*pNewAccesses));
+            if (pNewAccesses == NULL) {
+                taMutexUnlock(&pRecorder->lock);
+                return;
+            }
+
+            pRecorder->pAccesses = pNewAccesses;
+            pRecorder->accessCapacity = newCapacity;
+        }
+
+        pRecorder->pAccesses[pRecorder->accessCount].entryIndex = entryIndex;
+        pRecorder->pAccesses[pRecorder->accessCount].options = options;
+        pRecorder->accessCount += 1;
+        pRecorder->pRecordedBits[entryIndex >> 3] |= (taUInt8)(1 << (entryIndex & 7));
+    }
+    taMutexUnlock(&pRecorder->lock);
+}
+
+TA_PRIVATE taBool32 taFSIsEntryRecorded(taFS* pFS, taUInt32 entryIndex)
+{
+    taFSRecorder* pRecorder = &pFS->recorder;
+
+    taBool32 isRecorded = TA_FALSE;
+    taMutexLock(&pRecorder->lock);
+    {
+        isRecorded = pRecorder->isRecording && taFSIsEntryRecordedNoLock(pRecorder, entryIndex);
+    }
+    taMutexUnlock(&pRecorder->lock);
+
+    return isRecorded;
+}
+
+taResult taFSBeginRecording(taFS* pFS)
+{
+    if (pFS == NULL) {
+        return TA_INVALID_ARGS;
+    }
+
+    // Accesses are recorded by their position in the index, so there's nothing to record without one.
+    if (pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
+
+    taUInt8* pRecordedBits = (taUInt8*)calloc((pFS->index.entryCount + 7) / 8, 1);
+    if (pRecordedBits == NULL) {
+        return TA_OUT_OF_MEMORY;
+    }
+
+    taFSRecorder* pRecorder = &pFS->recorder;
+    taMutexLock(&pRecorder->lock);
+    {
+        free(pRecorder->pRecordedBits);
+        pRecorder->pRecordedBits = pRecordedBits;
+        pRecorder->accessCount = 0;
+        pRecorder->isRecording = TA_TRUE;
+    }
+    taMutexUnlock(&pRecorder->lock);
+
+    return TA_SUCCESS;
+}
+
+void taFSCreateFileDirectory(const char* filePath)
+{
+    char directoryPath[TA_MAX_PATH];
+    if (taPathBasePath(directoryPath, sizeof(directoryPath), filePath) > 1) {
+#ifdef _WIN32
+        CreateDirectoryA(directoryPath, NULL);
+#else
+        mkdir(directoryPath, 0777);
+#endif
+    }
+}
+
+TA_PRIVATE taResult taFSWriteManifest(taFS* pFS, const char* manifestRelativePath, const taFSRecordedAccess* pAccesses, taUInt32 accessCount)
+{
+    char manifestPath[TA_MAX_PATH];
+    if (!taPathAppend(manifestPath, sizeof(manifestPath), pFS->rootDir, manifestRelativePath)) {
+        return TA_INVALID_ARGS;
+    }
+
+    taFSCreateFileDirectory(manifestPath);
+
+    FILE* pFile = taFOpen(manifestPath, "wb");
+    if (pFile == NULL) {
+        return TA_FAILED_TO_CREATE_RESOURCE;
+    }
+
+    taResult result = TA_SUCCESS;
+    for (taUInt32 iAccess = 0; iAccess < accessCount; ++iAccess) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[pAccesses[iAccess].entryIndex];
+
+        char mode = TA_FS_MANIFEST_MODE_PAGE;
+        if ((pAccesses[iAccess].options & TA_OPEN_FILE_READ_ONLY) != 0 && (pAccesses[iAccess].options & TA_OPEN_FILE_STREAMED) == 0) {
+            mode = TA_FS_MANIFEST_MODE_CACHE;
+        }
+
+        if (fprintf(pFile, "%c\t%s\t%s\n", mode, pFS->pArchives[pEntry->archiveIndex].relativePath, pFS->index.pPaths + pEntry->pathOffset) < 0) {
+            result = TA_ERROR;
+            break;
+        }
+    }
+
+    if (fclose(pFile) != 0) {
+        result = TA_ERROR;
+    }
+
+    return result;
+}
+
+taResult taFSEndRecording(taFS* pFS, const char* manifestRelativePath)
+{
+    if (pFS == NULL) {
+        return TA_INVALID_ARGS;
+    }
+
+    // The recording is taken out of the recorder so that the manifest can be written without holding the lock.
+    taFSRecorder* pRecorder = &pFS->recorder;
+    taMutexLock(&pRecorder->lock);
+
+    taBool32 wasRecording = pRecorder->isRecording;
+    taFSRecordedAccess* pAccesses = pRecorder->pAccesses;
+    taUInt32 accessCount = pRecorder->accessCount;
+
+    free(pRecorder->pRecordedBits);
+    pRecorder->pRecordedBits = NULL;
+    pRecorder->pAccesses = NULL;
+    pRecorder->accessCount = 0;
+    pRecorder->accessCapacity = 0;
+    pRecorder->isRecording = TA_FALSE;
+
+    taMutexUnlock(&pRecorder->lock);
+
+    taResult result = TA_SUCCESS;
+    if (manifestRelativePath != NULL) {
+        if (wasRecording) {
+            result = taFSWriteManifest(pFS, manifestRelativePath, pAccesses, accessCount);
+        } else {
+            result = TA_ERROR;
+        }
+    }
+
+    free(pAccesses);
+    return result;
+}
+
+// Parses a line of a manifest, in place, and resolves it to an entry in the index. Returns TA_FS_INDEX_NONE if the line is malformed or
+// the file can't be found in the archive it was recorded from.
+TA_PRIVATE taUInt32 taFSParseManifestLine(taFS* pFS, char* line, char* pModeOut)
+{
+    assert(pFS != NULL);
+    assert(line != NULL);
+    assert(pModeOut != NULL);
+
+    // Split the line at the tabs, in place.
+    char* pFields[3] = {line, NULL, NULL};
+    taUInt32 fieldCount = 1;
+    for (char* pChar = line; *pChar != '\0'; ++pChar) {
+        if (*pChar == '\r' || *pChar == '\n') {
+            *pChar = '\0';
+            break;
+        }
+
+        if (*pChar == '\t' && fieldCount < 3) {
+            *pChar = '\0';
+            pFields[fieldCount++] = pChar + 1;
+        }
+    }
+
+    if (fieldCount != 3 || pFields[0][0] == '\0' || pFields[0][1] != '\0') {
+        return TA_FS_INDEX_NONE;
+    }
+
+    const char* archiveRelativePath = pFields[1];
+    const char* fileRelativePath = pFields[2];
+
+    taUInt32 iEntry = taFSIndexFind(&pFS->index, fileRelativePath);
+    while (iEntry != TA_FS_INDEX_NONE && _stricmp(pFS->pArchives[pFS->index.pEntries[iEntry].archiveIndex].relativePath, archiveRelativePath) != 0) {
+        iEntry = pFS->index.pEntries[iEntry].nextEntryIndex;
+    }
+
+    *pModeOut = pFields[0][0];
+    return iEntry;
+}
+
+TA_PRIVATE void taFSPrefetchAdviseItem(taFS* pFS, const taFSPrefetchItem* pItem)
+{
+    const taFSIndexEntry* pEntry = &pFS->index.pEntries[pItem->entryIndex];
+    if (pEntry->packFileIndex != TA_FS_INDEX_NONE) {
+        const taFSPackFile* pPackFile = taFSPackGetFile(&pFS->pack, pEntry->packFileIndex);
+        taMappedFileAdviseWillNeed(&pFS->pack.mappedFile, (size_t)pPackFile->dataOffset, pPackFile->dataSize);
+    } else {
+        taMappedFileAdviseWillNeed(&pFS->pArchives[pEntry->archiveIndex].mappedFile, pEntry->dataOffset, pEntry->dataSize);
+    }
+}
+
+TA_PRIVATE taThreadResult TA_THREADCALL taFSPrefetchThread(void* pData)
+{
+    taFS* pFS = (taFS*)pData;
+    taFSPrefetcher* pPrefetcher = &pFS->prefetcher;
+
+    // The OS is asked to read in everything first. This doesn't wait for the reads so the disk can get started on the whole list
+    // straight away, while the loader and the decompression below are busy with the CPU.
+    for (taUInt32 iItem = 0; iItem < pPrefetcher->itemCount; ++iItem) {
+        if (taAtomicFetchAdd32(&pPrefetcher->isCancelled, 0) != 0) {
+            return 0;
+        }
+
+        taFSPrefetchAdviseItem(pFS, &pPrefetcher->pItems[iItem]);
+    }
+
+    // With only a single CPU, decompressing ahead of time would just take time away from the loader.
+    if (taGetCPUCount() < 2) {
+        return 0;
+    }
+
+    // Only half of the cache is used so that prefetching does not evict files the loader has only just finished with.
+    size_t cacheBytesRemaining = pFS->cache.stats.budgetInBytes / 2;
+
+    for (taUInt32 iItem = 0; iItem < pPrefetcher->itemCount; ++iItem) {
+        if (taAtomicFetchAdd32(&pPrefetcher->isCancelled, 0) != 0) {
+            break;
+        }
+
+        // Files in the pack, and files stored as-is in a mapped archive, are opened straight from the mapping so there's nothing to
+        // decompress.
+        const taFSPrefetchItem* pItem = &pPrefetcher->pItems[iItem];
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[pItem->entryIndex];
+        taFSArchive* pArchive = &pFS->pArchives[pEntry->archiveIndex];
+        if (!pItem->useCache || pEntry->packFileIndex != TA_FS_INDEX_NONE || (pEntry->compressionType == 0 && pArchive->decryptionKey == 0 && pArchive->mappedFile.pData != NULL)) {
+            continue;
+        }
+
+        if (pEntry->dataSize > cacheBytesRemaining || !taFSCanCacheFile(pFS, pEntry->dataSize, TA_OPEN_FILE_READ_ONLY)) {
+            continue;
+        }
+
+        // There's no point decompressing anything the loader has already gotten to.
+        if (taFSIsEntryRecorded(pFS, pItem->entryIndex)) {
+            continue;
+        }
+
+        // The file is opened through the cache directly so that the open is not recorded.
+        taFile* pFile = taFSOpenCachedFile(pFS, pArchive, pEntry->dataOffset, pEntry->dataSize, pEntry->compressionType, NULL, NULL);
+        if (pFile != NULL) {
+            cacheBytesRemaining -= pEntry->dataSize;
+            taCloseFile(pFile);
+        }
+    }
+
+    return 0;
+}
+
+taResult taFSPrefetchManifest(taFS* pFS, const char* manifestRelativePath)
+{
+    if (pFS == NULL || manifestRelativePath == NULL) {
+        return TA_INVALID_ARGS;
+    }
+
+    taFSCancelPrefetch(pFS);
+
+    // Files are resolved through the index.
+    if (pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
+
+    char manifestPath[TA_MAX_PATH];
+    if (!taPathAppend(manifestPath, sizeof(manifestPath), pFS->rootDir, manifestRelativePath)) {
+        return TA_INVALID_ARGS;
+    }
+
+    FILE* pFile = taFOpen(manifestPath, "rb");
+    if (pFile == NULL) {
+        return TA_FILE_NOT_FOUND;
+    }
+
+    taFSPrefetcher* pPrefetcher = &pFS->prefetcher;
+    taUInt32 itemCapacity = 0;
+
+    // Lines that can't be resolved are skipped. This happens when the manifest was recorded with a different set of archives.
+    char line[TA_MAX_PATH*2 + 8];
+    while (fgets(line, sizeof(line), pFile) != NULL) {
+        char mode;
+        taUInt32 iEntry = taFSParseManifestLine(pFS, line, &mode);
+        if (iEntry == TA_FS_INDEX_NONE) {
+            continue;
+        }
+
+        if (pPrefetcher->itemCount == itemCapacity) {
+            taUInt32 newCapacity = (itemCapacity == 0) ? 64 : itemCapacity*2;
+            taFSPrefetchItem* pNewItems = (taFSPrefetchItem*)realloc(pPrefetcher->pItems, newCapacity * sizeof(*pNewItems));
+            if (pNewItems == NULL) {
+                break;  // <-- Just prefetch what we have so far.
+            }
+
+            pPrefetcher->pItems = pNewItems;
+            itemCapacity = newCapacity;
+        }
+
+        pPrefetcher->pItems[pPrefetcher->itemCount].entryIndex = iEntry;
+        pPrefetcher->pItems[pPrefetcher->itemCount].useCache = (mode == TA_FS_MANIFEST_MODE_CACHE);
+        pPrefetcher->itemCount += 1;
+    }
+
+    fclose(pFile);
+
+    if (pPrefetcher->itemCount == 0) {
+        free(pPrefetcher->pItems);
+        pPrefetcher->pItems = NULL;
+        return TA_SUCCESS;
+    }
+
+    pPrefetcher->isCancelled = 0;
+    if (!taCreateThread(&pPrefetcher->thread, taFSPrefetchThread, pFS)) {
+        free(pPrefetcher->pItems);
+        pPrefetcher->pItems = NULL;
+        pPrefetcher->itemCount = 0;
+        return TA_ERROR;
+    }
+
+    pPrefetcher->isRunning = TA_TRUE;
+    return TA_SUCCESS;
+}
+
+void taFSCancelPrefetch(taFS* pFS)
+{
+    if (pFS == NULL || !pFS->prefetcher.isRunning) {
+        return;
+    }
+
+    taFSPrefetcher* pPrefetcher = &pFS->prefetcher;
+    taAtomicFetchAdd32(&pPrefetcher->isCancelled, 1);
+    taWaitForThread(&pPrefetcher->thread);
+
+    free(pPrefetcher->pItems);
+    pPrefetcher->pItems = NULL;
+    pPrefetcher->itemCount = 0;
+    pPrefetcher->isRunning = TA_FALSE;
+}
+
+
+
+//// Repacking ////
+
+// The value of the header's save marker for archives. Saved games use a different value.
+#define TA_HPI_SAVE_MARKER          0x00010000
+
+// The value of the unused field of a chunk header. Archives written by the original tools always use this.
+#define TA_HPI_CHUNK_VERSION        2
+
+// The compression type of chunks written by taFSRepackArchive().
+#define TA_HPI_COMPRESSION_ZLIB     2
+
+typedef struct
+{
+    // The position of each file's data entry within the central directory, in the order they appear in the central directory.
+    taUInt32 fileCount;
+    taUInt32 fileCapacity;
+    taUInt32* pFileEntryPositions;
+} taFSRepackFileList;
+
+// The opposite of taHPIParseChunkHeader().
+TA_PRIVATE void taHPIWriteChunkHeader(const taHPIChunkHeader* pHeader, taUInt8* pHeaderData)
+{
+    assert(pHeader != NULL);
+    assert(pHeaderData != NULL);
+
+    memcpy(pHeaderData +  0, &pHeader->marker,           4);
+    memcpy(pHeaderData +  4, &pHeader->unused,           1);
+    memcpy(pHeaderData +  5, &pHeader->compressionType,  1);
+    memcpy(pHeaderData +  6, &pHeader->encrypted,        1);
+    memcpy(pHeaderData +  7, &pHeader->compressedSize,   4);
+    memcpy(pHeaderData + 11, &pHeader->uncompressedSize, 4);
+    memcpy(pHeaderData + 15, &pHeader->checksum,         4);
+}
+
+TA_PRIVATE taBool32 taFSRepackPushFile(taFSRepackFileList* pList, taUInt32 entryPos)
+{
+    if (pList->fileCount == pList->fileCapacity) {
+        taUInt32 newCapacity = (pList->fileCapacity == 0) ? 1024 : pList->fileCapacity*2;
+        taUInt32* pNewPositions = (taUInt32*)realloc(pList->pFileEntryPositions, newCapacity * sizeof(*pNewPositions));
+        if (pNewPositions == NULL) {
+            return TA_FALSE;
+        }
+
+        pList->pFileEntryPositions = pNewPositions;
+        pList->fileCapacity = newCapacity;
+    }
+
+    pList->pFileEntryPositions[pList->fileCount++] = entryPos;
+    return TA_TRUE;
+}
+
+// Undoes taFSAdjustCentralDirectoryNamePointers() on a copy of an archive's central directory so that the positions are relative to
+// the start of an archive whose central directory is at startPos. The data entry of each file is added to pList along the way.
+TA_PRIVATE taBool32 taFSRepackRestoreCentralDirectoryRecursive(taUInt8* pCentralDirectory, taUInt32 centralDirectorySize, taUInt32 directoryPos, taUInt32 startPos, taFSRepackFileList* pList)
+{
+    assert(pCentralDirectory != NULL);
+    assert(pList != NULL);
+
+    if (directoryPos > centralDirectorySize || centralDirectorySize - directoryPos < 8) {
+        return TA_FALSE;
+    }
+
+    taUInt32 fileCount;
+    taUInt32 entryOffset;
+    memcpy(&fileCount,   pCentralDirectory + directoryPos + 0, 4);
+    memcpy(&entryOffset, pCentralDirectory + directoryPos + 4, 4);
+    if (entryOffset > centralDirectorySize || (centralDirectorySize - entryOffset) / 9 < fileCount) {
+        return TA_FALSE;
+    }
+
+    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+        taUInt8* pEntry = pCentralDirectory + entryOffset + (iFile * 9);
+
+        taUInt32 namePos;
+        taUInt32 dataPos;
+        memcpy(&namePos, pEntry + 0, 4);
+        memcpy(&dataPos, pEntry + 4, 4);
+
+        if (pEntry[8]) {
+            if (!taFSRepackRestoreCentralDirectoryRecursive(pCentralDirectory, centralDirectorySize, dataPos, startPos, pList)) {
+                return TA_FALSE;
+            }
+        } else {
+            if (dataPos > centralDirectorySize || centralDirectorySize - dataPos < 9) {
+                return TA_FALSE;
+            }
+
+            if (!taFSRepackPushFile(pList, dataPos)) {
+                return TA_FALSE;
+            }
+        }
+
+        namePos += startPos;
+        dataPos += startPos;
+        memcpy(pEntry + 0, &namePos, 4);
+        memcpy(pEntry + 4, &dataPos, 4);
+    }
+
+    entryOffset += startPos;
+    memcpy(pCentralDirectory + directoryPos + 4, &entryOffset, 4);
+
+    return TA_TRUE;
+}
 
-    taUInt32 extraBytes = 0;
-    if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
-        extraBytes = 1;
-    }
-    
+// Compresses a file into the format of a compressed file in an archive: the size of each chunk followed by the chunks themselves. Returns
+// the size of the compressed data, or 0 if it would not be any smaller than the original data.
+TA_PRIVATE size_t taFSRepackCompressFile(const taUInt8* pData, taUInt32 dataSize, int compressionLevel, taUInt8* pOut, size_t outCapacity)
+{
+    assert(pData != NULL);
+    assert(pOut != NULL);
 
-    taFile* pFile = malloc(sizeof(*pFile) + dataSize + extraBytes);
-    if (pFile == NULL) {
-        fclose(pSTDIOFile);
-        return NULL;
+    size_t chunkCount = taHPICalculateChunkCount(dataSize);
+    if (chunkCount * 4 > outCapacity) {
+        return 0;
     }
 
-    pFile->_stream = taCreateMemoryStream(pFile->pFileData, dataSize);
-    pFile->pFS = pFS;
-    pFile->sizeInBytes = dataSize;
+    taUInt8* pChunkSizes = pOut;
+    size_t compressedSize = chunkCount * 4;
 
-    // Here is where we need to read the file data. There is 3 types of compression used.
-    //  0 - uncompressed
-    //  1 - LZ77
-    //  2 - Zlib
-    if (compressionType == 0) {
-        if (taHPIReadAndDecrypt(pSTDIOFile, pFile->pFileData, pFile->sizeInBytes, pArchive->decryptionKey) != pFile->sizeInBytes) {
-            fclose(pSTDIOFile);
-            free(pFile);
-            return NULL;
+    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+        size_t chunkOffset = iChunk * TA_HPI_CHUNK_SIZE;
+        taUInt32 chunkSize = dataSize - (taUInt32)chunkOffset;
+        if (chunkSize > TA_HPI_CHUNK_SIZE) {
+            chunkSize = TA_HPI_CHUNK_SIZE;
         }
-    } else {
-        if (!taHPIReadAndDecryptCompressed(pSTDIOFile, pFile->pFileData, pFile->sizeInBytes, pArchive->decryptionKey)) {
-            fclose(pSTDIOFile);
-            free(pFile);
-            return NULL;
+
+        if (outCapacity - compressedSize <= TA_HPI_CHUNK_HEADER_SIZE) {
+            return 0;
         }
-    }
 
-    // Null terminate if required.
-    if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
-        pFile->pFileData[pFile->sizeInBytes] = '\0';
+        taUInt8* pChunkData = pOut + compressedSize + TA_HPI_CHUNK_HEADER_SIZE;
+        mz_ulong chunkDataSize = (mz_ulong)(outCapacity - compressedSize - TA_HPI_CHUNK_HEADER_SIZE);
+        if (mz_compress2(pChunkData, &chunkDataSize, pData + chunkOffset, chunkSize, compressionLevel) != MZ_OK) {
+            return 0;
+        }
+
+        taHPIChunkHeader header;
+        header.marker           = 'HSQS';
+        header.unused           = TA_HPI_CHUNK_VERSION;
+        header.compressionType  = TA_HPI_COMPRESSION_ZLIB;
+        header.encrypted        = 0;
+        header.compressedSize   = (taUInt32)chunkDataSize;
+        header.uncompressedSize = chunkSize;
+        header.checksum         = 0;
+        for (mz_ulong i = 0; i < chunkDataSize; ++i) {
+            header.checksum += pChunkData[i];
+        }
+
+        taHPIWriteChunkHeader(&header, pOut + compressedSize);
+
+        taUInt32 chunkSizeInArchive = TA_HPI_CHUNK_HEADER_SIZE + (taUInt32)chunkDataSize;
+        memcpy(pChunkSizes + (iChunk * 4), &chunkSizeInArchive, 4);
+        compressedSize += chunkSizeInArchive;
     }
 
+    if (compressedSize >= dataSize) {
+        return 0;
+    }
 
-    fclose(pSTDIOFile);
-    return pFile;
+    return compressedSize;
 }
 
-
-taFS* taCreateFileSystem()
+taResult taFSRepackArchive(taFS* pFS, const char* archiveRelativePath, const char* filePath, const taFSRepackOptions* pOptions)
 {
-    // We need to retrieve the root directory first. We can't continue if this fails.
-    char exedir[TA_MAX_PATH];
-    if (taGetExecutableDirectoryPath(exedir, sizeof(exedir)) != TA_SUCCESS) {
-        return NULL;
+    if (pFS == NULL || archiveRelativePath == NULL || filePath == NULL) {
+        return TA_INVALID_ARGS;
     }
 
+    taFSRepackOptions defaultOptions;
+    if (pOptions == NULL) {
+        taZeroObject(&defaultOptions);
+        defaultOptions.uncompressedSizeThreshold = TA_FS_REPACK_DEFAULT_UNCOMPRESSED_SIZE_THRESHOLD;
+        defaultOptions.compressionLevel          = TA_FS_REPACK_DEFAULT_COMPRESSION_LEVEL;
+        pOptions = &defaultOptions;
+    }
 
+    if (pOptions->compressionLevel < 1 || pOptions->compressionLevel > 9 || (pOptions->ppManifestPaths == NULL && pOptions->manifestCount > 0)) {
+        return TA_INVALID_ARGS;
+    }
 
-    taFS* pFS = calloc(1, sizeof(*pFS));
-    if (pFS == NULL) {
-        return NULL;
+    taFSArchive* pArchive = NULL;
+    taUInt32 archiveIndex;
+    for (archiveIndex = 0; archiveIndex < pFS->archiveCount; ++archiveIndex) {
+        if (_stricmp(pFS->pArchives[archiveIndex].relativePath, archiveRelativePath) == 0) {
+            pArchive = &pFS->pArchives[archiveIndex];
+            break;
+        }
     }
 
-    if (strcpy_s(pFS->rootDir, sizeof(pFS->rootDir), exedir) != 0) {
-        taDeleteFileSystem(pFS);
-        return NULL;
+    if (pArchive == NULL) {
+        return TA_FILE_NOT_FOUND;
     }
 
-    pFS->archiveCount = 0;
-    pFS->pArchives = NULL;
+    // The manifests are resolved through the index.
+    if (pOptions->manifestCount > 0 && pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
 
-    // Now we want to try loading all of the known archive files. There are a few mandatory packages which if not present will result
-    // in this failing to initialize.
-    if (!taFSRegisterArchive(pFS, "rev31.gp3")   ||
-        !taFSRegisterArchive(pFS, "totala1.hpi") ||
-        !taFSRegisterArchive(pFS, "totala2.hpi"))
-    {
-        taDeleteFileSystem(pFS);
-        return TA_FALSE;
+    // The archive is written to a temporary file first so that a failed write doesn't leave a broken archive behind.
+    char tempFilePath[TA_MAX_PATH];
+    if (!taPathAppendExtension(tempFilePath, sizeof(tempFilePath), filePath, "tmp")) {
+        return TA_INVALID_ARGS;
     }
 
-    // Optional packages.
-    taFSRegisterArchive(pFS, "totala4.hpi");
-    taFSRegisterArchive(pFS, "ccdata.ccx");
-    taFSRegisterArchive(pFS, "ccmaps.ccx");
-    taFSRegisterArchive(pFS, "ccmiss.ccx");
-    taFSRegisterArchive(pFS, "btdata.ccx");
-    taFSRegisterArchive(pFS, "btmaps.ccx");
-    taFSRegisterArchive(pFS, "tactics1.hpi");
-    taFSRegisterArchive(pFS, "tactics2.hpi");
-    taFSRegisterArchive(pFS, "tactics3.hpi");
-    taFSRegisterArchive(pFS, "tactics4.hpi");
-    taFSRegisterArchive(pFS, "tactics5.hpi");
-    taFSRegisterArchive(pFS, "tactics6.hpi");
-    taFSRegisterArchive(pFS, "tactics7.hpi");
-    taFSRegisterArchive(pFS, "tactics8.hpi");
+    taResult result = TA_OUT_OF_MEMORY;
+    taFSRepackFileList files;
+    taZeroObject(&files);
+    taUInt32* pFileOrder = NULL;
+    taUInt8* pHotBits = NULL;
+    taUInt8* pFileData = NULL;
+    taUInt8* pCompressedData = NULL;
+    size_t fileDataCapacity = 0;
+    size_t compressedDataCapacity = 0;
+    FILE* pSTDIOFile = NULL;
+
+    // The central directory of the new archive is the original one with the file data entries pointing to the new data. It comes
+    // straight after the header.
+    taHPIHeader header;
+    taZeroObject(&header);
+    header.marker        = 'IPAH';
+    header.saveMarker    = TA_HPI_SAVE_MARKER;
+    header.directorySize = sizeof(header) + pArchive->centralDirectorySize;
+    header.key           = 0;
+    header.startPos      = sizeof(header);
+
+    taUInt8* pCentralDirectory = (taUInt8*)malloc(pArchive->centralDirectorySize);
+    if (pCentralDirectory == NULL) {
+        goto done;
+    }
 
-    // Now we need to search for .ufo files and register them. We only search the root directory for these.
+    memcpy(pCentralDirectory, pArchive->pCentralDirectory, pArchive->centralDirectorySize);
+    if (!taFSRepackRestoreCentralDirectoryRecursive(pCentralDirectory, pArchive->centralDirectorySize, 0, header.startPos, &files)) {
+        result = TA_INVALID_RESOURCE;
+        goto done;
+    }
+
+    // Files are marked as hot by the position of their data entry. Data entries are at least 9 bytes apart, so a bit for each byte of
+    // the central directory is plenty.
+    pFileOrder = (taUInt32*)malloc(((files.fileCount > 0) ? files.fileCount : 1) * sizeof(*pFileOrder));
+    pHotBits = (taUInt8*)calloc((pArchive->centralDirectorySize + 7) / 8, 1);
+    if (pFileOrder == NULL || pHotBits == NULL) {
+        goto done;
+    }
+
+    // Hot files come first, in the order they were recorded.
     taUInt32 fileCount = 0;
-    taFSFileInfo* pFiles = NULL;
-    taFSGatherFilesInNativeDirectory(pFS, "", TA_FALSE, &fileCount, &pFiles);
-    qsort(pFiles, fileCount, sizeof(*pFiles), taFSFileInfoQuickSortCallback);
+    taUInt32 hotFileCount = 0;
+    for (taUInt32 iManifest = 0; iManifest < pOptions->manifestCount; ++iManifest) {
+        char manifestPath[TA_MAX_PATH];
+        if (!taPathAppend(manifestPath, sizeof(manifestPath), pFS->rootDir, pOptions->ppManifestPaths[iManifest])) {
+            continue;
+        }
 
-    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
-        if (!pFiles[iFile].isDirectory && taPathExtensionEqual(pFiles[iFile].relativePath, "ufo")) {
-            taFSRegisterArchive(pFS, pFiles[iFile].relativePath);
+        FILE* pManifestFile = taFOpen(manifestPath, "rb");
+        if (pManifestFile == NULL) {
+            continue;
         }
-    }
-    
 
-    free(pFiles);
-    return pFS;
-}
+        char line[TA_MAX_PATH*2 + 8];
+        while (fgets(line, sizeof(line), pManifestFile) != NULL && fileCount < files.fileCount) {
+            char mode;
+            taUInt32 iEntry = taFSParseManifestLine(pFS, line, &mode);
+            if (iEntry == TA_FS_INDEX_NONE || pFS->index.pEntries[iEntry].archiveIndex != archiveIndex) {
+                continue;
+            }
 
-void taDeleteFileSystem(taFS* pFS)
-{
-    if (pFS == NULL) {
-        return;
+            taUInt32 entryPos = pFS->index.pEntries[iEntry].entryDataPos;
+            if ((pHotBits[entryPos >> 3] & (1 << (entryPos & 7))) == 0) {
+                pHotBits[entryPos >> 3] |= (taUInt8)(1 << (entryPos & 7));
+                pFileOrder[fileCount++] = entryPos;
+            }
+        }
+
+        fclose(pManifestFile);
     }
 
-    if (pFS->pArchives != NULL) {
-        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
-            free(pFS->pArchives[iArchive].pCentralDirectory);
+    hotFileCount = fileCount;
+
+    // Everything else is in the order of the central directory which keeps the files of each directory together.
+    for (taUInt32 iFile = 0; iFile < files.fileCount; ++iFile) {
+        taUInt32 entryPos = files.pFileEntryPositions[iFile];
+        if ((pHotBits[entryPos >> 3] & (1 << (entryPos & 7))) == 0) {
+            pFileOrder[fileCount++] = entryPos;
         }
+    }
 
-        free(pFS->pArchives);
+    if (pOptions->manifestCount == 0) {
+        hotFileCount = fileCount;
     }
 
-    
-    free(pFS);
-}
 
+    pSTDIOFile = taFOpen(tempFilePath, "wb");
+    if (pSTDIOFile == NULL) {
+        result = TA_ERROR;
+        goto done;
+    }
 
-taFile* taOpenSpecificFile(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath, unsigned int options)
-{
-    if (pFS == NULL) {
-        return NULL;
+    // The central directory is written again at the end once the file data entries have been updated.
+    if (fwrite(&header, 1, sizeof(header), pSTDIOFile) != sizeof(header) || fwrite(pCentralDirectory, 1, pArchive->centralDirectorySize, pSTDIOFile) != pArchive->centralDirectorySize) {
+        result = TA_ERROR;
+        goto done;
     }
 
+    taUInt64 dataOffset = header.directorySize;
+    for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+        taUInt8* pDataEntry = pCentralDirectory + pFileOrder[iFile];
 
-    if (archiveRelativePath == NULL || archiveRelativePath[0] == '\0') {
-        // No archive file was specified. Try opening from the native file system.
-        char fileAbsolutePath[TA_MAX_PATH];
-        if (!taPathAppend(fileAbsolutePath, sizeof(fileAbsolutePath), pFS->rootDir, fileRelativePath)) {
-            return NULL;
-        }
+        taUInt32 originalDataOffset;
+        taUInt32 dataSize;
+        taUInt8 compressionType;
+        memcpy(&originalDataOffset, pDataEntry + 0, 4);
+        memcpy(&dataSize,           pDataEntry + 4, 4);
+        memcpy(&compressionType,    pDataEntry + 8, 1);
+
+        if (dataSize > fileDataCapacity) {
+            taUInt8* pNewFileData = (taUInt8*)realloc(pFileData, dataSize);
+            if (pNewFileData == NULL) {
+                result = TA_OUT_OF_MEMORY;
+                goto done;
+            }
 
-        FILE* pSTDIOFile = taFOpen(fileAbsolutePath, "rb");
-        if (pSTDIOFile == NULL) {
-            return NULL;
+            pFileData = pNewFileData;
+            fileDataCapacity = dataSize;
         }
 
-        taUInt32 extraBytes = 0;
-        if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
-            extraBytes = 1;
+        if (dataSize > 0 && !taFSReadFileDataFromArchive(pFS, pArchive, originalDataOffset, dataSize, compressionType, pFileData, NULL, NULL)) {
+            result = TA_INVALID_RESOURCE;
+            goto done;
         }
 
+        const taUInt8* pDataToWrite = pFileData;
+        size_t dataSizeToWrite = dataSize;
+        compressionType = 0;
+
+        taBool32 isHot = iFile < hotFileCount;
+        if (dataSize > 0 && (!isHot || dataSize > pOptions->uncompressedSizeThreshold)) {
+            size_t chunkCount = taHPICalculateChunkCount(dataSize);
+            size_t requiredCapacity = chunkCount * (4 + TA_HPI_CHUNK_HEADER_SIZE + mz_compressBound(TA_HPI_CHUNK_SIZE));
+            if (requiredCapacity > compressedDataCapacity) {
+                taUInt8* pNewCompressedData = (taUInt8*)realloc(pCompressedData, requiredCapacity);
+                if (pNewCompressedData == NULL) {
+                    result = TA_OUT_OF_MEMORY;
+                    goto done;
+                }
 
-        taFSeek(pSTDIOFile, 0, SEEK_END);
-        taUInt64 sizeInBytes = taFTell(pSTDIOFile);
-        taFSeek(pSTDIOFile, 0, SEEK_SET);
+                pCompressedData = pNewCompressedData;
+                compressedDataCapacity = requiredCapacity;
+            }
 
-        if (sizeInBytes > (sizeInBytes - extraBytes)) {
-            fclose(pSTDIOFile);
-            return NULL;    // File's too big.
+            size_t compressedSize = taFSRepackCompressFile(pFileData, dataSize, pOptions->compressionLevel, pCompressedData, compressedDataCapacity);
+            if (compressedSize > 0) {
+                pDataToWrite = pCompressedData;
+                dataSizeToWrite = compressedSize;
+                compressionType = TA_HPI_COMPRESSION_ZLIB;
+            }
         }
 
+        // Positions in the archive are only 32 bits.
+        if (dataOffset + dataSizeToWrite > 0xFFFFFFFF) {
+            result = TA_ERROR;
+            goto done;
+        }
 
-        taFile* pFile = malloc(sizeof(*pFile) + (size_t)sizeInBytes + extraBytes);
-        if (pFile == NULL) {
-            fclose(pSTDIOFile);
-            return NULL;
+        if (fwrite(pDataToWrite, 1, dataSizeToWrite, pSTDIOFile) != dataSizeToWrite) {
+            result = TA_ERROR;
+            goto done;
         }
 
-        pFile->_stream = taCreateMemoryStream(pFile->pFileData, (size_t)sizeInBytes);
-        pFile->pFS = pFS;
-        pFile->sizeInBytes = (size_t)sizeInBytes;
+        taUInt32 newDataOffset = (taUInt32)dataOffset;
+        memcpy(pDataEntry + 0, &newDataOffset,   4);
+        memcpy(pDataEntry + 8, &compressionType, 1);
+        dataOffset += dataSizeToWrite;
+    }
 
-        if (!fread(pFile->pFileData, 1, pFile->sizeInBytes, pSTDIOFile)) {
-            fclose(pSTDIOFile);
-            return NULL;
-        }
+    result = TA_ERROR;
 
+    if (taFSeek(pSTDIOFile, header.startPos, SEEK_SET) != 0 || fwrite(pCentralDirectory, 1, pArchive->centralDirectorySize, pSTDIOFile) != pArchive->centralDirectorySize) {
+        goto done;
+    }
 
-        // Null terminate if required.
-        if (options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) {
-            pFile->pFileData[pFile->sizeInBytes] = '\0';
-        }
+    if (fclose(pSTDIOFile) != 0) {
+        pSTDIOFile = NULL;
+        goto done;
+    }
+    pSTDIOFile = NULL;
+
+    remove(filePath);   // <-- rename() will not replace an existing file on Windows.
+    if (rename(tempFilePath, filePath) != 0) {
+        goto done;
+    }
 
+    result = TA_SUCCESS;
+
+done:
+    if (pSTDIOFile != NULL) {
         fclose(pSTDIOFile);
-        return pFile;
-    } else {
-        // An archive file was specified. Try opening from that archive. To do this we need to search the central directory.
-        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
-            if (_stricmp(pFS->pArchives[iArchive].relativePath, archiveRelativePath) == 0) {
-                return taFSOpenFileFromArchive(pFS, &pFS->pArchives[iArchive], fileRelativePath, options);
-            }
-        }
+    }
 
-        return NULL;
+    if (result != TA_SUCCESS) {
+        remove(tempFilePath);
     }
+
+    free(pCompressedData);
+    free(pFileData);
+    free(pHotBits);
+    free(pFileOrder);
+    free(files.pFileEntryPositions);
+    free(pCentralDirectory);
+    return result;
 }
 
-taFile* taOpenFile(taFS* pFS, const char* relativePath, unsigned int options)
+
+
+//// I/O Statistics ////
+
+TA_PRIVATE void taFSIOCountersAddTime(volatile taUInt64* pTime, taTimer* pTimer)
 {
-    // All we need to do is try opening the file from every archive, in order of priority.
+    taAtomicFetchAdd64(pTime, (taUInt64)(taTimerTick(pTimer) * 1000000000.0));
+}
 
-    // The native file system is highest priority.
-    taFile* pFile = taOpenSpecificFile(pFS, NULL, relativePath, options);
-    if (pFile != NULL) {
-        return pFile;   // It's on the native file system.
+TA_PRIVATE void taFSTouchPages(const taUInt8* pData, size_t sizeInBytes)
+{
+    // One byte from each page is enough to fault it in. The sum is only there so the reads aren't optimized out.
+    volatile taUInt8 sum = 0;
+    for (size_t offset = 0; offset < sizeInBytes; offset += 4096) {
+        sum += pData[offset];
     }
 
+    if (sizeInBytes > 0) {
+        sum += pData[sizeInBytes-1];
+    }
+}
 
-    // At this point the file is not on the native file system so we just need to search for it.
-    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
-        pFile = taFSOpenFileFromArchive(pFS, &pFS->pArchives[iArchive], relativePath, options);
-        if (pFile != NULL) {
-            return pFile;
-        }
+TA_PRIVATE void taFSAddIOStats(taFSIOStats* pStats, const taFSIOStats* pOther)
+{
+    pStats->openCount         += pOther->openCount;
+    pStats->cacheHitCount     += pOther->cacheHitCount;
+    pStats->storedBytes       += pOther->storedBytes;
+    pStats->uncompressedBytes += pOther->uncompressedBytes;
+    pStats->readTime          += pOther->readTime;
+    pStats->decryptTime       += pOther->decryptTime;
+    pStats->decompressTime    += pOther->decompressTime;
+}
+
+TA_PRIVATE void taFSRecordIO(taFS* pFS, taUInt32 entryIndex, const taFSIOCounters* pCounters)
+{
+    assert(entryIndex < pFS->index.entryCount);
+    assert(pCounters != NULL);
+
+    const taFSIndexEntry* pEntry = &pFS->index.pEntries[entryIndex];
+
+    taFSIOStats stats;
+    stats.openCount         = 1;
+    stats.cacheHitCount     = (pCounters->isCacheHit) ? 1 : 0;
+    stats.storedBytes       = pCounters->storedBytes;
+    stats.uncompressedBytes = pEntry->dataSize;
+    stats.readTime          = pCounters->readTime;
+    stats.decryptTime       = pCounters->decryptTime;
+    stats.decompressTime    = pCounters->decompressTime;
+
+    taFSIOStatsRecorder* pIOStats = &pFS->ioStats;
+    taMutexLock(&pIOStats->lock);
+    if (pIOStats->isEnabled) {
+        taFSAddIOStats(&pIOStats->pFileStats[entryIndex], &stats);
+        taFSAddIOStats(&pIOStats->pArchiveStats[pEntry->archiveIndex], &stats);
     }
+    taMutexUnlock(&pIOStats->lock);
+}
 
+taResult taFSBeginIOStats(taFS* pFS)
+{
+    if (pFS == NULL) {
+        return TA_INVALID_ARGS;
+    }
 
-    // Didn't find the file...
-    assert(pFile == NULL);
-    return NULL;
+    // The statistics are kept per index entry.
+    if (pFS->index.pSlots == NULL) {
+        return TA_ERROR;
+    }
+
+    taFSIOStatsRecorder* pIOStats = &pFS->ioStats;
+    taMutexLock(&pIOStats->lock);
+    {
+        if (pIOStats->pFileStats == NULL) {
+            pIOStats->pFileStats    = (taFSIOStats*)calloc(pFS->index.entryCount, sizeof(*pIOStats->pFileStats));
+            pIOStats->pArchiveStats = (taFSIOStats*)calloc(pFS->archiveCount,     sizeof(*pIOStats->pArchiveStats));
+            if (pIOStats->pFileStats == NULL || pIOStats->pArchiveStats == NULL) {
+                free(pIOStats->pFileStats);
+                free(pIOStats->pArchiveStats);
+                pIOStats->pFileStats = NULL;
+                pIOStats->pArchiveStats = NULL;
+
+                taMutexUnlock(&pIOStats->lock);
+                return TA_OUT_OF_MEMORY;
+            }
+        } else {
+            memset(pIOStats->pFileStats,    0, pFS->index.entryCount * sizeof(*pIOStats->pFileStats));
+            memset(pIOStats->pArchiveStats, 0, pFS->archiveCount     * sizeof(*pIOStats->pArchiveStats));
+        }
+
+        pIOStats->isEnabled = TA_TRUE;
+    }
+    taMutexUnlock(&pIOStats->lock);
+
+    return TA_SUCCESS;
 }
 
-void taCloseFile(taFile* pFile)
+void taFSEndIOStats(taFS* pFS)
 {
-    if (pFile == NULL) {
+    if (pFS == NULL) {
         return;
     }
 
-    free(pFile);
+    taMutexLock(&pFS->ioStats.lock);
+    {
+        pFS->ioStats.isEnabled = TA_FALSE;
+    }
+    taMutexUnlock(&pFS->ioStats.lock);
 }
 
-
-taBool32 taReadFile(taFile* pFile, void* pBufferOut, size_t bytesToRead, size_t* pBytesReadOut)
+taResult taFSGetIOStats(taFS* pFS, const char* archiveRelativePath, taFSIOStats* pStatsOut)
 {
-    if (pFile == NULL || pBufferOut == NULL) {
-        return TA_FALSE;
+    if (pStatsOut == NULL) {
+        return TA_INVALID_ARGS;
     }
 
-    size_t bytesRead = taMemoryStreamRead(&pFile->_stream, pBufferOut, bytesToRead);
-    if (pBytesReadOut) {
-        *pBytesReadOut = bytesRead;
+    taZeroObject(pStatsOut);
+
+    if (pFS == NULL) {
+        return TA_INVALID_ARGS;
     }
 
-    return TA_TRUE;
+    taResult result = (archiveRelativePath == NULL) ? TA_SUCCESS : TA_FILE_NOT_FOUND;
+
+    taMutexLock(&pFS->ioStats.lock);
+    if (pFS->ioStats.pArchiveStats != NULL) {
+        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+            if (archiveRelativePath == NULL || _stricmp(pFS->pArchives[iArchive].relativePath, archiveRelativePath) == 0) {
+                taFSAddIOStats(pStatsOut, &pFS->ioStats.pArchiveStats[iArchive]);
+                result = TA_SUCCESS;
+            }
+        }
+    }
+    taMutexUnlock(&pFS->ioStats.lock);
+
+    return result;
 }
 
-taBool32 taSeekFile(taFile* pFile, taInt64 bytesToSeek, taSeekOrigin origin)
+// A file that was opened while gathering statistics. The statistics are copied out of the recorder so they can be written without
+// holding the lock.
+typedef struct
 {
-    if (pFile == NULL) {
-        return TA_FALSE;
-    }
+    taUInt32 entryIndex;
+    taFSIOStats stats;
+} taFSIOStatsRow;
 
-    return taMemoryStreamSeek(&pFile->_stream, bytesToSeek, origin);
+TA_PRIVATE int taFSIOStatsRowQuickSortCallback(const void* a, const void* b)
+{
+    const taFSIOStats* pStatsA = &((const taFSIOStatsRow*)a)->stats;
+    const taFSIOStats* pStatsB = &((const taFSIOStatsRow*)b)->stats;
+
+    taUInt64 timeA = pStatsA->readTime + pStatsA->decryptTime + pStatsA->decompressTime;
+    taUInt64 timeB = pStatsB->readTime + pStatsB->decryptTime + pStatsB->decompressTime;
+    if (timeA > timeB) return -1;
+    if (timeA < timeB) return  1;
+
+    // Ties are broken by index order so the output is stable.
+    taUInt32 entryIndexA = ((const taFSIOStatsRow*)a)->entryIndex;
+    taUInt32 entryIndexB = ((const taFSIOStatsRow*)b)->entryIndex;
+    return (entryIndexA < entryIndexB) ? -1 : (entryIndexA > entryIndexB);
 }
 
-taUInt64 taTellFile(taFile* pFile)
+// Writes a string as a quoted CSV field or JSON string.
+TA_PRIVATE taBool32 taFSWriteIOStatsString(FILE* pFile, const char* str, taFSIOStatsFormat format)
 {
-    if (pFile == NULL) {
+    if (fputc('"', pFile) == EOF) {
         return TA_FALSE;
     }
 
-    return (taUInt64)taMemoryStreamTell(&pFile->_stream);
-}
+    for (const char* c = str; c[0] != '\0'; ++c) {
+        int result;
+        if (format == taFSIOStatsFormatCSV) {
+            result = (c[0] == '"') ? fputs("\"\"", pFile) : fputc(c[0], pFile);
+        } else {
+            if (c[0] == '"' || c[0] == '\\') {
+                result = fprintf(pFile, "\\%c", c[0]);
+            } else if ((unsigned char)c[0] < 0x20) {
+                result = fprintf(pFile, "\\u%04x", (unsigned char)c[0]);
+            } else {
+                result = fputc(c[0], pFile);
+            }
+        }
 
+        if (result < 0) {
+            return TA_FALSE;
+        }
+    }
 
-taBool32 taReadFileUInt32(taFile* pFile, taUInt32* pBufferOut)
-{
-    size_t bytesRead;
-    return taReadFile(pFile, pBufferOut, sizeof(taUInt32), &bytesRead) && bytesRead == sizeof(taUInt32);
+    return fputc('"', pFile) != EOF;
 }
 
-taBool32 taReadFileInt32(taFile* pFile, taInt32* pBufferOut)
+// Writes a single row or object. filePath is null for the totals of an archive.
+TA_PRIVATE taBool32 taFSWriteIOStatsRow(FILE* pFile, const char* archivePath, const char* filePath, const taFSIOStats* pStats, taFSIOStatsFormat format, taBool32 isFirst)
 {
-    size_t bytesRead;
-    return taReadFile(pFile, pBufferOut, sizeof(taInt32), &bytesRead) && bytesRead == sizeof(taInt32);
-}
+    if (format == taFSIOStatsFormatCSV) {
+        if (!taFSWriteIOStatsString(pFile, archivePath, format) || fputc(',', pFile) == EOF) {
+            return TA_FALSE;
+        }
 
-taBool32 taReadFileUInt16(taFile* pFile, taUInt16* pBufferOut)
-{
-    size_t bytesRead;
-    return taReadFile(pFile, pBufferOut, sizeof(taUInt16), &bytesRead) && bytesRead == sizeof(taUInt16);
-}
+        // The totals of an archive are written with an empty path.
+        if (!taFSWriteIOStatsString(pFile, (filePath != NULL) ? filePath : "", format)) {
+            return TA_FALSE;
+        }
 
-taBool32 taReadFileInt16(taFile* pFile, taInt16* pBufferOut)
-{
-    size_t bytesRead;
-    return taReadFile(pFile, pBufferOut, sizeof(taInt16), &bytesRead) && bytesRead == sizeof(taInt16);
+        return fprintf(pFile, ",%u,%u,%llu,%llu,%.3f,%.3f,%.3f\n",
+            pStats->openCount, pStats->cacheHitCount, (unsigned long long)pStats->storedBytes, (unsigned long long)pStats->uncompressedBytes,
+            pStats->readTime / 1000000.0, pStats->decryptTime / 1000000.0, pStats->decompressTime / 1000000.0) > 0;
+    } else {
+        if (fputs((isFirst) ? "\n    {\"archive\": " : ",\n    {\"archive\": ", pFile) < 0 || !taFSWriteIOStatsString(pFile, archivePath, format)) {
+            return TA_FALSE;
+        }
+
+        if (filePath != NULL) {
+            if (fputs(", \"path\": ", pFile) < 0 || !taFSWriteIOStatsString(pFile, filePath, format)) {
+                return TA_FALSE;
+            }
+        }
+
+        return fprintf(pFile, ", \"opens\": %u, \"cacheHits\": %u, \"storedBytes\": %llu, \"uncompressedBytes\": %llu, \"readMS\": %.3f, \"decryptMS\": %.3f, \"decompressMS\": %.3f}",
+            pStats->openCount, pStats->cacheHitCount, (unsigned long long)pStats->storedBytes, (unsigned long long)pStats->uncompressedBytes,
+            pStats->readTime / 1000000.0, pStats->decryptTime / 1000000.0, pStats->decompressTime / 1000000.0) > 0;
+    }
 }
 
-taBool32 taReadFileUInt8(taFile* pFile, taUInt8* pBufferOut)
+taResult taFSWriteIOStats(taFS* pFS, const char* relativePath, taFSIOStatsFormat format)
 {
-    size_t bytesRead;
-    return taReadFile(pFile, pBufferOut, sizeof(taUInt8), &bytesRead) && bytesRead == sizeof(taUInt8);
-}
+    if (pFS == NULL || relativePath == NULL) {
+        return TA_INVALID_ARGS;
+    }
 
+    char filePath[TA_MAX_PATH];
+    if (!taPathAppend(filePath, sizeof(filePath), pFS->rootDir, relativePath)) {
+        return TA_INVALID_ARGS;
+    }
 
+    taFSIOStatsRow* pRows = NULL;
+    taFSIOStats* pArchiveStats = NULL;
+    taUInt32 rowCount = 0;
+    taResult result = TA_SUCCESS;
 
-//// Iteration ////
+    // Only the files that were actually opened are copied out.
+    taMutexLock(&pFS->ioStats.lock);
+    {
+        if (pFS->ioStats.pFileStats == NULL) {
+            result = TA_ERROR;  // <-- Statistics have never been gathered.
+        } else {
+            for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+                if (pFS->ioStats.pFileStats[iEntry].openCount > 0) {
+                    rowCount += 1;
+                }
+            }
 
-TA_PRIVATE taUInt32 taFSGatherFilesInDirectory(taFS* pFS, const char* directoryRelativePath, taFSFileInfo** ppFilesInOut, taBool32 recursive)
-{
-    assert(pFS != NULL);
-    assert(directoryRelativePath != NULL);
-    assert(ppFilesInOut != NULL);
+            pRows = (taFSIOStatsRow*)malloc(((rowCount > 0) ? rowCount : 1) * sizeof(*pRows));
+            pArchiveStats = (taFSIOStats*)malloc(((pFS->archiveCount > 0) ? pFS->archiveCount : 1) * sizeof(*pArchiveStats));
+            if (pRows == NULL || pArchiveStats == NULL) {
+                result = TA_OUT_OF_MEMORY;
+            } else {
+                taUInt32 iRow = 0;
+                for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+                    if (pFS->ioStats.pFileStats[iEntry].openCount > 0) {
+                        pRows[iRow].entryIndex = iEntry;
+                        pRows[iRow].stats = pFS->ioStats.pFileStats[iEntry];
+                        iRow += 1;
+                    }
+                }
 
-    taUInt32 fileCount = 0;
+                memcpy(pArchiveStats, pFS->ioStats.pArchiveStats, pFS->archiveCount * sizeof(*pArchiveStats));
+            }
+        }
+    }
+    taMutexUnlock(&pFS->ioStats.lock);
 
-    // Native directory has the highest priority.
-    taFSGatherFilesInNativeDirectory(pFS, directoryRelativePath, recursive, &fileCount, ppFilesInOut);
-    
-    // Archives after the native directory.
-    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
-        taFSGatherFilesInArchiveDirectory(pFS, &pFS->pArchives[iArchive], directoryRelativePath, recursive, &fileCount, ppFilesInOut);
+    if (result != TA_SUCCESS) {
+        goto done;
     }
 
-    return fileCount;
-}
+    qsort(pRows, rowCount, sizeof(*pRows), taFSIOStatsRowQuickSortCallback);
 
-taFSIterator* taFSBegin(taFS* pFS, const char* directoryRelativePath, taBool32 recursive)
-{
-    if (pFS == NULL) {
-        return NULL;
+    taFSCreateFileDirectory(filePath);
+
+    FILE* pFile = taFOpen(filePath, "wb");
+    if (pFile == NULL) {
+        result = TA_FAILED_TO_CREATE_RESOURCE;
+        goto done;
     }
 
-    // If the directory path is null, just treat it as though we are iteration over the root directory.
-    if (directoryRelativePath == NULL) {
-        directoryRelativePath = "";
+    taBool32 isWritten;
+    if (format == taFSIOStatsFormatCSV) {
+        isWritten = fputs("archive,path,opens,cache_hits,stored_bytes,uncompressed_bytes,read_ms,decrypt_ms,decompress_ms\n", pFile) >= 0;
+    } else {
+        isWritten = fputs("{\n  \"files\": [", pFile) >= 0;
     }
 
-    taFSIterator* pIter = calloc(1, sizeof(*pIter));
-    if (pIter == NULL) {
-        return NULL;
+    for (taUInt32 iRow = 0; iRow < rowCount && isWritten; ++iRow) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[pRows[iRow].entryIndex];
+        isWritten = taFSWriteIOStatsRow(pFile, pFS->pArchives[pEntry->archiveIndex].relativePath, pFS->index.pPaths + pEntry->pathOffset, &pRows[iRow].stats, format, iRow == 0);
     }
 
-    pIter->pFS = pFS;
-    pIter->_fileCount = taFSGatherFilesInDirectory(pFS, directoryRelativePath, &pIter->_pFiles, recursive);
+    if (format == taFSIOStatsFormatJSON && isWritten) {
+        isWritten = fputs("\n  ],\n  \"archives\": [", pFile) >= 0;
+    }
 
-    return pIter;
-}
+    taBool32 isFirstArchive = TA_TRUE;
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount && isWritten; ++iArchive) {
+        if (pArchiveStats[iArchive].openCount > 0) {
+            isWritten = taFSWriteIOStatsRow(pFile, pFS->pArchives[iArchive].relativePath, NULL, &pArchiveStats[iArchive], format, isFirstArchive);
+            isFirstArchive = TA_FALSE;
+        }
+    }
 
-void taFSEnd(taFSIterator* pIter)
-{
-    if (pIter == NULL) {
-        return;
+    if (format == taFSIOStatsFormatJSON && isWritten) {
+        isWritten = fputs("\n  ]\n}\n", pFile) >= 0;
     }
 
-    free(pIter->_pFiles);
-    free(pIter);
+    if (fclose(pFile) != 0 || !isWritten) {
+        result = TA_ERROR;
+    }
+
+done:
+    free(pArchiveStats);
+    free(pRows);
+    return result;
 }
 
-taBool32 taFSNext(taFSIterator* pIter)
-{
-    if (pIter == NULL || pIter->_iFile >= pIter->_fileCount) {
-        return TA_FALSE;
-    }
 
-    assert(pIter->_pFiles != NULL);
 
-    pIter->fileInfo = pIter->_pFiles[pIter->_iFile];
-    pIter->_iFile += 1;
+//// Unmapped Archives ////
 
-    return TA_TRUE;
-}
+// Archives that could not be memory mapped are read from the real file system each time a file is opened. Rather than following the
+// chunk headers of a compressed file with lots of small reads, the chunk sizes at the start of the file are read first, followed by
+// the entire file in one go. A batch of files is read the same way, with each round of reads being submitted together.
+//
+// On Linux the reads are submitted through io_uring, which allows a whole round to be submitted and waited on with a single system
+// call. Define TA_NO_IO_URING to disable this. It's also disabled when the kernel headers are older than 5.6 (see taEngine.h). If
+// io_uring is not available at run time each read falls back to pread().
 
+// A single read from a file on the real file system.
+typedef struct
+{
+    int fd;
+    taUInt64 offset;
+    size_t sizeInBytes;
+    void* pBufferOut;
 
+    // The number of bytes that have been read so far.
+    size_t bytesRead;
+} taFSRangeRead;
 
-//// HPI Helpers ////
+#ifdef TA_SUPPORT_IO_URING
+#define TA_FS_RING_ENTRY_COUNT  64
 
-taBool32 taHPIDecompressLZ77(const unsigned char* pIn, taUInt32 compressedSize, unsigned char* pOut, taUInt32 uncompressedSize)
+struct taFSRing
 {
-    const unsigned char* pInEnd = pIn + compressedSize;
-    const unsigned char* pOutEnd = pOut + uncompressedSize;
-    (void)pOutEnd;
+    // Only one batch of reads can be in flight at a time.
+    taMutex lock;
+
+    // The io_uring instance.
+    int fd;
+
+    // The submission queue. The kernel takes entries from the head and we add them to the tail.
+    void* pSQRing;
+    size_t sqRingSize;
+    volatile unsigned int* pSQHead;
+    volatile unsigned int* pSQTail;
+    unsigned int sqMask;
+    unsigned int sqEntryCount;
+    unsigned int* pSQArray;
+    struct io_uring_sqe* pSQEs;
+    size_t sqesSize;
+
+    // The completion queue. This may share the submission queue's mapping.
+    void* pCQRing;
+    size_t cqRingSize;
+    volatile unsigned int* pCQHead;
+    volatile unsigned int* pCQTail;
+    unsigned int cqMask;
+    struct io_uring_cqe* pCQEs;
+};
+
+TA_PRIVATE void taFSReadRangesWithRing(taFSRing* pRing, taFSRangeRead* pReads, taUInt32 readCount)
+{
+    taMutexLock(&pRing->lock);
 
-    unsigned char block[4096];
-    unsigned int iblock = 1;
+    for (taUInt32 iFirstRead = 0; iFirstRead < readCount; iFirstRead += pRing->sqEntryCount) {
+        unsigned int batchCount = readCount - iFirstRead;
+        if (batchCount > pRing->sqEntryCount) {
+            batchCount = pRing->sqEntryCount;
+        }
 
-    unsigned char tagMask = 1;
-    unsigned char tag = *pIn++;
+        // Only this thread adds to the submission queue, and it's always empty at this point.
+        unsigned int sqTail = *pRing->pSQTail;
+        unsigned int sqTailBeforeBatch = sqTail;
+        for (unsigned int iRead = 0; iRead < batchCount; ++iRead) {
+            taFSRangeRead* pRead = &pReads[iFirstRead + iRead];
 
-    while (pIn < pInEnd) {
-        if ((tag & tagMask) == 0) {
-            *pOut++       = *pIn;
-            block[iblock] = *pIn++;
+            // A single read is limited to a little under 2GB by the kernel. Anything past that is picked up by pread().
+            size_t bytesToRead = pRead->sizeInBytes;
+            if (bytesToRead > 0x7FFFF000) {
+                bytesToRead = 0x7FFFF000;
+            }
 
-            iblock = (iblock + 1) & 0xFFF;
-        } else {
-            unsigned int offset = (pIn[1] << 4) | ((pIn[0] & 0xF0) >> 4);
-            unsigned int length = (pIn[0] & 0x0F) + 2;
+            unsigned int iEntry = sqTail & pRing->sqMask;
+            struct io_uring_sqe* pEntry = &pRing->pSQEs[iEntry];
+            memset(pEntry, 0, sizeof(*pEntry));
+            pEntry->opcode    = IORING_OP_READ;
+            pEntry->fd        = pRead->fd;
+            pEntry->off       = pRead->offset;
+            pEntry->addr      = (taUInt64)(size_t)pRead->pBufferOut;
+            pEntry->len       = (taUInt32)bytesToRead;
+            pEntry->user_data = iFirstRead + iRead;
+
+            pRing->pSQArray[iEntry] = iEntry;
+            sqTail += 1;
+        }
 
-            if (offset == 0) {
-                assert(pOut == pOutEnd);
-                break;    // Done.
-            }
+        __atomic_store_n(pRing->pSQTail, sqTail, __ATOMIC_RELEASE);
 
-            for (unsigned int i = 0; i < length; ++i) {
-                *pOut++       = block[offset];
-                block[iblock] = block[offset];
+        unsigned int submitCount = batchCount;
+        unsigned int completeCount = 0;
+        while (completeCount < batchCount) {
+            int result = (int)syscall(__NR_io_uring_enter, pRing->fd, submitCount, batchCount - completeCount, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (result < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+
+                // If nothing was submitted the entries can be taken back and the reads will be done with pread() instead. Otherwise
+                // there are reads in flight which we can't safely walk away from, so keep waiting on them.
+                if (submitCount == batchCount) {
+                    __atomic_store_n(pRing->pSQTail, sqTailBeforeBatch, __ATOMIC_RELEASE);
+                    break;
+                }
 
-                iblock = (iblock + 1) & 0xFFF;
-                offset = (offset + 1) & 0xFFF;
+                continue;
             }
 
-            pIn += 2;
-        }
+            submitCount -= (unsigned int)result;
 
-        if (tagMask < 0x80) {
-            tagMask <<= 1;
-        } else {
-            tagMask = 1;
-            tag = *pIn++;
+            unsigned int cqHead = *pRing->pCQHead;
+            unsigned int cqTail = __atomic_load_n(pRing->pCQTail, __ATOMIC_ACQUIRE);
+            while (cqHead != cqTail) {
+                const struct io_uring_cqe* pCompletion = &pRing->pCQEs[cqHead & pRing->cqMask];
+
+                // Errors, including IORING_OP_READ not being supported by older kernels, are left to pread().
+                if (pCompletion->res > 0) {
+                    pReads[pCompletion->user_data].bytesRead = (size_t)pCompletion->res;
+                }
+
+                cqHead += 1;
+                completeCount += 1;
+            }
+
+            __atomic_store_n(pRing->pCQHead, cqHead, __ATOMIC_RELEASE);
         }
     }
 
-    return TA_TRUE;
+    taMutexUnlock(&pRing->lock);
 }
+#endif
 
-taBool32 taHPIDecompressZlib(const void* pIn, taUInt32 compressedSize, void* pOut, taUInt32 uncompressedSize)
+TA_PRIVATE taFSRing* taFSCreateRing()
 {
-    mz_ulong outSize = (mz_ulong)uncompressedSize;
-    return mz_uncompress(pOut, &outSize, pIn, compressedSize) == MZ_OK;
-}
+#ifdef TA_SUPPORT_IO_URING
+    struct io_uring_params params;
+    taZeroObject(&params);
 
-void taHPIDecrypt(taUInt8* pData, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos)
-{
-    assert(pData != NULL);
+    int fd = (int)syscall(__NR_io_uring_setup, TA_FS_RING_ENTRY_COUNT, &params);
+    if (fd < 0) {
+        return NULL;    // <-- Not supported by the kernel, or disabled.
+    }
 
-    if (decryptionKey != 0) {
-        for (size_t i = 0; i < sizeInBytes; ++i) {
-            pData[i] = (taUInt8)((firstBytePos + i) ^ decryptionKey) ^ ~pData[i];
+    taFSRing* pRing = (taFSRing*)calloc(1, sizeof(*pRing));
+    if (pRing == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    pRing->fd = fd;
+    pRing->sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(unsigned int));
+    pRing->cqRingSize = params.cq_off.cqes  + (params.cq_entries * sizeof(struct io_uring_cqe));
+    pRing->sqesSize   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Newer kernels map both queues with a single mapping.
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (pRing->cqRingSize > pRing->sqRingSize) {
+            pRing->sqRingSize = pRing->cqRingSize;
         }
+        pRing->cqRingSize = pRing->sqRingSize;
+    }
+
+    pRing->pSQRing = mmap(NULL, pRing->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (pRing->pSQRing == MAP_FAILED) {
+        goto on_error0;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        pRing->pCQRing = pRing->pSQRing;
     } else {
-        for (size_t i = 0; i < sizeInBytes; ++i) {
-            pData[i] = pData[i];
+        pRing->pCQRing = mmap(NULL, pRing->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (pRing->pCQRing == MAP_FAILED) {
+            goto on_error1;
         }
     }
-}
 
-size_t taHPIReadAndDecrypt(FILE* pFile, void* pBufferOut, size_t bytesToRead, taUInt32 decryptionKey)
-{
-    if (pFile == NULL) {
-        return 0;
+    pRing->pSQEs = (struct io_uring_sqe*)mmap(NULL, pRing->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (pRing->pSQEs == MAP_FAILED) {
+        goto on_error2;
     }
 
-    taUInt32 firstBytePos = (taUInt32)taFTell(pFile);
+    if (!taMutexInit(&pRing->lock)) {
+        goto on_error3;
+    }
 
-    size_t bytesRead = fread(pBufferOut, 1, bytesToRead, pFile);
-    if (decryptionKey != 0) {
-        taHPIDecrypt(pBufferOut, bytesRead, decryptionKey, firstBytePos);
+    pRing->pSQHead      = (volatile unsigned int*)((taUInt8*)pRing->pSQRing + params.sq_off.head);
+    pRing->pSQTail      = (volatile unsigned int*)((taUInt8*)pRing->pSQRing + params.sq_off.tail);
+    pRing->sqMask       = *(unsigned int*)((taUInt8*)pRing->pSQRing + params.sq_off.ring_mask);
+    pRing->sqEntryCount = params.sq_entries;
+    pRing->pSQArray     = (unsigned int*)((taUInt8*)pRing->pSQRing + params.sq_off.array);
+    pRing->pCQHead      = (volatile unsigned int*)((taUInt8*)pRing->pCQRing + params.cq_off.head);
+    pRing->pCQTail      = (volatile unsigned int*)((taUInt8*)pRing->pCQRing + params.cq_off.tail);
+    pRing->cqMask       = *(unsigned int*)((taUInt8*)pRing->pCQRing + params.cq_off.ring_mask);
+    pRing->pCQEs        = (struct io_uring_cqe*)((taUInt8*)pRing->pCQRing + params.cq_off.cqes);
+
+    return pRing;
+
+on_error3:
+    munmap(pRing->pSQEs, pRing->sqesSize);
+on_error2:
+    if (pRing->pCQRing != pRing->pSQRing) {
+        munmap(pRing->pCQRing, pRing->cqRingSize);
+    }
+on_error1:
+    munmap(pRing->pSQRing, pRing->sqRingSize);
+on_error0:
+    close(fd);
+    free(pRing);
+    return NULL;
+#else
+    return NULL;
+#endif
+}
+
+TA_PRIVATE void taFSDeleteRing(taFSRing* pRing)
+{
+    if (pRing == NULL) {
+        return;
     }
 
-    return bytesRead;
+#ifdef TA_SUPPORT_IO_URING
+    taMutexUninit(&pRing->lock);
+    munmap(pRing->pSQEs, pRing->sqesSize);
+    if (pRing->pCQRing != pRing->pSQRing) {
+        munmap(pRing->pCQRing, pRing->cqRingSize);
+    }
+    munmap(pRing->pSQRing, pRing->sqRingSize);
+    close(pRing->fd);
+    free(pRing);
+#endif
 }
 
-size_t taHPIReadAndDecryptCompressed(FILE* pFile, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey)
+#ifndef _WIN32
+TA_PRIVATE void taFSReadRanges(taFS* pFS, taFSRangeRead* pReads, taUInt32 readCount)
 {
-    if (pFile == NULL) {
-        return 0;
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        pReads[iRead].bytesRead = 0;
     }
 
-    size_t chunkCount = uncompressedBytesToRead / 65536;
-    if ((uncompressedBytesToRead % 65536) > 0) {
-        chunkCount += 1;
+#ifdef TA_SUPPORT_IO_URING
+    // A single read gains nothing from the ring, and would only hold up other threads waiting on the ring's lock.
+    if (pFS->pRing != NULL && readCount > 1) {
+        taFSReadRangesWithRing(pFS->pRing, pReads, readCount);
     }
+#else
+    (void)pFS;
+#endif
 
-    taBool32 result = TA_FALSE;
-    size_t* pChunkSizes = malloc(chunkCount * sizeof(*pChunkSizes));
+    // Anything that hasn't been read in full is finished off with pread(). Without io_uring this is everything.
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        taFSRangeRead* pRead = &pReads[iRead];
+        while (pRead->bytesRead < pRead->sizeInBytes) {
+            ssize_t bytesRead = pread(pRead->fd, (taUInt8*)pRead->pBufferOut + pRead->bytesRead, pRead->sizeInBytes - pRead->bytesRead, (off_t)(pRead->offset + pRead->bytesRead));
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
 
-    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
-        if (taHPIReadAndDecrypt(pFile, &pChunkSizes[iChunk], 4, decryptionKey) != 4) {
-            result = TA_FALSE;
-            goto finished;
+            if (bytesRead <= 0) {
+                break;
+            }
+
+            pRead->bytesRead += (size_t)bytesRead;
         }
     }
+}
 
+// Reads the data of each of the given files. Reads from the same archive should be next to each other so that the archive only needs
+// to be opened once. On output, pRawData will be set for each file that was read successfully. The data of every file is stored in a
+// single allocation which is returned, and needs to be freed with free() once the files have been decoded.
+TA_PRIVATE taUInt8* taFSReadRawFileData(taFS* pFS, taFSRawRead* pReads, taUInt32 readCount)
+{
+    assert(pFS != NULL);
+    assert(pReads != NULL);
 
-    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
-        taUInt32 marker = 0;
-        if (taHPIReadAndDecrypt(pFile, &marker, 4, decryptionKey) != 4 || marker != 'HSQS') {
-            result = TA_FALSE;
-            goto finished;
-        }
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        pReads[iRead].pRawData = NULL;
+        pReads[iRead].rawDataSize = 0;
+    }
 
-        taUInt8 unused;
-        if (taHPIReadAndDecrypt(pFile, &unused, 1, decryptionKey) != 1) {
-            result = TA_FALSE;
-            goto finished;
+    taFSRangeRead singleRange;  // <-- Most of the time only a single file is being read, in which case we can avoid an allocation.
+    taFSRangeRead* pRanges = &singleRange;
+    if (readCount > 1) {
+        pRanges = (taFSRangeRead*)malloc(readCount * sizeof(*pRanges));
+        if (pRanges == NULL) {
+            return NULL;
         }
+    }
 
-        taUInt8 compressionType;
-        if (taHPIReadAndDecrypt(pFile, &compressionType, 1, decryptionKey) != 1) {
-            result = TA_FALSE;
-            goto finished;
-        }
+    taUInt8* pChunkSizes = NULL;
+    taUInt8* pData = NULL;
+
+    // Open each archive, and work out where the chunk sizes of each compressed file will go.
+    taFSArchive* pOpenArchive = NULL;
+    int openFD = -1;
+    size_t chunkSizesSize = 0;
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        taFSRawRead* pRead = &pReads[iRead];
+        if (pRead->pArchive != pOpenArchive) {
+            char archiveAbsolutePath[TA_MAX_PATH];
+            if (taPathAppend(archiveAbsolutePath, sizeof(archiveAbsolutePath), pFS->rootDir, pRead->pArchive->relativePath)) {
+                openFD = open(archiveAbsolutePath, O_RDONLY);
+            } else {
+                openFD = -1;
+            }
 
-        taUInt8 encrypted;
-        if (taHPIReadAndDecrypt(pFile, &encrypted, 1, decryptionKey) != 1) {
-            result = TA_FALSE;
-            goto finished;
+            pOpenArchive = pRead->pArchive;
         }
 
-        taUInt32 compressedSize;
-        if (taHPIReadAndDecrypt(pFile, &compressedSize, 4, decryptionKey) != 4) {
-            result = TA_FALSE;
-            goto finished;
+        pRanges[iRead].fd = openFD;
+        pRanges[iRead].offset = pRead->dataOffset;
+        pRanges[iRead].sizeInBytes = 0;
+        pRanges[iRead].bytesRead = 0;
+        pRanges[iRead].pBufferOut = (void*)chunkSizesSize;   // <-- Converted to a pointer once the buffer has been allocated.
+
+        if (openFD != -1 && pRead->compressionType != 0) {
+            pRanges[iRead].sizeInBytes = taHPICalculateChunkCount(pRead->dataSize) * 4;
+            chunkSizesSize += pRanges[iRead].sizeInBytes;
         }
+    }
 
-        taUInt32 uncompressedSize;
-        if (taHPIReadAndDecrypt(pFile, &uncompressedSize, 4, decryptionKey) != 4) {
-            result = TA_FALSE;
-            goto finished;
+    // The first round of reads is for the chunk sizes of compressed files, which is what tells us how much data there is to read.
+    if (chunkSizesSize > 0) {
+        pChunkSizes = (taUInt8*)malloc(chunkSizesSize);
+        if (pChunkSizes == NULL) {
+            goto done;
         }
 
-        taUInt32 checksum;
-        if (taHPIReadAndDecrypt(pFile, &checksum, 4, decryptionKey) != 4) {
-            result = TA_FALSE;
-            goto finished;
+        for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+            pRanges[iRead].pBufferOut = pChunkSizes + (size_t)pRanges[iRead].pBufferOut;
         }
 
+        taFSReadRanges(pFS, pRanges, readCount);
+    }
 
-        unsigned char* pCompressedData = malloc(compressedSize);
-        if (taHPIReadAndDecrypt(pFile, pCompressedData, compressedSize, decryptionKey) != compressedSize) {
-            free(pCompressedData);
-            result = TA_FALSE;
-            goto finished;
+    // Now the size of every file is known. A compressed file runs from the start of its chunk sizes to the end of its last chunk. The
+    // chunk sizes are sanity checked to keep a corrupt archive from causing a huge allocation.
+    size_t dataSize = 0;
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        taFSRawRead* pRead = &pReads[iRead];
+        if (pRanges[iRead].fd == -1) {
+            continue;
         }
 
-        
-        // We do the decryption and checksum in one loop iteration.
-        taUInt32 checksum2 = 0;
-        if (encrypted) {
-            for (taUInt32 i = 0; i < compressedSize; ++i) {
-                checksum2 += pCompressedData[i];
-                pCompressedData[i] = (unsigned char)((pCompressedData[i] - i) ^ i);
-            }
+        if (pRead->compressionType == 0) {
+            pRead->rawDataSize = pRead->dataSize;
         } else {
-            for (taUInt32 i = 0; i < compressedSize; ++i) {
-                checksum2 += pCompressedData[i];
+            if (pRanges[iRead].bytesRead != pRanges[iRead].sizeInBytes) {
+                continue;
             }
-        }
 
-        if (checksum != checksum2) {
-            free(pCompressedData);
-            result = TA_FALSE;
-            goto finished;
-        }
+            taUInt8* pFileChunkSizes = (taUInt8*)pRanges[iRead].pBufferOut;
+            taHPIDecrypt(pFileChunkSizes, pRanges[iRead].sizeInBytes, pRead->pArchive->decryptionKey, pRead->dataOffset);
 
+            size_t chunksSize = 0;
+            for (size_t iChunk = 0; iChunk < pRanges[iRead].sizeInBytes / 4; ++iChunk) {
+                taUInt32 chunkSize;
+                memcpy(&chunkSize, pFileChunkSizes + (iChunk * 4), 4);
 
-        // The actual decompression.
-        switch (compressionType)
-        {
-            case 1: // LZ77
-            {
-                if (!taHPIDecompressLZ77(pCompressedData, compressedSize, (unsigned char*)pBufferOut + (iChunk * 65536), uncompressedSize)) {
-                    free(pCompressedData);
-                    result = TA_FALSE;
-                    goto finished;
-                }
-            } break;
-
-            case 2: // Zlib
-            {
-                if (!taHPIDecompressZlib(pCompressedData, compressedSize, (unsigned char*)pBufferOut + (iChunk * 65536), uncompressedSize)) {
-                    free(pCompressedData);
-                    result = TA_FALSE;
-                    goto finished;
+                if (chunkSize < TA_HPI_CHUNK_HEADER_SIZE || chunkSize > TA_HPI_CHUNK_HEADER_SIZE + (TA_HPI_CHUNK_SIZE*2)) {
+                    chunksSize = 0;
+                    break;
                 }
-            } break;
+
+                chunksSize += chunkSize;
+            }
+
+            if (chunksSize == 0) {
+                continue;
+            }
+
+            pRead->rawDataSize = pRanges[iRead].sizeInBytes + chunksSize;
         }
 
+        dataSize += pRead->rawDataSize;
+    }
 
-        free(pCompressedData);
+    // The allocation is never 0 bytes so that empty files still count as being read.
+    pData = (taUInt8*)malloc(dataSize + 1);
+    if (pData == NULL) {
+        goto done;
     }
 
-    result = TA_TRUE;
+    // The second round of reads is for the data of every file. The chunk sizes have already been read so they're just copied over.
+    size_t dataOffset = 0;
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        taFSRawRead* pRead = &pReads[iRead];
+        size_t chunkSizesSizeInBytes = (pRead->compressionType != 0) ? pRanges[iRead].sizeInBytes : 0;
 
+        if (pRead->rawDataSize == 0 && (pRead->compressionType != 0 || pRanges[iRead].fd == -1)) {
+            pRanges[iRead].sizeInBytes = 0;
+            continue;
+        }
+
+        pRead->pRawData = pData + dataOffset;
+        dataOffset += pRead->rawDataSize;
+
+        if (chunkSizesSizeInBytes > 0) {
+            memcpy(pRead->pRawData, pRanges[iRead].pBufferOut, chunkSizesSizeInBytes);
+        }
+
+        pRanges[iRead].offset = (taUInt64)pRead->dataOffset + chunkSizesSizeInBytes;
+        pRanges[iRead].sizeInBytes = pRead->rawDataSize - chunkSizesSizeInBytes;
+        pRanges[iRead].pBufferOut = pRead->pRawData + chunkSizesSizeInBytes;
+    }
+
+    taFSReadRanges(pFS, pRanges, readCount);
+
+    for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+        taFSRawRead* pRead = &pReads[iRead];
+        if (pRead->pRawData == NULL) {
+            continue;
+        }
+
+        if (pRanges[iRead].bytesRead != pRanges[iRead].sizeInBytes) {
+            pRead->pRawData = NULL;
+            continue;
+        }
+
+        size_t chunksOffset = pRead->rawDataSize - pRanges[iRead].sizeInBytes;
+        taHPIDecrypt(pRead->pRawData + chunksOffset, pRanges[iRead].sizeInBytes, pRead->pArchive->decryptionKey, (taUInt32)(pRead->dataOffset + chunksOffset));
+    }
+
+done:
+    // Each archive was only opened once, when it was first seen.
+    {
+        int closedFD = -1;
+        for (taUInt32 iRead = 0; iRead < readCount; ++iRead) {
+            if (pRanges[iRead].fd != -1 && pRanges[iRead].fd != closedFD) {
+                closedFD = pRanges[iRead].fd;
+                close(closedFD);
+            }
+        }
+    }
 
-finished:
     free(pChunkSizes);
-    return result;
+    if (pRanges != &singleRange) {
+        free(pRanges);
+    }
+
+    return pData;
+}
+
+// Decrypts and decompresses a file read with taFSReadRawFileData(). The outer encryption has already been removed at this point, so
+// it's counted as part of the read. pCounters can be null.
+TA_PRIVATE taBool32 taFSDecodeRawFileData(taFS* pFS, const taFSRawRead* pRead, void* pDataOut, taFSIOCounters* pCounters)
+{
+    assert(pRead->pRawData != NULL);
+
+    if (pRead->compressionType == 0) {
+        if (pRead->rawDataSize != pRead->dataSize) {
+            return TA_FALSE;
+        }
+
+        memcpy(pDataOut, pRead->pRawData, pRead->dataSize);
+        return TA_TRUE;
+    }
+
+    return taHPIDecodeCompressedFromMemory(pRead->pRawData, pRead->rawDataSize, 0, pDataOut, pRead->dataSize, 0, &pFS->threadPool, pCounters);
 }
+#endif
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1,9 +1,14 @@
 // Copyright (C) 2018 David Reid. See included LICENSE file.
 
 #define TA_OPEN_FILE_WITH_NULL_TERMINATOR    0x0001      // Opens a file with a null terminator at the end.
+#define TA_OPEN_FILE_STREAMED                0x0002      // Opens a file in streaming mode. See taFile::pFileData.
+#define TA_OPEN_FILE_READ_ONLY               0x0004      // The file data will not be modified. Allows the file to be shared through the file cache.
 
 typedef struct taFS taFS;
 typedef struct taFile taFile;
+typedef struct taStreamedFile taStreamedFile;
+typedef struct taFSCacheEntry taFSCacheEntry;
+typedef struct taFSRing taFSRing;
 
 enum taSeekOrigin
 {
@@ -12,6 +17,32 @@ enum taSeekOrigin
     taSeekOriginEnd,
 };
 
+#define TA_FS_INDEX_NONE    0xFFFFFFFF
+
+// A read-only memory mapping of a file on the real file system.
+typedef struct
+{
+    // A pointer to the start of the mapped file data.
+    const taUInt8* pData;
+
+    // The size of the mapped file.
+    size_t sizeInBytes;
+
+    // The time the file was last modified, as reported by the OS. This is only used for checking whether or not a file has changed.
+    taUInt64 modifiedTime;
+
+#ifdef _WIN32
+    HANDLE hFile;
+    HANDLE hMapping;
+#endif
+} taMappedFile;
+
+// Maps a file on the real file system into memory for reading. Returns false if the file does not exist or is empty.
+taBool32 taMapFile(const char* filePath, taMappedFile* pMappedFile);
+
+// Unmaps a file that was mapped with taMapFile().
+void taUnmapFile(taMappedFile* pMappedFile);
+
 typedef struct
 {
     // The relative path of the archive on the real file system. This is relative to the executable.
@@ -29,8 +60,314 @@ typedef struct
     // keeping this in memory we can avoid unnecessarilly opening and decrypting the archive for whenever we need to
     // check for a single file.
     char* pCentralDirectory;
+
+    // The archive file mapped into memory. This is kept mapped for the lifetime of the file system which means opening a file
+    // from the archive does not need to touch the real file system at all. File data is decrypted and decompressed directly
+    // from the mapping. If the archive could not be mapped, mappedFile.pData will be null and the archive will instead be
+    // read from the real file system on each open.
+    taMappedFile mappedFile;
+
+    // The index of the matching source archive in the file system's pack, or TA_FS_INDEX_NONE if the pack does not contain any
+    // files from this archive, or the archive has changed since the pack was written.
+    taUInt32 packSourceIndex;
 } taFSArchive;
 
+typedef struct
+{
+    // The case-insensitive hash of the file's relative path.
+    taUInt32 hash;
+
+    // The offset of the file's relative path within the index's path buffer.
+    taUInt32 pathOffset;
+
+    // The index of the archive that contains the file.
+    taUInt32 archiveIndex;
+
+    // The position of the file's entry data within the archive's central directory. This is where dataOffset, dataSize and
+    // compressionType are read from.
+    taUInt32 entryDataPos;
+
+    // The position of the file's data within the archive file.
+    taUInt32 dataOffset;
+
+    // The uncompressed size of the file.
+    taUInt32 dataSize;
+
+    // The compression type: 0 = uncompressed, 1 = LZ77, 2 = Zlib.
+    taUInt32 compressionType;
+
+    // The index of the next entry with the same path, but in a lower priority archive. Set to TA_FS_INDEX_NONE if this is
+    // the lowest priority instance of the file. This is what allows taOpenSpecificFile() to use the index.
+    taUInt32 nextEntryIndex;
+
+    // The index of the file within the file system's pack, or TA_FS_INDEX_NONE if the file is not in the pack.
+    taUInt32 packFileIndex;
+} taFSIndexEntry;
+
+// A hash index mapping relative paths to files across every registered archive. This is built once by taCreateFileSystem()
+// after every archive has been registered and allows a file to be found with a single hash probe rather than walking the
+// central directory of each archive in turn.
+typedef struct
+{
+    // The number of slots in the hash table. This is always a power of 2.
+    taUInt32 slotCount;
+
+    // The hash table. Each slot contains the index of the highest priority entry for a given path, or TA_FS_INDEX_NONE if
+    // the slot is empty. Collisions are resolved with linear probing.
+    taUInt32* pSlots;
+
+    // The list of every file in every archive.
+    taUInt32 entryCount;
+    taUInt32 entryCapacity;
+    taFSIndexEntry* pEntries;
+
+    // The buffer containing the null terminated relative path of each entry.
+    taUInt32 pathsSize;
+    taUInt32 pathsCapacity;
+    char* pPaths;
+} taFSIndex;
+
+// The name of the pack file that is mounted by taCreateFileSystem(). This sits in the same directory as the archives.
+#define TA_FS_PACK_FILE_NAME        "openta.pack"
+
+// A pack of files that were decrypted and decompressed ahead of time by taFSWritePack(). The pack is a flat, memory mapped file which
+// means opening a file from it is little more than a page fault. The pack records the size and modification time of each archive
+// the files were taken from, and only files from archives that are unchanged will be used.
+typedef struct
+{
+    // The pack file mapped into memory. This will be null if there is no pack.
+    taMappedFile mappedFile;
+
+    // The number of source archives and files in the pack.
+    taUInt32 sourceCount;
+    taUInt32 fileCount;
+} taFSPack;
+
+#define TA_FS_CACHE_BUCKET_COUNT    256
+#define TA_FS_DEFAULT_CACHE_SIZE    (64*1024*1024)
+
+// Statistics for the file cache. Use these for tuning the cache size.
+typedef struct
+{
+    // The number of times a file was found in the cache.
+    taUInt64 hitCount;
+
+    // The number of times a file was not in the cache and needed to be decompressed.
+    taUInt64 missCount;
+
+    // The number of files that were removed from the cache to make room for other files.
+    taUInt64 evictionCount;
+
+    // The number of files currently in the cache, including those that are currently open.
+    taUInt32 entryCount;
+
+    // The combined size of every file currently in the cache. This can be larger than the budget if files that are currently open
+    // exceed it.
+    size_t sizeInBytes;
+
+    // The maximum number of bytes the cache should hold onto.
+    size_t budgetInBytes;
+} taFSCacheStats;
+
+// A cache of decompressed files from the archives. Files opened with TA_OPEN_FILE_READ_ONLY are kept here so that opening the same
+// file again can skip decryption and decompression and share the same copy of the data. Files that are not currently open are
+// evicted in least recently used order once the cache exceeds its budget.
+typedef struct
+{
+    // The lock for synchronizing access to the cache. Files can be opened and closed from multiple threads.
+    taMutex lock;
+
+    // The hash table. Each bucket is a linked list of entries, keyed by the archive and the position of the file's data.
+    taFSCacheEntry* pBuckets[TA_FS_CACHE_BUCKET_COUNT];
+
+    // The list of every entry in order of use. The head is the most recently used.
+    taFSCacheEntry* pFirst;
+    taFSCacheEntry* pLast;
+
+    // The hit, miss and eviction counters, and the budget. entryCount and sizeInBytes are kept up to date at all times.
+    taFSCacheStats stats;
+} taFSCache;
+
+#define TA_FS_DEFAULT_IO_THREAD_COUNT   2
+
+// Priorities for asynchronous file requests. Any value can be used - pending requests with a higher priority are always started first,
+// and requests of the same priority are started in the order they were made.
+#define TA_FILE_REQUEST_PRIORITY_LOW        -100
+#define TA_FILE_REQUEST_PRIORITY_NORMAL     0
+#define TA_FILE_REQUEST_PRIORITY_HIGH       100
+
+typedef struct taFileRequest taFileRequest;
+
+// Called from an I/O thread when an asynchronous open has finished. pFile will be null if the file could not be opened. The file is
+// still owned by the request at this point and must not be closed from inside the callback.
+typedef void (* taFileRequestProc)(taFileRequest* pRequest, taFile* pFile, void* pUserData);
+
+// The queue of asynchronous file requests, and the I/O threads servicing it.
+typedef struct
+{
+    // The lock for synchronizing access to the queue and the state of each request.
+    taMutex lock;
+
+    // Released once for each request added to the queue.
+    taSemaphore workSemaphore;
+
+    // The I/O threads. Use taFSSetIOThreadCount() to configure this.
+    taUInt32 threadCount;
+    taThread* pThreads;
+
+    // The requests that have not yet been started, in order of priority. The head is the next request to be started.
+    taFileRequest* pFirst;
+    taFileRequest* pLast;
+    taUInt32 pendingCount;
+
+    // Set when the I/O threads need to exit.
+    taBool32 isTerminating;
+} taFSIOQueue;
+
+#define TA_FS_LISTING_BUCKET_COUNT  64
+
+typedef struct taFSListing taFSListing;
+
+// The directory listings that have already been gathered by taFSBegin(). The archives do not change while the file system is
+// alive, so a listing only needs to be gathered once. Note that this means files added to the real file system afterwards will
+// not show up in iteration.
+typedef struct
+{
+    // The lock for synchronizing access to the listings. Iteration can be done from multiple threads.
+    taMutex lock;
+
+    // The hash table, keyed by the directory path and whether or not it was gathered recursively.
+    taFSListing* pBuckets[TA_FS_LISTING_BUCKET_COUNT];
+} taFSListingCache;
+
+// The directory within the root directory where taLoadMap() keeps the access manifest of each map.
+#define TA_FS_MANIFEST_DIRECTORY    "manifests"
+
+typedef struct
+{
+    // The index of the file within the path index.
+    taUInt32 entryIndex;
+
+    // The options the file was first opened with.
+    unsigned int options;
+} taFSRecordedAccess;
+
+// The files read from the archives and the pack between taFSBeginRecording() and taFSEndRecording(). Only the first read of each file
+// is recorded, so the list is in the order files are first needed.
+typedef struct
+{
+    // The lock for synchronizing access to the recording. Files can be opened from multiple threads.
+    taMutex lock;
+
+    // Whether or not a recording is in progress.
+    taBool32 isRecording;
+
+    // The recorded accesses, in order.
+    taUInt32 accessCount;
+    taUInt32 accessCapacity;
+    taFSRecordedAccess* pAccesses;
+
+    // One bit per entry in the path index, set when the entry has been recorded.
+    taUInt8* pRecordedBits;
+} taFSRecorder;
+
+typedef struct
+{
+    // The index of the file within the path index.
+    taUInt32 entryIndex;
+
+    // Whether or not the file should be decompressed into the file cache. Otherwise only the OS is asked to read it ahead of time.
+    taBool32 useCache;
+} taFSPrefetchItem;
+
+// The background thread replaying a manifest with taFSPrefetchManifest().
+typedef struct
+{
+    // The prefetch thread. Only valid while isRunning is set.
+    taThread thread;
+    taBool32 isRunning;
+
+    // Set to non-zero to tell the thread to stop early. This is only ever accessed atomically.
+    volatile taUInt32 isCancelled;
+
+    // The files to prefetch, in the order they were recorded.
+    taUInt32 itemCount;
+    taFSPrefetchItem* pItems;
+} taFSPrefetcher;
+
+// The defaults used by taFSRepackArchive() when no options are given.
+#define TA_FS_REPACK_DEFAULT_UNCOMPRESSED_SIZE_THRESHOLD    (64*1024)
+#define TA_FS_REPACK_DEFAULT_COMPRESSION_LEVEL              9
+
+typedef struct
+{
+    // Hot files at or below this size are stored uncompressed and unencrypted so they can be used straight from the mapping.
+    taUInt32 uncompressedSizeThreshold;
+
+    // The zlib compression level, between 1 and 9, for the files that are compressed.
+    int compressionLevel;
+
+    // The manifests, relative to the root directory, that list the hot files. Hot files are stored before everything else in the
+    // order they were recorded. Manifests that don't exist are ignored. When no manifests are given, every file is hot.
+    taUInt32 manifestCount;
+    const char** ppManifestPaths;
+} taFSRepackOptions;
+
+// The signature of a file's contents. See taFSGetFileSignature().
+typedef struct
+{
+    // The uncompressed size of the file.
+    taUInt64 sizeInBytes;
+
+    // The hash of the file's data as it's stored in the archive. This changes whenever the contents change, but is much quicker to
+    // calculate than decoding the file.
+    taUInt32 hash;
+} taFSFileSignature;
+
+// The directory within the root directory where taLoadMap() writes the I/O statistics of each map.
+#define TA_FS_IO_STATS_DIRECTORY    "iostats"
+
+// The I/O statistics of a file, or of every file in an archive. Only files opened from the archives and the pack are counted, and
+// files in the pack are counted against the archive they were taken from.
+typedef struct
+{
+    // The number of times the file was opened, and how many of those were served by the file cache.
+    taUInt32 openCount;
+    taUInt32 cacheHitCount;
+
+    // The number of bytes read from the archive or the pack, and the number of bytes they decoded to.
+    taUInt64 storedBytes;
+    taUInt64 uncompressedBytes;
+
+    // The time spent reading, removing encryption and decompressing, in nanoseconds. Reading includes faulting in the pages of mapped
+    // archives. The chunks of large files are decoded in parallel, so these are the sum over every thread rather than wall time.
+    taUInt64 readTime;
+    taUInt64 decryptTime;
+    taUInt64 decompressTime;
+} taFSIOStats;
+
+typedef enum
+{
+    taFSIOStatsFormatCSV,
+    taFSIOStatsFormatJSON
+} taFSIOStatsFormat;
+
+// The I/O statistics gathered between taFSBeginIOStats() and taFSEndIOStats().
+typedef struct
+{
+    // The lock for synchronizing access to the statistics. Files can be opened from multiple threads.
+    taMutex lock;
+
+    // Whether or not statistics are being gathered.
+    taBool32 isEnabled;
+
+    // The statistics of each entry in the path index.
+    taFSIOStats* pFileStats;
+
+    // The statistics of each archive in the search list.
+    taFSIOStats* pArchiveStats;
+} taFSIOStatsRecorder;
+
 struct taFS
 {
     // The absolute path of the root directory on the real file system. This is where the executable is stored.
@@ -53,6 +390,40 @@ struct taFS
     //
     // Note that totala3.hpi and worlds.hpi are completely ignored.
     taFSArchive* pArchives;
+
+    // The hashed path index covering the files in every archive in pArchives. If this failed to build, lookups will fall
+    // back to searching the central directory of each archive.
+    taFSIndex index;
+
+    // The thread pool used for decompressing the chunks of large compressed files in parallel, and for other loading work that can be
+    // split into jobs, such as parsing the features library. Use taFSSetThreadCount() to configure this.
+    taThreadPool threadPool;
+
+    // The cache of decompressed files. Use taFSSetCacheSize() to configure this.
+    taFSCache cache;
+
+    // The pack of pre-decompressed files. Files in the pack take priority over the same files in the archives, but not over files
+    // sitting on the real file system.
+    taFSPack pack;
+
+    // The queue of files being opened asynchronously with taOpenFileAsync().
+    taFSIOQueue ioQueue;
+
+    // The cached directory listings for iteration.
+    taFSListingCache listings;
+
+    // The recording of accessed files for writing a manifest.
+    taFSRecorder recorder;
+
+    // The thread prefetching the files listed in a manifest.
+    taFSPrefetcher prefetcher;
+
+    // The I/O statistics of each file and archive.
+    taFSIOStatsRecorder ioStats;
+
+    // The io_uring instance used for reading from archives that could not be memory mapped. This is null if io_uring is not available,
+    // in which case pread() is used instead.
+    taFSRing* pRing;
 };
 
 struct taFile
@@ -70,8 +441,21 @@ struct taFile
     // The raw uncompressed and unencrypted file data. The rationale for keeping this on the heap is that it greatly
     // simplifies the file system abstraction.
     //
-    // The data is intentionally mutable so things can modify the data in-place if necessary.
-    char pFileData[1];
+    // The data is intentionally mutable so things can modify the data in-place if necessary. The exception to this is files opened
+    // with TA_OPEN_FILE_READ_ONLY, which may be shared with other open instances of the same file.
+    //
+    // This will be null if the file was opened with TA_OPEN_FILE_STREAMED, in which case the file can only be accessed
+    // with taReadFile() and friends. Streamed files decompress only the chunks that are actually read, and only keep a
+    // few of them in memory at a time. Uncompressed files are streamed straight out of the mapped archive, whatever their
+    // size. This is only a request - if the file is compressed but small, or not in a memory mapped archive, or it was
+    // also opened with TA_OPEN_FILE_WITH_NULL_TERMINATOR, it will be loaded in full like normal and pFileData will be valid.
+    char* pFileData;
+
+    // Internal use only. The state of a file opened with TA_OPEN_FILE_STREAMED. This is null for normal files.
+    taStreamedFile* _pStreamed;
+
+    // Internal use only. The cache entry that owns pFileData for files that are shared through the file cache.
+    taFSCacheEntry* _pCacheEntry;
 };
 
 
@@ -81,6 +465,69 @@ taFS* taCreateFileSystem();
 // Deletes the given file system instance.
 void taDeleteFileSystem(taFS* pFS);
 
+// Sets the number of threads to use when decompressing a file or running other loading jobs on the file system's thread pool. This
+// includes the calling thread, so a value of 1 will disable multi-threading. A value of 0 will use one thread per CPU.
+//
+// The thread pool is recreated by this, and it's shared with the I/O threads and the prefetch thread which can open files at any
+// time. This must only be called while nothing is using the file system, such as straight after taCreateFileSystem() and before
+// any file is opened, requested with taOpenFileAsync() or prefetched with taFSPrefetchManifest().
+void taFSSetThreadCount(taFS* pFS, taUInt32 threadCount);
+
+// Sets the maximum number of bytes to keep in the cache of decompressed files. Files that are currently open are never evicted so
+// the cache may temporarily exceed this. A value of 0 disables the cache.
+void taFSSetCacheSize(taFS* pFS, size_t sizeInBytes);
+
+// Retrieves the file cache's hit, miss and eviction counters.
+void taFSGetCacheStats(taFS* pFS, taFSCacheStats* pStatsOut);
+
+// Writes a pack containing every file in the archives that matches any of the given patterns. A pattern is either the relative path
+// of a file, or a directory followed by "*.ext" which will match every file with that extension in the directory and it's sub-
+// directories. Every instance of a matching file is included, not just the highest priority one. Any pack currently mounted by the
+// file system is unmounted first. The pack will be mounted the next time the file system is created if it's written to the root
+// directory with the name TA_FS_PACK_FILE_NAME.
+taResult taFSWritePack(taFS* pFS, const char* filePath, const char** ppPatterns, taUInt32 patternCount);
+
+// Starts recording the files that are read from the archives and the pack. Files on the real file system are not recorded. Any
+// recording that's already in progress is restarted.
+taResult taFSBeginRecording(taFS* pFS);
+
+// Stops recording and writes the recorded files to a manifest at the given path, relative to the root directory. The manifest's
+// directory is created if it does not already exist. If manifestRelativePath is null the recording is just discarded.
+taResult taFSEndRecording(taFS* pFS, const char* manifestRelativePath);
+
+// Starts reading the files listed in a manifest on a background thread, in the order they were recorded. Files that were opened with
+// TA_OPEN_FILE_READ_ONLY are decompressed into the file cache, up to half of its budget, and everything else is only read ahead into
+// the OS' page cache. While a recording is in progress, files that have already been recorded are skipped since they're no longer
+// needed ahead of time. Any prefetch already in progress is cancelled. Returns TA_FILE_NOT_FOUND if the manifest does not exist.
+taResult taFSPrefetchManifest(taFS* pFS, const char* manifestRelativePath);
+
+// Cancels the prefetch in progress, if any, and waits for the background thread to stop.
+void taFSCancelPrefetch(taFS* pFS);
+
+// Rewrites an archive so that it's faster to load, and writes it to the given path. The new archive is not encrypted, hot files that
+// are small enough are stored uncompressed, and everything else is recompressed with zlib at the given level unless it doesn't get
+// any smaller. The file data is laid out with the hot files first, followed by the rest of the files a directory at a time in the
+// same order as the central directory. The archive must not be written over the original while the file system is using it. pOptions
+// can be null in which case defaults are used.
+taResult taFSRepackArchive(taFS* pFS, const char* archiveRelativePath, const char* filePath, const taFSRepackOptions* pOptions);
+
+// Starts gathering I/O statistics for each file opened from the archives and the pack. Any statistics that have already been gathered
+// are discarded. Returns TA_ERROR if the path index could not be built. Gathering statistics slows down opening files slightly since
+// the pages of mapped archives need to be faulted in ahead of time.
+taResult taFSBeginIOStats(taFS* pFS);
+
+// Stops gathering I/O statistics. The statistics gathered so far are kept until the next call to taFSBeginIOStats().
+void taFSEndIOStats(taFS* pFS);
+
+// Retrieves the I/O statistics of every file in the given archive combined. If archiveRelativePath is null this is the statistics of
+// every archive combined.
+taResult taFSGetIOStats(taFS* pFS, const char* archiveRelativePath, taFSIOStats* pStatsOut);
+
+// Writes the gathered I/O statistics to the given path, relative to the root directory, as CSV or JSON. Every file that was opened is
+// listed with the archive it was opened from, slowest first, followed by the totals of each archive. Times are in milliseconds. The
+// file's directory is created if it does not already exist.
+taResult taFSWriteIOStats(taFS* pFS, const char* relativePath, taFSIOStatsFormat format);
+
 
 // Opens the file at the given path from the specified archive file.
 taFile* taOpenSpecificFile(taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath, unsigned int options);
@@ -88,6 +535,40 @@ taFile* taOpenSpecificFile(taFS* pFS, const char* archiveRelativePath, const cha
 // Searches for the given file and opens the first occurance from the highest priority archive.
 taFile* taOpenFile(taFS* pFS, const char* relativePath, unsigned int options);
 
+// Retrieves the signature of a file for checking whether or not it has changed without having to decode it. If archiveRelativePath
+// is null the signature is of the file that taOpenFile() would open. This only works for files in archives that are memory mapped.
+// TA_ERROR is returned for files on the real file system, and for files in archives that could not be mapped, since they would need
+// to be read in full anyway.
+taResult taFSGetFileSignature(taFS* pFS, const char* archiveRelativePath, const char* relativePath, taFSFileSignature* pSignatureOut);
+
+// Opens a batch of files at once. This is the same as calling taOpenFile() for each path, except that files in the archives are read
+// in the order they're stored, and are decompressed in parallel on the file system's thread pool. ppFilesOut[i] will be set to the file
+// for ppRelativePaths[i], or null if it could not be opened. Returns the number of files that were opened. Each file needs to be closed
+// with taCloseFile() like normal.
+taUInt32 taOpenFiles(taFS* pFS, const char** ppRelativePaths, taUInt32 count, unsigned int options, taFile** ppFilesOut);
+
+// Sets the number of threads used for servicing asynchronous file requests. A value of 0 will use TA_FS_DEFAULT_IO_THREAD_COUNT. Pending
+// requests are kept, but this will wait for any request that's currently being loaded.
+void taFSSetIOThreadCount(taFS* pFS, taUInt32 threadCount);
+
+// Opens a file on an I/O thread. This returns immediately. The request can be polled with taIsFileRequestComplete(), and must always be
+// ended with either taFinishFileRequest() or taCancelFileRequest(), including when onComplete is used. onComplete can be null. Every
+// request must be ended before the file system is deleted.
+taFileRequest* taOpenFileAsync(taFS* pFS, const char* relativePath, unsigned int options, taInt32 priority, taFileRequestProc onComplete, void* pUserData);
+
+// Changes the priority of a request. This has no effect if the request has already been started.
+void taSetFileRequestPriority(taFileRequest* pRequest, taInt32 priority);
+
+// Determines whether or not the given request has finished. This does not block.
+taBool32 taIsFileRequestComplete(taFileRequest* pRequest);
+
+// Waits for the given request to finish, deletes it and returns the file. The file will be null if it could not be opened, and needs
+// to be closed with taCloseFile() like normal.
+taFile* taFinishFileRequest(taFileRequest* pRequest);
+
+// Cancels and deletes the given request. If the request has already been started this will wait for it to finish and then close the file.
+void taCancelFileRequest(taFileRequest* pRequest);
+
 // Closes the given file.
 void taCloseFile(taFile* pFile);
 
@@ -132,14 +613,16 @@ taBool32 taReadFileUInt8(taFile* pFile, taUInt8* pBufferOut);
 //
 //
 // Iteration must be terminated with taFSEnd() at all times, even when the iteration ends naturally. Iteration is not recursive.
+//
+// The strings in taFSFileInfo are owned by the file system and remain valid until taFSEnd() is called.
 
 typedef struct
 {
     // The relative path of the archive that owns this file, if any. This will be empty if the file is sitting on the real file system.
-    char archiveRelativePath[TA_MAX_PATH];
+    const char* archiveRelativePath;
 
     // The relative path of the file.
-    char relativePath[TA_MAX_PATH];
+    const char* relativePath;
 
     // Whether or not the file is a directory.
     taBool32 isDirectory;
@@ -156,7 +639,8 @@ typedef struct
     // Variables below are for internal use only.
     size_t _iFile;
     size_t _fileCount;
-    taFSFileInfo* _pFiles;
+    const taFSFileInfo* _pFiles;
+    taFSListing* _pListing;
 } taFSIterator;
 
 // Begins iterating the contents of the given folder.
@@ -173,6 +657,9 @@ taBool32 taFSNext(taFSIterator* pIter);
 //// HPI Helpers ////
 
 // LZ77 decompression for HPI archives.
+//
+// Returns TA_FALSE if the data is corrupt or does not decompress to exactly uncompressedSize bytes. This never reads or writes
+// outside of the input and output buffers.
 taBool32 taHPIDecompressLZ77(const unsigned char* pIn, taUInt32 compressedSize, unsigned char* pOut, taUInt32 uncompressedSize);
 
 // ZLib decompression for HPI archives.
@@ -181,12 +668,20 @@ taBool32 taHPIDecompressZlib(const void* pIn, taUInt32 compressedSize, void* pOu
 // Decrypts data from a HPI archive.
 void taHPIDecrypt(taUInt8* pData, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos);
 
+// Decrypts data from a HPI archive while copying it to another buffer. pSrc and pDst must not overlap.
+void taHPIDecryptCopy(taUInt8* pDst, const taUInt8* pSrc, size_t sizeInBytes, taUInt32 decryptionKey, taUInt32 firstBytePos);
+
 // Reads and decrypts data from a HPI archive file.
 size_t taHPIReadAndDecrypt(FILE* pFile, void* pBufferOut, size_t bytesToRead, taUInt32 decryptionKey);
 
 // Reads, decrypts and decompresses data from a HPI archive file.
 size_t taHPIReadAndDecryptCompressed(FILE* pFile, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey);
 
+// Decrypts and decompresses a file's data from a HPI archive that has been loaded or mapped into memory. pArchiveData is the
+// start of the archive and dataOffset is the position of the file's chunk table within the archive. If pThreadPool is not null,
+// the file's chunks will be decompressed in parallel.
+taBool32 taHPIDecryptCompressedFromMemory(const taUInt8* pArchiveData, size_t archiveSize, taUInt32 dataOffset, void* pBufferOut, size_t uncompressedBytesToRead, taUInt32 decryptionKey, taThreadPool* pThreadPool);
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -198,4 +693,8 @@ size_t taHPIReadAndDecryptCompressed(FILE* pFile, void* pBufferOut, size_t uncom
 taResult taGetExecutablePath(char* pathOut, size_t pathOutSize);
 
 // Retrieves the absolute path of the directory containing the executable.
-taResult taGetExecutableDirectoryPath(char* pathOut, size_t pathOutSize);
\ No newline at end of file
+taResult taGetExecutableDirectoryPath(char* pathOut, size_t pathOutSize);
+
+// Creates the directory a file is about to be written to. The directory may already exist. Only the last directory in the path is
+// created. If this fails for any other reason opening the file will fail as well.
+void taFSCreateFileDirectory(const char* filePath);
\ No newline at end of file
@@ -1,13 +1,7 @@
 // Copyright (C) 2018 David Reid. See included LICENSE file.
 
-#define TA_FEATURE_CHUNK_SIZE   1024
-
-#if 0
-TA_PRIVATE taUInt32 taFeaturesLibraryHashString(const char* str)
-{
-    return hashlittle(str, strlen(str), 0);
-}
-#endif
+// Strings were originally stored in fixed size buffers of this size. Strings that don't fit are handled the same way they were then.
+#define TA_FEATURE_MAX_STRING   64
 
 #if 0
 TA_PRIVATE taFeatureCategory taParseFeatureCategory(const char* featureStr)
@@ -114,34 +108,207 @@ TA_PRIVATE taFeatureCategory taParseFeatureCategory(const char* featureStr)
 }
 #endif
 
-TA_PRIVATE taBool32 taFeaturesLibraryLoadFeature(taFeaturesLibrary* pLib, const char* featureName, taConfigObj* pFeatureConfig)
+//// String Pool ////
+
+TA_PRIVATE taBool32 taFeaturesLibraryGrowStringSlots(taFeaturesLibrary* pLib)
 {
-    if (pLib == NULL || pFeatureConfig == NULL) {
+    taUInt32 newSlotCount = (pLib->stringSlotCount == 0) ? 256 : pLib->stringSlotCount*2;
+    taUInt32* pNewSlots = (taUInt32*)calloc(newSlotCount, sizeof(*pNewSlots));
+    if (pNewSlots == NULL) {
         return TA_FALSE;
     }
 
-    // Add the feature to the list.
-    if (pLib->featuresCount == pLib->featuresBufferSize) {
-        // Need to reallocate.
-        taUInt32 newBufferSize = pLib->featuresBufferSize + TA_FEATURE_CHUNK_SIZE;
-        taFeatureDesc* pNewFeatures = realloc(pLib->pFeatures, newBufferSize * sizeof(*pLib->pFeatures));
-        if (pNewFeatures == NULL) {
-            return TA_FALSE;   // Failed to allocate memory.
+    taUInt32 mask = newSlotCount - 1;
+    for (taUInt32 iOldSlot = 0; iOldSlot < pLib->stringSlotCount; ++iOldSlot) {
+        taUInt32 offset = pLib->pStringSlots[iOldSlot];
+        if (offset != 0) {
+            const char* str = pLib->pStrings + offset;
+            taUInt32 iSlot = taHashString(str) & mask;
+            while (pNewSlots[iSlot] != 0) {
+                iSlot = (iSlot + 1) & mask;
+            }
+
+            pNewSlots[iSlot] = offset;
+        }
+    }
+
+    free(pLib->pStringSlots);
+    pLib->pStringSlots = pNewSlots;
+    pLib->stringSlotCount = newSlotCount;
+
+    return TA_TRUE;
+}
+
+TA_PRIVATE const char* taFeaturesLibraryGetString(const taFeaturesLibrary* pLib, taUInt32 offset)
+{
+    return (pLib->pStrings != NULL) ? pLib->pStrings + offset : "";
+}
+
+// Adds the first <length> characters of a string to the string pool, unless it's already there. Returns the offset of the string,
+// or 0 (which is an empty string) if there isn't enough memory.
+TA_PRIVATE taUInt32 taFeaturesLibraryInternString(taFeaturesLibrary* pLib, const char* str, size_t length)
+{
+    assert(pLib != NULL);
+    assert(str != NULL);
+
+    if (length == 0) {
+        return 0;
+    }
+
+    // The pool always starts with the empty string.
+    if (pLib->stringsSize == 0) {
+        pLib->pStrings = (char*)malloc(4096);
+        if (pLib->pStrings == NULL) {
+            return 0;
+        }
+
+        pLib->pStrings[0] = '\0';
+        pLib->stringsSize = 1;
+        pLib->stringsCapacity = 4096;
+    }
+
+    // The table is kept at most half full.
+    if ((pLib->stringSlotsUsed+1)*2 > pLib->stringSlotCount) {
+        if (!taFeaturesLibraryGrowStringSlots(pLib)) {
+            return 0;
+        }
+    }
+
+    taUInt32 mask = pLib->stringSlotCount - 1;
+    taUInt32 iSlot = taHashStringN(str, length) & mask;
+    while (pLib->pStringSlots[iSlot] != 0) {
+        const char* existingStr = pLib->pStrings + pLib->pStringSlots[iSlot];
+        if (strncmp(existingStr, str, length) == 0 && existingStr[length] == '\0') {
+            return pLib->pStringSlots[iSlot];
         }
 
-        pLib->featuresBufferSize = newBufferSize;
-        pLib->pFeatures = pNewFeatures;
+        iSlot = (iSlot + 1) & mask;
+    }
+
+    // It's a new string.
+    if (pLib->stringsSize + length + 1 > pLib->stringsCapacity) {
+        size_t newCapacity = (size_t)pLib->stringsCapacity*2;
+        while (newCapacity < pLib->stringsSize + length + 1) {
+            newCapacity *= 2;
+        }
+
+        if (newCapacity > 0xFFFFFFFF) {
+            return 0;
+        }
+
+        char* pNewStrings = (char*)realloc(pLib->pStrings, newCapacity);
+        if (pNewStrings == NULL) {
+            return 0;
+        }
+
+        pLib->pStrings = pNewStrings;
+        pLib->stringsCapacity = (taUInt32)newCapacity;
+    }
+
+    taUInt32 offset = pLib->stringsSize;
+    memcpy(pLib->pStrings + offset, str, length);
+    pLib->pStrings[offset + length] = '\0';
+    pLib->stringsSize += (taUInt32)length + 1;
+
+    pLib->pStringSlots[iSlot] = offset;
+    pLib->stringSlotsUsed += 1;
+
+    return offset;
+}
+
+// Makes sure there's room for <count> more features.
+TA_PRIVATE taBool32 taFeaturesLibraryReserve(taFeaturesLibrary* pLib, taUInt32 count)
+{
+    if (pLib->featuresBufferSize - pLib->featuresCount >= count) {
+        return TA_TRUE;
     }
 
-    taFeatureDesc* pFeature = pLib->pFeatures + pLib->featuresCount;
-    memset(pFeature, 0, sizeof(*pFeature));
-    strcpy_s(pFeature->name, sizeof(pFeature->name), featureName);
+    taUInt32 newBufferSize = pLib->featuresCount + count;
+    taFeatureDesc* pNewFeatures = realloc(pLib->pFeatures, newBufferSize * sizeof(*pLib->pFeatures));
+    if (pNewFeatures == NULL) {
+        return TA_FALSE;   // Failed to allocate memory.
+    }
+
+    pLib->pFeatures = pNewFeatures;
+
+    taFeatureSource* pNewSources = realloc(pLib->pSources, newBufferSize * sizeof(*pLib->pSources));
+    if (pNewSources == NULL) {
+        return TA_FALSE;   // Failed to allocate memory. The feature buffer being bigger than it needs to be is harmless.
+    }
+
+    pLib->pSources = pNewSources;
+    pLib->featuresBufferSize = newBufferSize;
+
+    return TA_TRUE;
+}
+
+
+//// Loading ////
+
+// A string of a feature's text while the feature is being loaded.
+typedef struct
+{
+    const char* str;
+    size_t length;
+} taFeatureTextString;
+
+// Strings other than the description used to be copied with strcpy_s() which leaves an empty string when the string is too long.
+TA_PRIVATE taFeatureTextString taFeatureMakeTextString(const char* str)
+{
+    taFeatureTextString result;
+    result.str = str;
+    result.length = strlen(str);
+    if (result.length >= TA_FEATURE_MAX_STRING) {
+        result.length = 0;
+    }
+
+    return result;
+}
+
+TA_PRIVATE taUInt32 taFeatureCopyTextString(taFeatureText* pText, taUInt32* pNextOffset, taFeatureTextString string)
+{
+    if (string.length == 0) {
+        return sizeof(*pText);  // <-- The empty string sitting straight after the taFeatureText.
+    }
+
+    taUInt32 offset = *pNextOffset;
+    memcpy((char*)pText + offset, string.str, string.length);
+    ((char*)pText)[offset + string.length] = '\0';
+    *pNextOffset += (taUInt32)string.length + 1;
+
+    return offset;
+}
+
+// Loads the properties of a feature from it's object in a TDF file. The text is returned in a new block of memory which needs to be
+// freed with free().
+TA_PRIVATE taFeatureText* taFeaturesLibraryLoadFeature(taFeatureDesc* pFeature, const taConfigObj* pFeatureConfig)
+{
+    assert(pFeature != NULL);
+    assert(pFeatureConfig != NULL);
+
+    taFeatureTextString description      = {"", 0};
+    taFeatureTextString filename         = {"", 0};
+    taFeatureTextString seqname          = {"", 0};
+    taFeatureTextString seqnameburn      = {"", 0};
+    taFeatureTextString seqnamedie       = {"", 0};
+    taFeatureTextString seqnamereclamate = {"", 0};
+    taFeatureTextString seqnameshadow    = {"", 0};
+    taFeatureTextString object           = {"", 0};
+
+    pFeature->footprintX = 0;
+    pFeature->footprintY = 0;
+    pFeature->flags = 0;
 
     for (taUInt32 iVar = 0; iVar < pFeatureConfig->varCount; ++iVar) {
         taConfigVar* pVar = pFeatureConfig->pVars + iVar;
 
         if (_stricmp(pVar->name, "description") == 0) {
-            strncpy_s(pFeature->description, sizeof(pFeature->description), pVar->value, _TRUNCATE);
+            // The description is truncated rather than cleared when it's too long.
+            description.str = pVar->value;
+            description.length = strlen(pVar->value);
+            if (description.length >= TA_FEATURE_MAX_STRING) {
+                description.length = TA_FEATURE_MAX_STRING-1;
+            }
             continue;
         }
 
@@ -162,31 +329,31 @@ TA_PRIVATE taBool32 taFeaturesLibraryLoadFeature(taFeaturesLibrary* pLib, const
         }
 
         if (_stricmp(pVar->name, "filename") == 0) {
-            strcpy_s(pFeature->filename, sizeof(pFeature->filename), pVar->value);
+            filename = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "seqname") == 0) {
-            strcpy_s(pFeature->seqname, sizeof(pFeature->seqname), pVar->value);
+            seqname = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "seqnameburn") == 0) {
-            strcpy_s(pFeature->seqnameburn, sizeof(pFeature->seqnameburn), pVar->value);
+            seqnameburn = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "seqnamedie") == 0) {
-            strcpy_s(pFeature->seqnamedie, sizeof(pFeature->seqnamedie), pVar->value);
+            seqnamedie = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "seqnamereclamate") == 0) {
-            strcpy_s(pFeature->seqnamereclamate, sizeof(pFeature->seqnamereclamate), pVar->value);
+            seqnamereclamate = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "seqnameshad") == 0) {
-            strcpy_s(pFeature->seqnameshadow, sizeof(pFeature->seqnameshadow), pVar->value);
+            seqnameshadow = taFeatureMakeTextString(pVar->value);
             continue;
         }
         if (_stricmp(pVar->name, "object") == 0) {
-            strcpy_s(pFeature->object, sizeof(pFeature->object), pVar->value);
+            object = taFeatureMakeTextString(pVar->value);
             continue;
         }
 
@@ -239,71 +406,312 @@ TA_PRIVATE taBool32 taFeaturesLibraryLoadFeature(taFeaturesLibrary* pLib, const
     }
 
 
-    // Add the feature to the end of the list.
-    pLib->featuresCount += 1;
+    // The text and it's strings go into a single allocation. The first string is always an empty string.
+    size_t textSize = sizeof(taFeatureText) + 1 +
+        (description.length + 1) + (filename.length + 1) + (seqname.length + 1) + (seqnameburn.length + 1) +
+        (seqnamedie.length + 1) + (seqnamereclamate.length + 1) + (seqnameshadow.length + 1) + (object.length + 1);
 
-    // When a new feature is added, the library is no longer in an optimized state.
-    pLib->isOptimized = TA_FALSE;
+    taFeatureText* pText = (taFeatureText*)malloc(textSize);
+    if (pText == NULL) {
+        return NULL;
+    }
 
-    return TA_TRUE;
+    ((char*)pText)[sizeof(*pText)] = '\0';
+
+    taUInt32 nextOffset = sizeof(*pText) + 1;
+    pText->description      = taFeatureCopyTextString(pText, &nextOffset, description);
+    pText->filename         = taFeatureCopyTextString(pText, &nextOffset, filename);
+    pText->seqname          = taFeatureCopyTextString(pText, &nextOffset, seqname);
+    pText->seqnameburn      = taFeatureCopyTextString(pText, &nextOffset, seqnameburn);
+    pText->seqnamedie       = taFeatureCopyTextString(pText, &nextOffset, seqnamedie);
+    pText->seqnamereclamate = taFeatureCopyTextString(pText, &nextOffset, seqnamereclamate);
+    pText->seqnameshadow    = taFeatureCopyTextString(pText, &nextOffset, seqnameshadow);
+    pText->object           = taFeatureCopyTextString(pText, &nextOffset, object);
+
+    return pText;
 }
 
-TA_PRIVATE taBool32 taFeaturesLibraryLoadFeaturesFromConfig(taFeaturesLibrary* pLib, taConfigObj* pConfig)
+// Loads the rest of a feature if it hasn't already been loaded. This is thread-safe. Returns TA_FALSE if the feature could not be
+// loaded.
+TA_PRIVATE taBool32 taFeaturesLibraryLoadFeatureOnDemand(taFeaturesLibrary* pLib, taUInt32 iFeature)
 {
-    if (pLib == NULL) {
-        return TA_FALSE;
+    assert(pLib != NULL);
+    assert(iFeature < pLib->featuresCount);
+
+    taFeatureSource* pSource = &pLib->pSources[iFeature];
+
+    taUInt32 state = taAtomicLoad32(&pSource->state);
+    if (state != TA_FEATURE_STATE_NOT_LOADED) {
+        return state == TA_FEATURE_STATE_LOADED;
+    }
+
+    // The file is parsed without holding the lock so that different features can be loaded at the same time. If two threads load the
+    // same feature at the same time, the second one to finish just throws away it's copy.
+    taFeatureDesc feature;
+    taZeroObject(&feature);
+    taFeatureText* pText = NULL;
+
+    const taFeatureScript* pScript = &pLib->pScripts[pSource->scriptIndex];
+    taConfigObj* pConfig = taParseConfigFromSpecificFile(pLib->pFS, pLib->pScriptPaths + pScript->archivePathOffset, pLib->pScriptPaths + pScript->filePathOffset);
+    if (pConfig != NULL) {
+        // The name is checked in case the file has changed since the library was created.
+        if (pSource->objectIndex < pConfig->varCount) {
+            const taConfigVar* pVar = &pConfig->pVars[pSource->objectIndex];
+            taFeatureTextString name = taFeatureMakeTextString(pVar->name);
+            const char* featureName = taFeaturesLibraryGetString(pLib, pLib->pFeatures[iFeature].name);
+            if (pVar->pObject != NULL && name.length == strlen(featureName) && strncmp(name.str, featureName, name.length) == 0) {
+                pText = taFeaturesLibraryLoadFeature(&feature, pVar->pObject);
+            }
+        }
+
+        taDeleteConfig(pConfig);
     }
 
-    taBool32 result = TA_TRUE;
-    for (unsigned int iVar = 0; iVar < pConfig->varCount; ++iVar) {
-        if (!taFeaturesLibraryLoadFeature(pLib, pConfig->pVars[iVar].name, pConfig->pVars[iVar].pObject)) {
-            result = TA_FALSE;
-            break;
+    taMutexLock(&pLib->lock);
+    {
+        state = pSource->state;
+        if (state == TA_FEATURE_STATE_NOT_LOADED) {
+            if (pText != NULL) {
+                pLib->pFeatures[iFeature].footprintX = feature.footprintX;
+                pLib->pFeatures[iFeature].footprintY = feature.footprintY;
+                pLib->pFeatures[iFeature].flags      = feature.flags;
+                pLib->pFeatures[iFeature].pText      = pText;
+                pText = NULL;   // <-- Owned by the library now.
+
+                state = TA_FEATURE_STATE_LOADED;
+            } else {
+                state = TA_FEATURE_STATE_MISSING;
+            }
+
+            taAtomicStore32(&pSource->state, state);
         }
     }
+    taMutexUnlock(&pLib->lock);
 
-    return result;
+    free(pText);
+    return state == TA_FEATURE_STATE_LOADED;
 }
 
-TA_PRIVATE taBool32 taFeaturesLibraryLoadAndParseScript(taFeaturesLibrary* pLib, taFS* pFS, const char* archiveRelativePath, const char* fileRelativePath)
+
+// A TDF file being scanned by taCreateFeaturesLibrary(). Each file is parsed for the names of it's features, which are then merged
+// into the library in the order the files were found.
+typedef struct
 {
-    assert(pLib != NULL);
-    assert(pFS != NULL);
-    assert(fileRelativePath != NULL);
+    // Offsets of the archive and file paths in the path buffer of the library.
+    taUInt32 archivePathOffset;
+    taUInt32 filePathOffset;
+
+    // The names of the features in the file, one after the other, each null terminated.
+    char* pNames;
+    taUInt32 nameCount;
+} taFeaturesLibraryScanScript;
 
-    taConfigObj* pConfig = taParseConfigFromSpecificFile(pFS, archiveRelativePath, fileRelativePath);
+typedef struct
+{
+    taFS* pFS;
+    taFeaturesLibraryScanScript* pScripts;
+    const char* pPaths;
+} taFeaturesLibraryScanJob;
+
+TA_PRIVATE void taFeaturesLibraryScanJobProc(void* pUserData, taUInt32 iJob)
+{
+    taFeaturesLibraryScanJob* pJob = (taFeaturesLibraryScanJob*)pUserData;
+    taFeaturesLibraryScanScript* pScript = &pJob->pScripts[iJob];
+
+    taConfigObj* pConfig = taParseConfigFromSpecificFile(pJob->pFS, pJob->pPaths + pScript->archivePathOffset, pJob->pPaths + pScript->filePathOffset);
     if (pConfig == NULL) {
-        return TA_FALSE;
+        return;
+    }
+
+    // Every variable at the root of the file is a feature. A variable that's not an object stops the rest of the file from being
+    // loaded, which is how it's always been.
+    taUInt32 objectCount = 0;
+    size_t namesSize = 0;
+    while (objectCount < pConfig->varCount && pConfig->pVars[objectCount].pObject != NULL) {
+        namesSize += strlen(pConfig->pVars[objectCount].name) + 1;
+        objectCount += 1;
     }
 
-    taBool32 result = taFeaturesLibraryLoadFeaturesFromConfig(pLib, pConfig);
-    //printf("FILE: %s/%s\n", archiveRelativePath, fileRelativePath);
+    pScript->pNames = (char*)malloc((namesSize > 0) ? namesSize : 1);
+    if (pScript->pNames != NULL) {
+        char* pNextName = pScript->pNames;
+        for (taUInt32 iObject = 0; iObject < objectCount; ++iObject) {
+            size_t nameSize = strlen(pConfig->pVars[iObject].name) + 1;
+            memcpy(pNextName, pConfig->pVars[iObject].name, nameSize);
+            pNextName += nameSize;
+        }
+
+        pScript->nameCount = objectCount;
+    }
 
     taDeleteConfig(pConfig);
-    return result;
 }
 
+TA_PRIVATE taBool32 taFeaturesLibraryPushScriptPath(char** ppPaths, size_t* pPathsSize, size_t* pPathsCapacity, const char* path, taUInt32* pOffsetOut)
+{
+    size_t pathSize = strlen(path)+1;
+    if (*pPathsSize + pathSize > *pPathsCapacity) {
+        size_t newCapacity = (*pPathsCapacity == 0) ? 4096 : *pPathsCapacity*2;
+        while (newCapacity < *pPathsSize + pathSize) {
+            newCapacity *= 2;
+        }
+
+        if (newCapacity > 0xFFFFFFFF) {
+            return TA_FALSE;
+        }
+
+        char* pNewPaths = (char*)realloc(*ppPaths, newCapacity);
+        if (pNewPaths == NULL) {
+            return TA_FALSE;
+        }
+
+        *ppPaths = pNewPaths;
+        *pPathsCapacity = newCapacity;
+    }
+
+    memcpy(*ppPaths + *pPathsSize, path, pathSize);
+    *pOffsetOut = (taUInt32)*pPathsSize;
+    *pPathsSize += pathSize;
+
+    return TA_TRUE;
+}
+
+
+TA_PRIVATE int taFeaturesLibrarySortedNameQuickSortCallback(const void* a, const void* b)
+{
+    const taFeatureSortedName* pA = (const taFeatureSortedName*)a;
+    const taFeatureSortedName* pB = (const taFeatureSortedName*)b;
+
+    int result = _stricmp(pA->name, pB->name);
+    if (result != 0) {
+        return result;
+    }
+
+    // Features with the same name stay in the order they were loaded so the first one can be found.
+    return (pA->featureIndex < pB->featureIndex) ? -1 : ((pA->featureIndex > pB->featureIndex) ? 1 : 0);
+}
 
 TA_PRIVATE void taFeaturesLibraryOptimize(taFeaturesLibrary* pLib)
 {
     assert(pLib != NULL);
 
-    // TODO: Sort by hash; optimize buffer, set pLib->isOptimized to TA_TRUE.
-    (void)pLib;
+    // The library is finished so the buffers can be trimmed, and the table for interning strings is no longer needed.
+    if (pLib->featuresCount > 0 && pLib->featuresCount < pLib->featuresBufferSize) {
+        taFeatureDesc* pNewFeatures = realloc(pLib->pFeatures, pLib->featuresCount * sizeof(*pLib->pFeatures));
+        if (pNewFeatures != NULL) {
+            pLib->pFeatures = pNewFeatures;
+        }
+
+        taFeatureSource* pNewSources = realloc(pLib->pSources, pLib->featuresCount * sizeof(*pLib->pSources));
+        if (pNewSources != NULL) {
+            pLib->pSources = pNewSources;
+        }
+
+        if (pNewFeatures != NULL && pNewSources != NULL) {
+            pLib->featuresBufferSize = pLib->featuresCount;
+        }
+    }
+
+    if (pLib->stringsSize > 0 && pLib->stringsSize < pLib->stringsCapacity) {
+        char* pNewStrings = (char*)realloc(pLib->pStrings, pLib->stringsSize);
+        if (pNewStrings != NULL) {
+            pLib->pStrings = pNewStrings;
+            pLib->stringsCapacity = pLib->stringsSize;
+        }
+    }
+
+    free(pLib->pStringSlots);
+    pLib->pStringSlots = NULL;
+    pLib->stringSlotCount = 0;
+    pLib->stringSlotsUsed = 0;
+
+    // Now that nothing is going to move, each feature can point at the string pool.
+    const char* pStrings = (pLib->pStrings != NULL) ? pLib->pStrings : "";
+    for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+        pLib->pFeatures[iFeature].pStrings = pStrings;
+    }
+
+    // The sorted names are the fallback for when there isn't enough memory for the hash index.
+    pLib->pSortedNames = (taFeatureSortedName*)malloc((pLib->featuresCount > 0 ? pLib->featuresCount : 1) * sizeof(*pLib->pSortedNames));
+    if (pLib->pSortedNames != NULL) {
+        for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+            pLib->pSortedNames[iFeature].name = taFeaturesLibraryGetString(pLib, pLib->pFeatures[iFeature].name);
+            pLib->pSortedNames[iFeature].featureIndex = iFeature;
+        }
+
+        qsort(pLib->pSortedNames, pLib->featuresCount, sizeof(*pLib->pSortedNames), taFeaturesLibrarySortedNameQuickSortCallback);
+        pLib->isOptimized = TA_TRUE;
+    }
+
+    // The hash index is kept at most half full.
+    taUInt32 slotCount = 16;
+    while (slotCount < pLib->featuresCount*2) {
+        slotCount *= 2;
+    }
+
+    pLib->pSlots = (taFeatureSlot*)calloc(slotCount, sizeof(*pLib->pSlots));
+    if (pLib->pSlots != NULL) {
+        // Features are inserted in order so that when a name is used more than once, the first one is found first.
+        taUInt32 mask = slotCount - 1;
+        for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+            taUInt32 nameHash = pLib->pFeatures[iFeature].nameHash;
+
+            taUInt32 iSlot = nameHash & mask;
+            while (pLib->pSlots[iSlot].featureIndex != 0) {
+                iSlot = (iSlot + 1) & mask;
+            }
+
+            pLib->pSlots[iSlot].nameHash = nameHash;
+            pLib->pSlots[iSlot].featureIndex = iFeature + 1;
+        }
+
+        pLib->slotCount = slotCount;
+        pLib->isOptimized = TA_TRUE;
+    }
 }
 
 
+// Finds a feature by name, loading it if necessary. If a feature fails to load, the next one with the same name is tried.
 TA_PRIVATE taFeatureDesc* taFeaturesLibraryFindByName(taFeaturesLibrary* pLib, const char* name)
 {
     assert(pLib != NULL);
 
     if (pLib->isOptimized) {
-        // Optimized binary search.
-        // TODO: Implement.
+        if (pLib->pSlots != NULL) {
+            // Hash index.
+            taUInt32 nameHash = taHashStringCaseInsensitive(name);
+            taUInt32 mask = pLib->slotCount - 1;
+            for (taUInt32 iSlot = nameHash & mask; pLib->pSlots[iSlot].featureIndex != 0; iSlot = (iSlot + 1) & mask) {
+                if (pLib->pSlots[iSlot].nameHash == nameHash) {
+                    taUInt32 iFeature = pLib->pSlots[iSlot].featureIndex - 1;
+                    if (_stricmp(taFeaturesLibraryGetString(pLib, pLib->pFeatures[iFeature].name), name) == 0 && taFeaturesLibraryLoadFeatureOnDemand(pLib, iFeature)) {
+                        return pLib->pFeatures + iFeature;
+                    }
+                }
+            }
+        } else {
+            // Binary search of the sorted names. This finds the first of any features with the same name.
+            taUInt32 lo = 0;
+            taUInt32 hi = pLib->featuresCount;
+            while (lo < hi) {
+                taUInt32 mid = lo + (hi - lo)/2;
+                if (_stricmp(pLib->pSortedNames[mid].name, name) < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+
+            for (; lo < pLib->featuresCount && _stricmp(pLib->pSortedNames[lo].name, name) == 0; ++lo) {
+                if (taFeaturesLibraryLoadFeatureOnDemand(pLib, pLib->pSortedNames[lo].featureIndex)) {
+                    return pLib->pFeatures + pLib->pSortedNames[lo].featureIndex;
+                }
+            }
+        }
     } else {
         // Linear search.
         for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
-            if (_stricmp(pLib->pFeatures[iFeature].name, name) == 0) {
+            if (_stricmp(taFeaturesLibraryGetString(pLib, pLib->pFeatures[iFeature].name), name) == 0 && taFeaturesLibraryLoadFeatureOnDemand(pLib, iFeature)) {
                 return pLib->pFeatures + iFeature;
             }
         }
@@ -320,27 +728,105 @@ taFeaturesLibrary* taCreateFeaturesLibrary(taFS* pFS)
         return NULL;
     }
 
-    taFeaturesLibrary* pLib = malloc(sizeof(*pLib));
+    taFeaturesLibrary* pLib = calloc(1, sizeof(*pLib));
     if (pLib == NULL) {
         return NULL;
     }
 
-    pLib->featuresCount = 0;
-    pLib->featuresBufferSize = TA_FEATURE_CHUNK_SIZE;
-    pLib->pFeatures = malloc(pLib->featuresBufferSize * sizeof(*pLib->pFeatures));
-    if (pLib->pFeatures == NULL) {
+    pLib->pFS = pFS;
+
+    if (!taMutexInit(&pLib->lock)) {
         free(pLib);
         return NULL;
     }
 
+    // The scripts are found first, and then scanned for the names of their features in parallel on the file system's thread pool.
+    // The rest of each feature is loaded when it's first needed. The paths are stored in a single buffer that's referenced by offset
+    // since it can be moved while growing.
+    taFeaturesLibraryScanScript* pScripts = NULL;
+    taUInt32 scriptCount = 0;
+    taUInt32 scriptCapacity = 0;
+    size_t pathsSize = 0;
+    size_t pathsCapacity = 0;
+
     taFSIterator* pIter = taFSBegin(pFS, "features", TA_TRUE);     // <-- "TA_TRUE" means to search recursively.
     while (taFSNext(pIter)) {
         if (!pIter->fileInfo.isDirectory && taPathExtensionEqual(pIter->fileInfo.relativePath, "tdf")) {
-            taFeaturesLibraryLoadAndParseScript(pLib, pFS, pIter->fileInfo.archiveRelativePath, pIter->fileInfo.relativePath);
+            if (scriptCount == scriptCapacity) {
+                taUInt32 newCapacity = (scriptCapacity == 0) ? 256 : scriptCapacity*2;
+                taFeaturesLibraryScanScript* pNewScripts = (taFeaturesLibraryScanScript*)realloc(pScripts, newCapacity * sizeof(*pScripts));
+                if (pNewScripts == NULL) {
+                    break;  // <-- Out of memory. Just load the scripts we have so far.
+                }
+
+                pScripts = pNewScripts;
+                scriptCapacity = newCapacity;
+            }
+
+            taFeaturesLibraryScanScript* pScript = &pScripts[scriptCount];
+            taZeroObject(pScript);
+            if (!taFeaturesLibraryPushScriptPath(&pLib->pScriptPaths, &pathsSize, &pathsCapacity, pIter->fileInfo.archiveRelativePath, &pScript->archivePathOffset) ||
+                !taFeaturesLibraryPushScriptPath(&pLib->pScriptPaths, &pathsSize, &pathsCapacity, pIter->fileInfo.relativePath, &pScript->filePathOffset)) {
+                break;
+            }
+
+            scriptCount += 1;
         }
     }
     taFSEnd(pIter);
 
+    taFeaturesLibraryScanJob job;
+    job.pFS = pFS;
+    job.pScripts = pScripts;
+    job.pPaths = pLib->pScriptPaths;
+    taThreadPoolRun(&pFS->threadPool, scriptCount, taFeaturesLibraryScanJobProc, &job);
+
+    // The names are merged in the order the scripts were found so that when a name is used more than once, the feature that's found
+    // is the same as when the scripts are loaded one at a time.
+    pLib->pScripts = (taFeatureScript*)malloc(((scriptCount > 0) ? scriptCount : 1) * sizeof(*pLib->pScripts));
+    if (pLib->pScripts != NULL) {
+        taUInt32 totalFeatureCount = 0;
+        for (taUInt32 iScript = 0; iScript < scriptCount; ++iScript) {
+            totalFeatureCount += pScripts[iScript].nameCount;
+        }
+
+        taFeaturesLibraryReserve(pLib, totalFeatureCount);
+
+        for (taUInt32 iScript = 0; iScript < scriptCount; ++iScript) {
+            taFeaturesLibraryScanScript* pScript = &pScripts[iScript];
+            pLib->pScripts[iScript].archivePathOffset = pScript->archivePathOffset;
+            pLib->pScripts[iScript].filePathOffset = pScript->filePathOffset;
+
+            const char* pName = pScript->pNames;
+            for (taUInt32 iObject = 0; iObject < pScript->nameCount && pLib->featuresCount < pLib->featuresBufferSize; ++iObject) {
+                taFeatureTextString name = taFeatureMakeTextString(pName);
+                pName += strlen(pName) + 1;
+
+                taFeatureDesc* pFeature = &pLib->pFeatures[pLib->featuresCount];
+                taZeroObject(pFeature);
+                pFeature->name = taFeaturesLibraryInternString(pLib, name.str, name.length);
+                pFeature->nameHash = taHashStringCaseInsensitive(taFeaturesLibraryGetString(pLib, pFeature->name));
+
+                taFeatureSource* pSource = &pLib->pSources[pLib->featuresCount];
+                pSource->scriptIndex = iScript;
+                pSource->objectIndex = iObject;
+                pSource->state = TA_FEATURE_STATE_NOT_LOADED;
+
+                pLib->featuresCount += 1;
+            }
+
+            free(pScript->pNames);
+        }
+
+        pLib->scriptCount = scriptCount;
+    } else {
+        for (taUInt32 iScript = 0; iScript < scriptCount; ++iScript) {
+            free(pScripts[iScript].pNames);
+        }
+    }
+
+    free(pScripts);
+
 
     // The features library is immutable which means we can optimize a few things for efficiency.
     taFeaturesLibraryOptimize(pLib);
@@ -354,7 +840,19 @@ void taDeleteFeaturesLibrary(taFeaturesLibrary* pLib)
         return;
     }
 
+    for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+        free((void*)pLib->pFeatures[iFeature].pText);
+    }
+
+    free(pLib->pSlots);
+    free(pLib->pSortedNames);
+    free(pLib->pStringSlots);
+    free(pLib->pStrings);
+    free(pLib->pScriptPaths);
+    free(pLib->pScripts);
+    free(pLib->pSources);
     free(pLib->pFeatures);
+    taMutexUninit(&pLib->lock);
     free(pLib);
 }
 
@@ -363,3 +861,49 @@ taFeatureDesc* taFindFeatureDesc(taFeaturesLibrary* pLib, const char* featureNam
 {
     return taFeaturesLibraryFindByName(pLib, featureName);
 }
+
+
+const char* taFeatureDescGetName(const taFeatureDesc* pDesc)
+{
+    return pDesc->pStrings + pDesc->name;
+}
+
+const char* taFeatureDescGetDescription(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->description : "";
+}
+
+const char* taFeatureDescGetFilename(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->filename : "";
+}
+
+const char* taFeatureDescGetSeqName(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->seqname : "";
+}
+
+const char* taFeatureDescGetSeqNameBurn(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->seqnameburn : "";
+}
+
+const char* taFeatureDescGetSeqNameDie(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->seqnamedie : "";
+}
+
+const char* taFeatureDescGetSeqNameReclamate(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->seqnamereclamate : "";
+}
+
+const char* taFeatureDescGetSeqNameShadow(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->seqnameshadow : "";
+}
+
+const char* taFeatureDescGetObject(const taFeatureDesc* pDesc)
+{
+    return (pDesc->pText != NULL) ? (const char*)pDesc->pText + pDesc->pText->object : "";
+}
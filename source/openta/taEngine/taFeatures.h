@@ -52,49 +52,65 @@ typedef enum
 } taFeatureCategory;
 #endif
 
-// Structure describing a feature. This is not a feature instantiation.
-//
-// Note that not every property is stored in this structure - only what we need.
+// The text of a feature. This is kept apart from taFeatureDesc since it's only needed while loading the feature's graphics. The text
+// is allocated in a single block along with it's strings, and each string is an offset from the start of the block. Use the
+// taFeatureDescGet*() functions to get the strings themselves.
 typedef struct
 {
-    // The name of the feature. This is used when searching for the feature.
-    char name[64];
-
     // The description of the feature. This is shown at the bottom of the screen when the player places the mouse over the object.
-    char description[64];
-
-#if 0
-    // The category. We're only using a set of predefined categories that we use which means this can be represented
-    // with an enumerator.
-    taFeatureCategory category;
-#endif
-
-    // The width of the object, in 16x16 tiles.
-    unsigned short footprintX;
-
-    // The height of the object, in 16x16 tiles.
-    unsigned short footprintY;
+    taUInt32 description;
 
     // File .GAF file that contains the feature's graphics.
-    char filename[64];
+    taUInt32 filename;
 
     // The name of the sequence within the GAF file of <filename> where the default graphic is located.
-    char seqname[64];
+    taUInt32 seqname;
 
     // Same as seqname, except for when the feature is burned.
-    char seqnameburn[64];
+    taUInt32 seqnameburn;
 
     // The graphic used after the feature has been destroyed.
-    char seqnamedie[64];
+    taUInt32 seqnamedie;
 
     // The graphic animation used when the feature is reclamated.
-    char seqnamereclamate[64];
+    taUInt32 seqnamereclamate;
 
     // The graphic used to draw the feature's shadow.
-    char seqnameshadow[64];
+    taUInt32 seqnameshadow;
 
     // The 3DO object to use as the graphic for the feature. Blank for 2D features.
-    char object[64];
+    taUInt32 object;
+} taFeatureText;
+
+// Structure describing a feature. This is not a feature instantiation.
+//
+// Note that not every property is stored in this structure - only what we need. The names of every feature are stored once in a
+// string pool owned by the library, and the text that's only needed while loading is stored separately in a taFeatureText.
+//
+// Only the name is known until the feature is first returned by taFindFeatureDesc(), at which point the rest is loaded.
+typedef struct
+{
+    // The string pool of the library, which is set once the library has finished loading, and the text of the feature, which is set
+    // when the rest of the feature is loaded.
+    const char* pStrings;
+    const taFeatureText* pText;
+
+    // The name of the feature as an offset into the string pool, and it's case-insensitive hash. This is used when searching for the
+    // feature.
+    taUInt32 name;
+    taUInt32 nameHash;
+
+#if 0
+    // The category. We're only using a set of predefined categories that we use which means this can be represented
+    // with an enumerator.
+    taFeatureCategory category;
+#endif
+
+    // The width of the object, in 16x16 tiles.
+    unsigned short footprintX;
+
+    // The height of the object, in 16x16 tiles.
+    unsigned short footprintY;
 
     // Boolean properties
     //  TA_FEATURE_ANIMATING -> "animating"
@@ -111,8 +127,48 @@ typedef struct
     taUInt16 flags;
 } taFeatureDesc;
 
-// Structure containing the descriptors of every known feature. This structure is filled
-// once during load time from TDF files contained in the "features" directory.
+// An entry in the hash index of a features library.
+typedef struct
+{
+    // The case-insensitive hash of the feature's name.
+    taUInt32 nameHash;
+
+    // The index of the feature plus one. Zero means the slot is empty.
+    taUInt32 featureIndex;
+} taFeatureSlot;
+
+// An entry in the sorted name index of a features library.
+typedef struct
+{
+    const char* name;
+    taUInt32 featureIndex;
+} taFeatureSortedName;
+
+// Where a feature is defined, and whether or not the rest of it has been loaded.
+typedef struct
+{
+    // The index of the TDF file in the library's list of scripts, and the index of the feature's object within the root of the file.
+    taUInt32 scriptIndex;
+    taUInt32 objectIndex;
+
+    // One of TA_FEATURE_STATE_*. This is accessed atomically.
+    volatile taUInt32 state;
+} taFeatureSource;
+
+#define TA_FEATURE_STATE_NOT_LOADED     0
+#define TA_FEATURE_STATE_LOADED         1
+#define TA_FEATURE_STATE_MISSING        2   // <-- The feature could not be loaded.
+
+// A TDF file features are defined in. The paths are offsets into the library's script paths.
+typedef struct
+{
+    taUInt32 archivePathOffset;
+    taUInt32 filePathOffset;
+} taFeatureScript;
+
+// Structure containing the descriptors of every known feature. This structure is filled once during load time from the TDF files
+// contained in the "features" directory. Only the names of the features are loaded at first. The rest of each feature is loaded from
+// it's TDF file the first time it's found with taFindFeatureDesc(), which is thread-safe.
 typedef struct
 {
     // The number of features in the library.
@@ -121,11 +177,44 @@ typedef struct
     // The size of the buffer containing the features. This is used for determining whether or not the buffer needs to be reallocated.
     taUInt32 featuresBufferSize;
 
-    // The list of feature descriptors making up the library.
+    // The list of feature descriptors making up the library, and where each one is defined.
     taFeatureDesc* pFeatures;
+    taFeatureSource* pSources;
+
+    // The TDF files the features are defined in, and the buffer containing their paths.
+    taUInt32 scriptCount;
+    taFeatureScript* pScripts;
+    char* pScriptPaths;
+
+    // The file system the TDF files are loaded from. This must outlive the library.
+    taFS* pFS;
 
-    // Whether or not the library is optimized. If so, we can so a binary search for items.
+    // Locked while publishing a feature that has just been loaded.
+    taMutex lock;
+
+    // The string pool. Every distinct name is stored once, null terminated. Offset 0 is always an empty string.
+    char* pStrings;
+    taUInt32 stringsSize;
+    taUInt32 stringsCapacity;
+
+    // The table used for finding strings that are already in the pool while the library is loading. Each slot is the offset of a
+    // string, with 0 meaning the slot is empty. This is freed once the library has finished loading.
+    taUInt32 stringSlotCount;
+    taUInt32 stringSlotsUsed;
+    taUInt32* pStringSlots;
+
+    // Whether or not the library is optimized. If so, features are found with the hash index, or with a binary search of the sorted
+    // names if the hash index could not be allocated.
     taBool32 isOptimized;
+
+    // The hash index of the features, keyed by the case-insensitive hash of their names. This is open addressed and at most half
+    // full. slotCount is always a power of 2, or 0 if the index has not been built.
+    taUInt32 slotCount;
+    taFeatureSlot* pSlots;
+
+    // The names of the features sorted case-insensitively, with features of the same name in the order they were loaded. Null if
+    // the library has not been optimized.
+    taFeatureSortedName* pSortedNames;
 } taFeaturesLibrary;
 
 // Creates a features library by loading every TDF file in the "features" directory and all of it's sub-directories.
@@ -135,5 +224,18 @@ taFeaturesLibrary* taCreateFeaturesLibrary(taFS* pFS);
 void taDeleteFeaturesLibrary(taFeaturesLibrary* pLib);
 
 
-// Finds a descriptor by name.
-taFeatureDesc* taFindFeatureDesc(taFeaturesLibrary* pLib, const char* featureName);
\ No newline at end of file
+// Finds a descriptor by name. This is case-insensitive. If more than one feature has the same name, the first one loaded is returned.
+taFeatureDesc* taFindFeatureDesc(taFeaturesLibrary* pLib, const char* featureName);
+
+
+// Retrieves the strings of a feature. These are never null. Everything but the name is empty if the feature was not returned by
+// taFindFeatureDesc(), since only that loads it.
+const char* taFeatureDescGetName(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetDescription(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetFilename(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetSeqName(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetSeqNameBurn(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetSeqNameDie(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetSeqNameReclamate(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetSeqNameShadow(const taFeatureDesc* pDesc);
+const char* taFeatureDescGetObject(const taFeatureDesc* pDesc);
@@ -10,7 +10,7 @@ taResult taFontLoadFNT(taEngineContext* pEngine, const char* filePath, taFont* p
 
     pFont->canBeColored = TA_TRUE;
 
-    taFile* pFile = taOpenFile(pEngine->pFS, filePath, 0);
+    taFile* pFile = taOpenFile(pEngine->pFS, filePath, TA_OPEN_FILE_READ_ONLY);
     if (pFile == NULL) {
         return TA_FILE_NOT_FOUND;
     }
@@ -132,7 +132,7 @@ taResult taFontLoadGAF(taEngineContext* pEngine, const char* filePath, taFont* p
         return TA_FILE_NOT_FOUND;
     }
 
-    taGAF* pGAF = taOpenGAF(pEngine->pFS, packagePath);
+    taGAF* pGAF = taOpenGAF(pEngine->pFS, packagePath, TA_OPEN_FILE_READ_ONLY);
     if (pGAF == NULL) {
         return TA_FILE_NOT_FOUND;
     }
@@ -151,7 +151,63 @@ TA_PRIVATE taBool32 taGAFReadFramePixels(taGAF* pGAF, taGAFFrameHeader* pFrameHe
 }
 
 
-taGAF* taOpenGAF(taFS* pFS, const char* filename)
+TA_PRIVATE taBool32 taGAFLoadSequences(taGAF* pGAF)
+{
+    assert(pGAF != NULL);
+
+    if (pGAF->sequenceCount == 0) {
+        return TA_TRUE;
+    }
+
+    // The sequence pointers are located at byte position 12.
+    if (pGAF->sequenceCount > (pGAF->pFile->sizeInBytes - 12) / sizeof(taUInt32)) {
+        return TA_FALSE;
+    }
+
+    pGAF->_pSequences = (taGAFSequence*)calloc(pGAF->sequenceCount, sizeof(*pGAF->_pSequences));
+    if (pGAF->_pSequences == NULL) {
+        return TA_FALSE;
+    }
+
+    // The pointers are all read first so that the file can then be read in one pass.
+    for (taUInt32 iSequence = 0; iSequence < pGAF->sequenceCount; ++iSequence) {
+        if (!taSeekFile(pGAF->pFile, 12 + (iSequence * sizeof(taUInt32)), taSeekOriginStart)) {
+            return TA_FALSE;
+        }
+
+        if (!taReadFileUInt32(pGAF->pFile, &pGAF->_pSequences[iSequence].pointer)) {
+            return TA_FALSE;
+        }
+    }
+
+    for (taUInt32 iSequence = 0; iSequence < pGAF->sequenceCount; ++iSequence) {
+        taGAFSequence* pSequence = &pGAF->_pSequences[iSequence];
+        if (!taSeekFile(pGAF->pFile, pSequence->pointer, taSeekOriginStart)) {
+            return TA_FALSE;
+        }
+
+        taUInt16 frameCount;
+        if (!taReadFileUInt16(pGAF->pFile, &frameCount)) {
+            return TA_FALSE;
+        }
+
+        if (!taSeekFile(pGAF->pFile, 6, taSeekOriginCurrent)) {
+            return TA_FALSE;
+        }
+
+        size_t bytesRead;
+        if (!taReadFile(pGAF->pFile, pSequence->name, sizeof(pSequence->name), &bytesRead) || bytesRead != sizeof(pSequence->name)) {
+            return TA_FALSE;
+        }
+
+        pSequence->name[sizeof(pSequence->name) - 1] = '\0';
+        pSequence->frameCount = frameCount;
+    }
+
+    return TA_TRUE;
+}
+
+taGAF* taOpenGAF(taFS* pFS, const char* filename, unsigned int fileOptions)
 {
     if (pFS == NULL || filename == NULL) {
         return NULL;
@@ -172,20 +228,32 @@ taGAF* taOpenGAF(taFS* pFS, const char* filename)
         }
     }
 
+    return taOpenGAFFromFile(taOpenFile(pFS, fullFileName, fileOptions), filename);
+}
+
+taGAF* taOpenGAFFromFile(taFile* pFile, const char* filename)
+{
+    if (pFile == NULL) {
+        return NULL;
+    }
+
+    if (filename == NULL) {
+        taCloseFile(pFile);
+        return NULL;
+    }
+
     taGAF* pGAF = calloc(1, sizeof(*pGAF));
     if (pGAF == NULL) {
+        taCloseFile(pFile);
         return NULL;
     }
 
+    pGAF->pFile = pFile;
+
     if (strcpy_s(pGAF->filename, sizeof(pGAF->filename), filename) != 0) {
         goto on_error;
     }
     
-    pGAF->pFile = taOpenFile(pFS, fullFileName, 0);
-    if (pGAF->pFile == NULL) {
-        goto on_error;
-    }
-    
     taUInt32 version;
     if (!taReadFileUInt32(pGAF->pFile, &version)) {
         goto on_error;    
@@ -198,6 +266,10 @@ taGAF* taOpenGAF(taFS* pFS, const char* filename)
         goto on_error;
     }
 
+    if (!taGAFLoadSequences(pGAF)) {
+        goto on_error;
+    }
+
 
 
     return pGAF;
@@ -208,6 +280,7 @@ on_error:
             taCloseFile(pGAF->pFile);
         }
 
+        free(pGAF->_pSequences);
         free(pGAF);
     }
     
@@ -221,6 +294,7 @@ void taCloseGAF(taGAF* pGAF)
     }
 
     taCloseFile(pGAF->pFile);
+    free(pGAF->_pSequences);
     free(pGAF);
 }
 
@@ -233,40 +307,9 @@ taBool32 taGAFSelectSequence(taGAF* pGAF, const char* sequenceName, taUInt32* pF
 
     // We need to find the sequence which we do by simply iterating over each one and comparing it's name.
     for (taUInt32 iSequence = 0; iSequence < pGAF->sequenceCount; ++iSequence) {
-        // The sequence pointers are located at byte position 12.
-        if (!taSeekFile(pGAF->pFile, 12 + (iSequence * sizeof(taUInt32)), taSeekOriginStart)) {
-            return TA_FALSE;
-        }
-
-        taUInt32 sequencePointer;
-        if (!taReadFileUInt32(pGAF->pFile, &sequencePointer)) {
-            return TA_FALSE;
-        }
-
-        if (!taSeekFile(pGAF->pFile, sequencePointer, taSeekOriginStart)) {
-            return TA_FALSE;
-        }
-
-
-        taUInt16 frameCount;
-        if (!taReadFileUInt16(pGAF->pFile, &frameCount)) {
-            return TA_FALSE;
-        }
-
-        if (!taSeekFile(pGAF->pFile, 6, taSeekOriginCurrent)) {
-            return TA_FALSE;
-        }
-
-        // The file will be sitting on the sequence's name, so we just need to compare. If they're not equal just try the next sequence.
-        const char* pName = pGAF->pFile->pFileData + taTellFile(pGAF->pFile);
-        if (_stricmp(pName, sequenceName) == 0) {
+        if (_stricmp(pGAF->_pSequences[iSequence].name, sequenceName) == 0) {
             // It's the sequence we're looking for.
-            pGAF->_sequenceName = pName;
-            pGAF->_sequencePointer = sequencePointer;
-            pGAF->_sequenceFrameCount = frameCount;
-
-            *pFrameCountOut = frameCount;
-            return TA_TRUE;
+            return taGAFSelectSequenceByIndex(pGAF, iSequence, pFrameCountOut);
         }
     }
     
@@ -283,36 +326,13 @@ taBool32 taGAFSelectSequenceByIndex(taGAF* pGAF, taUInt32 index, taUInt32* pFram
         return TA_FALSE;
     }
 
-    // The sequence pointers are located at byte position 12.
-    if (!taSeekFile(pGAF->pFile, 12 + (index * sizeof(taUInt32)), taSeekOriginStart)) {
-        return TA_FALSE;
-    }
-
-    taUInt32 sequencePointer;
-    if (!taReadFileUInt32(pGAF->pFile, &sequencePointer)) {
-        return TA_FALSE;
-    }
-
-    if (!taSeekFile(pGAF->pFile, sequencePointer, taSeekOriginStart)) {
-        return TA_FALSE;
-    }
-
-
-    taUInt16 frameCount;
-    if (!taReadFileUInt16(pGAF->pFile, &frameCount)) {
-        return TA_FALSE;
-    }
-
-    if (!taSeekFile(pGAF->pFile, 6, taSeekOriginCurrent)) {
-        return TA_FALSE;
-    }
-
-    pGAF->_sequenceName = pGAF->pFile->pFileData + taTellFile(pGAF->pFile);
-    pGAF->_sequencePointer = sequencePointer;
-    pGAF->_sequenceFrameCount = frameCount;
+    const taGAFSequence* pSequence = &pGAF->_pSequences[index];
+    pGAF->_sequenceName = pSequence->name;
+    pGAF->_sequencePointer = pSequence->pointer;
+    pGAF->_sequenceFrameCount = pSequence->frameCount;
 
     if (pFrameCountOut) {
-        *pFrameCountOut = frameCount;
+        *pFrameCountOut = pSequence->frameCount;
     }
 
     return TA_TRUE;
@@ -489,7 +509,7 @@ taResult taGAFTextureGroupInit(taEngineContext* pEngine, const char* filePath, t
     
     pGroup->pEngine = pEngine;
 
-    taGAF* pGAF = taOpenGAF(pEngine->pFS, filePath);
+    taGAF* pGAF = taOpenGAF(pEngine->pFS, filePath, TA_OPEN_FILE_READ_ONLY);
     if (pGAF == NULL) {
         return TA_FILE_NOT_FOUND;
     }
@@ -499,7 +519,10 @@ taResult taGAFTextureGroupInit(taEngineContext* pEngine, const char* filePath, t
     // pass performs the actual loading.
 
     taTexturePacker packer;
-    taTexturePackerInit(&packer, TA_MAX_TEXTURE_ATLAS_SIZE, TA_MAX_TEXTURE_ATLAS_SIZE, 1, TA_TEXTURE_PACKER_FLAG_HARD_EDGE);
+    if (!taTexturePackerInit(&packer, TA_MAX_TEXTURE_ATLAS_SIZE, TA_MAX_TEXTURE_ATLAS_SIZE, 1, TA_TEXTURE_PACKER_FLAG_HARD_EDGE | TA_TEXTURE_PACKER_FLAG_SKYLINE)) {
+        taCloseGAF(pGAF);
+        return TA_OUT_OF_MEMORY;
+    }
 
     // PASS #1
     // =======
@@ -551,6 +574,7 @@ taResult taGAFTextureGroupInit(taEngineContext* pEngine, const char* filePath, t
 
     pGroup->_pPayload = (taUInt8*)calloc(1, payloadSize);
     if (pGroup->_pPayload == NULL) {
+        taTexturePackerUninit(&packer);
         taCloseGAF(pGAF);
         return TA_OUT_OF_MEMORY;
     }
@@ -620,7 +644,7 @@ taResult taGAFTextureGroupInit(taEngineContext* pEngine, const char* filePath, t
         totalAtlasCount += 1;
     }
 
-
+    taTexturePackerUninit(&packer);
     return TA_SUCCESS;
 }
 
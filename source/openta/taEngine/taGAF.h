@@ -5,7 +5,19 @@
 
 typedef struct
 {
-    // The name of the file as specified by taOpenGAF().
+    // The name of the sequence. This is always null terminated.
+    char name[32];
+
+    // The position in the file of the sequence.
+    taUInt32 pointer;
+
+    // The number of frames in the sequence.
+    taUInt32 frameCount;
+} taGAFSequence;
+
+typedef struct
+{
+    // The name of the file as specified by taOpenGAF() or taOpenGAFFromFile().
     char filename[TA_MAX_PATH];
 
     // The file to load from.
@@ -14,6 +26,10 @@ typedef struct
     // The number of sequences making up the GAF archive.
     taUInt32 sequenceCount;
 
+    // Internal use only. The name, location and frame count of each sequence. These are read when the file is opened so that
+    // selecting a sequence does not need to touch the file.
+    taGAFSequence* _pSequences;
+
     // Internal use only. The name of the currently selected sequence.
     const char* _sequenceName;
 
@@ -24,8 +40,13 @@ typedef struct
     taUInt32 _sequenceFrameCount;
 } taGAF;
 
-// Opens a GAF archive.
-taGAF* taOpenGAF(taFS* pFS, const char* filename);
+// Opens a GAF archive. fileOptions is passed through to taOpenFile(). GAFs that are kept open for a long time but only
+// have a few frames read from them should use TA_OPEN_FILE_STREAMED.
+taGAF* taOpenGAF(taFS* pFS, const char* filename, unsigned int fileOptions);
+
+// Opens a GAF archive from a file that has already been opened. The GAF takes ownership of the file, which will be closed by
+// taCloseGAF(), or straight away if this fails.
+taGAF* taOpenGAFFromFile(taFile* pFile, const char* filename);
 
 // Closes the given GAF archive.
 void taCloseGAF(taGAF* pGAF);
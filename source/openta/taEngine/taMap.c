@@ -92,7 +92,7 @@ TA_PRIVATE int taMapSortFeatureTypesByFileName(const void* a, const void* b)
         return -1;
     }
 
-    return strcmp(pFeatureTypeA->pDesc->filename, pFeatureTypeB->pDesc->filename);
+    return strcmp(taFeatureDescGetFilename(pFeatureTypeA->pDesc), taFeatureDescGetFilename(pFeatureTypeB->pDesc));
 }
 
 TA_PRIVATE int taMapSortFeatureTypesByIndex(const void* a, const void* b)
@@ -514,20 +514,24 @@ TA_PRIVATE taUInt32 taMapLoad3DOObjectsRecursive(taMapInstance* pMap, taMapLoadC
     return 1 + childCount + siblingCount;
 }
 
-TA_PRIVATE taMap3DO* taMapLoad3DO(taMapInstance* pMap, taMapLoadContext* pLoadContext, const char* objectName)
+TA_PRIVATE taBool32 taMapGet3DOFilePath(const char* objectName, char* pathOut, size_t pathOutSize)
 {
     // 3DO files are in the "objects3d" folder.
-    char fullFileName[TA_MAX_PATH];
-    if (!taPathAppend(fullFileName, sizeof(fullFileName), "objects3d", objectName /*"armgate"*/)) {
-        return NULL;
+    if (!taPathAppend(pathOut, pathOutSize, "objects3d", objectName /*"armgate"*/)) {
+        return TA_FALSE;
     }
     if (!taPathExtensionEqual(objectName, "3do")) {
-        if (!taPathAppendExtension(fullFileName, sizeof(fullFileName), fullFileName, "3do")) {
-            return NULL;
+        if (!taPathAppendExtension(pathOut, pathOutSize, pathOut, "3do")) {
+            return TA_FALSE;
         }
     }
 
-    taFile* pFile = taOpenFile(pMap->pEngine->pFS, fullFileName, 0);
+    return TA_TRUE;
+}
+
+// This takes ownership of the file and will close it.
+TA_PRIVATE taMap3DO* taMapLoad3DOFromFile(taMapInstance* pMap, taMapLoadContext* pLoadContext, taFile* pFile)
+{
     if (pFile == NULL) {
         return NULL;
     }
@@ -584,6 +588,121 @@ TA_PRIVATE void taMapCalculateObjectPositionXY(taUInt32 tileX, taUInt32 tileY, t
 }
 
 
+// Loads the GAF or 3DO of every feature type. The feature types need to be sorted by file name before calling this.
+TA_PRIVATE taBool32 taMapLoadFeatureTypeAssets(taMapInstance* pMap, taMapLoadContext* pLoadContext)
+{
+    assert(pMap != NULL);
+    assert(pLoadContext != NULL);
+
+    taUInt32 featureTypesCount = pMap->featureTypesCount;
+    if (featureTypesCount == 0) {
+        return TA_TRUE;
+    }
+
+    // Every asset is opened in a single batch so they can be read in the order they're stored in the archives rather than the order
+    // the feature types happen to be listed in. Feature types sharing the same GAF are next to each other so each GAF is only opened once.
+    void* pAssetData = malloc(featureTypesCount * (sizeof(const char*) + sizeof(taFile*) + sizeof(taUInt32) + TA_MAX_PATH));
+    if (pAssetData == NULL) {
+        return TA_FALSE;
+    }
+
+    const char** ppAssetPaths = (const char**)pAssetData;
+    taFile** ppAssetFiles = (taFile**)(ppAssetPaths + featureTypesCount);
+    taUInt32* pAssetIndices = (taUInt32*)(ppAssetFiles + featureTypesCount);   // <-- The asset of each feature type.
+    char* pAssetPathData = (char*)(pAssetIndices + featureTypesCount);
+
+    taBool32 result = TA_FALSE;
+    taGAF* pCurrentGAF = NULL;
+    taUInt32 currentGAFAssetIndex = 0xFFFFFFFF;
+    taUInt32 assetCount = 0;
+    for (taUInt32 iFeatureType = 0; iFeatureType < featureTypesCount; ++iFeatureType) {
+        const taFeatureDesc* pDesc = pMap->pFeatureTypes[iFeatureType].pDesc;
+        char* pAssetPath = pAssetPathData + (assetCount * TA_MAX_PATH);
+
+        if (taFeatureDescGetFilename(pDesc)[0] != '\0') {
+            if (iFeatureType > 0 && _stricmp(taFeatureDescGetFilename(pMap->pFeatureTypes[iFeatureType-1].pDesc), taFeatureDescGetFilename(pDesc)) == 0) {
+                pAssetIndices[iFeatureType] = pAssetIndices[iFeatureType-1];
+                continue;
+            }
+
+            // GAF files will be in the "anims" directory.
+            if (!taPathAppend(pAssetPath, TA_MAX_PATH, "anims", taFeatureDescGetFilename(pDesc))) {
+                goto done;
+            }
+            if (!taPathExtensionEqual(pAssetPath, "gaf")) {
+                if (!taPathAppendExtension(pAssetPath, TA_MAX_PATH, pAssetPath, "gaf")) {
+                    goto done;
+                }
+            }
+        } else {
+            // It's not a 2D feature so assume it's a 3D one.
+            if (!taMapGet3DOFilePath(taFeatureDescGetObject(pDesc), pAssetPath, TA_MAX_PATH)) {
+                goto done;
+            }
+        }
+
+        ppAssetPaths[assetCount] = pAssetPath;
+        ppAssetFiles[assetCount] = NULL;
+        pAssetIndices[iFeatureType] = assetCount;
+        assetCount += 1;
+    }
+
+    taOpenFiles(pMap->pEngine->pFS, ppAssetPaths, assetCount, TA_OPEN_FILE_READ_ONLY, ppAssetFiles);
+
+    for (taUInt32 iFeatureType = 0; iFeatureType < featureTypesCount; ++iFeatureType)
+    {
+        taMapFeatureType* pFeatureType = &pMap->pFeatureTypes[iFeatureType];
+        taUInt32 iAsset = pAssetIndices[iFeatureType];
+
+        if (taFeatureDescGetFilename(pFeatureType->pDesc)[0] != '\0')
+        {
+            if (currentGAFAssetIndex != iAsset)
+            {
+                // The GAF takes ownership of the file.
+                taCloseGAF(pCurrentGAF);
+                pCurrentGAF = taOpenGAFFromFile(ppAssetFiles[iAsset], ppAssetPaths[iAsset]);
+                ppAssetFiles[iAsset] = NULL;
+                currentGAFAssetIndex = iAsset;
+
+                if (pCurrentGAF == NULL) {
+                    goto done;
+                }
+            }
+
+            // At this point the GAF file containing the feature should be loaded and we just need to read it's frame data for
+            // every required sequence.
+            pFeatureType->pSequenceDefault = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, taFeatureDescGetSeqName(pFeatureType->pDesc));
+            pFeatureType->pSequenceBurn = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, taFeatureDescGetSeqNameBurn(pFeatureType->pDesc));
+            pFeatureType->pSequenceDie = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, taFeatureDescGetSeqNameDie(pFeatureType->pDesc));
+            pFeatureType->pSequenceReclamate = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, taFeatureDescGetSeqNameReclamate(pFeatureType->pDesc));
+            pFeatureType->pSequenceShadow = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, taFeatureDescGetSeqNameShadow(pFeatureType->pDesc));
+        }
+        else
+        {
+            // The 3DO takes ownership of the file.
+            pFeatureType->p3DO = taMapLoad3DOFromFile(pMap, pLoadContext, ppAssetFiles[iAsset]);
+            ppAssetFiles[iAsset] = NULL;
+
+            if (pFeatureType->p3DO == NULL) {
+                goto done;
+            }
+        }
+    }
+
+    result = TA_TRUE;
+
+done:
+    taCloseGAF(pCurrentGAF);
+
+    // Anything that wasn't handed over will still be open, which only happens when this fails part way through.
+    for (taUInt32 iAsset = 0; iAsset < assetCount; ++iAsset) {
+        taCloseFile(ppAssetFiles[iAsset]);
+    }
+
+    free(pAssetData);
+    return result;
+}
+
 TA_PRIVATE taFile* taMapOpenTNTFile(taFS* pFS, const char* mapName)
 {
     char filename[TA_MAX_PATH];
@@ -594,7 +713,7 @@ TA_PRIVATE taFile* taMapOpenTNTFile(taFS* pFS, const char* mapName)
         return NULL;
     }
 
-    return taOpenFile(pFS, filename, 0);
+    return taOpenFile(pFS, filename, TA_OPEN_FILE_READ_ONLY);
 }
 
 TA_PRIVATE void taMapCloseTNTFile(taFile* pTNT)
@@ -897,54 +1016,17 @@ TA_PRIVATE taBool32 taMapLoadTNT(taMapInstance* pMap, const char* mapName, taMap
 
         pMap->pFeatureTypes[iFeatureType].pDesc = taFindFeatureDesc(pMap->pEngine->pFeatures, pMap->pFeatureTypes[iFeatureType].name);
         pMap->pFeatureTypes[iFeatureType]._index = iFeatureType;
-        //printf("%s\n", pMap->pFeatureTypes[iFeatureType].pDesc->filename);
+        //printf("%s\n", taFeatureDescGetFilename(pMap->pFeatureTypes[iFeatureType].pDesc));
     }
 
     // The feature types need to be sorted by their file name so we can load them efficiently.
     qsort(pMap->pFeatureTypes, pMap->featureTypesCount, sizeof(*pMap->pFeatureTypes), taMapSortFeatureTypesByFileName);
 
 
-    taGAF* pCurrentGAF = NULL;
-    for (taUInt32 iFeatureType = 0; iFeatureType < pMap->featureTypesCount; ++iFeatureType)
-    {
-        taMapFeatureType* pFeatureType = &pMap->pFeatureTypes[iFeatureType];
-        if (pFeatureType->pDesc->filename[0] != '\0')
-        {
-            if (pCurrentGAF == NULL || _stricmp(pCurrentGAF->filename, pFeatureType->pDesc->filename) != 0)
-            {
-                // A new GAF file needs to be loaded. These will be in the "anims" directory.
-                char filename[TA_MAX_PATH];
-                if (!taPathAppend(filename, sizeof(filename), "anims", pFeatureType->pDesc->filename)) {
-                    goto on_error;
-                }
-
-                taCloseGAF(pCurrentGAF);
-                pCurrentGAF = taOpenGAF(pMap->pEngine->pFS, filename);
-                if (pCurrentGAF == NULL) {
-                    goto on_error;
-                }
-            }
-
-            // At this point the GAF file containing the feature should be loaded and we just need to read it's frame data for
-            // every required sequence.
-            pFeatureType->pSequenceDefault = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, pFeatureType->pDesc->seqname);
-            pFeatureType->pSequenceBurn = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, pFeatureType->pDesc->seqnameburn);
-            pFeatureType->pSequenceDie = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, pFeatureType->pDesc->seqnamedie);
-            pFeatureType->pSequenceReclamate = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, pFeatureType->pDesc->seqnamereclamate);
-            pFeatureType->pSequenceShadow = taMapLoadGAFSequence(pMap, &pLoadContext->texturePacker, pCurrentGAF, pFeatureType->pDesc->seqnameshadow);
-        }
-        else
-        {
-            // It's not a 2D feature so assume it's a 3D one.
-            pFeatureType->p3DO = taMapLoad3DO(pMap, pLoadContext, pFeatureType->pDesc->object);
-            if (pFeatureType->p3DO == NULL) {
-                goto on_error;
-            }
-        }
+    if (!taMapLoadFeatureTypeAssets(pMap, pLoadContext)) {
+        goto on_error;
     }
 
-    taCloseGAF(pCurrentGAF);
-
 
 
     // Features are loaded by iterating over each 16x16 tile. The type of each feature is determine based on an index, however
@@ -1066,8 +1148,9 @@ TA_PRIVATE taBool32 taMapLoadContextInit(taMapLoadContext* pLoadContext, taEngin
         maxTextureSize = TA_MAX_TEXTURE_ATLAS_SIZE;
     }
 
-    // We'll need a texture packer to help us pack images into atlases.
-    if (!taTexturePackerInit(&pLoadContext->texturePacker, maxTextureSize, maxTextureSize, 1, 0)) {
+    // We'll need a texture packer to help us pack images into atlases. Feature graphics come in all sorts of sizes so the skyline
+    // packer is used to keep the number of atlases, and therefore texture switches while drawing, down.
+    if (!taTexturePackerInit(&pLoadContext->texturePacker, maxTextureSize, maxTextureSize, 1, TA_TEXTURE_PACKER_FLAG_SKYLINE)) {
         return TA_FALSE;
     }
 
@@ -1095,6 +1178,13 @@ taMapInstance* taLoadMap(taEngineContext* pEngine, const char* mapName)
         return NULL;
     }
 
+    char manifestPath[TA_MAX_PATH];
+    manifestPath[0] = '\0';
+
+    char ioStatsPath[TA_MAX_PATH];
+    ioStatsPath[0] = '\0';
+    taFSIOStatsFormat ioStatsFormat = taFSIOStatsFormatCSV;
+
     taMapInstance* pMap = calloc(1, sizeof(*pMap));
     if (pMap == NULL) {
         taMapLoadContextUninit(&loadContext);
@@ -1111,6 +1201,29 @@ taMapInstance* taLoadMap(taEngineContext* pEngine, const char* mapName)
 
     taMapPackSubTexture(pMap, &loadContext.texturePacker, 16, 16, paletteIndices, &loadContext.paletteTextureSlot);
 
+    // The files read while loading the map are recorded to a manifest. The next time the map is loaded the manifest is used to read
+    // those files ahead of the loader on a background thread. This is off by default. Set openta.fs-map-manifests to true to enable it.
+    if (taPropertyManagerGetBool(&pEngine->properties, "openta.fs-map-manifests")) {
+        if (taPathAppend(manifestPath, sizeof(manifestPath), TA_FS_MANIFEST_DIRECTORY, mapName) && taPathAppendExtension(manifestPath, sizeof(manifestPath), manifestPath, "manifest")) {
+            taFSPrefetchManifest(pEngine->pFS, manifestPath);   // <-- This will fail harmlessly the first time a map is loaded.
+            taFSBeginRecording(pEngine->pFS);
+        } else {
+            manifestPath[0] = '\0';
+        }
+    }
+
+    // The I/O statistics of each file read while loading the map can be written out by setting openta.fs-io-stats to "csv" or "json".
+    const char* ioStatsFormatName = taPropertyManagerGet(&pEngine->properties, "openta.fs-io-stats");
+    if (ioStatsFormatName != NULL && (_stricmp(ioStatsFormatName, "csv") == 0 || _stricmp(ioStatsFormatName, "json") == 0)) {
+        ioStatsFormat = (_stricmp(ioStatsFormatName, "csv") == 0) ? taFSIOStatsFormatCSV : taFSIOStatsFormatJSON;
+        if (!taPathAppend(ioStatsPath, sizeof(ioStatsPath), TA_FS_IO_STATS_DIRECTORY, mapName) ||
+            !taPathAppendExtension(ioStatsPath, sizeof(ioStatsPath), ioStatsPath, (ioStatsFormat == taFSIOStatsFormatCSV) ? "csv" : "json") ||
+            taFSBeginIOStats(pEngine->pFS) != TA_SUCCESS)
+        {
+            ioStatsPath[0] = '\0';
+        }
+    }
+
     if (!taMapLoadTNT(pMap, mapName, &loadContext)) {
         goto on_error;
     }
@@ -1119,9 +1232,22 @@ taMapInstance* taLoadMap(taEngineContext* pEngine, const char* mapName)
         goto on_error;
     }
 
+    // Anything the prefetcher hasn't gotten to by now won't be needed.
+    if (manifestPath[0] != '\0') {
+        taFSCancelPrefetch(pEngine->pFS);
+        taFSEndRecording(pEngine->pFS, manifestPath);
+        manifestPath[0] = '\0';
+    }
+
+    if (ioStatsPath[0] != '\0') {
+        taFSEndIOStats(pEngine->pFS);
+        taFSWriteIOStats(pEngine->pFS, ioStatsPath, ioStatsFormat);
+        ioStatsPath[0] = '\0';
+    }
+
     
     // At the end of loading everything there could be a texture still sitting in the packer which needs to be created.
-    if (loadContext.texturePacker.cursorPosX != 0 || loadContext.texturePacker.cursorPosY != 0) {
+    if (!taTexturePackerIsEmpty(&loadContext.texturePacker)) {
         if (!taMapCreateAndPushTexture(pMap, &loadContext.texturePacker)) {  // <-- This will reset the texture packer.
             goto on_error;
         }
@@ -1133,6 +1259,15 @@ taMapInstance* taLoadMap(taEngineContext* pEngine, const char* mapName)
 
 
 on_error:
+    if (manifestPath[0] != '\0') {
+        taFSCancelPrefetch(pEngine->pFS);
+        taFSEndRecording(pEngine->pFS, NULL);
+    }
+
+    if (ioStatsPath[0] != '\0') {
+        taFSEndIOStats(pEngine->pFS);
+    }
+
     taMapLoadContextUninit(&loadContext);
     taUnloadMap(pMap);
     return NULL;
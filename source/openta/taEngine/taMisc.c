@@ -2,6 +2,434 @@
 
 // This file just contains miscellaneous stuff that doesn't really fit anywhere.
 
+//// CPU Features ////
+
+#if defined(TA_X64) || defined(TA_X86)
+TA_PRIVATE void taCPUID(int info[4], int functionID, int subfunctionID)
+{
+#ifdef _MSC_VER
+    __cpuidex(info, functionID, subfunctionID);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(functionID, subfunctionID, a, b, c, d);
+    info[0] = (int)a;
+    info[1] = (int)b;
+    info[2] = (int)c;
+    info[3] = (int)d;
+#endif
+}
+
+TA_PRIVATE taUInt64 taXGETBV(int index)
+{
+#ifdef _MSC_VER
+    return _xgetbv(index);
+#else
+    taUInt32 lo;
+    taUInt32 hi;
+    __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(index));
+    return ((taUInt64)hi << 32) | lo;
+#endif
+}
+#endif
+
+taBool32 taHasSSE2()
+{
+#if defined(TA_X64)
+    return TA_TRUE;
+#elif defined(TA_X86)
+    int info[4];
+    taCPUID(info, 1, 0);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return TA_FALSE;
+#endif
+}
+
+taBool32 taHasAVX2()
+{
+#if defined(TA_X64) || defined(TA_X86)
+    int info[4];
+    taCPUID(info, 0, 0);
+    if (info[0] < 7) {
+        return TA_FALSE;
+    }
+
+    // The OS needs to be saving the YMM registers on context switches, which is what OSXSAVE and XGETBV are checking for.
+    taCPUID(info, 1, 0);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+        return TA_FALSE;    // No OSXSAVE or no AVX.
+    }
+
+    if ((taXGETBV(0) & 0x06) != 0x06) {
+        return TA_FALSE;
+    }
+
+    taCPUID(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return TA_FALSE;
+#endif
+}
+
+
+//// Hashing ////
+
+#define TA_FNV1A_OFFSET_BASIS   2166136261u
+#define TA_FNV1A_PRIME          16777619u
+
+taUInt32 taHashString(const char* str)
+{
+    taUInt32 hash = TA_FNV1A_OFFSET_BASIS;
+    if (str == NULL) {
+        return hash;
+    }
+
+    while (str[0] != '\0') {
+        hash ^= (taUInt8)str[0];
+        hash *= TA_FNV1A_PRIME;
+        str += 1;
+    }
+
+    return hash;
+}
+
+taUInt32 taHashStringN(const char* str, size_t length)
+{
+    taUInt32 hash = TA_FNV1A_OFFSET_BASIS;
+    if (str == NULL) {
+        return hash;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (taUInt8)str[i];
+        hash *= TA_FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+taUInt32 taHashBytes(const void* pData, size_t dataSize, taUInt32 seed)
+{
+    taUInt32 hash = TA_FNV1A_OFFSET_BASIS ^ seed;
+    if (pData == NULL) {
+        return hash;
+    }
+
+    const taUInt8* pBytes = (const taUInt8*)pData;
+    for (size_t i = 0; i < dataSize; ++i) {
+        hash ^= pBytes[i];
+        hash *= TA_FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+taUInt32 taHashStringCaseInsensitive(const char* str)
+{
+    taUInt32 hash = TA_FNV1A_OFFSET_BASIS;
+    if (str == NULL) {
+        return hash;
+    }
+
+    while (str[0] != '\0') {
+        hash ^= (taUInt8)taToLowerASCII(str[0]);
+        hash *= TA_FNV1A_PRIME;
+        str += 1;
+    }
+
+    return hash;
+}
+
+taUInt32 taHashStringCaseInsensitiveN(const char* str, size_t length)
+{
+    taUInt32 hash = TA_FNV1A_OFFSET_BASIS;
+    if (str == NULL) {
+        return hash;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (taUInt8)taToLowerASCII(str[i]);
+        hash *= TA_FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+
+//// Threading ////
+#ifdef _WIN32
+taUInt32 taGetCPUCount()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    if (info.dwNumberOfProcessors == 0) {
+        return 1;
+    }
+
+    return (taUInt32)info.dwNumberOfProcessors;
+}
+
+taBool32 taCreateThread(taThread* pThread, taThreadEntryProc entryProc, void* pData)
+{
+    *pThread = CreateThread(NULL, 0, entryProc, pData, 0, NULL);
+    return *pThread != NULL;
+}
+
+void taWaitForThread(taThread* pThread)
+{
+    WaitForSingleObject(*pThread, INFINITE);
+    CloseHandle(*pThread);
+}
+
+taBool32 taMutexInit(taMutex* pMutex)
+{
+    InitializeCriticalSection(pMutex);
+    return TA_TRUE;
+}
+
+void taMutexUninit(taMutex* pMutex)
+{
+    DeleteCriticalSection(pMutex);
+}
+
+void taMutexLock(taMutex* pMutex)
+{
+    EnterCriticalSection(pMutex);
+}
+
+void taMutexUnlock(taMutex* pMutex)
+{
+    LeaveCriticalSection(pMutex);
+}
+
+taBool32 taMutexTryLock(taMutex* pMutex)
+{
+    return TryEnterCriticalSection(pMutex) != 0;
+}
+
+taBool32 taSemaphoreInit(taSemaphore* pSemaphore, taUInt32 initialValue)
+{
+    *pSemaphore = CreateSemaphoreA(NULL, (LONG)initialValue, LONG_MAX, NULL);
+    return *pSemaphore != NULL;
+}
+
+void taSemaphoreUninit(taSemaphore* pSemaphore)
+{
+    CloseHandle(*pSemaphore);
+}
+
+void taSemaphoreWait(taSemaphore* pSemaphore)
+{
+    WaitForSingleObject(*pSemaphore, INFINITE);
+}
+
+void taSemaphoreRelease(taSemaphore* pSemaphore)
+{
+    ReleaseSemaphore(*pSemaphore, 1, NULL);
+}
+#else
+taUInt32 taGetCPUCount()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count <= 0) {
+        return 1;
+    }
+
+    return (taUInt32)count;
+}
+
+taBool32 taCreateThread(taThread* pThread, taThreadEntryProc entryProc, void* pData)
+{
+    return pthread_create(pThread, NULL, entryProc, pData) == 0;
+}
+
+void taWaitForThread(taThread* pThread)
+{
+    pthread_join(*pThread, NULL);
+}
+
+taBool32 taMutexInit(taMutex* pMutex)
+{
+    return pthread_mutex_init(pMutex, NULL) == 0;
+}
+
+void taMutexUninit(taMutex* pMutex)
+{
+    pthread_mutex_destroy(pMutex);
+}
+
+void taMutexLock(taMutex* pMutex)
+{
+    pthread_mutex_lock(pMutex);
+}
+
+void taMutexUnlock(taMutex* pMutex)
+{
+    pthread_mutex_unlock(pMutex);
+}
+
+taBool32 taMutexTryLock(taMutex* pMutex)
+{
+    return pthread_mutex_trylock(pMutex) == 0;
+}
+
+taBool32 taSemaphoreInit(taSemaphore* pSemaphore, taUInt32 initialValue)
+{
+    return sem_init(pSemaphore, 0, initialValue) == 0;
+}
+
+void taSemaphoreUninit(taSemaphore* pSemaphore)
+{
+    sem_destroy(pSemaphore);
+}
+
+void taSemaphoreWait(taSemaphore* pSemaphore)
+{
+    while (sem_wait(pSemaphore) != 0) {
+        // Interrupted by a signal. Try again.
+    }
+}
+
+void taSemaphoreRelease(taSemaphore* pSemaphore)
+{
+    sem_post(pSemaphore);
+}
+#endif
+
+
+//// Thread Pool ////
+
+TA_PRIVATE void taThreadPoolRunJobs(taThreadPool* pPool)
+{
+    for (;;) {
+        taUInt32 iJob = taAtomicFetchAdd32(&pPool->nextJob, 1);
+        if (iJob >= pPool->jobCount) {
+            break;
+        }
+
+        pPool->onJob(pPool->pJobUserData, iJob);
+    }
+}
+
+TA_PRIVATE taThreadResult TA_THREADCALL taThreadPoolWorker(void* pData)
+{
+    taThreadPool* pPool = (taThreadPool*)pData;
+    assert(pPool != NULL);
+
+    for (;;) {
+        taSemaphoreWait(&pPool->workSemaphore);
+        if (pPool->isTerminating) {
+            break;
+        }
+
+        taThreadPoolRunJobs(pPool);
+        taSemaphoreRelease(&pPool->doneSemaphore);
+    }
+
+    return (taThreadResult)0;
+}
+
+taBool32 taThreadPoolInit(taThreadPool* pPool, taUInt32 threadCount)
+{
+    if (pPool == NULL) {
+        return TA_FALSE;
+    }
+
+    taZeroObject(pPool);
+
+    if (!taSemaphoreInit(&pPool->workSemaphore, 0)) {
+        return TA_FALSE;
+    }
+
+    if (!taSemaphoreInit(&pPool->doneSemaphore, 0)) {
+        taSemaphoreUninit(&pPool->workSemaphore);
+        return TA_FALSE;
+    }
+
+    if (threadCount > 0) {
+        pPool->pThreads = (taThread*)malloc(threadCount * sizeof(*pPool->pThreads));
+        if (pPool->pThreads == NULL) {
+            taThreadPoolUninit(pPool);
+            return TA_FALSE;
+        }
+
+        // If a thread fails to start we just run with what we have.
+        for (taUInt32 iThread = 0; iThread < threadCount; ++iThread) {
+            if (!taCreateThread(&pPool->pThreads[iThread], taThreadPoolWorker, pPool)) {
+                break;
+            }
+
+            pPool->threadCount += 1;
+        }
+    }
+
+    return TA_TRUE;
+}
+
+void taThreadPoolUninit(taThreadPool* pPool)
+{
+    if (pPool == NULL) {
+        return;
+    }
+
+    pPool->isTerminating = TA_TRUE;
+    for (taUInt32 iThread = 0; iThread < pPool->threadCount; ++iThread) {
+        taSemaphoreRelease(&pPool->workSemaphore);
+    }
+
+    for (taUInt32 iThread = 0; iThread < pPool->threadCount; ++iThread) {
+        taWaitForThread(&pPool->pThreads[iThread]);
+    }
+
+    free(pPool->pThreads);
+    taSemaphoreUninit(&pPool->doneSemaphore);
+    taSemaphoreUninit(&pPool->workSemaphore);
+    taZeroObject(pPool);
+}
+
+void taThreadPoolRun(taThreadPool* pPool, taUInt32 jobCount, taJobProc onJob, void* pUserData)
+{
+    if (onJob == NULL || jobCount == 0) {
+        return;
+    }
+
+    // Run everything on this thread if there's no point waking any workers, or if the pool is already busy. The busy flag is used
+    // rather than a mutex because a job running on the calling thread can end up back here, and a critical section on Windows would
+    // let the same thread straight back in.
+    if (pPool == NULL || pPool->threadCount == 0 || jobCount == 1 || !taAtomicCompareExchange32(&pPool->isBusy, TA_FALSE, TA_TRUE)) {
+        for (taUInt32 iJob = 0; iJob < jobCount; ++iJob) {
+            onJob(pUserData, iJob);
+        }
+
+        return;
+    }
+
+    pPool->onJob = onJob;
+    pPool->pJobUserData = pUserData;
+    pPool->jobCount = jobCount;
+    pPool->nextJob = 0;
+
+    // There's no point waking more workers than there are jobs. The calling thread takes one of the jobs.
+    taUInt32 wakeCount = pPool->threadCount;
+    if (wakeCount > jobCount - 1) {
+        wakeCount = jobCount - 1;
+    }
+
+    for (taUInt32 iThread = 0; iThread < wakeCount; ++iThread) {
+        taSemaphoreRelease(&pPool->workSemaphore);
+    }
+
+    taThreadPoolRunJobs(pPool);
+
+    for (taUInt32 iThread = 0; iThread < wakeCount; ++iThread) {
+        taSemaphoreWait(&pPool->doneSemaphore);
+    }
+
+    taAtomicStore32(&pPool->isBusy, TA_FALSE);
+}
+
+
 //// Memory Stream ////
 
 taMemoryStream taCreateMemoryStream(void* pData, size_t dataSize)
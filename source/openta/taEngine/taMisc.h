@@ -11,6 +11,31 @@
 #include <endian.h>
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define TA_X64
+#elif defined(__i386) || defined(_M_IX86)
+#define TA_X86
+#endif
+
+#if defined(TA_X64) || defined(TA_X86)
+#define TA_SUPPORT_SSE2
+#define TA_SUPPORT_AVX2
+#include <emmintrin.h>
+#include <immintrin.h>
+#if !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+#endif
+
+// Functions using SSE2 or AVX2 intrinsics need to be tagged with these. MSVC does not require it.
+#if defined(TA_SUPPORT_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define TA_TARGET_SSE2 __attribute__((target("sse2")))
+#define TA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TA_TARGET_SSE2
+#define TA_TARGET_AVX2
+#endif
+
 #ifdef _MSC_VER
 #define TA_INLINE __forceinline
 #else
@@ -19,6 +44,19 @@
 
 typedef void (* taProc)(void);
 
+// Returns the index of the lowest set bit. n must not be zero.
+static TA_INLINE unsigned int taBitScanForward32(taUInt32 n)
+{
+    assert(n != 0);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, n);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(n);
+#endif
+}
+
 //// Endian Management ////
 static TA_INLINE taBool32 taIsLittleEndian()
 {
@@ -72,6 +110,181 @@ static TA_INLINE taUInt32 taNextPowerOf2(taUInt32 value)
 #define taAbs(x) (((x) < 0) ? (-(x)) : (x))
 
 
+//// CPU Features ////
+
+// Determines whether or not SSE2 is supported by the CPU. This is always true on 64-bit x86.
+taBool32 taHasSSE2();
+
+// Determines whether or not AVX2 is supported by both the CPU and the OS.
+taBool32 taHasAVX2();
+
+
+//// Hashing ////
+
+// Converts an ASCII character to lower case. Non-ASCII characters are left unmodified.
+static TA_INLINE char taToLowerASCII(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c + ('a' - 'A');
+    }
+
+    return c;
+}
+
+// Hashes a null terminated string using 32-bit FNV-1a.
+taUInt32 taHashString(const char* str);
+
+// Same as taHashString(), except only the first length characters are hashed. The string does not need to be null terminated.
+taUInt32 taHashStringN(const char* str, size_t length);
+
+// Hashes a buffer of bytes using 32-bit FNV-1a. The seed is mixed into the initial state so the same bytes can be given different
+// hashes, such as by seeding with the size of the data the bytes came from.
+taUInt32 taHashBytes(const void* pData, size_t dataSize, taUInt32 seed);
+
+// Same as taHashString(), except ASCII characters are folded to lower case before hashing. Use this for things that TA
+// treats case-insensitively, such as file paths.
+taUInt32 taHashStringCaseInsensitive(const char* str);
+
+// Same as taHashStringCaseInsensitive(), except only the first length characters are hashed. The string does not need to be null
+// terminated. This gives the same result as taHashStringCaseInsensitive() on a string of the same characters.
+taUInt32 taHashStringCaseInsensitiveN(const char* str, size_t length);
+
+
+//// Threading ////
+#ifdef _WIN32
+typedef HANDLE           taThread;
+typedef CRITICAL_SECTION taMutex;
+typedef HANDLE           taSemaphore;
+typedef DWORD            taThreadResult;
+#define TA_THREADCALL    WINAPI
+#else
+typedef pthread_t        taThread;
+typedef pthread_mutex_t  taMutex;
+typedef sem_t            taSemaphore;
+typedef void*            taThreadResult;
+#define TA_THREADCALL
+#endif
+
+typedef taThreadResult (TA_THREADCALL * taThreadEntryProc)(void* pData);
+
+// Retrieves the number of logical processors on the system. This will never return 0.
+taUInt32 taGetCPUCount();
+
+// Creates and starts a new thread.
+taBool32 taCreateThread(taThread* pThread, taThreadEntryProc entryProc, void* pData);
+
+// Waits for the given thread to terminate and then frees it. Every thread created with taCreateThread() must be waited on.
+void taWaitForThread(taThread* pThread);
+
+taBool32 taMutexInit(taMutex* pMutex);
+void taMutexUninit(taMutex* pMutex);
+void taMutexLock(taMutex* pMutex);
+void taMutexUnlock(taMutex* pMutex);
+
+// Locks the mutex only if it's not already locked. Returns TA_TRUE if the mutex was locked. On Windows this also succeeds if the
+// calling thread already owns the mutex.
+taBool32 taMutexTryLock(taMutex* pMutex);
+
+taBool32 taSemaphoreInit(taSemaphore* pSemaphore, taUInt32 initialValue);
+void taSemaphoreUninit(taSemaphore* pSemaphore);
+void taSemaphoreWait(taSemaphore* pSemaphore);
+void taSemaphoreRelease(taSemaphore* pSemaphore);
+
+// Atomically adds a value to a 32-bit integer and returns the value from before the addition.
+static TA_INLINE taUInt32 taAtomicFetchAdd32(volatile taUInt32* pValue, taUInt32 addend)
+{
+#ifdef _MSC_VER
+    return (taUInt32)InterlockedExchangeAdd((volatile LONG*)pValue, (LONG)addend);
+#else
+    return __sync_fetch_and_add(pValue, addend);
+#endif
+}
+
+// Atomically adds a value to a 64-bit integer and returns the value from before the addition.
+static TA_INLINE taUInt64 taAtomicFetchAdd64(volatile taUInt64* pValue, taUInt64 addend)
+{
+#ifdef _MSC_VER
+    return (taUInt64)InterlockedExchangeAdd64((volatile LONG64*)pValue, (LONG64)addend);
+#else
+    return __sync_fetch_and_add(pValue, addend);
+#endif
+}
+
+// Atomically sets a 32-bit integer to <desired>, but only if it's currently equal to <expected>. Returns TA_TRUE if it was set.
+static TA_INLINE taBool32 taAtomicCompareExchange32(volatile taUInt32* pValue, taUInt32 expected, taUInt32 desired)
+{
+#ifdef _MSC_VER
+    return (taUInt32)InterlockedCompareExchange((volatile LONG*)pValue, (LONG)desired, (LONG)expected) == expected;
+#else
+    return __sync_bool_compare_and_swap(pValue, expected, desired);
+#endif
+}
+
+// Atomically reads a 32-bit integer. Nothing after this is read before it.
+static TA_INLINE taUInt32 taAtomicLoad32(volatile taUInt32* pValue)
+{
+#ifdef _MSC_VER
+    return (taUInt32)InterlockedCompareExchange((volatile LONG*)pValue, 0, 0);
+#else
+    return __atomic_load_n(pValue, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// Atomically writes a 32-bit integer. Nothing before this is written after it.
+static TA_INLINE void taAtomicStore32(volatile taUInt32* pValue, taUInt32 value)
+{
+#ifdef _MSC_VER
+    InterlockedExchange((volatile LONG*)pValue, (LONG)value);
+#else
+    __atomic_store_n(pValue, value, __ATOMIC_RELEASE);
+#endif
+}
+
+
+//// Thread Pool ////
+//
+// This is a simple parallel-for style thread pool. A batch of jobs is handed to the pool with taThreadPoolRun() which does not return
+// until every job has been completed. The calling thread takes part in running the jobs.
+
+typedef void (* taJobProc)(void* pUserData, taUInt32 iJob);
+
+typedef struct
+{
+    // The number of worker threads. This does not include the thread calling taThreadPoolRun().
+    taUInt32 threadCount;
+    taThread* pThreads;
+
+    // Only a single batch of jobs can be run at a time. This is set for the duration of taThreadPoolRun() and is accessed atomically.
+    volatile taUInt32 isBusy;
+
+    // Released once for each worker that needs to wake up and start taking jobs.
+    taSemaphore workSemaphore;
+
+    // Released by each worker once it has run out of jobs to take.
+    taSemaphore doneSemaphore;
+
+    // The current batch of jobs.
+    taJobProc onJob;
+    void* pJobUserData;
+    taUInt32 jobCount;
+    volatile taUInt32 nextJob;
+
+    volatile taBool32 isTerminating;
+} taThreadPool;
+
+// Initializes a thread pool with the given number of worker threads. A thread count of 0 is valid, in which case every job is run
+// on the calling thread.
+taBool32 taThreadPoolInit(taThreadPool* pPool, taUInt32 threadCount);
+
+// Uninitializes a thread pool. This must not be called while a batch of jobs is running.
+void taThreadPoolUninit(taThreadPool* pPool);
+
+// Runs onJob for every index in [0, jobCount) and waits for them all to complete. This is thread-safe, but if the pool is already
+// busy with another batch, the jobs will be run serially on the calling thread rather than waiting for the pool to become available.
+// This also makes it safe to call from inside a job.
+void taThreadPoolRun(taThreadPool* pPool, taUInt32 jobCount, taJobProc onJob, void* pUserData);
+
+
 //// Memory Stream ////
 
 typedef struct
@@ -12,58 +12,260 @@ taResult taPropertyManagerUninit(taPropertyManager* pProperties)
 {
     if (pProperties == NULL) return TA_INVALID_ARGS;
 
-    // Only the keys for each property is frees because the value is part of the same allocation.
     for (taUInt32 i = 0; i < pProperties->count; ++i) {
         free(pProperties->pProperties[i].key);
+        free(pProperties->pProperties[i].str);
     }
 
     free(pProperties->pProperties);
+    free(pProperties->pSlots);
     return TA_SUCCESS;
 }
 
 
-taResult taPropertyManagerSet(taPropertyManager* pProperties, const char* key, const char* val)
+TA_PRIVATE taProperty* taPropertyManagerGetPropertyByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
 {
-    if (pProperties == NULL || key == NULL) return TA_INVALID_ARGS;
+    if (pProperties == NULL || handle == 0 || handle > pProperties->count) {
+        return NULL;
+    }
 
-    if (val != NULL) {
-        size_t keyLen = strlen(key);
-        size_t valLen = strlen(val);
+    return &pProperties->pProperties[handle-1];
+}
 
-        taProperty prop;
-        prop.key = (char*)malloc(keyLen+1 + valLen+1); if (prop.key == NULL) return TA_OUT_OF_MEMORY;
-        ta_strcpy_s(prop.key, keyLen+1, key);
+TA_PRIVATE taBool32 taPropertyManagerGrowSlots(taPropertyManager* pProperties)
+{
+    taUInt32 newSlotCount = (pProperties->slotCount == 0) ? 64 : pProperties->slotCount*2;
+    taPropertyHandle* pNewSlots = (taPropertyHandle*)calloc(newSlotCount, sizeof(*pNewSlots));
+    if (pNewSlots == NULL) {
+        return TA_FALSE;
+    }
+
+    taUInt32 mask = newSlotCount - 1;
+    for (taUInt32 i = 0; i < pProperties->count; ++i) {
+        taUInt32 iSlot = pProperties->pProperties[i].keyHash & mask;
+        while (pNewSlots[iSlot] != 0) {
+            iSlot = (iSlot + 1) & mask;
+        }
+
+        pNewSlots[iSlot] = i+1;
+    }
+
+    free(pProperties->pSlots);
+    pProperties->pSlots = pNewSlots;
+    pProperties->slotCount = newSlotCount;
+
+    return TA_TRUE;
+}
+
+// Finds the handle of the property with the given key. If it doesn't exist and <create> is true, a new property is added in an unset
+// state. Returns 0 if the property does not exist, or there isn't enough memory to add it.
+TA_PRIVATE taPropertyHandle taPropertyManagerFind(taPropertyManager* pProperties, const char* key, taBool32 create)
+{
+    assert(pProperties != NULL);
+    assert(key != NULL);
 
-        prop.val = prop.key + keyLen+1;
-        ta_strcpy_s(prop.val, valLen+1, val);
+    taUInt32 keyHash = taHashString(key);
 
-        if (pProperties->capacity == pProperties->count) {
-            taUInt32 newCapacity = (pProperties->capacity == 0) ? 16 : pProperties->capacity*2;
-            taProperty* pNewProperties = (taProperty*)realloc(pProperties->pProperties, newCapacity * sizeof(taProperty));
-            if (pNewProperties == NULL) {
-                return TA_OUT_OF_MEMORY;
+    if (pProperties->slotCount > 0) {
+        taUInt32 mask = pProperties->slotCount - 1;
+        for (taUInt32 iSlot = keyHash & mask; pProperties->pSlots[iSlot] != 0; iSlot = (iSlot + 1) & mask) {
+            taProperty* pProperty = &pProperties->pProperties[pProperties->pSlots[iSlot]-1];
+            if (pProperty->keyHash == keyHash && strcmp(pProperty->key, key) == 0) {
+                return pProperties->pSlots[iSlot];
             }
+        }
+    }
+
+    if (!create) {
+        return 0;
+    }
+
+
+    // It's a new property.
+    if ((pProperties->count+1)*2 > pProperties->slotCount) {
+        if (!taPropertyManagerGrowSlots(pProperties)) {
+            return 0;
+        }
+    }
+
+    if (pProperties->capacity == pProperties->count) {
+        taUInt32 newCapacity = (pProperties->capacity == 0) ? 16 : pProperties->capacity*2;
+        taProperty* pNewProperties = (taProperty*)realloc(pProperties->pProperties, newCapacity * sizeof(taProperty));
+        if (pNewProperties == NULL) {
+            return 0;
+        }
+
+        pProperties->pProperties = pNewProperties;
+        pProperties->capacity = newCapacity;
+    }
+
+    size_t keyLen = strlen(key);
+
+    taProperty prop;
+    taZeroObject(&prop);
+    prop.key = (char*)malloc(keyLen+1); if (prop.key == NULL) return 0;
+    ta_strcpy_s(prop.key, keyLen+1, key);
+    prop.keyHash = keyHash;
+    prop.type = TA_PROPERTY_TYPE_NONE;
+
+    assert(pProperties->capacity > pProperties->count);
+    pProperties->pProperties[pProperties->count] = prop;
+    pProperties->count += 1;
+
+    taUInt32 mask = pProperties->slotCount - 1;
+    taUInt32 iSlot = keyHash & mask;
+    while (pProperties->pSlots[iSlot] != 0) {
+        iSlot = (iSlot + 1) & mask;
+    }
 
-            pProperties->pProperties = pNewProperties;
-            pProperties->capacity = newCapacity;
+    pProperties->pSlots[iSlot] = pProperties->count;
+    return pProperties->count;
+}
+
+// Makes sure the string of a property can hold a string of the given length. The old contents are not preserved.
+TA_PRIVATE taBool32 taPropertyReserveString(taProperty* pProperty, size_t len)
+{
+    if (len+1 <= pProperty->strCapacity) {
+        return TA_TRUE;
+    }
+
+    size_t newCapacity = (len+1 < 16) ? 16 : len+1;
+    char* pNewStr = (char*)malloc(newCapacity);
+    if (pNewStr == NULL) {
+        return TA_FALSE;
+    }
+
+    free(pProperty->str);
+    pProperty->str = pNewStr;
+    pProperty->strCapacity = (taUInt32)newCapacity;
+
+    return TA_TRUE;
+}
+
+// Retrieves the string of a property, converting it from its native type if necessary.
+TA_PRIVATE const char* taPropertyGetString(taProperty* pProperty)
+{
+    if (pProperty == NULL || pProperty->type == TA_PROPERTY_TYPE_NONE) {
+        return NULL;
+    }
+
+    if (!pProperty->isStrValid) {
+        char valStr[64];
+        switch (pProperty->type)
+        {
+            case TA_PROPERTY_TYPE_INT:   snprintf(valStr, sizeof(valStr), "%d", pProperty->value.i); break;
+            case TA_PROPERTY_TYPE_FLOAT: snprintf(valStr, sizeof(valStr), "%f", pProperty->value.f); break;
+            case TA_PROPERTY_TYPE_BOOL:  ta_strcpy_s(valStr, sizeof(valStr), (pProperty->value.b) ? "true" : "false"); break;
+            default: return NULL;
         }
 
-        assert(pProperties->capacity > pProperties->count);
-        pProperties->pProperties[pProperties->count] = prop;
-        pProperties->count += 1;
+        if (!taPropertyReserveString(pProperty, strlen(valStr))) {
+            return NULL;
+        }
+
+        ta_strcpy_s(pProperty->str, pProperty->strCapacity, valStr);
+        pProperty->isStrValid = TA_TRUE;
+    }
+
+    return pProperty->str;
+}
+
+TA_PRIVATE int taPropertyGetInt(taProperty* pProperty)
+{
+    if (pProperty == NULL) {
+        return 0;
+    }
+
+    switch (pProperty->type)
+    {
+        case TA_PROPERTY_TYPE_STRING: return atoi(pProperty->str);
+        case TA_PROPERTY_TYPE_INT:    return pProperty->value.i;
+        case TA_PROPERTY_TYPE_FLOAT:  return (int)pProperty->value.f;
+        case TA_PROPERTY_TYPE_BOOL:   return (pProperty->value.b) ? 1 : 0;
+        default: return 0;
+    }
+}
+
+TA_PRIVATE float taPropertyGetFloat(taProperty* pProperty)
+{
+    if (pProperty == NULL) {
+        return 0;
+    }
+
+    switch (pProperty->type)
+    {
+        case TA_PROPERTY_TYPE_STRING: return (float)atof(pProperty->str);
+        case TA_PROPERTY_TYPE_INT:    return (float)pProperty->value.i;
+        case TA_PROPERTY_TYPE_FLOAT:  return pProperty->value.f;
+        case TA_PROPERTY_TYPE_BOOL:   return (pProperty->value.b) ? 1.0f : 0.0f;
+        default: return 0;
+    }
+}
+
+TA_PRIVATE taBool32 taPropertyGetBool(taProperty* pProperty)
+{
+    if (pProperty == NULL) {
+        return TA_FALSE;
+    }
+
+    switch (pProperty->type)
+    {
+        case TA_PROPERTY_TYPE_STRING: return !((pProperty->str[0] == '0' && pProperty->str[1] == '\0') || _stricmp(pProperty->str, "false") == 0);
+        case TA_PROPERTY_TYPE_INT:    return pProperty->value.i != 0;
+        case TA_PROPERTY_TYPE_FLOAT:  return pProperty->value.f != 0;
+        case TA_PROPERTY_TYPE_BOOL:   return pProperty->value.b;
+        default: return TA_FALSE;
+    }
+}
+
+// Sets the native value of a property. The string is regenerated the next time it's needed.
+TA_PRIVATE taResult taPropertyManagerSetValue(taPropertyManager* pProperties, const char* key, taUInt32 type, taInt32 i, float f)
+{
+    if (pProperties == NULL || key == NULL) return TA_INVALID_ARGS;
+
+    taProperty* pProperty = taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_TRUE));
+    if (pProperty == NULL) {
+        return TA_OUT_OF_MEMORY;
+    }
+
+    pProperty->type = type;
+    pProperty->isStrValid = TA_FALSE;
+    if (type == TA_PROPERTY_TYPE_FLOAT) {
+        pProperty->value.f = f;
+    } else {
+        pProperty->value.i = i;
+    }
+
+    return TA_SUCCESS;
+}
+
+
+taResult taPropertyManagerSet(taPropertyManager* pProperties, const char* key, const char* val)
+{
+    if (pProperties == NULL || key == NULL) return TA_INVALID_ARGS;
+
+    if (val != NULL) {
+        taProperty* pProperty = taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_TRUE));
+        if (pProperty == NULL) {
+            return TA_OUT_OF_MEMORY;
+        }
+
+        // The existing string is reused if the new value fits.
+        if (!taPropertyReserveString(pProperty, strlen(val))) {
+            return TA_OUT_OF_MEMORY;
+        }
+
+        ta_strcpy_s(pProperty->str, pProperty->strCapacity, val);
+        pProperty->type = TA_PROPERTY_TYPE_STRING;
+        pProperty->isStrValid = TA_TRUE;
 
         return TA_SUCCESS;
     } else {
-        // The key is being unset so just clear it.
-        for (taUInt32 i = 0; i < pProperties->count; ++i) {
-            if (strcmp(pProperties->pProperties[i].key, key) == 0) {
-                for (taUInt32 j = i; j < pProperties->count-1; ++j) {
-                    pProperties->pProperties[j] = pProperties->pProperties[j+1];
-                }
-
-                pProperties->count -= 1;
-                break;
-            }
+        // The key is being unset so just clear it. The property itself stays in the table so handles to it remain valid.
+        taProperty* pProperty = taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_FALSE));
+        if (pProperty != NULL) {
+            pProperty->type = TA_PROPERTY_TYPE_NONE;
+            pProperty->isStrValid = TA_FALSE;
         }
 
         return TA_SUCCESS;
@@ -72,17 +274,17 @@ taResult taPropertyManagerSet(taPropertyManager* pProperties, const char* key, c
 
 taResult taPropertyManagerSetInt(taPropertyManager* pProperties, const char* key, int val)
 {
-    char valStr[16];
-    if (_itoa_s(val, valStr, sizeof(valStr), 10) != 0) {
-        return TA_ERROR;
-    }
+    return taPropertyManagerSetValue(pProperties, key, TA_PROPERTY_TYPE_INT, val, 0);
+}
 
-    return taPropertyManagerSet(pProperties, key, valStr);
+taResult taPropertyManagerSetFloat(taPropertyManager* pProperties, const char* key, float val)
+{
+    return taPropertyManagerSetValue(pProperties, key, TA_PROPERTY_TYPE_FLOAT, 0, val);
 }
 
 taResult taPropertyManagerSetBool(taPropertyManager* pProperties, const char* key, taBool32 val)
 {
-    return taPropertyManagerSet(pProperties, key, (val) ? "true" : "false");
+    return taPropertyManagerSetValue(pProperties, key, TA_PROPERTY_TYPE_BOOL, (val) ? TA_TRUE : TA_FALSE, 0);
 }
 
 taResult taPropertyManagerUnset(taPropertyManager* pProperties, const char* key)
@@ -94,14 +296,7 @@ const char* taPropertyManagerGet(taPropertyManager* pProperties, const char* key
 {
     if (pProperties == NULL || key == NULL) return NULL;
 
-    for (taUInt32 i = 0; i < pProperties->count; ++i) {
-        if (strcmp(pProperties->pProperties[i].key, key) == 0) {
-            return pProperties->pProperties[i].val;
-        }
-    }
-
-    // Property does not exist.
-    return NULL;
+    return taPropertyGetString(taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_FALSE)));
 }
 
 const char* taPropertyManagerGetV(taPropertyManager* pProperties, const char* key, va_list args)
@@ -126,4 +321,63 @@ const char* taPropertyManagerGetF(taPropertyManager* pProperties, const char* ke
 
     va_end(args);
     return str;
-}
\ No newline at end of file
+}
+
+int taPropertyManagerGetInt(taPropertyManager* pProperties, const char* key)
+{
+    if (pProperties == NULL || key == NULL) return 0;
+
+    return taPropertyGetInt(taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_FALSE)));
+}
+
+float taPropertyManagerGetFloat(taPropertyManager* pProperties, const char* key)
+{
+    if (pProperties == NULL || key == NULL) return 0;
+
+    return taPropertyGetFloat(taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_FALSE)));
+}
+
+taBool32 taPropertyManagerGetBool(taPropertyManager* pProperties, const char* key)
+{
+    if (pProperties == NULL || key == NULL) return TA_FALSE;
+
+    return taPropertyGetBool(taPropertyManagerGetPropertyByHandle(pProperties, taPropertyManagerFind(pProperties, key, TA_FALSE)));
+}
+
+
+taPropertyHandle taPropertyManagerGetHandle(taPropertyManager* pProperties, const char* key)
+{
+    if (pProperties == NULL || key == NULL) return 0;
+
+    return taPropertyManagerFind(pProperties, key, TA_TRUE);
+}
+
+taUInt32 taPropertyManagerGetTypeByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
+{
+    taProperty* pProperty = taPropertyManagerGetPropertyByHandle(pProperties, handle);
+    if (pProperty == NULL) {
+        return TA_PROPERTY_TYPE_NONE;
+    }
+
+    return pProperty->type;
+}
+
+const char* taPropertyManagerGetByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
+{
+    return taPropertyGetString(taPropertyManagerGetPropertyByHandle(pProperties, handle));
+}
+
+int taPropertyManagerGetIntByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
+{
+    return taPropertyGetInt(taPropertyManagerGetPropertyByHandle(pProperties, handle));
+}
+
+float taPropertyManagerGetFloatByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
+{
+    return taPropertyGetFloat(taPropertyManagerGetPropertyByHandle(pProperties, handle));
+}
+
+taBool32 taPropertyManagerGetBoolByHandle(taPropertyManager* pProperties, taPropertyHandle handle)
+{
+    return taPropertyGetBool(taPropertyManagerGetPropertyByHandle(pProperties, handle));
+}
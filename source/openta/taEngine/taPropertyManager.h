@@ -1,34 +1,85 @@
 // Copyright (C) 2018 David Reid. See included LICENSE file.
 
-// TODO: This needs an almost complete re-implementation:
-// - Add support for changing the value of existing keys.
-// - Add support for non-string values: numbers, booleans, strings
+// Properties are stored with their native type. Integers, floats and booleans are only converted to a string when they're retrieved
+// with taPropertyManagerGet(), and strings are only parsed when they're retrieved with one of the typed getters.
+//
+// Properties are found with an open-addressed hash table. A property that's needed often, such as every frame, can be looked up once
+// with taPropertyManagerGetHandle() and then retrieved with the *ByHandle() functions which skip the lookup entirely.
+
+#define TA_PROPERTY_TYPE_NONE   0   // <-- The property is not set.
+#define TA_PROPERTY_TYPE_STRING 1
+#define TA_PROPERTY_TYPE_INT    2
+#define TA_PROPERTY_TYPE_FLOAT  3
+#define TA_PROPERTY_TYPE_BOOL   4
+
+// A handle to a property. Handles remain valid for the lifetime of the property manager, even if the property is unset and then set
+// again. 0 is never a valid handle.
+typedef taUInt32 taPropertyHandle;
 
 typedef struct
 {
-    // The key and value is stored in the same memory allocation. The value is stored just after
-    // the null terminator of the key.
+    // The key is owned by the property. Properties are never removed once they've been added which is what keeps handles stable.
+    // Unsetting a property just sets its type to TA_PROPERTY_TYPE_NONE.
     char* key;
-    char* val;
+    taUInt32 keyHash;
+    taUInt32 type;
+
+    union
+    {
+        taInt32 i;
+        float f;
+        taBool32 b;
+    } value;
+
+    // The value as a string. For string properties this is the value itself. For other types this is filled in by
+    // taPropertyManagerGet() when it's first needed.
+    char* str;
+    taUInt32 strCapacity;
+    taBool32 isStrValid;
 } taProperty;
 
 typedef struct
 {
-    // TODO: This can be improved. It's currently just a simple variable-length array, but the memory
-    // management should be able to be improved a bit here.
+    // The properties in the order they were added. A handle is an index into this list, plus one.
     taUInt32 count;
     taUInt32 capacity;
     taProperty* pProperties;
+
+    // The hash table. Each slot is the handle of a property, or 0 if the slot is empty. This is kept at most half full.
+    taUInt32 slotCount;
+    taPropertyHandle* pSlots;
 } taPropertyManager;
 
 taResult taPropertyManagerInit(taPropertyManager* pProperties);
 taResult taPropertyManagerUninit(taPropertyManager* pProperties);
 
+// Setting a property that already exists replaces its value and type in place. Setting a string property to NULL unsets it.
 taResult taPropertyManagerSet(taPropertyManager* pProperties, const char* key, const char* val);
 taResult taPropertyManagerSetInt(taPropertyManager* pProperties, const char* key, int val);
+taResult taPropertyManagerSetFloat(taPropertyManager* pProperties, const char* key, float val);
 taResult taPropertyManagerSetBool(taPropertyManager* pProperties, const char* key, taBool32 val);
 taResult taPropertyManagerUnset(taPropertyManager* pProperties, const char* key);
 
+// Retrieves a property as a string. Returns NULL if the property is not set. The returned pointer can become invalid when the
+// property is changed.
 const char* taPropertyManagerGet(taPropertyManager* pProperties, const char* key);
 const char* taPropertyManagerGetV(taPropertyManager* pProperties, const char* key, va_list args);
 const char* taPropertyManagerGetF(taPropertyManager* pProperties, const char* key, ...);
+
+// Retrieves a property as a specific type, converting it if necessary. These return 0 (or false) if the property is not set. A string
+// is false if it's "0" or "false", and true otherwise.
+int taPropertyManagerGetInt(taPropertyManager* pProperties, const char* key);
+float taPropertyManagerGetFloat(taPropertyManager* pProperties, const char* key);
+taBool32 taPropertyManagerGetBool(taPropertyManager* pProperties, const char* key);
+
+
+// Retrieves a handle to the property with the given key. The property does not need to be set. Returns 0 if there isn't enough memory.
+taPropertyHandle taPropertyManagerGetHandle(taPropertyManager* pProperties, const char* key);
+
+// Retrieves the type of the property. This is TA_PROPERTY_TYPE_NONE if it's not set.
+taUInt32 taPropertyManagerGetTypeByHandle(taPropertyManager* pProperties, taPropertyHandle handle);
+
+const char* taPropertyManagerGetByHandle(taPropertyManager* pProperties, taPropertyHandle handle);
+int taPropertyManagerGetIntByHandle(taPropertyManager* pProperties, taPropertyHandle handle);
+float taPropertyManagerGetFloatByHandle(taPropertyManager* pProperties, taPropertyHandle handle);
+taBool32 taPropertyManagerGetBoolByHandle(taPropertyManager* pProperties, taPropertyHandle handle);
@@ -1,20 +1,11 @@
 // Copyright (C) 2018 David Reid. See included LICENSE file.
 
-TA_PRIVATE taBool32 taTexturePackerFindSlot(taTexturePacker* pPacker, taUInt16 width, taUInt16 height, taUInt16* pPosXOut, taUInt16* pPosYOut)
+TA_PRIVATE taBool32 taTexturePackerFindSlot_Row(taTexturePacker* pPacker, taUInt16 outerWidth, taUInt16 outerHeight, taUInt16 edge, taUInt16* pPosXOut, taUInt16* pPosYOut)
 {
     assert(pPacker != NULL);
     assert(pPosXOut != NULL);
     assert(pPosYOut != NULL);
 
-    taUInt16 edge = (pPacker->flags & (TA_TEXTURE_PACKER_FLAG_HARD_EDGE | TA_TEXTURE_PACKER_FLAG_TRANSPARENT_EDGE)) ? 1 : 0;
-    taUInt16 outerWidth  = width  + (edge*2);
-    taUInt16 outerHeight = height + (edge*2);
-
-    if (outerWidth > pPacker->width || outerHeight > pPacker->height) {
-        return TA_FALSE;
-    }
-
-
     // Finding a slot is fairly straight forward. There's just a cursor that runs along the x and y axis and we just try to place
     // the image such that the top left of it is sitting on that point.
 
@@ -66,6 +57,160 @@ TA_PRIVATE taBool32 taTexturePackerFindSlot(taTexturePacker* pPacker, taUInt16 w
     }
 }
 
+// Determines where an image would sit if its left edge was placed at the start of the given skyline node. The image rests on the
+// highest node underneath it. Returns TA_FALSE if the image would stick out of the atlas.
+TA_PRIVATE taBool32 taTexturePackerSkylineFit(const taTexturePacker* pPacker, taUInt32 iNode, taUInt16 outerWidth, taUInt16 outerHeight, taUInt16* pPosYOut)
+{
+    const taTexturePackerSkylineNode* pNode = &pPacker->pSkyline[iNode];
+    if ((taUInt32)pNode->posX + outerWidth > pPacker->width) {
+        return TA_FALSE;
+    }
+
+    taUInt16 posY = 0;
+    taInt32 widthLeft = outerWidth;
+    while (widthLeft > 0) {
+        assert(iNode < pPacker->skylineNodeCount);  // <-- Can't happen because the nodes cover the whole width of the atlas.
+
+        if (posY < pPacker->pSkyline[iNode].posY) {
+            posY = pPacker->pSkyline[iNode].posY;
+        }
+
+        if ((taUInt32)posY + outerHeight > pPacker->height) {
+            return TA_FALSE;
+        }
+
+        widthLeft -= pPacker->pSkyline[iNode].width;
+        iNode += 1;
+    }
+
+    *pPosYOut = posY;
+    return TA_TRUE;
+}
+
+TA_PRIVATE taBool32 taTexturePackerFindSlot_Skyline(taTexturePacker* pPacker, taUInt16 outerWidth, taUInt16 outerHeight, taUInt16 edge, taUInt16* pPosXOut, taUInt16* pPosYOut)
+{
+    assert(pPacker != NULL);
+    assert(pPacker->pSkyline != NULL);
+    assert(pPosXOut != NULL);
+    assert(pPosYOut != NULL);
+
+    // An empty image doesn't take up any room so there's no need to touch the skyline.
+    if (outerWidth == 0 || outerHeight == 0) {
+        *pPosXOut = edge;
+        *pPosYOut = edge;
+        return TA_TRUE;
+    }
+
+    // The image goes where its bottom edge is lowest. Ties go to the narrowest node so that wide gaps are kept for wide images.
+    taUInt32 bestNode   = (taUInt32)-1;
+    taUInt32 bestBottom = 0xFFFFFFFF;
+    taUInt32 bestWidth  = 0xFFFFFFFF;
+    taUInt16 bestPosY   = 0;
+    for (taUInt32 iNode = 0; iNode < pPacker->skylineNodeCount; ++iNode) {
+        taUInt16 posY;
+        if (taTexturePackerSkylineFit(pPacker, iNode, outerWidth, outerHeight, &posY)) {
+            taUInt32 bottom = (taUInt32)posY + outerHeight;
+            if (bottom < bestBottom || (bottom == bestBottom && pPacker->pSkyline[iNode].width < bestWidth)) {
+                bestNode   = iNode;
+                bestBottom = bottom;
+                bestWidth  = pPacker->pSkyline[iNode].width;
+                bestPosY   = posY;
+            }
+        }
+    }
+
+    if (bestNode == (taUInt32)-1) {
+        return TA_FALSE;    // <-- It doesn't fit anywhere.
+    }
+
+
+    // The image becomes a new node sitting on top of the nodes underneath it. Those nodes are shortened or removed.
+    taTexturePackerSkylineNode newNode;
+    newNode.posX  = pPacker->pSkyline[bestNode].posX;
+    newNode.posY  = (taUInt16)bestBottom;
+    newNode.width = outerWidth;
+
+    assert(pPacker->skylineNodeCount < (taUInt32)pPacker->width + 1);
+    memmove(pPacker->pSkyline + bestNode + 1, pPacker->pSkyline + bestNode, (pPacker->skylineNodeCount - bestNode) * sizeof(*pPacker->pSkyline));
+    pPacker->pSkyline[bestNode] = newNode;
+    pPacker->skylineNodeCount += 1;
+
+    taUInt32 newNodeEndX = (taUInt32)newNode.posX + newNode.width;
+    while (bestNode+1 < pPacker->skylineNodeCount) {
+        taTexturePackerSkylineNode* pNode = &pPacker->pSkyline[bestNode+1];
+        if (pNode->posX >= newNodeEndX) {
+            break;
+        }
+
+        taUInt32 nodeEndX = (taUInt32)pNode->posX + pNode->width;
+        if (nodeEndX <= newNodeEndX) {
+            // The node is completely covered.
+            memmove(pNode, pNode + 1, (pPacker->skylineNodeCount - (bestNode+2)) * sizeof(*pPacker->pSkyline));
+            pPacker->skylineNodeCount -= 1;
+        } else {
+            pNode->width = (taUInt16)(nodeEndX - newNodeEndX);
+            pNode->posX  = (taUInt16)newNodeEndX;
+            break;
+        }
+    }
+
+    // Neighbouring nodes at the same height are merged to keep the list short.
+    for (taUInt32 iNode = 0; iNode+1 < pPacker->skylineNodeCount; /* DO NOTHING */) {
+        if (pPacker->pSkyline[iNode].posY == pPacker->pSkyline[iNode+1].posY) {
+            pPacker->pSkyline[iNode].width += pPacker->pSkyline[iNode+1].width;
+            memmove(pPacker->pSkyline + iNode + 1, pPacker->pSkyline + iNode + 2, (pPacker->skylineNodeCount - (iNode+2)) * sizeof(*pPacker->pSkyline));
+            pPacker->skylineNodeCount -= 1;
+        } else {
+            iNode += 1;
+        }
+    }
+
+    *pPosXOut = newNode.posX + edge;
+    *pPosYOut = bestPosY + edge;
+    return TA_TRUE;
+}
+
+TA_PRIVATE void taTexturePackerResetSkyline(taTexturePacker* pPacker)
+{
+    if (pPacker->pSkyline == NULL) {
+        return;
+    }
+
+    pPacker->pSkyline[0].posX  = 0;
+    pPacker->pSkyline[0].posY  = 0;
+    pPacker->pSkyline[0].width = pPacker->width;
+    pPacker->skylineNodeCount = 1;
+}
+
+TA_PRIVATE taBool32 taTexturePackerFindSlot(taTexturePacker* pPacker, taUInt16 width, taUInt16 height, taUInt16* pPosXOut, taUInt16* pPosYOut)
+{
+    assert(pPacker != NULL);
+    assert(pPosXOut != NULL);
+    assert(pPosYOut != NULL);
+
+    taUInt16 edge = (pPacker->flags & (TA_TEXTURE_PACKER_FLAG_HARD_EDGE | TA_TEXTURE_PACKER_FLAG_TRANSPARENT_EDGE)) ? 1 : 0;
+    taUInt32 outerWidth  = (taUInt32)width  + (edge*2);
+    taUInt32 outerHeight = (taUInt32)height + (edge*2);
+
+    if (outerWidth > pPacker->width || outerHeight > pPacker->height) {
+        return TA_FALSE;
+    }
+
+    taBool32 result;
+    if (pPacker->flags & TA_TEXTURE_PACKER_FLAG_SKYLINE) {
+        result = taTexturePackerFindSlot_Skyline(pPacker, (taUInt16)outerWidth, (taUInt16)outerHeight, edge, pPosXOut, pPosYOut);
+    } else {
+        result = taTexturePackerFindSlot_Row(pPacker, (taUInt16)outerWidth, (taUInt16)outerHeight, edge, pPosXOut, pPosYOut);
+    }
+
+    if (result) {
+        pPacker->subTextureCount += 1;
+        pPacker->usedArea += outerWidth * outerHeight;
+    }
+
+    return result;
+}
+
 TA_PRIVATE taBool32 taTexturePackerCopyImageData(taTexturePacker* pPacker, const taTexturePackerSlot* pSlot, const taUInt8* pSubTextureData)
 {
     assert(pPacker != NULL);
@@ -133,6 +278,16 @@ taBool32 taTexturePackerInit(taTexturePacker* pPacker, taUInt16 width, taUInt16
         return TA_FALSE;
     }
 
+    if (pPacker->flags & TA_TEXTURE_PACKER_FLAG_SKYLINE) {
+        pPacker->pSkyline = (taTexturePackerSkylineNode*)malloc(((taUInt32)width + 1) * sizeof(*pPacker->pSkyline));
+        if (pPacker->pSkyline == NULL) {
+            free(pPacker->pImageData);
+            return TA_FALSE;
+        }
+
+        taTexturePackerResetSkyline(pPacker);
+    }
+
     if (pPacker->bpp == 1) {
         memset(pPacker->pImageData, TA_TRANSPARENT_COLOR, pPacker->width * pPacker->height * pPacker->bpp);
     } else {
@@ -148,6 +303,7 @@ void taTexturePackerUninit(taTexturePacker* pPacker)
         return;
     }
 
+    free(pPacker->pSkyline);
     free(pPacker->pImageData);
 }
 
@@ -160,6 +316,10 @@ void taTexturePackerReset(taTexturePacker* pPacker)
     pPacker->cursorPosX = 0;
     pPacker->cursorPosY = 0;
     pPacker->currentRowHeight = 0;
+    taTexturePackerResetSkyline(pPacker);
+
+    pPacker->subTextureCount = 0;
+    pPacker->usedArea = 0;
 
     // Clear the image data to transparency.
     if (pPacker->bpp == 1) {
@@ -197,5 +357,12 @@ taBool32 taTexturePackerPackSubTexture(taTexturePacker* pPacker, taUInt16 width,
 taBool32 taTexturePackerIsEmpty(const taTexturePacker* pPacker)
 {
     if (pPacker == NULL) return TA_FALSE;
-    return pPacker->cursorPosX == 0 && pPacker->cursorPosY;
+    return pPacker->subTextureCount == 0;
 }
+
+float taTexturePackerGetOccupancy(const taTexturePacker* pPacker)
+{
+    if (pPacker == NULL || pPacker->width == 0 || pPacker->height == 0) return 0;
+    return (float)pPacker->usedArea / ((taUInt32)pPacker->width * pPacker->height);
+}
+
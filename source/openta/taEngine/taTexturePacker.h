@@ -21,9 +21,24 @@
 // and precision errors with UV coordinates. One was of handling this is to put an extra pixel
 // around each sub-texture which can be used to emulate clamping. To enable this, set the
 // TA_TEXTURE_PACKER_FLAG_HARD_EDGE option flag.
+//
+// The row cursor wastes whatever is left at the end of each row, and everything above the shortest image in a row. When fewer
+// atlases are more important than speed, set the TA_TEXTURE_PACKER_FLAG_SKYLINE option flag. This tracks the top edge of everything
+// that has been packed so far (the "skyline") as a list of horizontal segments, and places each image on the segment that leaves its
+// bottom edge as low as possible. This fills in the gaps the row cursor leaves behind at the cost of a search through the segments
+// for each image.
 
 #define TA_TEXTURE_PACKER_FLAG_HARD_EDGE        (1 << 0)
 #define TA_TEXTURE_PACKER_FLAG_TRANSPARENT_EDGE (1 << 1)
+#define TA_TEXTURE_PACKER_FLAG_SKYLINE          (1 << 2)
+
+// A horizontal segment of the skyline. Used with TA_TEXTURE_PACKER_FLAG_SKYLINE.
+typedef struct
+{
+    taUInt16 posX;
+    taUInt16 posY;
+    taUInt16 width;
+} taTexturePackerSkylineNode;
 
 typedef struct
 {
@@ -47,6 +62,16 @@ typedef struct
     // The height of the current row.
     taUInt16 currentRowHeight;
 
+    // The segments of the skyline, from left to right. These are only used with TA_TEXTURE_PACKER_FLAG_SKYLINE, in which case the
+    // cursors are not used. There can never be more segments than there are pixels across the atlas.
+    taUInt32 skylineNodeCount;
+    taTexturePackerSkylineNode* pSkyline;
+
+
+    // The number of sub-textures packed since the last reset, and the number of pixels they take up, including edges.
+    taUInt32 subTextureCount;
+    taUInt32 usedArea;
+
 
     // The buffer containing the packed image data.
     taUInt8* pImageData;
@@ -76,3 +101,6 @@ taBool32 taTexturePackerPackSubTexture(taTexturePacker* pPacker, taUInt16 width,
 
 // Determines if the texture packer is empty or not.
 taBool32 taTexturePackerIsEmpty(const taTexturePacker* pPacker);
+
+// Retrieves the fraction of the atlas that's taken up by sub-textures, between 0 and 1. This is useful for comparing packing modes.
+float taTexturePackerGetOccupancy(const taTexturePacker* pPacker);
@@ -6,13 +6,17 @@
 void taGameOnStep(taEngineContext* pEngine);
 void taGameOnLoadProperties(taEngineContext* pEngine, taPropertyManager* pProperties);
 
+// The key for "GlobalHeader/missionname" in OTA files. This is looked up a lot when sorting maps so it's hashed ahead of time. This
+// is initialized in taCreateGame().
+TA_PRIVATE taConfigKey g_taMissionNameKey;
+
 TA_PRIVATE int taQuickSortCallbackMap(const void* a, const void* b)
 {
     const taConfigObj** ppOTA_0 = (const taConfigObj**)a;
     const taConfigObj** ppOTA_1 = (const taConfigObj**)b;
 
-    const char* name0 = taConfigGetString(*ppOTA_0, "GlobalHeader/missionname");
-    const char* name1 = taConfigGetString(*ppOTA_1, "GlobalHeader/missionname");
+    const char* name0 = taConfigGetStringByKey(*ppOTA_0, &g_taMissionNameKey);
+    const char* name1 = taConfigGetStringByKey(*ppOTA_1, &g_taMissionNameKey);
 
     return _stricmp(name0, name1);
 }
@@ -310,6 +314,10 @@ taGame* taCreateGame(int argc, char** argv)
     // - Save memory by converting OTA data to a struct rather than just holding a pointer to the taConfigObj.
     //
     // Grab the maps for skirmish and multiplayer.
+    taConfigKey schemaTypeKey;
+    taConfigInitKey(&schemaTypeKey, "GlobalHeader/Schema 0/Type", 0);
+    taConfigInitKey(&g_taMissionNameKey, "GlobalHeader/missionname", 0);
+
     taFSIterator* pIter = taFSBegin(pGame->engine.pFS, "maps", TA_FALSE);
     do
     {
@@ -318,7 +326,7 @@ taGame* taCreateGame(int argc, char** argv)
         if (taPathExtensionEqual(pIter->fileInfo.relativePath, "ota")) {
             taConfigObj* pOTA = taParseConfigFromFile(pGame->engine.pFS, pIter->fileInfo.relativePath);
             if (pOTA != NULL) {
-                const char* type = taConfigGetString(pOTA, "GlobalHeader/Schema 0/Type");
+                const char* type = taConfigGetStringByKey(pOTA, &schemaTypeKey);
                 if (type != NULL && _stricmp(type, "Network 1") == 0) {
                     stb_sb_push(pGame->ppMPMaps, pOTA);
                     printf("MP Map: %s\n", pIter->fileInfo.relativePath);
@@ -339,7 +347,7 @@ taGame* taCreateGame(int argc, char** argv)
     if (taGUIFindGadgetByName(&pGame->selectMapDialog, "MAPNAMES", &iMapListGadget)) {
         const char** ppMPMapNames = (const char**)malloc(stb_sb_count(pGame->ppMPMaps) * sizeof(*ppMPMapNames));
         for (int i = 0; i < stb_sb_count(pGame->ppMPMaps); ++i) {
-            ppMPMapNames[i] = taConfigGetString(pGame->ppMPMaps[i], "GlobalHeader/missionname");
+            ppMPMapNames[i] = taConfigGetStringByKey(pGame->ppMPMaps[i], &g_taMissionNameKey);
         }
 
         taGUISetListboxItems(&pGame->selectMapDialog.pGadgets[iMapListGadget], ppMPMapNames, stb_sb_count(pGame->ppMPMaps));
@@ -391,21 +399,17 @@ taResult taSetProperty(taGame* pGame, const char* key, const char* value)
 
 taResult taSetPropertyInt(taGame* pGame, const char* key, taInt32 value)
 {
-    char valueStr[256];
-    snprintf(valueStr, sizeof(valueStr), "%d", value);
-    return taSetProperty(pGame, key, valueStr);
+    return taPropertyManagerSetInt(&pGame->engine.properties, key, value);
 }
 
 taResult taSetPropertyFloat(taGame* pGame, const char* key, float value)
 {
-    char valueStr[256];
-    snprintf(valueStr, sizeof(valueStr), "%f", value);
-    return taSetProperty(pGame, key, valueStr);
+    return taPropertyManagerSetFloat(&pGame->engine.properties, key, value);
 }
 
 taResult taSetPropertyBool(taGame* pGame, const char* key, taBool32 value)
 {
-    return taSetProperty(pGame, key, value ? "1" : "0");
+    return taPropertyManagerSetBool(&pGame->engine.properties, key, value);
 }
 
 
@@ -427,36 +431,43 @@ const char* taGetPropertyF(taGame* pGame, const char* key, ...)
 
 taInt32 taGetPropertyInt(taGame* pGame, const char* key)
 {
-    const char* valueStr = taGetProperty(pGame, key);
-    if (valueStr == NULL) {
-        return 0;
-    }
-
-    return atoi(valueStr);
+    return taPropertyManagerGetInt(&pGame->engine.properties, key);
 }
 
 float taGetPropertyFloat(taGame* pGame, const char* key)
 {
-    const char* valueStr = taGetProperty(pGame, key);
-    if (valueStr == NULL) {
-        return 0;
-    }
-
-    return (float)atof(valueStr);
+    return taPropertyManagerGetFloat(&pGame->engine.properties, key);
 }
 
 taBool32 taGetPropertyBool(taGame* pGame, const char* key)
 {
-    const char* valueStr = taGetProperty(pGame, key);
-    if (valueStr == NULL) {
-        return TA_FALSE;
-    }
+    return taPropertyManagerGetBool(&pGame->engine.properties, key);
+}
 
-    if ((key[0] == '0' && key[1] == '\0') || _stricmp(key, "false") == 0) {
-        return TA_FALSE;
-    }
 
-    return TA_TRUE;
+taPropertyHandle taGetPropertyHandle(taGame* pGame, const char* key)
+{
+    return taPropertyManagerGetHandle(&pGame->engine.properties, key);
+}
+
+const char* taGetPropertyByHandle(taGame* pGame, taPropertyHandle handle)
+{
+    return taPropertyManagerGetByHandle(&pGame->engine.properties, handle);
+}
+
+taInt32 taGetPropertyIntByHandle(taGame* pGame, taPropertyHandle handle)
+{
+    return taPropertyManagerGetIntByHandle(&pGame->engine.properties, handle);
+}
+
+float taGetPropertyFloatByHandle(taGame* pGame, taPropertyHandle handle)
+{
+    return taPropertyManagerGetFloatByHandle(&pGame->engine.properties, handle);
+}
+
+taBool32 taGetPropertyBoolByHandle(taGame* pGame, taPropertyHandle handle)
+{
+    return taPropertyManagerGetBoolByHandle(&pGame->engine.properties, handle);
 }
 
 
@@ -83,6 +83,14 @@ taInt32 taGetPropertyInt(taGame* pGame, const char* key);
 float taGetPropertyFloat(taGame* pGame, const char* key);
 taBool32 taGetPropertyBool(taGame* pGame, const char* key);
 
+// Retrieves a handle to a global property for properties that are read often, such as every frame. The handle remains valid for the
+// lifetime of the game, and the property does not need to be set.
+taPropertyHandle taGetPropertyHandle(taGame* pGame, const char* key);
+const char* taGetPropertyByHandle(taGame* pGame, taPropertyHandle handle);
+taInt32 taGetPropertyIntByHandle(taGame* pGame, taPropertyHandle handle);
+float taGetPropertyFloatByHandle(taGame* pGame, taPropertyHandle handle);
+taBool32 taGetPropertyBoolByHandle(taGame* pGame, taPropertyHandle handle);
+
 
 // Runs the given game.
 int taGameRun(taGame* pGame);
@@ -0,0 +1,55 @@
+// Copyright (C) 2018 David Reid. See included LICENSE file.
+
+// The entry point for the pack tool. Like taMain.c, this is the only compiled file for the entire tool.
+//
+// This writes a pack of pre-decompressed files for the file system to mount at startup. It needs to be placed in the same directory
+// as the game's archives, and needs to be run again whenever an archive is added or changed (files from changed archives will simply
+// be loaded from the archive like normal until then).
+//
+// Usage: taPack [pattern...]
+//
+// Each pattern is either the relative path of a file, or a directory followed by "*.ext". If no patterns are specified, the files
+// that are loaded at startup are packed.
+
+#include "taEngine/taEngine.c"
+
+TA_PRIVATE const char* g_DefaultPackPatterns[] = {
+    "palettes/*.pal",
+    "anims/hattfont11.gaf",
+    "anims/hattfont12.gaf",
+    "anims/commongui.gaf",
+    "features/*.tdf",
+    "textures/*.gaf"
+};
+
+int main(int argc, char** argv)
+{
+    taFS* pFS = taCreateFileSystem();
+    if (pFS == NULL) {
+        printf("Failed to create the file system. Make sure taPack is in the same directory as the game's archives.\n");
+        return TA_ERROR;
+    }
+
+    const char** ppPatterns = g_DefaultPackPatterns;
+    taUInt32 patternCount = (taUInt32)taCountOf(g_DefaultPackPatterns);
+    if (argc > 1) {
+        ppPatterns = (const char**)argv + 1;
+        patternCount = (taUInt32)argc - 1;
+    }
+
+    char packFilePath[TA_MAX_PATH];
+    if (!taPathAppend(packFilePath, sizeof(packFilePath), pFS->rootDir, TA_FS_PACK_FILE_NAME)) {
+        taDeleteFileSystem(pFS);
+        return TA_ERROR;
+    }
+
+    taResult result = taFSWritePack(pFS, packFilePath, ppPatterns, patternCount);
+    if (result != TA_SUCCESS) {
+        printf("Failed to write %s.\n", packFilePath);
+    } else {
+        printf("Wrote %s.\n", packFilePath);
+    }
+
+    taDeleteFileSystem(pFS);
+    return result;
+}
@@ -0,0 +1,155 @@
+// Copyright (C) 2018 David Reid. See included LICENSE file.
+
+// The entry point for the repack tool. Like taMain.c, this is the only compiled file for the entire tool.
+//
+// This rewrites archives so that they're faster to load. It needs to be placed in the same directory as the game's archives. The
+// new archives are written to the "repacked" directory, and need to be copied over the originals by hand. The manifests recorded by
+// taLoadMap() decide which files are hot, so it's best to play a few maps before running this.
+//
+// Usage: taRepack [-level <1-9>] [-threshold <bytes>] [-manifest <path>]... [archive...]
+//
+// -level is the zlib compression level for files that are compressed. -threshold is the size at or below which hot files are stored
+// uncompressed. -manifest adds a manifest, relative to the root directory, to use in addition to the ones found in the manifests
+// directory. If no archives are specified, every archive is repacked.
+
+#include "taEngine/taEngine.c"
+
+#define TA_REPACK_OUTPUT_DIRECTORY  "repacked"
+
+TA_PRIVATE taBool32 taRepackPushManifestPath(char (** ppManifestPaths)[TA_MAX_PATH], taUInt32* pManifestCount, taUInt32* pManifestCapacity, const char* manifestPath)
+{
+    if (*pManifestCount == *pManifestCapacity) {
+        taUInt32 newCapacity = (*pManifestCapacity == 0) ? 16 : *pManifestCapacity*2;
+        char (* pNewManifestPaths)[TA_MAX_PATH] = realloc(*ppManifestPaths, newCapacity * sizeof(*pNewManifestPaths));
+        if (pNewManifestPaths == NULL) {
+            return TA_FALSE;
+        }
+
+        *ppManifestPaths = pNewManifestPaths;
+        *pManifestCapacity = newCapacity;
+    }
+
+    if (strcpy_s((*ppManifestPaths)[*pManifestCount], TA_MAX_PATH, manifestPath) != 0) {
+        return TA_TRUE; // <-- The path is too long. Skip it.
+    }
+
+    *pManifestCount += 1;
+    return TA_TRUE;
+}
+
+int main(int argc, char** argv)
+{
+    taFS* pFS = taCreateFileSystem();
+    if (pFS == NULL) {
+        printf("Failed to create the file system. Make sure taRepack is in the same directory as the game's archives.\n");
+        return TA_ERROR;
+    }
+
+    taFSRepackOptions options;
+    taZeroObject(&options);
+    options.uncompressedSizeThreshold = TA_FS_REPACK_DEFAULT_UNCOMPRESSED_SIZE_THRESHOLD;
+    options.compressionLevel          = TA_FS_REPACK_DEFAULT_COMPRESSION_LEVEL;
+
+    const char** ppArchivePaths = (const char**)malloc(((argc > 1) ? argc : 1) * sizeof(*ppArchivePaths));
+    if (ppArchivePaths == NULL) {
+        taDeleteFileSystem(pFS);
+        return TA_OUT_OF_MEMORY;
+    }
+
+    // Manifests given on the command line go first in the list of manifests.
+    char (* pManifestPaths)[TA_MAX_PATH] = NULL;
+    taUInt32 manifestCapacity = 0;
+
+    taUInt32 archiveCount = 0;
+    for (int iArg = 1; iArg < argc; ++iArg) {
+        if (strcmp(argv[iArg], "-level") == 0 && iArg+1 < argc) {
+            options.compressionLevel = atoi(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-threshold") == 0 && iArg+1 < argc) {
+            options.uncompressedSizeThreshold = (taUInt32)atoi(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-manifest") == 0 && iArg+1 < argc) {
+            taRepackPushManifestPath(&pManifestPaths, &options.manifestCount, &manifestCapacity, argv[++iArg]);
+        } else {
+            ppArchivePaths[archiveCount++] = argv[iArg];
+        }
+    }
+
+    if (archiveCount == 0) {
+        const char** ppNewArchivePaths = (const char**)realloc(ppArchivePaths, ((pFS->archiveCount > 0) ? pFS->archiveCount : 1) * sizeof(*ppArchivePaths));
+        if (ppNewArchivePaths == NULL) {
+            free(ppArchivePaths);
+            taDeleteFileSystem(pFS);
+            return TA_OUT_OF_MEMORY;
+        }
+
+        ppArchivePaths = ppNewArchivePaths;
+
+        for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+            ppArchivePaths[archiveCount++] = pFS->pArchives[iArchive].relativePath;
+        }
+    }
+
+
+    // The hot files are taken from every manifest. Only manifests sitting on the real file system are used.
+    taFSIterator* pIter = taFSBegin(pFS, TA_FS_MANIFEST_DIRECTORY, TA_FALSE);
+    while (taFSNext(pIter)) {
+        if (pIter->fileInfo.isDirectory || pIter->fileInfo.archiveRelativePath[0] != '\0' || !taPathExtensionEqual(pIter->fileInfo.relativePath, "manifest")) {
+            continue;
+        }
+
+        if (!taRepackPushManifestPath(&pManifestPaths, &options.manifestCount, &manifestCapacity, pIter->fileInfo.relativePath)) {
+            break;  // <-- Just use the manifests we have so far.
+        }
+    }
+    taFSEnd(pIter);
+
+    const char** ppManifestPaths = (const char**)malloc(((options.manifestCount > 0) ? options.manifestCount : 1) * sizeof(*ppManifestPaths));
+    if (ppManifestPaths == NULL) {
+        free(pManifestPaths);
+        free(ppArchivePaths);
+        taDeleteFileSystem(pFS);
+        return TA_OUT_OF_MEMORY;
+    }
+
+    for (taUInt32 iManifest = 0; iManifest < options.manifestCount; ++iManifest) {
+        ppManifestPaths[iManifest] = pManifestPaths[iManifest];
+    }
+    options.ppManifestPaths = ppManifestPaths;
+
+    if (options.manifestCount == 0) {
+        printf("No manifests were found. Every small file will be stored uncompressed.\n");
+    }
+
+
+    char outputDirectoryPath[TA_MAX_PATH];
+    taResult result = TA_SUCCESS;
+    if (!taPathAppend(outputDirectoryPath, sizeof(outputDirectoryPath), pFS->rootDir, TA_REPACK_OUTPUT_DIRECTORY)) {
+        result = TA_ERROR;
+    } else {
+#ifdef _WIN32
+        CreateDirectoryA(outputDirectoryPath, NULL);
+#else
+        mkdir(outputDirectoryPath, 0777);
+#endif
+    }
+
+    for (taUInt32 iArchive = 0; iArchive < archiveCount && result == TA_SUCCESS; ++iArchive) {
+        char outputFilePath[TA_MAX_PATH];
+        if (!taPathAppend(outputFilePath, sizeof(outputFilePath), outputDirectoryPath, ppArchivePaths[iArchive])) {
+            result = TA_ERROR;
+            break;
+        }
+
+        result = taFSRepackArchive(pFS, ppArchivePaths[iArchive], outputFilePath, &options);
+        if (result != TA_SUCCESS) {
+            printf("Failed to repack %s.\n", ppArchivePaths[iArchive]);
+        } else {
+            printf("Wrote %s.\n", outputFilePath);
+        }
+    }
+
+    free(ppManifestPaths);
+    free(pManifestPaths);
+    free(ppArchivePaths);
+    taDeleteFileSystem(pFS);
+    return result;
+}
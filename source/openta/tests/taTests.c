@@ -0,0 +1,2297 @@
+// Copyright (C) 2018 David Reid. See included LICENSE file.
+
+// The entry point for the engine's self tests. Like taMain.c, this is the only compiled file for the entire program.
+//
+// These check the optimized code paths against their simple reference versions on randomly generated input, and time them. The file
+// system tests use the archives in the program's directory, like the game does, and are skipped if there aren't any.
+//
+// Usage: taTests [-seed <n>] [-iterations <n>] [-bench] [test...]
+//
+// If no tests are specified, every test is run. -bench also prints the throughput of each code path. The return value is the number
+// of failed checks.
+
+#include "../taEngine/taEngine.c"
+
+typedef struct
+{
+    taUInt32 seed;
+    taUInt32 iterations;
+    taBool32 bench;
+    taUInt32 failCount;
+} taTestContext;
+
+typedef void (* taTestProc)(taTestContext* pContext);
+
+// A simple xorshift generator so the results are the same on every platform for a given seed.
+TA_PRIVATE taUInt32 taTestRandom(taTestContext* pContext)
+{
+    taUInt32 x = pContext->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pContext->seed = x;
+    return x;
+}
+
+TA_PRIVATE taUInt32 taTestRandomRange(taTestContext* pContext, taUInt32 count)
+{
+    return (count > 0) ? taTestRandom(pContext) % count : 0;
+}
+
+TA_PRIVATE size_t taTestMin(size_t a, size_t b)
+{
+    return (a < b) ? a : b;
+}
+
+TA_PRIVATE void taTestFail(taTestContext* pContext, const char* format, ...)
+{
+    pContext->failCount += 1;
+
+    // Only the first few failures are printed so a broken code path doesn't flood the output.
+    if (pContext->failCount <= 20) {
+        va_list args;
+        va_start(args, format);
+        printf("  FAIL: ");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+    }
+}
+
+TA_PRIVATE void taTestPrintThroughput(const char* name, size_t bytesProcessed, double seconds)
+{
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+
+    printf("  %-24s %8.1f MB/s\n", name, (bytesProcessed / (1024.0*1024.0)) / seconds);
+}
+
+
+//// HPI Decryption ////
+
+// Each vectorized decryption routine is compared against the byte loop with random sizes, buffer alignments, keys and starting
+// positions, both in place and as a copy.
+typedef struct
+{
+    const char* name;
+    taHPIDecryptProc proc;
+} taTestDecryptProc;
+
+TA_PRIVATE taUInt32 taTestGetDecryptProcs(taTestDecryptProc* pProcs)
+{
+    taUInt32 count = 0;
+    pProcs[count].name = "scalar"; pProcs[count].proc = taHPIDecrypt_Scalar; count += 1;
+#if defined(TA_SUPPORT_SSE2)
+    if (taHasSSE2()) {
+        pProcs[count].name = "sse2"; pProcs[count].proc = taHPIDecrypt_SSE2; count += 1;
+    }
+#endif
+#if defined(TA_SUPPORT_AVX2)
+    if (taHasAVX2()) {
+        pProcs[count].name = "avx2"; pProcs[count].proc = taHPIDecrypt_AVX2; count += 1;
+    }
+#endif
+
+    return count;
+}
+
+TA_PRIVATE void taTestDecrypt(taTestContext* pContext)
+{
+    taTestDecryptProc procs[3];
+    taUInt32 procCount = taTestGetDecryptProcs(procs);
+
+    const size_t maxSize = 4096;
+    taUInt8* pSrc      = (taUInt8*)malloc(maxSize + 64);
+    taUInt8* pExpected = (taUInt8*)malloc(maxSize + 64);
+    taUInt8* pActual   = (taUInt8*)malloc(maxSize + 64);
+    if (pSrc == NULL || pExpected == NULL || pActual == NULL) {
+        taTestFail(pContext, "out of memory");
+        goto done;
+    }
+
+    for (taUInt32 iIteration = 0; iIteration < pContext->iterations; ++iIteration) {
+        // Small sizes are the interesting ones since they exercise the tails.
+        size_t size = (taTestRandomRange(pContext, 4) == 0) ? taTestRandomRange(pContext, (taUInt32)maxSize + 1) : taTestRandomRange(pContext, 100);
+        size_t srcAlign = taTestRandomRange(pContext, 32);
+        size_t dstAlign = taTestRandomRange(pContext, 32);
+        taUInt32 key = taTestRandom(pContext);
+        taUInt32 pos = taTestRandom(pContext);
+        if (key == 0) {
+            key = 1;
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            pSrc[srcAlign + i] = (taUInt8)taTestRandom(pContext);
+        }
+
+        taHPIDecrypt_Scalar(pExpected, pSrc + srcAlign, size, key, pos);
+
+        for (taUInt32 iProc = 1; iProc < procCount; ++iProc) {
+            // Copy. The bytes either side of the destination must not be touched.
+            memset(pActual, 0xCD, maxSize + 64);
+            procs[iProc].proc(pActual + dstAlign, pSrc + srcAlign, size, key, pos);
+            if (memcmp(pActual + dstAlign, pExpected, size) != 0 || (dstAlign > 0 && pActual[dstAlign-1] != 0xCD) || pActual[dstAlign + size] != 0xCD) {
+                taTestFail(pContext, "decrypt %s: copy differs (size=%u srcAlign=%u dstAlign=%u key=0x%08X pos=0x%08X)", procs[iProc].name, (unsigned int)size, (unsigned int)srcAlign, (unsigned int)dstAlign, key, pos);
+            }
+
+            // In place.
+            memcpy(pActual + srcAlign, pSrc + srcAlign, size);
+            procs[iProc].proc(pActual + srcAlign, pActual + srcAlign, size, key, pos);
+            if (memcmp(pActual + srcAlign, pExpected, size) != 0) {
+                taTestFail(pContext, "decrypt %s: in place differs (size=%u align=%u key=0x%08X pos=0x%08X)", procs[iProc].name, (unsigned int)size, (unsigned int)srcAlign, key, pos);
+            }
+        }
+    }
+
+    if (pContext->bench) {
+        const size_t benchSize = 16*1024*1024;
+        taUInt8* pBench = (taUInt8*)malloc(benchSize);
+        if (pBench != NULL) {
+            memset(pBench, 0x5A, benchSize);
+            for (taUInt32 iProc = 0; iProc < procCount; ++iProc) {
+                taTimer timer;
+                taTimerInit(&timer);
+                for (int iRep = 0; iRep < 8; ++iRep) {
+                    procs[iProc].proc(pBench, pBench, benchSize, 0x7D, iRep);
+                }
+                taTestPrintThroughput(procs[iProc].name, benchSize*8, taTimerTick(&timer));
+            }
+
+            free(pBench);
+        }
+    }
+
+done:
+    free(pSrc);
+    free(pExpected);
+    free(pActual);
+}
+
+//// HPI LZ77 ////
+
+// The reference decoder is the straightforward version which keeps an explicit 4096 byte window, the way the format is described.
+// It decodes at most outputCapacity bytes and returns TA_FALSE if the data is corrupt or doesn't fit.
+TA_PRIVATE taBool32 taTestLZ77Reference(const taUInt8* pIn, size_t inputSize, taUInt8* pOut, size_t outputCapacity, size_t* pOutputSize)
+{
+    const taUInt8* pInEnd = pIn + inputSize;
+    taUInt8 window[4096];
+    unsigned int iWindow = 1;
+    size_t outputSize = 0;
+
+    memset(window, 0, sizeof(window));
+    *pOutputSize = 0;
+
+    while (pIn < pInEnd) {
+        unsigned int tag = *pIn++;
+        for (unsigned int iBit = 0; iBit < 8 && pIn < pInEnd; ++iBit) {
+            if ((tag & (1 << iBit)) == 0) {
+                if (outputSize == outputCapacity) {
+                    return TA_FALSE;
+                }
+
+                pOut[outputSize++] = *pIn;
+                window[iWindow] = *pIn++;
+                iWindow = (iWindow + 1) & 0xFFF;
+            } else {
+                if ((pInEnd - pIn) < 2) {
+                    return TA_FALSE;
+                }
+
+                unsigned int offset = (pIn[1] << 4) | (pIn[0] >> 4);
+                unsigned int length = (pIn[0] & 0x0F) + 2;
+                pIn += 2;
+
+                if (offset == 0) {
+                    *pOutputSize = outputSize;
+                    return TA_TRUE;
+                }
+
+                if (outputCapacity - outputSize < length) {
+                    return TA_FALSE;
+                }
+
+                for (unsigned int i = 0; i < length; ++i) {
+                    pOut[outputSize++] = window[offset];
+                    window[iWindow] = window[offset];
+                    iWindow = (iWindow + 1) & 0xFFF;
+                    offset  = (offset  + 1) & 0xFFF;
+                }
+            }
+        }
+    }
+
+    *pOutputSize = outputSize;
+    return TA_TRUE;
+}
+
+// A greedy encoder for generating valid streams from known data. It only needs to be correct, not good. pOut needs to be at least
+// dataSize + dataSize/8 + 3 bytes.
+TA_PRIVATE size_t taTestLZ77Encode(const taUInt8* pData, size_t dataSize, taUInt8* pOut)
+{
+    static int recent[1 << 12];    // <-- The most recent position of each 3 byte hash.
+    for (size_t i = 0; i < taCountOf(recent); ++i) {
+        recent[i] = -1;
+    }
+
+    size_t outputSize = 0;
+    size_t tagPos = 0;
+    unsigned int itemCount = 0;
+    size_t iData = 0;
+    for (;;) {
+        if ((itemCount % 8) == 0) {
+            tagPos = outputSize;
+            pOut[outputSize++] = 0;
+        }
+
+        if (iData == dataSize) {
+            // Terminator.
+            pOut[tagPos] |= (taUInt8)(1 << (itemCount % 8));
+            pOut[outputSize++] = 0;
+            pOut[outputSize++] = 0;
+            break;
+        }
+
+        size_t matchSrc = 0;
+        size_t matchLength = 0;
+        if (iData + 2 < dataSize) {
+            unsigned int hash = ((pData[iData] << 8) ^ (pData[iData+1] << 4) ^ pData[iData+2]) & 0xFFF;
+            int src = recent[hash];
+            recent[hash] = (int)iData;
+
+            // The window position of a byte is its index plus one, and position 0 can't be referenced since it means the end.
+            if (src >= 0 && iData - src < 4000 && ((src + 1) & 0xFFF) != 0) {
+                while (matchLength < 17 && iData + matchLength < dataSize && pData[src + matchLength] == pData[iData + matchLength]) {
+                    matchLength += 1;
+                }
+                matchSrc = (size_t)src;
+            }
+        }
+
+        if (matchLength >= 2) {
+            unsigned int offset = (unsigned int)((matchSrc + 1) & 0xFFF);
+            pOut[tagPos] |= (taUInt8)(1 << (itemCount % 8));
+            pOut[outputSize++] = (taUInt8)(((offset & 0x0F) << 4) | (matchLength - 2));
+            pOut[outputSize++] = (taUInt8)(offset >> 4);
+            iData += matchLength;
+        } else {
+            pOut[outputSize++] = pData[iData++];
+        }
+
+        itemCount += 1;
+    }
+
+    return outputSize;
+}
+
+// Generates data with a configurable amount of repetition so both literals and back references get exercised.
+TA_PRIVATE void taTestLZ77GenerateData(taTestContext* pContext, taUInt8* pData, size_t dataSize, unsigned int alphabetSize)
+{
+    for (size_t i = 0; i < dataSize; ++i) {
+        pData[i] = (taTestRandomRange(pContext, 7) == 0) ? (taUInt8)taTestRandom(pContext) : (taUInt8)taTestRandomRange(pContext, alphabetSize);
+    }
+}
+
+// Generates a random stream of tokens. Unlike the encoder this makes references into parts of the window that haven't been written
+// yet, which a real archive may do at the start of a chunk.
+TA_PRIVATE size_t taTestLZ77GenerateTokens(taTestContext* pContext, taUInt8* pOut, unsigned int itemCount)
+{
+    size_t outputSize = 0;
+    size_t tagPos = 0;
+    for (unsigned int iItem = 0; iItem <= itemCount; ++iItem) {
+        if ((iItem % 8) == 0) {
+            tagPos = outputSize;
+            pOut[outputSize++] = 0;
+        }
+
+        if (iItem == itemCount) {
+            // Terminator, but not always. The input may also just end.
+            if (taTestRandomRange(pContext, 4) != 0) {
+                pOut[tagPos] |= (taUInt8)(1 << (iItem % 8));
+                pOut[outputSize++] = 0;
+                pOut[outputSize++] = 0;
+            }
+            break;
+        }
+
+        if (taTestRandomRange(pContext, 3) == 0) {
+            pOut[outputSize++] = (taUInt8)taTestRandom(pContext);
+        } else {
+            unsigned int offset = 1 + taTestRandomRange(pContext, 4095);
+            unsigned int length = 2 + taTestRandomRange(pContext, 16);
+            pOut[tagPos] |= (taUInt8)(1 << (iItem % 8));
+            pOut[outputSize++] = (taUInt8)(((offset & 0x0F) << 4) | (length - 2));
+            pOut[outputSize++] = (taUInt8)(offset >> 4);
+        }
+    }
+
+    return outputSize;
+}
+
+TA_PRIVATE void taTestLZ77Bench(taTestContext* pContext, const char* name, const taUInt8* pData, size_t dataSize)
+{
+    // Archives compress files in 64K chunks so that's what is timed.
+    const size_t chunkSize = 65536;
+    size_t chunkCount = (dataSize + chunkSize - 1) / chunkSize;
+
+    taUInt8* pCompressed = (taUInt8*)malloc(dataSize + dataSize/8 + chunkCount*3);
+    size_t* pChunkOffsets = (size_t*)malloc((chunkCount + 1) * sizeof(*pChunkOffsets));
+    taUInt8* pOut = (taUInt8*)malloc(dataSize);
+    if (pCompressed == NULL || pChunkOffsets == NULL || pOut == NULL) {
+        taTestFail(pContext, "out of memory");
+        goto done;
+    }
+
+    pChunkOffsets[0] = 0;
+    for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+        size_t thisChunkSize = taTestMin(chunkSize, dataSize - iChunk*chunkSize);
+        pChunkOffsets[iChunk+1] = pChunkOffsets[iChunk] + taTestLZ77Encode(pData + iChunk*chunkSize, thisChunkSize, pCompressed + pChunkOffsets[iChunk]);
+    }
+
+    const int repetitionCount = 20;
+    double seconds[2];
+    for (int iDecoder = 0; iDecoder < 2; ++iDecoder) {
+        taTimer timer;
+        taTimerInit(&timer);
+        for (int iRep = 0; iRep < repetitionCount; ++iRep) {
+            for (size_t iChunk = 0; iChunk < chunkCount; ++iChunk) {
+                size_t thisChunkSize = taTestMin(chunkSize, dataSize - iChunk*chunkSize);
+                const taUInt8* pChunk = pCompressed + pChunkOffsets[iChunk];
+                size_t chunkCompressedSize = pChunkOffsets[iChunk+1] - pChunkOffsets[iChunk];
+                if (iDecoder == 0) {
+                    size_t outputSize;
+                    taTestLZ77Reference(pChunk, chunkCompressedSize, pOut + iChunk*chunkSize, thisChunkSize, &outputSize);
+                } else {
+                    taHPIDecompressLZ77(pChunk, (taUInt32)chunkCompressedSize, pOut + iChunk*chunkSize, (taUInt32)thisChunkSize);
+                }
+            }
+        }
+        seconds[iDecoder] = taTimerTick(&timer);
+    }
+
+    if (memcmp(pOut, pData, dataSize) != 0) {
+        taTestFail(pContext, "lz77: %s did not round trip", name);
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s (reference)", name);
+    taTestPrintThroughput(label, dataSize*repetitionCount, seconds[0]);
+    taTestPrintThroughput(name, dataSize*repetitionCount, seconds[1]);
+
+done:
+    free(pCompressed);
+    free(pChunkOffsets);
+    free(pOut);
+}
+
+// Round trips random data through the encoder, and compares the decoder against the reference decoder on random and mutated
+// streams. Every buffer is allocated at its exact size so an address sanitizer catches any overrun.
+TA_PRIVATE void taTestLZ77(taTestContext* pContext)
+{
+    const size_t maxDataSize = 20000;
+    const size_t maxStreamSize = 8192 + maxDataSize + maxDataSize/8 + 3;
+    const size_t maxOutputSize = 65536;
+
+    taUInt8* pData     = (taUInt8*)malloc(maxDataSize);
+    taUInt8* pStream   = (taUInt8*)malloc(maxStreamSize);
+    taUInt8* pExpected = (taUInt8*)malloc(maxOutputSize);
+    if (pData == NULL || pStream == NULL || pExpected == NULL) {
+        taTestFail(pContext, "out of memory");
+        goto done;
+    }
+
+    for (taUInt32 iIteration = 0; iIteration < pContext->iterations; ++iIteration) {
+        size_t streamSize;
+        if ((iIteration % 2) == 0) {
+            size_t dataSize = 1 + taTestRandomRange(pContext, (taUInt32)maxDataSize);
+            taTestLZ77GenerateData(pContext, pData, dataSize, 1 + taTestRandomRange(pContext, 8));
+            streamSize = taTestLZ77Encode(pData, dataSize, pStream);
+
+            taUInt8* pOut = (taUInt8*)malloc(dataSize);
+            if (pOut == NULL) {
+                taTestFail(pContext, "out of memory");
+                goto done;
+            }
+
+            if (!taHPIDecompressLZ77(pStream, (taUInt32)streamSize, pOut, (taUInt32)dataSize) || memcmp(pOut, pData, dataSize) != 0) {
+                taTestFail(pContext, "lz77: round trip failed (iteration=%u size=%u)", iIteration, (unsigned int)dataSize);
+            }
+
+            free(pOut);
+        } else {
+            streamSize = taTestLZ77GenerateTokens(pContext, pStream, 1 + taTestRandomRange(pContext, 800));
+        }
+
+        // Corrupt some of the streams by flipping a byte or truncating them.
+        switch (taTestRandomRange(pContext, 4)) {
+            case 1: pStream[taTestRandomRange(pContext, (taUInt32)streamSize)] ^= (taUInt8)(1 + taTestRandomRange(pContext, 255)); break;
+            case 2: streamSize = 1 + taTestRandomRange(pContext, (taUInt32)streamSize); break;
+            default: break;
+        }
+
+        // Usually the output size is what the stream actually decodes to, but sometimes it's wrong which must be detected.
+        size_t outputSize;
+        if (!taTestLZ77Reference(pStream, streamSize, pExpected, maxOutputSize, &outputSize) || taTestRandomRange(pContext, 4) == 0) {
+            outputSize = taTestRandomRange(pContext, (taUInt32)maxOutputSize);
+        }
+
+        taUInt8* pIn  = (taUInt8*)malloc(streamSize);
+        taUInt8* pOut = (taUInt8*)malloc(outputSize > 0 ? outputSize : 1);
+        if (pIn == NULL || pOut == NULL) {
+            free(pIn);
+            free(pOut);
+            taTestFail(pContext, "out of memory");
+            goto done;
+        }
+
+        memcpy(pIn, pStream, streamSize);
+
+        size_t expectedSize;
+        taBool32 expectedResult = taTestLZ77Reference(pIn, streamSize, pExpected, outputSize, &expectedSize) && expectedSize == outputSize;
+        taBool32 actualResult   = taHPIDecompressLZ77(pIn, (taUInt32)streamSize, pOut, (taUInt32)outputSize);
+        if (expectedResult != actualResult || (expectedResult && memcmp(pOut, pExpected, outputSize) != 0)) {
+            taTestFail(pContext, "lz77: differs from the reference (iteration=%u streamSize=%u outputSize=%u expected=%u actual=%u)", iIteration, (unsigned int)streamSize, (unsigned int)outputSize, expectedResult, actualResult);
+        }
+
+        free(pIn);
+        free(pOut);
+    }
+
+    if (pContext->bench) {
+        const size_t benchSize = 1024*1024;
+        taUInt8* pBench = (taUInt8*)malloc(benchSize);
+        if (pBench != NULL) {
+            // Text, like TDF and FBI files.
+            const char* words[] = {"[UNITINFO]\r\n", "{\r\n", "}\r\n", "\tName=", "\tDescription=", "\tObject=", "footprintx=2;", "footprintz=2;", "armsolar", "corlab", "energymake=20;"};
+            for (size_t i = 0; i < benchSize; ) {
+                const char* word = words[taTestRandomRange(pContext, taCountOf(words))];
+                size_t wordLength = taTestMin(strlen(word), benchSize - i);
+                memcpy(pBench + i, word, wordLength);
+                i += wordLength;
+            }
+            taTestLZ77Bench(pContext, "text", pBench, benchSize);
+
+            // Palette indices with runs of transparency, like GAF frames.
+            for (size_t i = 0; i < benchSize; ) {
+                size_t runLength = taTestMin(1 + taTestRandomRange(pContext, 60), benchSize - i);
+                taUInt8 base = (taUInt8)taTestRandomRange(pContext, 240);
+                taBool32 isTransparent = taTestRandomRange(pContext, 3) == 0;
+                for (size_t j = 0; j < runLength; ++j) {
+                    pBench[i++] = isTransparent ? TA_TRANSPARENT_COLOR : (taUInt8)(base + taTestRandomRange(pContext, 4));
+                }
+            }
+            taTestLZ77Bench(pContext, "image", pBench, benchSize);
+
+            // Incompressible.
+            for (size_t i = 0; i < benchSize; ++i) {
+                pBench[i] = (taUInt8)taTestRandom(pContext);
+            }
+            taTestLZ77Bench(pContext, "random", pBench, benchSize);
+
+            free(pBench);
+        }
+    }
+
+done:
+    free(pData);
+    free(pStream);
+    free(pExpected);
+}
+
+//// Config Parsing ////
+
+// A growable buffer for recording what a parser produced so two parsers can be compared with a memcmp().
+typedef struct
+{
+    char* pData;
+    size_t size;
+    size_t capacity;
+} taTestBuffer;
+
+TA_PRIVATE void taTestBufferAppend(taTestBuffer* pBuffer, const void* pData, size_t dataSize)
+{
+    if (pBuffer == NULL) {
+        return; // <-- Not recording, such as when benchmarking.
+    }
+
+    if (pBuffer->size + dataSize > pBuffer->capacity) {
+        size_t newCapacity = (pBuffer->capacity > 0) ? pBuffer->capacity*2 : 4096;
+        while (newCapacity < pBuffer->size + dataSize) {
+            newCapacity *= 2;
+        }
+
+        char* pNewData = (char*)realloc(pBuffer->pData, newCapacity);
+        if (pNewData == NULL) {
+            return; // <-- Out of memory. The comparison will fail.
+        }
+
+        pBuffer->pData = pNewData;
+        pBuffer->capacity = newCapacity;
+    }
+
+    memcpy(pBuffer->pData + pBuffer->size, pData, dataSize);
+    pBuffer->size += dataSize;
+}
+
+// Records an item as a tag followed by the length and contents of each string.
+TA_PRIVATE void taTestBufferAppendItem(taTestBuffer* pBuffer, char tag, const char* name, const char* value)
+{
+    taTestBufferAppend(pBuffer, &tag, 1);
+
+    taUInt32 length = (taUInt32)strlen(name);
+    taTestBufferAppend(pBuffer, &length, sizeof(length));
+    taTestBufferAppend(pBuffer, name, length);
+
+    length = (taUInt32)strlen(value);
+    taTestBufferAppend(pBuffer, &length, sizeof(length));
+    taTestBufferAppend(pBuffer, value, length);
+}
+
+TA_PRIVATE void taTestRecordConfig(taTestBuffer* pBuffer, const taConfigObj* pObj)
+{
+    for (unsigned int iVar = 0; iVar < pObj->varCount; ++iVar) {
+        const taConfigVar* pVar = &pObj->pVars[iVar];
+        if (pVar->pObject != NULL) {
+            taTestBufferAppendItem(pBuffer, '[', pVar->name, "");
+            taTestRecordConfig(pBuffer, pVar->pObject);
+            taTestBufferAppendItem(pBuffer, '}', "", "");
+        } else {
+            taTestBufferAppendItem(pBuffer, '=', pVar->name, pVar->value);
+        }
+    }
+}
+
+// The reference parser is the original one which looks at a single character at a time. It records the same items as
+// taTestRecordConfig() as it goes, including everything parsed before an error, since the real parser keeps that too.
+TA_PRIVATE char* taTestConfigReferenceNextToken(char* str)
+{
+    for (;;) {
+        while (taConfigIsWhitespace(str[0])) {
+            str += 1;
+        }
+
+        if (str[0] == '\0') {
+            return NULL;
+        }
+
+        if (taConfigIsOnLineComment(str)) {
+            str += 2;
+            while (*str != '\0') {
+                if (*str++ == '\n') {
+                    break;
+                }
+            }
+        } else if (taConfigIsOnBlockComment(str)) {
+            str += 2;
+            while (*str != '\0') {
+                if (str[0] == '*' && str[1] == '/') {
+                    str += 2;
+                    break;
+                }
+                str += 1;
+            }
+        } else {
+            return str;
+        }
+    }
+}
+
+TA_PRIVATE char* taTestConfigReferenceSeek(char* str, char delimiter)
+{
+    while (*str != delimiter) {
+        if (*str == '\0' || taConfigIsOnLineComment(str) || taConfigIsOnBlockComment(str)) {
+            return NULL;
+        }
+        str += 1;
+    }
+
+    return str;
+}
+
+TA_PRIVATE char* taTestConfigReferenceParseObject(taTestBuffer* pBuffer, char* str)
+{
+    while ((str = taTestConfigReferenceNextToken(str)) != NULL) {
+        if (*str == '}') {
+            return str + 1;
+        }
+
+        if (*str == '[') {
+            char* nameBeg = str + 1;
+            char* nameEnd = taTestConfigReferenceSeek(nameBeg, ']');
+            if (nameEnd == NULL) {
+                return NULL;
+            }
+            *nameEnd = '\0';
+
+            str = taTestConfigReferenceNextToken(nameEnd + 1);
+            if (str == NULL || *str++ != '{') {
+                return NULL;
+            }
+
+            taTestBufferAppendItem(pBuffer, '[', nameBeg, "");
+            str = taTestConfigReferenceParseObject(pBuffer, str);
+            taTestBufferAppendItem(pBuffer, '}', "", "");
+            if (str == NULL) {
+                return NULL;
+            }
+        } else {
+            if (*str != '_' && !(*str >= 'a' && *str <= 'z') && !(*str >= 'A' && *str <= 'Z')) {
+                return NULL;
+            }
+
+            char* nameBeg = str;
+            char* nameEnd = taTestConfigReferenceSeek(nameBeg + 1, '=');
+            if (nameEnd == NULL) {
+                return NULL;
+            }
+            *nameEnd = '\0';
+
+            char* valueBeg = nameEnd + 1;
+            char* valueEnd = taTestConfigReferenceSeek(valueBeg, ';');
+            if (valueEnd == NULL) {
+                return NULL;
+            }
+            *valueEnd = '\0';
+
+            taTestBufferAppendItem(pBuffer, '=', nameBeg, valueBeg);
+            str = valueEnd + 1;
+        }
+    }
+
+    return NULL;
+}
+
+// Parses text with the real parser. The text is copied into a file allocated at its exact size so an address sanitizer catches
+// any read past the null terminator.
+TA_PRIVATE void taTestConfigParse(taTestBuffer* pBuffer, const char* text, size_t textSize)
+{
+    taFile* pFile = (taFile*)malloc(sizeof(*pFile) + textSize + 1);
+    if (pFile == NULL) {
+        return;
+    }
+
+    taZeroObject(pFile);
+    pFile->pFileData = (char*)(pFile + 1);
+    pFile->sizeInBytes = textSize;
+    memcpy(pFile->pFileData, text, textSize);
+    pFile->pFileData[textSize] = '\0';
+
+    taConfigObj* pConfig = taParseConfigFromOpenFile(pFile);  // <-- Takes ownership of the file.
+    if (pConfig != NULL && pBuffer != NULL) {
+        taTestRecordConfig(pBuffer, pConfig);
+        taDeleteConfig(pConfig);
+    }
+}
+
+TA_PRIVATE void taTestConfigParseReference(taTestBuffer* pBuffer, const char* text, size_t textSize)
+{
+    char* pCopy = (char*)malloc(textSize + 1);
+    if (pCopy == NULL) {
+        return;
+    }
+
+    memcpy(pCopy, text, textSize);
+    pCopy[textSize] = '\0';
+    taTestConfigReferenceParseObject(pBuffer, pCopy);
+    free(pCopy);
+}
+
+// Appends a random but mostly well formed config in the style of the game's TDF and FBI files. Runs of whitespace are sometimes
+// long so they straddle the 16 byte blocks of the vectorized scanner.
+TA_PRIVATE void taTestGenerateConfig(taTestContext* pContext, taTestBuffer* pText, int depth)
+{
+    static const char* s_names[]  = {"Name", "UnitName", "Description", "footprintx", "_x", "a", "Object", "energymake", "weapon1"};
+    static const char* s_values[] = {"ARMSOLAR", "2", "Solar Collector", "0.55", "", "a/b", "*", "very long value with spaces in it"};
+    static const char* s_spaces[] = {"", " ", "\t", "\r\n", "\r\n\t\t", "                    ", "\n\v\f", " // comment\r\n", "/* block */", "/* multi\r\nline */ "};
+
+    unsigned int itemCount = taTestRandomRange(pContext, 12);
+    for (unsigned int iItem = 0; iItem < itemCount; ++iItem) {
+        const char* space = s_spaces[taTestRandomRange(pContext, taCountOf(s_spaces))];
+        taTestBufferAppend(pText, space, strlen(space));
+
+        if (depth < 4 && taTestRandomRange(pContext, 4) == 0) {
+            const char* name = s_names[taTestRandomRange(pContext, taCountOf(s_names))];
+            taTestBufferAppend(pText, "[", 1);
+            taTestBufferAppend(pText, name, strlen(name));
+            taTestBufferAppend(pText, "]\r\n{", 4);
+            taTestGenerateConfig(pContext, pText, depth + 1);
+            taTestBufferAppend(pText, "}", 1);
+        } else {
+            const char* name  = s_names [taTestRandomRange(pContext, taCountOf(s_names))];
+            const char* value = s_values[taTestRandomRange(pContext, taCountOf(s_values))];
+            taTestBufferAppend(pText, name, strlen(name));
+            taTestBufferAppend(pText, "=", 1);
+            taTestBufferAppend(pText, value, strlen(value));
+            taTestBufferAppend(pText, ";", 1);
+        }
+    }
+
+    const char* space = s_spaces[taTestRandomRange(pContext, taCountOf(s_spaces))];
+    taTestBufferAppend(pText, space, strlen(space));
+}
+
+#if defined(TA_SUPPORT_SSE2)
+// The vectorized scanning functions are compared against the scalar ones at every starting position of random text, which is
+// allocated at its exact size so reading past the null terminator is caught.
+TA_PRIVATE void taTestConfigScanner(taTestContext* pContext)
+{
+    static const char s_alphabet[] = {' ', '\t', '\n', '\v', '\f', '\r', 8, 14, 31, 33, '=', ';', '/', '*', 'a', (char)0x89, (char)0xA0, (char)0xFF};
+
+    if (!taHasSSE2()) {
+        return;
+    }
+
+    for (taUInt32 iIteration = 0; iIteration < pContext->iterations/10; ++iIteration) {
+        size_t length = taTestRandomRange(pContext, 80);
+        char* text = (char*)malloc(length + 1);
+        if (text == NULL) {
+            taTestFail(pContext, "out of memory");
+            return;
+        }
+
+        for (size_t i = 0; i < length; ++i) {
+            text[i] = s_alphabet[taTestRandomRange(pContext, sizeof(s_alphabet))];
+        }
+        text[length] = '\0';
+
+        const char* pEnd = text + length + 1;
+        char c0 = s_alphabet[taTestRandomRange(pContext, sizeof(s_alphabet))];
+        char c1 = s_alphabet[taTestRandomRange(pContext, sizeof(s_alphabet))];
+        for (size_t i = 0; i <= length; ++i) {
+            if (taConfigFind_SSE2(text + i, pEnd, c0, c1) != taConfigFind_Scalar(text + i, pEnd, c0, c1)) {
+                taTestFail(pContext, "config: find differs (length=%u start=%u c0=0x%02X c1=0x%02X)", (unsigned int)length, (unsigned int)i, (taUInt8)c0, (taUInt8)c1);
+            }
+            if (taConfigSkipWhitespace_SSE2(text + i, pEnd) != taConfigSkipWhitespace_Scalar(text + i, pEnd)) {
+                taTestFail(pContext, "config: skipping whitespace differs (length=%u start=%u)", (unsigned int)length, (unsigned int)i);
+            }
+        }
+
+        free(text);
+    }
+}
+#endif
+
+// A pass over the text that stops at the same places the parser does, for timing the scanning functions on their own.
+TA_PRIVATE size_t taTestConfigScan(taConfigScanner scanner, char* text, const char* pEnd)
+{
+    size_t tokenCount = 0;
+    for (;;) {
+        text = scanner.skipWhitespace(text, pEnd);
+        text = scanner.find(text, pEnd, ';', '\n');
+        if (*text == '\0') {
+            return tokenCount;
+        }
+
+        tokenCount += 1;
+        text += 1;
+    }
+}
+
+TA_PRIVATE void taTestConfigBench(taTestContext* pContext)
+{
+    taTestBuffer text;
+    taZeroObject(&text);
+    while (text.size < 4*1024*1024) {
+        taTestGenerateConfig(pContext, &text, 0);
+    }
+    taTestBufferAppend(&text, "", 1);   // <-- The scanning functions need a null terminator.
+    text.size -= 1;
+
+    const int repetitionCount = 10;
+
+    // The whole parser, including building the tree. Nothing is recorded.
+    taTimer timer;
+    taTimerInit(&timer);
+    for (int iRep = 0; iRep < repetitionCount; ++iRep) {
+        taTestConfigParse(NULL, text.pData, text.size);
+    }
+    taTestPrintThroughput("parser", text.size*repetitionCount, taTimerTick(&timer));
+
+    // Just the scanning.
+    taConfigScanner scanners[2];
+    const char* scannerNames[2];
+    taUInt32 scannerCount = 0;
+    scanners[scannerCount].find = taConfigFind_Scalar;
+    scanners[scannerCount].skipWhitespace = taConfigSkipWhitespace_Scalar;
+    scannerNames[scannerCount] = "scan scalar";
+    scannerCount += 1;
+#if defined(TA_SUPPORT_SSE2)
+    if (taHasSSE2()) {
+        scanners[scannerCount].find = taConfigFind_SSE2;
+        scanners[scannerCount].skipWhitespace = taConfigSkipWhitespace_SSE2;
+        scannerNames[scannerCount] = "scan sse2";
+        scannerCount += 1;
+    }
+#endif
+
+    for (taUInt32 iScanner = 0; iScanner < scannerCount; ++iScanner) {
+        taTimerInit(&timer);
+        for (int iRep = 0; iRep < repetitionCount; ++iRep) {
+            taTestConfigScan(scanners[iScanner], text.pData, text.pData + text.size + 1);
+        }
+        taTestPrintThroughput(scannerNames[iScanner], text.size*repetitionCount, taTimerTick(&timer));
+    }
+
+    free(text.pData);
+}
+
+// The parser is compared against the reference parser on generated configs, mutations of them and random text made from the
+// characters that matter to the parser.
+TA_PRIVATE void taTestConfig(taTestContext* pContext)
+{
+    static const char s_alphabet[] = {' ', '\t', '\r', '\n', '[', ']', '{', '}', '=', ';', '/', '*', '_', 'a', 'Z', '0'};
+
+#if defined(TA_SUPPORT_SSE2)
+    taTestConfigScanner(pContext);
+#endif
+
+    taTestBuffer text;
+    taTestBuffer expected;
+    taTestBuffer actual;
+    taZeroObject(&text);
+    taZeroObject(&expected);
+    taZeroObject(&actual);
+
+    for (taUInt32 iIteration = 0; iIteration < pContext->iterations; ++iIteration) {
+        text.size = 0;
+        if ((iIteration % 4) == 3) {
+            size_t length = taTestRandomRange(pContext, 200);
+            for (size_t i = 0; i < length; ++i) {
+                taTestBufferAppend(&text, &s_alphabet[taTestRandomRange(pContext, sizeof(s_alphabet))], 1);
+            }
+        } else {
+            taTestGenerateConfig(pContext, &text, 0);
+
+            // Mutate some of them by replacing a few characters or truncating them.
+            if ((iIteration % 4) != 0 && text.size > 0) {
+                if (taTestRandomRange(pContext, 2) == 0) {
+                    text.size = taTestRandomRange(pContext, (taUInt32)text.size);
+                } else {
+                    for (unsigned int iMutation = taTestRandomRange(pContext, 4) + 1; iMutation > 0; --iMutation) {
+                        text.pData[taTestRandomRange(pContext, (taUInt32)text.size)] = s_alphabet[taTestRandomRange(pContext, sizeof(s_alphabet))];
+                    }
+                }
+            }
+        }
+
+        expected.size = 0;
+        actual.size = 0;
+        taTestConfigParseReference(&expected, text.pData, text.size);
+        taTestConfigParse(&actual, text.pData, text.size);
+        if (expected.size != actual.size || memcmp(expected.pData, actual.pData, expected.size) != 0) {
+            taTestFail(pContext, "config: differs from the reference (iteration=%u size=%u)", iIteration, (unsigned int)text.size);
+        }
+    }
+
+    free(text.pData);
+    free(expected.pData);
+    free(actual.pData);
+
+    if (pContext->bench) {
+        taTestConfigBench(pContext);
+    }
+}
+
+
+//// Texture Packer ////
+
+// Every image placed in an atlas is checked against the bounds of the atlas and against every other image placed since the last reset,
+// including the edges. The pixels of each image are checked when the atlas is full, which catches a later image overwriting an
+// earlier one.
+typedef struct
+{
+    taTexturePackerSlot slot;
+    taUInt32 id;
+} taTestPackedImage;
+
+TA_PRIVATE taUInt8 taTestPackerPixel(taUInt32 id, taUInt32 x, taUInt32 y)
+{
+    return (taUInt8)(id*7 + x + y*3);
+}
+
+TA_PRIVATE void taTestPackerCheckPixels(taTestContext* pContext, const taTexturePacker* pPacker, const taTestPackedImage* pImages, taUInt32 imageCount)
+{
+    for (taUInt32 iImage = 0; iImage < imageCount; ++iImage) {
+        const taTexturePackerSlot* pSlot = &pImages[iImage].slot;
+        for (taUInt32 y = 0; y < pSlot->height; ++y) {
+            for (taUInt32 x = 0; x < pSlot->width; ++x) {
+                if (pPacker->pImageData[(pSlot->posY + y)*pPacker->width + (pSlot->posX + x)] != taTestPackerPixel(pImages[iImage].id, x, y)) {
+                    taTestFail(pContext, "packer: image %u was overwritten at %u,%u", pImages[iImage].id, pSlot->posX + x, pSlot->posY + y);
+                    y = pSlot->height;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Generates the size of an image. Most are small, like map tiles and feature frames, but there are a few large ones.
+TA_PRIVATE void taTestPackerGenerateSize(taTestContext* pContext, taUInt16 maxSize, taUInt16* pWidth, taUInt16* pHeight)
+{
+    switch (taTestRandomRange(pContext, 4)) {
+        case 0:  *pWidth = 32; *pHeight = 32; break;
+        case 1:  *pWidth = (taUInt16)(1 + taTestRandomRange(pContext, maxSize)); *pHeight = (taUInt16)(1 + taTestRandomRange(pContext, maxSize)); break;
+        default: *pWidth = (taUInt16)(1 + taTestRandomRange(pContext, 64)); *pHeight = (taUInt16)(1 + taTestRandomRange(pContext, 96)); break;
+    }
+}
+
+// Packs sizes shaped like the frames of feature GAFs: single frame rocks and heaps, trees, wrecks and large animated features. This is
+// what decides how many atlases a map needs.
+TA_PRIVATE taUInt32 taTestPackerGenerateFeatureSizes(taTestContext* pContext, taUInt16* pSizes, taUInt32 sequenceCount)
+{
+    taUInt32 count = 0;
+    for (taUInt32 iSequence = 0; iSequence < sequenceCount; ++iSequence) {
+        taUInt32 kind = taTestRandomRange(pContext, 10);
+        taUInt32 width, height, frameCount;
+        if (kind < 3) {
+            width  = 12 + taTestRandomRange(pContext, 30);
+            height = 10 + taTestRandomRange(pContext, 24);
+            frameCount = 1;
+        } else if (kind < 7) {
+            width  = 20 + taTestRandomRange(pContext, 40);
+            height = 40 + taTestRandomRange(pContext, 60);
+            frameCount = 1 + taTestRandomRange(pContext, 10);
+        } else if (kind < 9) {
+            width  = 40 + taTestRandomRange(pContext, 80);
+            height = 30 + taTestRandomRange(pContext, 70);
+            frameCount = 1 + taTestRandomRange(pContext, 4);
+        } else {
+            width  = 64 + taTestRandomRange(pContext, 128);
+            height = 64 + taTestRandomRange(pContext, 128);
+            frameCount = 4 + taTestRandomRange(pContext, 16);
+        }
+
+        for (taUInt32 iFrame = 0; iFrame < frameCount; ++iFrame) {
+            pSizes[count*2 + 0] = (taUInt16)(width  - taTestRandomRange(pContext, 5));
+            pSizes[count*2 + 1] = (taUInt16)(height - taTestRandomRange(pContext, 5));
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+TA_PRIVATE void taTestPackerBench(taTestContext* pContext)
+{
+    const taUInt32 sequenceCount = 2000;
+    taUInt16* pSizes = (taUInt16*)malloc(sequenceCount*20 * 2 * sizeof(*pSizes));
+    taUInt8* pImageData = (taUInt8*)malloc(256*256);
+    if (pSizes == NULL || pImageData == NULL) {
+        taTestFail(pContext, "out of memory");
+        goto done;
+    }
+
+    memset(pImageData, 7, 256*256);
+    taUInt32 imageCount = taTestPackerGenerateFeatureSizes(pContext, pSizes, sequenceCount);
+
+    taUInt32 modes[2] = {0, TA_TEXTURE_PACKER_FLAG_SKYLINE};
+    for (int iMode = 0; iMode < 2; ++iMode) {
+        taTexturePacker packer;
+        if (!taTexturePackerInit(&packer, 512, 512, 1, TA_TEXTURE_PACKER_FLAG_HARD_EDGE | modes[iMode])) {
+            taTestFail(pContext, "out of memory");
+            goto done;
+        }
+
+        taUInt32 atlasCount = 0;
+        double occupancy = 0;
+
+        taTimer timer;
+        taTimerInit(&timer);
+        for (taUInt32 iImage = 0; iImage < imageCount; ++iImage) {
+            if (!taTexturePackerPackSubTexture(&packer, pSizes[iImage*2 + 0], pSizes[iImage*2 + 1], pImageData, NULL)) {
+                occupancy += taTexturePackerGetOccupancy(&packer);
+                atlasCount += 1;
+                taTexturePackerReset(&packer);
+                taTexturePackerPackSubTexture(&packer, pSizes[iImage*2 + 0], pSizes[iImage*2 + 1], pImageData, NULL);
+            }
+        }
+
+        if (!taTexturePackerIsEmpty(&packer)) {
+            occupancy += taTexturePackerGetOccupancy(&packer);
+            atlasCount += 1;
+        }
+
+        double seconds = taTimerTick(&timer);
+        printf("  %-24s %8u atlases, %5.1f%% occupied, %.2f ms\n", (iMode == 0) ? "row" : "skyline", atlasCount, occupancy/atlasCount*100, seconds*1000);
+
+        taTexturePackerUninit(&packer);
+    }
+
+done:
+    free(pSizes);
+    free(pImageData);
+}
+
+TA_PRIVATE void taTestPacker(taTestContext* pContext)
+{
+    const taUInt32 maxAtlasSize = 512;
+    taUInt32* pOwners = (taUInt32*)malloc(maxAtlasSize*maxAtlasSize * sizeof(*pOwners));
+    taUInt8* pImageData = (taUInt8*)malloc(maxAtlasSize*maxAtlasSize);
+    taTestPackedImage* pImages = (taTestPackedImage*)malloc(maxAtlasSize*maxAtlasSize * sizeof(*pImages));
+    if (pOwners == NULL || pImageData == NULL || pImages == NULL) {
+        taTestFail(pContext, "out of memory");
+        goto done;
+    }
+
+    taTexturePacker packer;
+    taZeroObject(&packer);
+    taUInt32 imageCount = 0;
+    taUInt32 usedArea = 0;
+
+    for (taUInt32 iIteration = 0; iIteration < pContext->iterations; ++iIteration) {
+        // Every now and then, start again with a different size and mode. The packer needs to be reinitialized for this.
+        if (packer.pImageData == NULL || (imageCount == 0 && taTestRandomRange(pContext, 4) == 0)) {
+            taTexturePackerUninit(&packer);
+
+            taUInt16 atlasSize = (taUInt16)(64 << taTestRandomRange(pContext, 4));
+            taUInt32 flags = 0;
+            if (taTestRandomRange(pContext, 2) == 0) flags |= TA_TEXTURE_PACKER_FLAG_SKYLINE;
+            if (taTestRandomRange(pContext, 2) == 0) flags |= TA_TEXTURE_PACKER_FLAG_HARD_EDGE;
+
+            if (!taTexturePackerInit(&packer, atlasSize, atlasSize, 1, flags)) {
+                taTestFail(pContext, "out of memory");
+                goto done;
+            }
+
+            memset(pOwners, 0, maxAtlasSize*maxAtlasSize * sizeof(*pOwners));
+        }
+
+        taUInt32 edge = (packer.flags & TA_TEXTURE_PACKER_FLAG_HARD_EDGE) ? 1 : 0;
+
+        taUInt16 width;
+        taUInt16 height;
+        taTestPackerGenerateSize(pContext, packer.width, &width, &height);
+
+        for (taUInt32 y = 0; y < height; ++y) {
+            for (taUInt32 x = 0; x < width; ++x) {
+                pImageData[y*width + x] = taTestPackerPixel(iIteration, x, y);
+            }
+        }
+
+        taTexturePackerSlot slot;
+        if (!taTexturePackerPackSubTexture(&packer, width, height, pImageData, &slot)) {
+            if (imageCount == 0) {
+                if (width + edge*2 <= packer.width && height + edge*2 <= packer.height) {
+                    taTestFail(pContext, "packer: %ux%u did not fit in an empty %ux%u atlas (flags=0x%X)", width, height, packer.width, packer.height, packer.flags);
+                }
+                continue;
+            }
+
+            // The atlas is full. Everything in it needs to be intact, and the occupancy needs to add up. The image that didn't fit is dropped.
+            taTestPackerCheckPixels(pContext, &packer, pImages, imageCount);
+            if (packer.subTextureCount != imageCount || taTexturePackerGetOccupancy(&packer) != (float)usedArea / ((taUInt32)packer.width * packer.height)) {
+                taTestFail(pContext, "packer: occupancy does not match the %u packed images (flags=0x%X)", imageCount, packer.flags);
+            }
+
+            taTexturePackerReset(&packer);
+            memset(pOwners, 0, maxAtlasSize*maxAtlasSize * sizeof(*pOwners));
+            imageCount = 0;
+            usedArea = 0;
+            continue;
+        }
+
+        if (slot.width != width || slot.height != height || slot.posX < edge || slot.posY < edge || slot.posX + width + edge > packer.width || slot.posY + height + edge > packer.height) {
+            taTestFail(pContext, "packer: %ux%u placed out of bounds at %u,%u (flags=0x%X)", width, height, slot.posX, slot.posY, packer.flags);
+            continue;
+        }
+
+        for (taUInt32 y = slot.posY - edge; y < slot.posY + height + edge; ++y) {
+            for (taUInt32 x = slot.posX - edge; x < slot.posX + width + edge; ++x) {
+                if (pOwners[y*packer.width + x] != 0) {
+                    taTestFail(pContext, "packer: %ux%u at %u,%u overlaps image %u (flags=0x%X)", width, height, slot.posX, slot.posY, pOwners[y*packer.width + x] - 1, packer.flags);
+                    y = slot.posY + height + edge;
+                    break;
+                }
+
+                pOwners[y*packer.width + x] = iIteration + 1;
+            }
+        }
+
+        pImages[imageCount].slot = slot;
+        pImages[imageCount].id = iIteration;
+        imageCount += 1;
+        usedArea += (width + edge*2) * (height + edge*2);
+    }
+
+    taTestPackerCheckPixels(pContext, &packer, pImages, imageCount);
+    taTexturePackerUninit(&packer);
+
+    if (pContext->bench) {
+        taTestPackerBench(pContext);
+    }
+
+done:
+    free(pOwners);
+    free(pImageData);
+    free(pImages);
+}
+
+//// File System ////
+
+// The file system tests run against whatever archives are in the program's directory. They're skipped when there aren't any.
+TA_PRIVATE taFS* taTestCreateFileSystem(void)
+{
+    taFS* pFS = taCreateFileSystem();
+    if (pFS == NULL) {
+        printf("  skipped: the game's archives were not found\n");
+    }
+
+    return pFS;
+}
+
+//// Path Index ////
+
+// The reference lookup walks an archive's central directory one path segment at a time. Unlike taFSFindFileInArchive() it only matches
+// whole segment names. Returns the position of the file's entry data, or TA_FS_INDEX_NONE.
+TA_PRIVATE taUInt32 taTestIndexReferenceFind(const taFSArchive* pArchive, const char* relativePath)
+{
+    taPathIterator i;
+    if (!taPathFirst(relativePath, &i)) {
+        return TA_FS_INDEX_NONE;
+    }
+
+    taUInt32 directoryPos = 0;
+    for (;;) {
+        if (i.segment.length == 0) {
+            if (!taPathNext(&i)) {
+                return TA_FS_INDEX_NONE;
+            }
+            continue;
+        }
+
+        if ((taUInt64)directoryPos + 8 > pArchive->centralDirectorySize) {
+            return TA_FS_INDEX_NONE;
+        }
+
+        taUInt32 fileCount;
+        memcpy(&fileCount, pArchive->pCentralDirectory + directoryPos, 4);
+
+        taUInt32 foundDataPos = TA_FS_INDEX_NONE;
+        taBool32 foundIsDirectory = TA_FALSE;
+        for (taUInt32 iFile = 0; iFile < fileCount; ++iFile) {
+            taUInt64 entryPos = (taUInt64)directoryPos + 8 + (taUInt64)iFile*9;
+            if (entryPos + 9 > pArchive->centralDirectorySize) {
+                return TA_FS_INDEX_NONE;
+            }
+
+            taUInt32 namePos;
+            taUInt32 dataPos;
+            memcpy(&namePos, pArchive->pCentralDirectory + entryPos + 0, 4);
+            memcpy(&dataPos, pArchive->pCentralDirectory + entryPos + 4, 4);
+
+            const char* name = pArchive->pCentralDirectory + namePos;
+            if (strlen(name) == i.segment.length && _strnicmp(name, i.path + i.segment.offset, i.segment.length) == 0) {
+                foundDataPos = dataPos;
+                foundIsDirectory = pArchive->pCentralDirectory[entryPos + 8] != 0;
+                break;
+            }
+        }
+
+        if (foundDataPos == TA_FS_INDEX_NONE) {
+            return TA_FS_INDEX_NONE;
+        }
+
+        // Skip over trailing separators to see whether this is the last segment.
+        taBool32 isLastSegment = TA_TRUE;
+        while (taPathNext(&i)) {
+            if (i.segment.length > 0) {
+                isLastSegment = TA_FALSE;
+                break;
+            }
+        }
+
+        if (isLastSegment) {
+            return foundIsDirectory ? TA_FS_INDEX_NONE : foundDataPos;
+        }
+
+        if (!foundIsDirectory) {
+            return TA_FS_INDEX_NONE;
+        }
+
+        directoryPos = foundDataPos;
+    }
+}
+
+// Checks that the index finds every instance of a path, in priority order, the same way as walking every archive.
+TA_PRIVATE void taTestIndexCheckPath(taTestContext* pContext, taFS* pFS, const char* relativePath)
+{
+    taUInt32 iEntry = taFSIndexFind(&pFS->index, relativePath);
+    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+        taUInt32 dataPos = taTestIndexReferenceFind(&pFS->pArchives[iArchive], relativePath);
+        if (dataPos == TA_FS_INDEX_NONE) {
+            continue;
+        }
+
+        if (iEntry == TA_FS_INDEX_NONE) {
+            taTestFail(pContext, "index: \"%s\" is missing the instance in %s", relativePath, pFS->pArchives[iArchive].relativePath);
+            return;
+        }
+
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+        if (pEntry->archiveIndex != iArchive || pEntry->entryDataPos != dataPos) {
+            taTestFail(pContext, "index: \"%s\" found in %s instead of %s", relativePath, pFS->pArchives[pEntry->archiveIndex].relativePath, pFS->pArchives[iArchive].relativePath);
+            return;
+        }
+
+        iEntry = pEntry->nextEntryIndex;
+    }
+
+    if (iEntry != TA_FS_INDEX_NONE) {
+        taTestFail(pContext, "index: \"%s\" has an instance in %s which walking the archives doesn't find", relativePath, pFS->pArchives[pFS->index.pEntries[iEntry].archiveIndex].relativePath);
+    }
+}
+
+// Every path in the index is looked up as it is, with different case and separators, and with random changes that mostly make it miss.
+TA_PRIVATE void taTestIndex(taTestContext* pContext)
+{
+    taFS* pFS = taTestCreateFileSystem();
+    if (pFS == NULL) {
+        return;
+    }
+
+    if (pFS->index.pSlots == NULL) {
+        taTestFail(pContext, "index: the index was not built");
+        taDeleteFileSystem(pFS);
+        return;
+    }
+
+    taUInt32 checkCount = (pFS->index.entryCount < pContext->iterations) ? pFS->index.entryCount : pContext->iterations;
+    for (taUInt32 iCheck = 0; iCheck < checkCount; ++iCheck) {
+        taUInt32 iEntry = (checkCount == pFS->index.entryCount) ? iCheck : taTestRandomRange(pContext, pFS->index.entryCount);
+        const char* path = pFS->index.pPaths + pFS->index.pEntries[iEntry].pathOffset;
+        taTestIndexCheckPath(pContext, pFS, path);
+
+        char variant[TA_MAX_PATH + 8];
+        size_t length = strlen(path);
+        if (length + 4 > sizeof(variant)) {
+            continue;
+        }
+
+        // Upper case with back slashes, and with a leading and doubled separator.
+        for (size_t i = 0; i <= length; ++i) {
+            variant[i] = (path[i] == '/') ? '\\' : (char)toupper((unsigned char)path[i]);
+        }
+        taTestIndexCheckPath(pContext, pFS, variant);
+
+        size_t variantLength = 0;
+        variant[variantLength++] = '/';
+        for (size_t i = 0; i <= length; ++i) {
+            variant[variantLength++] = path[i];
+            if (path[i] == '/') {
+                variant[variantLength++] = '/';
+            }
+        }
+        taTestIndexCheckPath(pContext, pFS, variant);
+
+        // Random changes.
+        memcpy(variant, path, length + 1);
+        switch (taTestRandomRange(pContext, 3)) {
+            case 0: variant[taTestRandomRange(pContext, (taUInt32)length)] = (char)('a' + taTestRandomRange(pContext, 26)); break;
+            case 1: variant[taTestRandomRange(pContext, (taUInt32)length + 1)] = '\0'; break;
+            default: variant[length] = 'x'; variant[length + 1] = '\0'; break;
+        }
+        taTestIndexCheckPath(pContext, pFS, variant);
+    }
+
+    if (pContext->bench) {
+        const taUInt32 lookupCount = 200000;
+        double seconds[2];
+        for (int iMethod = 0; iMethod < 2; ++iMethod) {
+            taUInt32 foundCount = 0;
+            taTimer timer;
+            taTimerInit(&timer);
+            for (taUInt32 iLookup = 0; iLookup < lookupCount; ++iLookup) {
+                const char* path = pFS->index.pPaths + pFS->index.pEntries[(iLookup * 2654435761u) % pFS->index.entryCount].pathOffset;
+                if (iMethod == 0) {
+                    for (taUInt32 iArchive = 0; iArchive < pFS->archiveCount; ++iArchive) {
+                        taUInt32 dataPos;
+                        if (taFSFindFileInArchive(pFS, &pFS->pArchives[iArchive], path, &dataPos)) {
+                            foundCount += 1;
+                            break;
+                        }
+                    }
+                } else {
+                    foundCount += (taFSIndexFind(&pFS->index, path) != TA_FS_INDEX_NONE);
+                }
+            }
+            seconds[iMethod] = taTimerTick(&timer);
+
+            if (foundCount != lookupCount) {
+                taTestFail(pContext, "index: %u of %u lookups failed", lookupCount - foundCount, lookupCount);
+            }
+        }
+
+        printf("  %-24s %8.0f lookups/s\n", "walk", lookupCount / seconds[0]);
+        printf("  %-24s %8.0f lookups/s\n", "index", lookupCount / seconds[1]);
+    }
+
+    taDeleteFileSystem(pFS);
+}
+
+//// Parallel Chunk Decoding ////
+
+// Every compressed file in the mapped archives is decoded from the mapping on a thread pool, from the mapping on the calling thread,
+// and through stdio one chunk at a time, which is how files were read before chunks were decoded in parallel. All three need to
+// agree. The pool has more workers than there are CPUs in most test machines so the chunks really do get decoded concurrently.
+TA_PRIVATE void taTestChunks(taTestContext* pContext)
+{
+    taFS* pFS = taTestCreateFileSystem();
+    if (pFS == NULL) {
+        return;
+    }
+
+    taThreadPool threadPool;
+    if (!taThreadPoolInit(&threadPool, 4)) {
+        taTestFail(pContext, "chunks: failed to create the thread pool");
+        taDeleteFileSystem(pFS);
+        return;
+    }
+
+    taUInt32 multiChunkFileCount = 0;
+    for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+        const taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+        const taFSArchive* pArchive = &pFS->pArchives[pEntry->archiveIndex];
+        if (pEntry->compressionType == 0 || pArchive->mappedFile.pData == NULL || pEntry->dataSize == 0) {
+            continue;
+        }
+
+        // Files that fit in one chunk don't use the pool, so only some of them are checked.
+        taBool32 isMultiChunk = pEntry->dataSize > TA_HPI_CHUNK_SIZE;
+        if (!isMultiChunk && taTestRandomRange(pContext, 16) != 0) {
+            continue;
+        }
+
+        const char* path = pFS->index.pPaths + pEntry->pathOffset;
+        taUInt8* pParallel = (taUInt8*)malloc(pEntry->dataSize);
+        taUInt8* pSerial   = (taUInt8*)malloc(pEntry->dataSize);
+        taUInt8* pSTDIO    = (taUInt8*)malloc(pEntry->dataSize);
+        if (pParallel == NULL || pSerial == NULL || pSTDIO == NULL) {
+            free(pParallel);
+            free(pSerial);
+            free(pSTDIO);
+            taTestFail(pContext, "out of memory");
+            break;
+        }
+
+        taBool32 parallelResult = taHPIDecryptCompressedFromMemory(pArchive->mappedFile.pData, pArchive->mappedFile.sizeInBytes, pEntry->dataOffset, pParallel, pEntry->dataSize, pArchive->decryptionKey, &threadPool);
+        taBool32 serialResult   = taHPIDecryptCompressedFromMemory(pArchive->mappedFile.pData, pArchive->mappedFile.sizeInBytes, pEntry->dataOffset, pSerial,   pEntry->dataSize, pArchive->decryptionKey, NULL);
+
+        taBool32 stdioResult = TA_FALSE;
+        char archiveAbsolutePath[TA_MAX_PATH];
+        if (taPathAppend(archiveAbsolutePath, sizeof(archiveAbsolutePath), pFS->rootDir, pArchive->relativePath)) {
+            FILE* pSTDIOFile = taFOpen(archiveAbsolutePath, "rb");
+            if (pSTDIOFile != NULL) {
+                if (taFSeek(pSTDIOFile, pEntry->dataOffset, taSeekOriginStart) == 0) {
+                    stdioResult = taHPIReadAndDecryptCompressed(pSTDIOFile, pSTDIO, pEntry->dataSize, pArchive->decryptionKey) != 0;
+                }
+                fclose(pSTDIOFile);
+            }
+        }
+
+        if (!stdioResult) {
+            taTestFail(pContext, "chunks: \"%s\" could not be read through stdio", path);
+        } else if (!parallelResult || memcmp(pParallel, pSTDIO, pEntry->dataSize) != 0) {
+            taTestFail(pContext, "chunks: \"%s\" decoded in parallel differs (%u bytes)", path, pEntry->dataSize);
+        } else if (!serialResult || memcmp(pSerial, pSTDIO, pEntry->dataSize) != 0) {
+            taTestFail(pContext, "chunks: \"%s\" decoded serially differs (%u bytes)", path, pEntry->dataSize);
+        }
+
+        free(pParallel);
+        free(pSerial);
+        free(pSTDIO);
+
+        multiChunkFileCount += isMultiChunk;
+    }
+
+    if (multiChunkFileCount == 0) {
+        printf("  note: none of the archives have a compressed file bigger than one chunk\n");
+    }
+
+    if (pContext->bench && multiChunkFileCount > 0) {
+        // Only files bigger than a chunk are timed since they're the only ones that are split up.
+        for (int iMode = 0; iMode < 2; ++iMode) {
+            size_t bytesDecoded = 0;
+            taTimer timer;
+            taTimerInit(&timer);
+            for (taUInt32 iEntry = 0; iEntry < pFS->index.entryCount; ++iEntry) {
+                const taFSIndexEntry* pEntry = &pFS->index.pEntries[iEntry];
+                const taFSArchive* pArchive = &pFS->pArchives[pEntry->archiveIndex];
+                if (pEntry->compressionType == 0 || pArchive->mappedFile.pData == NULL || pEntry->dataSize <= TA_HPI_CHUNK_SIZE) {
+                    continue;
+                }
+
+                taUInt8* pOut = (taUInt8*)malloc(pEntry->dataSize);
+                if (pOut != NULL) {
+                    taHPIDecryptCompressedFromMemory(pArchive->mappedFile.pData, pArchive->mappedFile.sizeInBytes, pEntry->dataOffset, pOut, pEntry->dataSize, pArchive->decryptionKey, (iMode == 0) ? NULL : &threadPool);
+                    bytesDecoded += pEntry->dataSize;
+                    free(pOut);
+                }
+            }
+
+            taTestPrintThroughput((iMode == 0) ? "serial" : "4 threads", bytesDecoded, taTimerTick(&timer));
+        }
+    }
+
+    taThreadPoolUninit(&threadPool);
+    taDeleteFileSystem(pFS);
+}
+
+//// Pack ////
+
+// Reads the whole of a file through taReadFile(), which works the same way for streamed files.
+TA_PRIVATE taUInt8* taTestReadWholeFile(taFile* pFile)
+{
+    taUInt8* pData = (taUInt8*)malloc(pFile->sizeInBytes + 1);
+    if (pData == NULL) {
+        return NULL;
+    }
+
+    size_t bytesRead;
+    if (!taReadFile(pFile, pData, pFile->sizeInBytes, &bytesRead) || bytesRead != pFile->sizeInBytes) {
+        free(pData);
+        return NULL;
+    }
+
+    return pData;
+}
+
+// Opens a file from both file systems and checks they have the same content. archiveRelativePath can be null.
+TA_PRIVATE void taTestPackCompareFile(taTestContext* pContext, taFS* pArchiveFS, taFS* pPackFS, const char* archiveRelativePath, const char* relativePath, unsigned int options)
+{
+    taFile* pExpectedFile = (archiveRelativePath == NULL) ? taOpenFile(pArchiveFS, relativePath, options) : taOpenSpecificFile(pArchiveFS, archiveRelativePath, relativePath, options);
+    taFile* pActualFile   = (archiveRelativePath == NULL) ? taOpenFile(pPackFS,    relativePath, options) : taOpenSpecificFile(pPackFS,    archiveRelativePath, relativePath, options);
+    if (pExpectedFile == NULL || pActualFile == NULL) {
+        if (pExpectedFile != pActualFile) {
+            taTestFail(pContext, "pack: \"%s\" (%s, options=0x%X) opened from only one of the file systems", relativePath, (archiveRelativePath != NULL) ? archiveRelativePath : "any archive", options);
+        }
+    } else {
+        taUInt8* pExpected = taTestReadWholeFile(pExpectedFile);
+        taUInt8* pActual   = taTestReadWholeFile(pActualFile);
+        if (pExpected == NULL || pActual == NULL || pExpectedFile->sizeInBytes != pActualFile->sizeInBytes || memcmp(pExpected, pActual, pExpectedFile->sizeInBytes) != 0) {
+            taTestFail(pContext, "pack: \"%s\" (%s, options=0x%X) differs from the archive", relativePath, (archiveRelativePath != NULL) ? archiveRelativePath : "any archive", options);
+        } else if ((options & TA_OPEN_FILE_WITH_NULL_TERMINATOR) && (pActualFile->pFileData == NULL || pActualFile->pFileData[pActualFile->sizeInBytes] != '\0')) {
+            taTestFail(pContext, "pack: \"%s\" is not null terminated", relativePath);
+        }
+
+        free(pExpected);
+        free(pActual);
+    }
+
+    taCloseFile(pExpectedFile);
+    taCloseFile(pActualFile);
+}
+
+// A sample of the files in the archives is written to a pack in the root directory, which the next file system mounts. Every instance of
+// those files needs to read back the same as from the archives, in every open mode. A truncated pack needs to be ignored. The test
+// won't replace a pack that's already there, and deletes the one it writes.
+TA_PRIVATE void taTestPack(taTestContext* pContext)
+{
+    taFS* pArchiveFS = taTestCreateFileSystem();
+    if (pArchiveFS == NULL) {
+        return;
+    }
+
+    char packPath[TA_MAX_PATH];
+    if (!taPathAppend(packPath, sizeof(packPath), pArchiveFS->rootDir, TA_FS_PACK_FILE_NAME)) {
+        taTestFail(pContext, "pack: the path is too long");
+        taDeleteFileSystem(pArchiveFS);
+        return;
+    }
+
+    FILE* pExistingPack = taFOpen(packPath, "rb");
+    if (pExistingPack != NULL) {
+        fclose(pExistingPack);
+        printf("  skipped: %s already exists\n", TA_FS_PACK_FILE_NAME);
+        taDeleteFileSystem(pArchiveFS);
+        return;
+    }
+
+    const taUInt32 maxPatternCount = 256;
+    const char** ppPatterns = (const char**)malloc(maxPatternCount * sizeof(*ppPatterns));
+    if (ppPatterns == NULL) {
+        taTestFail(pContext, "out of memory");
+        taDeleteFileSystem(pArchiveFS);
+        return;
+    }
+
+    taUInt32 patternCount = 0;
+    for (taUInt32 iPattern = 0; iPattern < maxPatternCount && iPattern < pArchiveFS->index.entryCount; ++iPattern) {
+        taUInt32 iEntry = (pArchiveFS->index.entryCount <= maxPatternCount) ? iPattern : taTestRandomRange(pContext, pArchiveFS->index.entryCount);
+        ppPatterns[patternCount++] = pArchiveFS->index.pPaths + pArchiveFS->index.pEntries[iEntry].pathOffset;
+    }
+
+    taTimer timer;
+    taTimerInit(&timer);
+    taResult result = taFSWritePack(pArchiveFS, packPath, ppPatterns, patternCount);
+    double writeTime = taTimerTick(&timer);
+    if (result != TA_SUCCESS) {
+        taTestFail(pContext, "pack: taFSWritePack() failed (%d)", result);
+        goto done;
+    }
+
+    const unsigned int optionsList[] = {0, TA_OPEN_FILE_READ_ONLY, TA_OPEN_FILE_STREAMED, TA_OPEN_FILE_WITH_NULL_TERMINATOR};
+    for (int iPass = 0; iPass < 2; ++iPass) {
+        // The second pass is with the pack cut in half. It needs to be rejected in full rather than used in part.
+        if (iPass == 1) {
+            taMappedFile packFile;
+            if (!taMapFile(packPath, &packFile)) {
+                taTestFail(pContext, "pack: the pack was not written");
+                break;
+            }
+
+            size_t truncatedSize = packFile.sizeInBytes / 2;
+            taUInt8* pTruncated = (taUInt8*)malloc(truncatedSize);
+            if (pTruncated != NULL) {
+                memcpy(pTruncated, packFile.pData, truncatedSize);
+            }
+            taUnmapFile(&packFile);
+
+            FILE* pPackFile = taFOpen(packPath, "wb");
+            if (pTruncated == NULL || pPackFile == NULL || fwrite(pTruncated, 1, truncatedSize, pPackFile) != truncatedSize) {
+                taTestFail(pContext, "pack: failed to truncate the pack");
+            }
+
+            if (pPackFile != NULL) {
+                fclose(pPackFile);
+            }
+            free(pTruncated);
+        }
+
+        taTimerInit(&timer);
+        taFS* pPackFS = taCreateFileSystem();
+        double createTime = taTimerTick(&timer);
+        if (pPackFS == NULL) {
+            taTestFail(pContext, "pack: failed to create the file system with the pack");
+            break;
+        }
+
+        taBool32 isMounted = pPackFS->pack.mappedFile.pData != NULL;
+        if (isMounted != (iPass == 0)) {
+            taTestFail(pContext, (iPass == 0) ? "pack: the pack was not mounted" : "pack: the truncated pack was mounted");
+        }
+
+        for (taUInt32 iPattern = 0; iPattern < patternCount; ++iPattern) {
+            const char* relativePath = ppPatterns[iPattern];
+            for (size_t iOptions = 0; iOptions < taCountOf(optionsList); ++iOptions) {
+                taTestPackCompareFile(pContext, pArchiveFS, pPackFS, NULL, relativePath, optionsList[iOptions]);
+            }
+
+            // Lower priority instances of the file are packed as well.
+            for (taUInt32 iEntry = taFSIndexFind(&pArchiveFS->index, relativePath); iEntry != TA_FS_INDEX_NONE; iEntry = pArchiveFS->index.pEntries[iEntry].nextEntryIndex) {
+                taTestPackCompareFile(pContext, pArchiveFS, pPackFS, pArchiveFS->pArchives[pArchiveFS->index.pEntries[iEntry].archiveIndex].relativePath, relativePath, 0);
+            }
+
+            if (iPass == 0 && isMounted) {
+                taUInt32 iEntry = taFSIndexFind(&pPackFS->index, relativePath);
+                if (iEntry != TA_FS_INDEX_NONE && pPackFS->index.pEntries[iEntry].packFileIndex == TA_FS_INDEX_NONE) {
+                    taTestFail(pContext, "pack: \"%s\" is not read from the pack", relativePath);
+                }
+            }
+        }
+
+        if (pContext->bench && iPass == 0) {
+            printf("  %-24s %8.1f ms (%u files)\n", "write", writeTime*1000, patternCount);
+            printf("  %-24s %8.1f ms\n", "create with pack", createTime*1000);
+        }
+
+        taDeleteFileSystem(pPackFS);
+    }
+
+done:
+    remove(packPath);
+    free((void*)ppPatterns);
+    taDeleteFileSystem(pArchiveFS);
+}
+
+//// Asynchronous Loading ////
+
+#define TA_TEST_ASYNC_FILE_COUNT        32
+#define TA_TEST_ASYNC_SUBMITTER_COUNT   6
+
+typedef struct
+{
+    taFS* pFS;
+
+    // The files being requested, with their contents as loaded by taOpenFile(). The last one doesn't exist.
+    const char* pPaths[TA_TEST_ASYNC_FILE_COUNT + 1];
+    taFile* pExpectedFiles[TA_TEST_ASYNC_FILE_COUNT + 1];
+    taUInt32 fileCount;
+    taUInt32 roundCount;
+
+    // Failures are counted atomically from the submitters and the I/O threads, and added to the context at the end.
+    volatile taUInt32 failCount;
+
+    // Used for checking the order requests are started in.
+    taSemaphore startedSemaphore;
+    taSemaphore gateSemaphore;
+    char order[8];
+    volatile taUInt32 orderLength;
+} taTestAsyncState;
+
+typedef struct
+{
+    taTestAsyncState* pState;
+    taUInt32 iFile;
+    char name;
+} taTestAsyncRequestData;
+
+// Each submitter thread has its own context since taTestRandom() isn't thread-safe.
+typedef struct
+{
+    taTestAsyncState* pState;
+    taTestContext context;
+    taThread thread;
+} taTestAsyncSubmitter;
+
+TA_PRIVATE taBool32 taTestAsyncCheckFile(taTestAsyncState* pState, taUInt32 iFile, taFile* pFile)
+{
+    taFile* pExpectedFile = pState->pExpectedFiles[iFile];
+    if (pExpectedFile == NULL || pFile == NULL) {
+        return pExpectedFile == pFile;
+    }
+
+    return pFile->sizeInBytes == pExpectedFile->sizeInBytes && memcmp(pFile->pFileData, pExpectedFile->pFileData, pFile->sizeInBytes) == 0;
+}
+
+TA_PRIVATE void taTestAsyncOnComplete(taFileRequest* pRequest, taFile* pFile, void* pUserData)
+{
+    (void)pRequest;
+
+    taTestAsyncRequestData* pData = (taTestAsyncRequestData*)pUserData;
+    if (!taTestAsyncCheckFile(pData->pState, pData->iFile, pFile)) {
+        taAtomicFetchAdd32(&pData->pState->failCount, 1);
+    }
+}
+
+// The first request holds up the I/O thread until the gate is released. The others record the order they're started in.
+TA_PRIVATE void taTestAsyncOnCompleteOrdered(taFileRequest* pRequest, taFile* pFile, void* pUserData)
+{
+    (void)pRequest;
+    (void)pFile;
+
+    taTestAsyncRequestData* pData = (taTestAsyncRequestData*)pUserData;
+    if (pData->name == 'G') {
+        taSemaphoreRelease(&pData->pState->startedSemaphore);
+        taSemaphoreWait(&pData->pState->gateSemaphore);
+    } else {
+        taUInt32 iOrder = taAtomicFetchAdd32(&pData->pState->orderLength, 1);
+        if (iOrder < sizeof(pData->pState->order)) {
+            pData->pState->order[iOrder] = pData->name;
+        }
+    }
+}
+
+TA_PRIVATE taThreadResult TA_THREADCALL taTestAsyncSubmitterEntry(void* pUserData)
+{
+    taTestAsyncSubmitter* pSubmitter = (taTestAsyncSubmitter*)pUserData;
+    taTestAsyncState* pState = pSubmitter->pState;
+    taTestContext* pContext = &pSubmitter->context;
+
+    taFileRequest* pRequests[64];
+    taTestAsyncRequestData requestData[64];
+    for (taUInt32 iRound = 0; iRound < pState->roundCount; ++iRound) {
+        taUInt32 requestCount = 1 + taTestRandomRange(pContext, taCountOf(pRequests));
+        for (taUInt32 iRequest = 0; iRequest < requestCount; ++iRequest) {
+            requestData[iRequest].pState = pState;
+            requestData[iRequest].iFile  = taTestRandomRange(pContext, pState->fileCount + 1);
+            requestData[iRequest].name   = '\0';
+
+            unsigned int options = (taTestRandomRange(pContext, 3) == 0) ? TA_OPEN_FILE_READ_ONLY : 0;
+            taInt32 priority = (taInt32)taTestRandomRange(pContext, 5) - 2;
+            taFileRequestProc onComplete = (iRequest & 1) ? taTestAsyncOnComplete : NULL;
+            pRequests[iRequest] = taOpenFileAsync(pState->pFS, pState->pPaths[requestData[iRequest].iFile], options, priority, onComplete, &requestData[iRequest]);
+            if (pRequests[iRequest] == NULL) {
+                taAtomicFetchAdd32(&pState->failCount, 1);
+                continue;
+            }
+
+            if (taTestRandomRange(pContext, 7) == 0) {
+                taSetFileRequestPriority(pRequests[iRequest], TA_FILE_REQUEST_PRIORITY_HIGH);
+            }
+        }
+
+        // Requests are ended in every way there is: cancelled, polled for a while and then finished, or just finished.
+        for (taUInt32 iRequest = 0; iRequest < requestCount; ++iRequest) {
+            if (pRequests[iRequest] == NULL) {
+                continue;
+            }
+
+            taUInt32 mode = taTestRandomRange(pContext, 4);
+            if (mode == 0) {
+                taCancelFileRequest(pRequests[iRequest]);
+                continue;
+            }
+
+            if (mode == 1) {
+                for (int iPoll = 0; iPoll < 1000 && !taIsFileRequestComplete(pRequests[iRequest]); ++iPoll) {
+                }
+            }
+
+            taFile* pFile = taFinishFileRequest(pRequests[iRequest]);
+            if (!taTestAsyncCheckFile(pState, requestData[iRequest].iFile, pFile)) {
+                taAtomicFetchAdd32(&pState->failCount, 1);
+            }
+
+            taCloseFile(pFile);
+        }
+    }
+
+    return (taThreadResult)0;
+}
+
+// Checks that requests are started in order of priority, including after a change of priority, and that a cancelled request is never
+// started. The only I/O thread is held up by the first request so the others queue up behind it.
+TA_PRIVATE void taTestAsyncOrder(taTestContext* pContext, taTestAsyncState* pState)
+{
+    const char* names = "Gabcde";
+    const taInt32 priorities[6] = {0, TA_FILE_REQUEST_PRIORITY_LOW, TA_FILE_REQUEST_PRIORITY_NORMAL, TA_FILE_REQUEST_PRIORITY_HIGH, TA_FILE_REQUEST_PRIORITY_NORMAL, TA_FILE_REQUEST_PRIORITY_LOW};
+
+    taFSSetIOThreadCount(pState->pFS, 1);
+    pState->orderLength = 0;
+
+    taFileRequest* pRequests[6];
+    taTestAsyncRequestData requestData[6];
+    for (int iRequest = 0; iRequest < 6; ++iRequest) {
+        requestData[iRequest].pState = pState;
+        requestData[iRequest].iFile  = 0;
+        requestData[iRequest].name   = names[iRequest];
+        pRequests[iRequest] = taOpenFileAsync(pState->pFS, pState->pPaths[0], 0, priorities[iRequest], taTestAsyncOnCompleteOrdered, &requestData[iRequest]);
+        if (pRequests[iRequest] == NULL) {
+            taTestFail(pContext, "async: taOpenFileAsync() failed");
+            return;     // <-- Can't clean up without releasing the gate, which isn't safe if it hasn't been started.
+        }
+
+        if (iRequest == 0) {
+            taSemaphoreWait(&pState->startedSemaphore);
+        }
+    }
+
+    taSetFileRequestPriority(pRequests[5], TA_FILE_REQUEST_PRIORITY_HIGH + 1);
+    taCancelFileRequest(pRequests[4]);
+    if (taIsFileRequestComplete(pRequests[1])) {
+        taTestFail(pContext, "async: a request completed while the only I/O thread was busy");
+    }
+
+    taSemaphoreRelease(&pState->gateSemaphore);
+    for (int iRequest = 0; iRequest < 6; ++iRequest) {
+        if (iRequest != 4) {
+            taCloseFile(taFinishFileRequest(pRequests[iRequest]));
+        }
+    }
+
+    if (pState->orderLength != 4 || memcmp(pState->order, "ecba", 4) != 0) {
+        taTestFail(pContext, "async: requests were started in the order \"%.*s\" instead of \"ecba\"", (int)taTestMin(pState->orderLength, sizeof(pState->order)), pState->order);
+    }
+}
+
+// Several threads submit, poll, finish and cancel requests for random files at once, while the number of I/O threads is changed
+// underneath them. Every file that comes back needs to match what taOpenFile() loads.
+TA_PRIVATE void taTestAsync(taTestContext* pContext)
+{
+    taTestAsyncState state;
+    taZeroObject(&state);
+
+    state.pFS = taTestCreateFileSystem();
+    if (state.pFS == NULL) {
+        return;
+    }
+
+    if (!taSemaphoreInit(&state.startedSemaphore, 0) || !taSemaphoreInit(&state.gateSemaphore, 0)) {
+        taTestFail(pContext, "async: failed to create the semaphores");
+        taDeleteFileSystem(state.pFS);
+        return;
+    }
+
+    // Small files are preferred so the queue gets a lot of traffic.
+    for (taUInt32 iAttempt = 0; iAttempt < 1000 && state.fileCount < TA_TEST_ASYNC_FILE_COUNT && state.pFS->index.entryCount > 0; ++iAttempt) {
+        const taFSIndexEntry* pEntry = &state.pFS->index.pEntries[taTestRandomRange(pContext, state.pFS->index.entryCount)];
+        if (pEntry->dataSize > 1024*1024 && iAttempt < 900) {
+            continue;
+        }
+
+        const char* path = state.pFS->index.pPaths + pEntry->pathOffset;
+        taFile* pFile = taOpenFile(state.pFS, path, 0);
+        if (pFile != NULL) {
+            state.pPaths[state.fileCount] = path;
+            state.pExpectedFiles[state.fileCount] = pFile;
+            state.fileCount += 1;
+        }
+    }
+
+    state.pPaths[state.fileCount] = "does/not/exist";
+    state.pExpectedFiles[state.fileCount] = NULL;
+
+    if (state.fileCount == 0) {
+        taTestFail(pContext, "async: no files could be opened");
+        goto done;
+    }
+
+    taTestAsyncOrder(pContext, &state);
+
+    // The stress test.
+    taTimer timer;
+    taTimerInit(&timer);
+
+    state.roundCount = (pContext->iterations / 1000) + 1;
+    taFSSetIOThreadCount(state.pFS, 0);
+
+    taTestAsyncSubmitter submitters[TA_TEST_ASYNC_SUBMITTER_COUNT];
+    taUInt32 submitterCount = 0;
+    for (taUInt32 iSubmitter = 0; iSubmitter < TA_TEST_ASYNC_SUBMITTER_COUNT; ++iSubmitter) {
+        submitters[submitterCount].pState = &state;
+        submitters[submitterCount].context = *pContext;
+        submitters[submitterCount].context.seed = taTestRandom(pContext) | 1;
+        if (taCreateThread(&submitters[submitterCount].thread, taTestAsyncSubmitterEntry, &submitters[submitterCount])) {
+            submitterCount += 1;
+        }
+    }
+
+    for (taUInt32 threadCount = 1; threadCount <= 5; threadCount += 2) {
+        taFSSetIOThreadCount(state.pFS, threadCount);
+    }
+
+    for (taUInt32 iSubmitter = 0; iSubmitter < submitterCount; ++iSubmitter) {
+        taWaitForThread(&submitters[iSubmitter].thread);
+    }
+
+    if (submitterCount == 0) {
+        taTestFail(pContext, "async: failed to create the submitter threads");
+    }
+
+    if (state.failCount > 0) {
+        taTestFail(pContext, "async: %u requests came back with the wrong file", state.failCount);
+    }
+
+    if (pContext->bench) {
+        printf("  %-24s %8.1f ms (%u submitters x %u rounds)\n", "stress", taTimerTick(&timer)*1000, submitterCount, state.roundCount);
+    }
+
+done:
+    for (taUInt32 iFile = 0; iFile < state.fileCount; ++iFile) {
+        taCloseFile(state.pExpectedFiles[iFile]);
+    }
+
+    taDeleteFileSystem(state.pFS);
+    taSemaphoreUninit(&state.gateSemaphore);
+    taSemaphoreUninit(&state.startedSemaphore);
+}
+
+//// Features Library ////
+
+// The lookup paths of the features library are switched by hiding the indexes from it.
+typedef enum
+{
+    taTestFeatureLookupHash,
+    taTestFeatureLookupSorted,
+    taTestFeatureLookupLinear
+} taTestFeatureLookup;
+
+TA_PRIVATE taFeatureDesc* taTestFindFeatureDesc(taFeaturesLibrary* pLib, const char* name, taTestFeatureLookup lookup)
+{
+    taFeatureSlot* pSlots = pLib->pSlots;
+    taBool32 isOptimized = pLib->isOptimized;
+    if (lookup != taTestFeatureLookupHash) {
+        pLib->pSlots = NULL;
+    }
+    if (lookup == taTestFeatureLookupLinear) {
+        pLib->isOptimized = TA_FALSE;
+    }
+
+    taFeatureDesc* pDesc = taFindFeatureDesc(pLib, name);
+
+    pLib->pSlots = pSlots;
+    pLib->isOptimized = isOptimized;
+    return pDesc;
+}
+
+// Every feature name is looked up as it is, in upper and lower case, and with a random change that mostly makes it miss. The hash
+// index and the sorted names both need to find the same feature as the linear search, which is the first one loaded with that name.
+TA_PRIVATE void taTestFeatures(taTestContext* pContext)
+{
+    static const char* s_lookupNames[] = {"hash", "sorted", "linear"};
+
+    taFS* pFS = taTestCreateFileSystem();
+    if (pFS == NULL) {
+        return;
+    }
+
+    taFeaturesLibrary* pLib = taCreateFeaturesLibrary(pFS);
+    if (pLib == NULL) {
+        taTestFail(pContext, "features: failed to create the library");
+        taDeleteFileSystem(pFS);
+        return;
+    }
+
+    if (pLib->pSlots == NULL || pLib->pSortedNames == NULL) {
+        taTestFail(pContext, "features: the library has not been indexed");
+    }
+
+    // Nothing has been looked up yet so the text of every feature should be empty, but never null.
+    for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+        const taFeatureDesc* pDesc = &pLib->pFeatures[iFeature];
+        if (pLib->pSources[iFeature].state == TA_FEATURE_STATE_NOT_LOADED && (taFeatureDescGetFilename(pDesc)[0] != '\0' || taFeatureDescGetObject(pDesc)[0] != '\0')) {
+            taTestFail(pContext, "features: %s has text before it was loaded", taFeatureDescGetName(pDesc));
+        }
+    }
+
+    taUInt32 checkCount = (pLib->featuresCount < pContext->iterations) ? pLib->featuresCount : pContext->iterations;
+    for (taUInt32 iCheck = 0; iCheck < checkCount; ++iCheck) {
+        taUInt32 iFeature = (checkCount == pLib->featuresCount) ? iCheck : taTestRandomRange(pContext, pLib->featuresCount);
+
+        char names[4][256];
+        if (ta_strcpy_s(names[0], sizeof(names[0]), taFeatureDescGetName(&pLib->pFeatures[iFeature])) != 0) {
+            continue;
+        }
+
+        size_t length = strlen(names[0]);
+        for (size_t i = 0; i <= length; ++i) {
+            names[1][i] = (char)toupper((unsigned char)names[0][i]);
+            names[2][i] = (char)tolower((unsigned char)names[0][i]);
+            names[3][i] = names[0][i];
+        }
+
+        switch (taTestRandomRange(pContext, 3)) {
+            case 0: if (length > 0) names[3][taTestRandomRange(pContext, (taUInt32)length)] = (char)('a' + taTestRandomRange(pContext, 26)); break;
+            case 1: names[3][taTestRandomRange(pContext, (taUInt32)length + 1)] = '\0'; break;
+            default: if (length + 1 < sizeof(names[3])) { names[3][length] = 'x'; names[3][length + 1] = '\0'; } break;
+        }
+
+        for (int iName = 0; iName < 4; ++iName) {
+            taFeatureDesc* pExpected = taTestFindFeatureDesc(pLib, names[iName], taTestFeatureLookupLinear);
+            if (iName < 3 && pExpected == NULL && pLib->pSources[iFeature].state != TA_FEATURE_STATE_MISSING) {
+                taTestFail(pContext, "features: \"%s\" was not found", names[iName]);
+            }
+
+            for (int iLookup = taTestFeatureLookupHash; iLookup < taTestFeatureLookupLinear; ++iLookup) {
+                taFeatureDesc* pActual = taTestFindFeatureDesc(pLib, names[iName], (taTestFeatureLookup)iLookup);
+                if (pActual != pExpected) {
+                    taTestFail(pContext, "features: \"%s\" found feature %d with the %s lookup instead of %d", names[iName], (pActual != NULL) ? (int)(pActual - pLib->pFeatures) : -1, s_lookupNames[iLookup], (pExpected != NULL) ? (int)(pExpected - pLib->pFeatures) : -1);
+                }
+            }
+        }
+    }
+
+    if (pContext->bench && pLib->featuresCount > 0) {
+        // Load everything first so only the lookups themselves are timed.
+        for (taUInt32 iFeature = 0; iFeature < pLib->featuresCount; ++iFeature) {
+            taTestFindFeatureDesc(pLib, taFeatureDescGetName(&pLib->pFeatures[iFeature]), taTestFeatureLookupHash);
+        }
+
+        for (int iLookup = taTestFeatureLookupHash; iLookup <= taTestFeatureLookupLinear; ++iLookup) {
+            taUInt32 lookupCount = (iLookup == taTestFeatureLookupLinear) ? 2000 : 200000;
+            taTimer timer;
+            taTimerInit(&timer);
+            for (taUInt32 iName = 0; iName < lookupCount; ++iName) {
+                taTestFindFeatureDesc(pLib, taFeatureDescGetName(&pLib->pFeatures[(iName * 2654435761u) % pLib->featuresCount]), (taTestFeatureLookup)iLookup);
+            }
+            printf("  %-24s %8.0f lookups/s\n", s_lookupNames[iLookup], lookupCount / taTimerTick(&timer));
+        }
+    }
+
+    taDeleteFeaturesLibrary(pLib);
+    taDeleteFileSystem(pFS);
+}
+
+//// Property Manager ////
+
+// What a property is expected to hold. The string is what taPropertyManagerGet() should return.
+typedef struct
+{
+    taUInt32 type;
+    char str[64];
+    int i;
+    float f;
+    taBool32 b;
+    taPropertyHandle handle;
+} taTestProperty;
+
+TA_PRIVATE void taTestPropertyMakeExpected(taTestProperty* pExpected)
+{
+    switch (pExpected->type)
+    {
+        case TA_PROPERTY_TYPE_STRING:
+        {
+            pExpected->i = atoi(pExpected->str);
+            pExpected->f = (float)atof(pExpected->str);
+            pExpected->b = !(strcmp(pExpected->str, "0") == 0 || _stricmp(pExpected->str, "false") == 0);
+        } break;
+
+        case TA_PROPERTY_TYPE_INT:
+        {
+            snprintf(pExpected->str, sizeof(pExpected->str), "%d", pExpected->i);
+            pExpected->f = (float)pExpected->i;
+            pExpected->b = pExpected->i != 0;
+        } break;
+
+        case TA_PROPERTY_TYPE_FLOAT:
+        {
+            snprintf(pExpected->str, sizeof(pExpected->str), "%f", pExpected->f);
+            pExpected->i = (int)pExpected->f;
+            pExpected->b = pExpected->f != 0;
+        } break;
+
+        case TA_PROPERTY_TYPE_BOOL:
+        {
+            ta_strcpy_s(pExpected->str, sizeof(pExpected->str), (pExpected->b) ? "true" : "false");
+            pExpected->i = (pExpected->b) ? 1 : 0;
+            pExpected->f = (pExpected->b) ? 1.0f : 0.0f;
+        } break;
+
+        default:
+        {
+            pExpected->str[0] = '\0';
+            pExpected->i = 0;
+            pExpected->f = 0;
+            pExpected->b = TA_FALSE;
+        } break;
+    }
+}
+
+// Checks a property through its key and through its handle.
+TA_PRIVATE void taTestPropertyCheck(taTestContext* pContext, taPropertyManager* pProperties, taUInt32 iKey, const taTestProperty* pExpected)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "test.key%u", iKey);
+
+    taPropertyHandle handle = taPropertyManagerGetHandle(pProperties, key);
+    if (handle == 0 || (pExpected->handle != 0 && handle != pExpected->handle)) {
+        taTestFail(pContext, "properties: %s has handle %u instead of %u", key, handle, pExpected->handle);
+        return;
+    }
+
+    taUInt32 type = taPropertyManagerGetTypeByHandle(pProperties, handle);
+    if (type != pExpected->type) {
+        taTestFail(pContext, "properties: %s has type %u instead of %u", key, type, pExpected->type);
+    }
+
+    const char* str[3];
+    str[0] = taPropertyManagerGet(pProperties, key);
+    str[1] = taPropertyManagerGetF(pProperties, "test.key%u", iKey);
+    str[2] = taPropertyManagerGetByHandle(pProperties, handle);
+    for (int iStr = 0; iStr < 3; ++iStr) {
+        if ((pExpected->type == TA_PROPERTY_TYPE_NONE) ? (str[iStr] != NULL) : (str[iStr] == NULL || strcmp(str[iStr], pExpected->str) != 0)) {
+            taTestFail(pContext, "properties: %s is \"%s\" instead of \"%s\"", key, (str[iStr] != NULL) ? str[iStr] : "(null)", pExpected->str);
+        }
+    }
+
+    if (taPropertyManagerGetInt(pProperties, key) != pExpected->i || taPropertyManagerGetIntByHandle(pProperties, handle) != pExpected->i) {
+        taTestFail(pContext, "properties: %s is not %d as an int", key, pExpected->i);
+    }
+    if (taPropertyManagerGetFloat(pProperties, key) != pExpected->f || taPropertyManagerGetFloatByHandle(pProperties, handle) != pExpected->f) {
+        taTestFail(pContext, "properties: %s is not %f as a float", key, pExpected->f);
+    }
+    if (taPropertyManagerGetBool(pProperties, key) != pExpected->b || taPropertyManagerGetBoolByHandle(pProperties, handle) != pExpected->b) {
+        taTestFail(pContext, "properties: %s is not %s as a bool", key, (pExpected->b) ? "true" : "false");
+    }
+}
+
+// Properties are set, overwritten with other types and unset at random, and each one is checked against what it should hold after
+// every change. Some handles are taken before their property is ever set, and none of them are allowed to change.
+TA_PRIVATE void taTestProperties(taTestContext* pContext)
+{
+    static const char* s_strings[] = {"", "0", "1", "00", "false", "FALSE", "true", "12", "-7", "1.5", "abc"};
+    const taUInt32 keyCount = 200;
+
+    taTestProperty* pExpected = (taTestProperty*)calloc(keyCount, sizeof(*pExpected));
+    if (pExpected == NULL) {
+        taTestFail(pContext, "properties: out of memory");
+        return;
+    }
+
+    taPropertyManager properties;
+    taPropertyManagerInit(&properties);
+
+    for (taUInt32 iKey = 0; iKey < keyCount; iKey += 2) {
+        char key[32];
+        snprintf(key, sizeof(key), "test.key%u", iKey);
+        pExpected[iKey].handle = taPropertyManagerGetHandle(&properties, key);
+    }
+
+    // Looking up a property that was never added must not add it.
+    taUInt32 propertyCount = properties.count;
+    if (taPropertyManagerGet(&properties, "test.missing") != NULL || taPropertyManagerGetBool(&properties, "test.missing") || properties.count != propertyCount) {
+        taTestFail(pContext, "properties: looking up a missing property changed the manager");
+    }
+
+    for (taUInt32 iteration = 0; iteration < pContext->iterations; ++iteration) {
+        taUInt32 iKey = taTestRandomRange(pContext, keyCount);
+        char key[32];
+        snprintf(key, sizeof(key), "test.key%u", iKey);
+
+        taTestProperty* pProperty = &pExpected[iKey];
+        taResult result = TA_SUCCESS;
+        switch (taTestRandomRange(pContext, 7))
+        {
+            case 0:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_STRING;
+                ta_strcpy_s(pProperty->str, sizeof(pProperty->str), s_strings[taTestRandomRange(pContext, taCountOf(s_strings))]);
+                result = taPropertyManagerSet(&properties, key, pProperty->str);
+            } break;
+
+            case 1:
+            {
+                // Strings of any length so that the storage of a property is both reused and grown.
+                taUInt32 length = taTestRandomRange(pContext, sizeof(pProperty->str));
+                for (taUInt32 i = 0; i < length; ++i) {
+                    pProperty->str[i] = (char)('0' + taTestRandomRange(pContext, 43));
+                }
+                pProperty->str[length] = '\0';
+
+                pProperty->type = TA_PROPERTY_TYPE_STRING;
+                result = taPropertyManagerSet(&properties, key, pProperty->str);
+            } break;
+
+            case 2:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_INT;
+                pProperty->i = (int)taTestRandom(pContext);
+                result = taPropertyManagerSetInt(&properties, key, pProperty->i);
+            } break;
+
+            case 3:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_FLOAT;
+                pProperty->f = ((int)taTestRandomRange(pContext, 20001) - 10000) / 64.0f;
+                result = taPropertyManagerSetFloat(&properties, key, pProperty->f);
+            } break;
+
+            case 4:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_BOOL;
+                pProperty->b = taTestRandomRange(pContext, 2);
+                result = taPropertyManagerSetBool(&properties, key, (pProperty->b) ? 7 : 0);     // <-- Any non-zero value is true.
+            } break;
+
+            case 5:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_NONE;
+                result = taPropertyManagerUnset(&properties, key);
+            } break;
+
+            default:
+            {
+                pProperty->type = TA_PROPERTY_TYPE_NONE;
+                result = taPropertyManagerSet(&properties, key, NULL);
+            } break;
+        }
+
+        if (result != TA_SUCCESS) {
+            taTestFail(pContext, "properties: failed to change %s", key);
+        }
+
+        taTestPropertyMakeExpected(pProperty);
+        taTestPropertyCheck(pContext, &properties, iKey, pProperty);
+        if (pProperty->handle == 0) {
+            pProperty->handle = taPropertyManagerGetHandle(&properties, key);
+        }
+
+        // Every now and then make sure nothing else was disturbed.
+        if ((iteration % 1024) == 1023) {
+            for (taUInt32 iOtherKey = 0; iOtherKey < keyCount; ++iOtherKey) {
+                taTestPropertyCheck(pContext, &properties, iOtherKey, &pExpected[iOtherKey]);
+            }
+        }
+    }
+
+    for (taUInt32 iKey = 0; iKey < keyCount; ++iKey) {
+        taTestPropertyCheck(pContext, &properties, iKey, &pExpected[iKey]);
+    }
+
+    if (pContext->bench) {
+        const taUInt32 lookupCount = 1000000;
+        taPropertyManagerSetBool(&properties, "test.key0", TA_TRUE);
+
+        taPropertyHandle handle = taPropertyManagerGetHandle(&properties, "test.key0");
+        taUInt32 trueCount = 0;
+
+        taTimer timer;
+        taTimerInit(&timer);
+        for (taUInt32 iLookup = 0; iLookup < lookupCount; ++iLookup) {
+            trueCount += taPropertyManagerGetBool(&properties, "test.key0");
+        }
+        double keySeconds = taTimerTick(&timer);
+
+        for (taUInt32 iLookup = 0; iLookup < lookupCount; ++iLookup) {
+            trueCount += taPropertyManagerGetBoolByHandle(&properties, handle);
+        }
+        double handleSeconds = taTimerTick(&timer);
+
+        if (trueCount != lookupCount*2) {
+            taTestFail(pContext, "properties: %u of %u lookups failed", lookupCount*2 - trueCount, lookupCount*2);
+        }
+
+        printf("  %-24s %8.0f lookups/s\n", "key", lookupCount / keySeconds);
+        printf("  %-24s %8.0f lookups/s\n", "handle", lookupCount / handleSeconds);
+    }
+
+    taPropertyManagerUninit(&properties);
+    free(pExpected);
+}
+
+typedef struct
+{
+    const char* name;
+    taTestProc proc;
+} taTest;
+
+TA_PRIVATE taTest g_Tests[] = {
+    {"decrypt",    taTestDecrypt},
+    {"lz77",       taTestLZ77},
+    {"config",     taTestConfig},
+    {"packer",     taTestPacker},
+    {"index",      taTestIndex},
+    {"chunks",     taTestChunks},
+    {"pack",       taTestPack},
+    {"async",      taTestAsync},
+    {"features",   taTestFeatures},
+    {"properties", taTestProperties}
+};
+
+int main(int argc, char** argv)
+{
+    taTestContext context;
+    taZeroObject(&context);
+    context.seed = 0x12345678;
+    context.iterations = 10000;
+
+    const char** ppTestNames = (const char**)malloc(((argc > 1) ? argc : 1) * sizeof(*ppTestNames));
+    if (ppTestNames == NULL) {
+        return TA_OUT_OF_MEMORY;
+    }
+
+    taUInt32 testNameCount = 0;
+    for (int iArg = 1; iArg < argc; ++iArg) {
+        if (strcmp(argv[iArg], "-seed") == 0 && iArg+1 < argc) {
+            context.seed = (taUInt32)strtoul(argv[++iArg], NULL, 0);
+            if (context.seed == 0) {
+                context.seed = 1;   // <-- xorshift gets stuck on 0.
+            }
+        } else if (strcmp(argv[iArg], "-iterations") == 0 && iArg+1 < argc) {
+            context.iterations = (taUInt32)strtoul(argv[++iArg], NULL, 0);
+        } else if (strcmp(argv[iArg], "-bench") == 0) {
+            context.bench = TA_TRUE;
+        } else {
+            ppTestNames[testNameCount++] = argv[iArg];
+        }
+    }
+
+    for (taUInt32 iTest = 0; iTest < taCountOf(g_Tests); ++iTest) {
+        taBool32 isSelected = (testNameCount == 0);
+        for (taUInt32 iName = 0; iName < testNameCount; ++iName) {
+            if (_stricmp(ppTestNames[iName], g_Tests[iTest].name) == 0) {
+                isSelected = TA_TRUE;
+            }
+        }
+
+        if (isSelected) {
+            taUInt32 prevFailCount = context.failCount;
+            printf("%s\n", g_Tests[iTest].name);
+            g_Tests[iTest].proc(&context);
+            printf("  %s\n", (context.failCount == prevFailCount) ? "passed" : "FAILED");
+        }
+    }
+
+    free(ppTestNames);
+    return (int)context.failCount;
+}